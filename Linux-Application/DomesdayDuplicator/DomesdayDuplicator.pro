@@ -47,7 +47,16 @@ SOURCES += \
     playercommunication.cpp \
     playercontrol.cpp \
     automaticcapturedialog.cpp \
-    advancednamingdialog.cpp
+    advancednamingdialog.cpp \
+    capturelog.cpp \
+    storagemonitor.cpp \
+    throughputmonitor.cpp \
+    threadtuning.cpp \
+    capturetimeline.cpp \
+    transfercalibration.cpp \
+    capturebench.cpp \
+    crc32c.cpp \
+    capturemanifest.cpp
 
 HEADERS += \
         mainwindow.h \
@@ -60,7 +69,16 @@ HEADERS += \
     playercommunication.h \
     playercontrol.h \
     automaticcapturedialog.h \
-    advancednamingdialog.h
+    advancednamingdialog.h \
+    capturelog.h \
+    storagemonitor.h \
+    throughputmonitor.h \
+    threadtuning.h \
+    capturetimeline.h \
+    transfercalibration.h \
+    capturebench.h \
+    crc32c.h \
+    capturemanifest.h
 
 FORMS += \
         mainwindow.ui \
@@ -0,0 +1,245 @@
+/************************************************************************
+
+    capturebench.cpp
+
+    Capture application for the Domesday Duplicator
+    DomesdayDuplicator - LaserDisc RF sampler
+    Copyright (C) 2018-2019 Simon Inns
+
+    This file is part of Domesday Duplicator.
+
+    Domesday Duplicator is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+
+#include "capturebench.h"
+#include "capturelog.h"
+#include "capturetimeline.h"
+#include "capturemanifest.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+
+// The device delivers 40 MSPS of 16-bit samples - the bench passes if at least BENCHMINIMUMRATE
+// of this rate is sustained, with no more than BENCHMAXIMUMOCCUPANCY disk buffers ever waiting
+// to be written (half of the disk buffers)
+#define BENCHDEVICERATE (40000000.0 * 2.0)
+#define BENCHMINIMUMRATE 0.98
+#define BENCHMAXIMUMOCCUPANCY 2.0
+
+// Class constructor
+CaptureBench::CaptureBench(QObject *parent, UsbDevice *usbDeviceParam) : QObject(parent)
+{
+    usbDevice = usbDeviceParam;
+    isBenchRunning = false;
+    isStopping = false;
+    lastError = tr("None");
+
+    benchTimer = new QTimer(this);
+    connect(benchTimer, &QTimer::timeout, this, &CaptureBench::benchTimerSignalHandler);
+}
+
+// Start the bench - streams test data through the capture pipeline to a file in the given
+// directory for durationSeconds.  With isSynthetic set no USB device is needed.
+bool CaptureBench::start(QString directory, bool isCaptureFormat10Bit, bool isCaptureFormat10BitDecimated,
+                         qint32 durationSeconds, bool isSynthetic)
+{
+    if (isBenchRunning) return false;
+
+    if (usbDevice->isCaptureRunning() || usbDevice->isTransferCalibrationRunning()) {
+        lastError = tr("A capture or USB transfer calibration is already running");
+        return false;
+    }
+
+    if (durationSeconds < 1) {
+        lastError = tr("The bench must run for at least a second");
+        return false;
+    }
+
+    // Reset the result
+    result = CaptureBenchResult();
+    result.isSynthetic = isSynthetic;
+    result.durationSeconds = durationSeconds;
+    result.isPassed = false;
+
+    // Bench the same format the captures use
+    QString suffix = ".raw";
+    if (isCaptureFormat10Bit) suffix = isCaptureFormat10BitDecimated ? ".cds" : ".lds";
+    benchFilename = QDir(directory).filePath(QString("DomesdayDuplicator-bench-%1").arg(QCoreApplication::applicationPid()) + suffix);
+
+    qDebug() << "CaptureBench::start(): Starting a" << durationSeconds << "second bench to" << benchFilename <<
+                (isSynthetic ? "using the synthetic source" : "using the USB device");
+
+    // The bench verifies the device's test data ramp
+    if (!isSynthetic) usbDevice->sendConfigurationCommand(true);
+    usbDevice->setSyntheticSource(isSynthetic);
+
+    connect(usbDevice, &UsbDevice::transferFailed, this, &CaptureBench::transferFailedSignalHandler, Qt::UniqueConnection);
+    connect(usbDevice, &UsbDevice::captureFinished, this, &CaptureBench::captureFinishedSignalHandler, Qt::UniqueConnection);
+
+    isBenchRunning = true;
+    isStopping = false;
+    usbDevice->startCapture(benchFilename, isCaptureFormat10Bit, isCaptureFormat10BitDecimated, true);
+
+    benchElapsedTimer.start();
+    benchTimer->start(1000);
+    emit benchProgress(0, durationSeconds);
+
+    return true;
+}
+
+// Stop the bench early (the result covers the time run so far)
+void CaptureBench::stop(void)
+{
+    if (!isBenchRunning || isStopping) return;
+
+    qDebug() << "CaptureBench::stop(): Stopping the bench capture";
+    isStopping = true;
+    benchTimer->stop();
+    usbDevice->stopCapture();
+}
+
+// Returns true if the bench is running
+bool CaptureBench::isRunning(void)
+{
+    return isBenchRunning;
+}
+
+// Get the result of the last bench
+CaptureBenchResult CaptureBench::getResult(void)
+{
+    return result;
+}
+
+// Get the last error
+QString CaptureBench::getLastError(void)
+{
+    return lastError;
+}
+
+// Get a readable report of the last bench
+QString CaptureBench::getReport(void)
+{
+    const CaptureStageStatistics &stageStatistics = result.stageStatistics;
+    QString report;
+
+    report += tr("Capture bench: %1 seconds from the %2\n")
+            .arg(result.durationSeconds).arg(result.isSynthetic ? tr("synthetic source") : tr("USB device"));
+    if (result.isPassed) report += tr("Result: PASSED\n");
+    else report += tr("Result: FAILED - %1\n").arg(result.failureReason);
+
+    report += tr("Sustained input: %1 MB/s (the device delivers %2 MB/s)\n")
+            .arg(result.inputRate, 0, 'f', 1).arg(BENCHDEVICERATE / 1000000.0, 0, 'f', 1);
+    report += tr("Disk writes: %1 MB/s\n").arg(result.writeRate, 0, 'f', 1);
+    report += tr("CPU: transfer completion %1%, disk writer %2% (of which conversion %3%)\n")
+            .arg(result.completionCpuLoad, 0, 'f', 1).arg(result.writerCpuLoad, 0, 'f', 1).arg(result.conversionLoad, 0, 'f', 1);
+    report += tr("Peak disk buffer occupancy: %1 disk buffers\n").arg(stageStatistics.peakRingOccupancy, 0, 'f', 2);
+    report += tr("Transfer completions: mean interval %1 mS, jitter %2 mS, longest interval %3 mS\n")
+            .arg(stageStatistics.meanCompletionInterval, 0, 'f', 2).arg(stageStatistics.completionJitter, 0, 'f', 2)
+            .arg(stageStatistics.maximumCompletionInterval, 0, 'f', 2);
+    if (stageStatistics.startLatency >= 0.0)
+        report += tr("Capture start: first transfer %1 mS after the request\n").arg(stageStatistics.startLatency, 0, 'f', 1);
+    report += tr("Gaps: %1").arg(stageStatistics.numberOfGaps);
+
+    return report;
+}
+
+// Bench timer signal handler (once a second)
+void CaptureBench::benchTimerSignalHandler(void)
+{
+    qint32 secondsElapsed = static_cast<qint32>(benchElapsedTimer.elapsed() / 1000);
+    emit benchProgress(qMin(secondsElapsed, result.durationSeconds), result.durationSeconds);
+
+    if (secondsElapsed >= result.durationSeconds) stop();
+}
+
+// Transfer failed signal handler
+void CaptureBench::transferFailedSignalHandler(void)
+{
+    qDebug() << "CaptureBench::transferFailedSignalHandler(): The bench capture failed";
+    if (result.failureReason.isEmpty()) result.failureReason = usbDevice->getLastError();
+
+    // If the capture never started there's nothing to wait for
+    if (!usbDevice->isCaptureRunning()) {
+        result.stageStatistics = CaptureStageStatistics();
+        finishBench();
+        return;
+    }
+
+    stop();
+}
+
+// Capture finished signal handler
+void CaptureBench::captureFinishedSignalHandler(void)
+{
+    result.stageStatistics = usbDevice->getCaptureStageStatistics();
+    finishBench();
+}
+
+// Calculate the result and clean up
+void CaptureBench::finishBench(void)
+{
+    if (!isBenchRunning) return;
+    isBenchRunning = false;
+    benchTimer->stop();
+
+    disconnect(usbDevice, &UsbDevice::transferFailed, this, &CaptureBench::transferFailedSignalHandler);
+    disconnect(usbDevice, &UsbDevice::captureFinished, this, &CaptureBench::captureFinishedSignalHandler);
+    usbDevice->setSyntheticSource(false);
+
+    const CaptureStageStatistics &stageStatistics = result.stageStatistics;
+    // The rates are measured while data was arriving and being written (not while the capture
+    // started and the disk buffers drained)
+    if (stageStatistics.receiveTime > 0.0)
+        result.inputRate = static_cast<double>(stageStatistics.bytesReceived) / stageStatistics.receiveTime / 1000000.0;
+    if (stageStatistics.writeTime > 0.0)
+        result.writeRate = static_cast<double>(stageStatistics.bytesWritten) / stageStatistics.writeTime / 1000000.0;
+    if (stageStatistics.captureTime > 0.0) {
+        result.completionCpuLoad = stageStatistics.completionCpuTime / stageStatistics.captureTime * 100.0;
+        result.writerCpuLoad = stageStatistics.writerCpuTime / stageStatistics.captureTime * 100.0;
+        result.conversionLoad = stageStatistics.conversionTime / stageStatistics.captureTime * 100.0;
+    }
+
+    // Decide if the host has enough headroom
+    if (!result.failureReason.isEmpty() || !stageStatistics.isSuccessful) {
+        if (result.failureReason.isEmpty()) result.failureReason = tr("The capture failed");
+    } else if (stageStatistics.numberOfGaps > 0) {
+        result.failureReason = tr("Data was dropped following a disk buffer overflow");
+    } else if (result.inputRate * 1000000.0 < BENCHDEVICERATE * BENCHMINIMUMRATE) {
+        result.failureReason = tr("The data rate was not sustained");
+    } else if (stageStatistics.peakRingOccupancy > BENCHMAXIMUMOCCUPANCY) {
+        result.failureReason = tr("Disk writes fell too far behind (peak of %1 disk buffers waiting)")
+                .arg(stageStatistics.peakRingOccupancy, 0, 'f', 2);
+    } else {
+        result.isPassed = true;
+    }
+
+    removeBenchFiles();
+
+    qDebug() << "CaptureBench::finishBench(): Bench complete -" << (result.isPassed ? "passed" : "failed");
+    emit benchComplete(result.isPassed);
+}
+
+// Remove the bench capture and its log, timeline and manifest
+void CaptureBench::removeBenchFiles(void)
+{
+    QFile::remove(benchFilename);
+    QFile::remove(CaptureLog::logFilename(benchFilename));
+    QFile::remove(CaptureTimeline::timelineFilename(benchFilename));
+    QFile::remove(CaptureManifest::manifestFilename(benchFilename));
+}
@@ -0,0 +1,93 @@
+/************************************************************************
+
+    capturebench.h
+
+    Capture application for the Domesday Duplicator
+    DomesdayDuplicator - LaserDisc RF sampler
+    Copyright (C) 2018-2019 Simon Inns
+
+    This file is part of Domesday Duplicator.
+
+    Domesday Duplicator is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+
+#ifndef CAPTUREBENCH_H
+#define CAPTUREBENCH_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QDebug>
+
+#include "usbdevice.h"
+
+// The outcome of a capture bench run
+struct CaptureBenchResult {
+    bool isSynthetic;               // True if the synthetic source replaced the USB device
+    qint32 durationSeconds;         // Requested length of the run
+    CaptureStageStatistics stageStatistics;
+    double inputRate;               // Sustained rate data was received (Mbytes/second)
+    double writeRate;               // Rate the capture file was written while writing (Mbytes/second)
+    double completionCpuLoad;       // CPU used accounting for completed transfers (% of one CPU)
+    double writerCpuLoad;           // CPU used by the disk writer thread (% of one CPU)
+    double conversionLoad;          // Time spent converting samples (% of the capture time)
+    bool isPassed;                  // True if the host sustained the device's data rate with headroom
+    QString failureReason;
+};
+
+// Streams the device's test data (or a synthetic ramp) through the full capture pipeline -
+// verification, conversion and disk writes - for a fixed time and reports whether the host can
+// sustain 40 MSPS in the chosen format.  The bench file is removed afterwards.
+class CaptureBench : public QObject
+{
+    Q_OBJECT
+public:
+    explicit CaptureBench(QObject *parent = nullptr, UsbDevice *usbDeviceParam = nullptr);
+
+    bool start(QString directory, bool isCaptureFormat10Bit, bool isCaptureFormat10BitDecimated,
+               qint32 durationSeconds, bool isSynthetic);
+    void stop(void);
+    bool isRunning(void);
+    CaptureBenchResult getResult(void);
+    QString getReport(void);
+    QString getLastError(void);
+
+signals:
+    void benchProgress(qint32 secondsElapsed, qint32 durationSeconds);
+    void benchComplete(bool isPassed);
+
+private slots:
+    void benchTimerSignalHandler(void);
+    void transferFailedSignalHandler(void);
+    void captureFinishedSignalHandler(void);
+
+private:
+    UsbDevice *usbDevice;
+    QTimer *benchTimer;
+    QElapsedTimer benchElapsedTimer;
+    QString benchFilename;
+    bool isBenchRunning;
+    bool isStopping;
+    CaptureBenchResult result;
+    QString lastError;
+
+    void finishBench(void);
+    void removeBenchFiles(void);
+};
+
+#endif // CAPTUREBENCH_H
@@ -0,0 +1,71 @@
+/************************************************************************
+
+    capturelog.cpp
+
+    Capture application for the Domesday Duplicator
+    DomesdayDuplicator - LaserDisc RF sampler
+    Copyright (C) 2018-2019 Simon Inns
+
+    This file is part of Domesday Duplicator.
+
+    Domesday Duplicator is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#include "capturelog.h"
+
+// Class constructor - opens (and truncates) the log for the given capture file
+CaptureLog::CaptureLog(QString captureFilename)
+{
+    logFile.setFileName(logFilename(captureFilename));
+    if (!logFile.open(QFile::WriteOnly | QFile::Truncate | QFile::Text)) {
+        qDebug() << "CaptureLog::CaptureLog(): Could not open capture log" << logFile.fileName() << "for writing";
+        return;
+    }
+
+    append("Capture log for " + QFileInfo(captureFilename).fileName());
+}
+
+// Class destructor
+CaptureLog::~CaptureLog()
+{
+    if (logFile.isOpen()) logFile.close();
+}
+
+// Append a time-stamped line to the log
+void CaptureLog::append(QString message)
+{
+    QMutexLocker locker(&mutex);
+    if (!logFile.isOpen()) return;
+
+    QString line = QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss.zzz") + " " + message + "\n";
+    logFile.write(line.toUtf8());
+    logFile.flush();
+}
+
+// Returns true if the log file was opened successfully
+bool CaptureLog::isOpen(void)
+{
+    QMutexLocker locker(&mutex);
+    return logFile.isOpen();
+}
+
+// Return the log file name for a capture file (the capture name with a .log suffix)
+QString CaptureLog::logFilename(QString captureFilename)
+{
+    QFileInfo captureFileInfo(captureFilename);
+    return captureFileInfo.path() + "/" + captureFileInfo.completeBaseName() + ".log";
+}
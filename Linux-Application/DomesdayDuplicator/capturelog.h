@@ -0,0 +1,59 @@
+/************************************************************************
+
+    capturelog.h
+
+    Capture application for the Domesday Duplicator
+    DomesdayDuplicator - LaserDisc RF sampler
+    Copyright (C) 2018-2019 Simon Inns
+
+    This file is part of Domesday Duplicator.
+
+    Domesday Duplicator is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#ifndef CAPTURELOG_H
+#define CAPTURELOG_H
+
+#include <QString>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QMutex>
+#include <QDebug>
+
+// Per-capture log file written alongside the capture data (<capture name>.log)
+//
+// The log is appended to from both the disk writer thread and the GUI thread,
+// so all writes are serialised by a mutex.  Each line is flushed as it is
+// written so the log is complete even if the application is terminated.
+class CaptureLog
+{
+public:
+    explicit CaptureLog(QString captureFilename);
+    ~CaptureLog();
+
+    void append(QString message);
+    bool isOpen(void);
+
+    static QString logFilename(QString captureFilename);
+
+private:
+    QMutex mutex;
+    QFile logFile;
+};
+
+#endif // CAPTURELOG_H
@@ -0,0 +1,90 @@
+/************************************************************************
+
+    capturemanifest.cpp
+
+    Capture application for the Domesday Duplicator
+    DomesdayDuplicator - LaserDisc RF sampler
+    Copyright (C) 2018-2019 Simon Inns
+
+    This file is part of Domesday Duplicator.
+
+    Domesday Duplicator is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+
+#include "capturemanifest.h"
+
+// Class constructor - opens (and truncates) the manifest for the given capture file
+CaptureManifest::CaptureManifest(QString captureFilename)
+{
+    captureFileOffset = 0;
+
+    manifestFile.setFileName(manifestFilename(captureFilename));
+    if (!manifestFile.open(QFile::WriteOnly | QFile::Truncate | QFile::Text)) {
+        qDebug() << "CaptureManifest::CaptureManifest(): Could not open capture manifest" << manifestFile.fileName() << "for writing";
+        return;
+    }
+
+    QString header = "# Capture manifest for " + QFileInfo(captureFilename).fileName() + "\n" +
+            "# offset,length,crc32c\n";
+    manifestFile.write(header.toUtf8());
+    manifestFile.flush();
+
+    qDebug() << "CaptureManifest::CaptureManifest(): Checksums are" <<
+                (Crc32c::isHardwareAccelerated() ? "hardware accelerated" : "calculated in software");
+}
+
+// Class destructor
+CaptureManifest::~CaptureManifest()
+{
+    if (manifestFile.isOpen()) manifestFile.close();
+}
+
+// Checksum a block of data that has just been written to the capture file
+void CaptureManifest::append(const unsigned char *data, qint64 length)
+{
+    if (!manifestFile.isOpen() || length <= 0) return;
+
+    quint32 checksum = Crc32c::update(0, data, length);
+    QString line = QString("%1,%2,%3\n").arg(captureFileOffset).arg(length).arg(checksum, 8, 16, QChar('0'));
+    manifestFile.write(line.toUtf8());
+    manifestFile.flush();
+
+    captureFileOffset += length;
+}
+
+// Record the total size of the capture file and close the manifest
+void CaptureManifest::close(void)
+{
+    if (!manifestFile.isOpen()) return;
+
+    manifestFile.write(QString("total,%1\n").arg(captureFileOffset).toUtf8());
+    manifestFile.close();
+}
+
+// Returns true if the manifest file was opened successfully
+bool CaptureManifest::isOpen(void)
+{
+    return manifestFile.isOpen();
+}
+
+// Return the manifest file name for a capture file (the capture name with a .manifest suffix)
+QString CaptureManifest::manifestFilename(QString captureFilename)
+{
+    QFileInfo captureFileInfo(captureFilename);
+    return captureFileInfo.path() + "/" + captureFileInfo.completeBaseName() + ".manifest";
+}
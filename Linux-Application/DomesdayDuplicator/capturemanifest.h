@@ -0,0 +1,68 @@
+/************************************************************************
+
+    capturemanifest.h
+
+    Capture application for the Domesday Duplicator
+    DomesdayDuplicator - LaserDisc RF sampler
+    Copyright (C) 2018-2019 Simon Inns
+
+    This file is part of Domesday Duplicator.
+
+    Domesday Duplicator is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+
+#ifndef CAPTUREMANIFEST_H
+#define CAPTUREMANIFEST_H
+
+#include <QString>
+#include <QFile>
+#include <QFileInfo>
+#include <QDebug>
+
+#include "crc32c.h"
+
+// Per-capture checksum manifest written alongside the capture data (<capture name>.manifest)
+//
+// The disk writer checksums each block of data (CRC-32C) as it is written to the
+// capture file, while the data is still in the cache, and records it here.  A copy
+// of the capture can then be verified against the manifest (see dddutil) without
+// the original.  One comma-separated line is written per block:
+//
+//     <byte offset>,<length>,<CRC-32C in hex>
+//
+// followed, when the capture file is closed, by a line giving its total size:
+//
+//     total,<length>
+class CaptureManifest
+{
+public:
+    explicit CaptureManifest(QString captureFilename);
+    ~CaptureManifest();
+
+    void append(const unsigned char *data, qint64 length);
+    void close(void);
+    bool isOpen(void);
+
+    static QString manifestFilename(QString captureFilename);
+
+private:
+    QFile manifestFile;
+    qint64 captureFileOffset;
+};
+
+#endif // CAPTUREMANIFEST_H
@@ -0,0 +1,78 @@
+/************************************************************************
+
+    capturetimeline.cpp
+
+    Capture application for the Domesday Duplicator
+    DomesdayDuplicator - LaserDisc RF sampler
+    Copyright (C) 2018-2019 Simon Inns
+
+    This file is part of Domesday Duplicator.
+
+    Domesday Duplicator is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#include "capturetimeline.h"
+
+// Class constructor - opens (and truncates) the timeline for the given capture file
+CaptureTimeline::CaptureTimeline(QString captureFilename)
+{
+    lastIsTimeCode = false;
+    lastAddress = -1;
+
+    timelineFile.setFileName(timelineFilename(captureFilename));
+    if (!timelineFile.open(QFile::WriteOnly | QFile::Truncate | QFile::Text)) {
+        qDebug() << "CaptureTimeline::CaptureTimeline(): Could not open capture timeline" << timelineFile.fileName() << "for writing";
+        return;
+    }
+
+    QString header = "# Capture timeline for " + QFileInfo(captureFilename).fileName() + "\n" +
+            "# sample,type,address\n";
+    timelineFile.write(header.toUtf8());
+    timelineFile.flush();
+}
+
+// Class destructor
+CaptureTimeline::~CaptureTimeline()
+{
+    if (timelineFile.isOpen()) timelineFile.close();
+}
+
+// Append a player position to the timeline (repeated readings of the same position are ignored)
+void CaptureTimeline::append(qint64 samplePosition, bool isTimeCode, qint32 address)
+{
+    if (!timelineFile.isOpen()) return;
+    if (isTimeCode == lastIsTimeCode && address == lastAddress) return;
+    lastIsTimeCode = isTimeCode;
+    lastAddress = address;
+
+    QString line = QString("%1,%2,%3\n").arg(samplePosition).arg(isTimeCode ? "timecode" : "frame").arg(address);
+    timelineFile.write(line.toUtf8());
+    timelineFile.flush();
+}
+
+// Returns true if the timeline file was opened successfully
+bool CaptureTimeline::isOpen(void)
+{
+    return timelineFile.isOpen();
+}
+
+// Return the timeline file name for a capture file (the capture name with a .timeline suffix)
+QString CaptureTimeline::timelineFilename(QString captureFilename)
+{
+    QFileInfo captureFileInfo(captureFilename);
+    return captureFileInfo.path() + "/" + captureFileInfo.completeBaseName() + ".timeline";
+}
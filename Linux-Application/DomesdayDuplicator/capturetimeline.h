@@ -0,0 +1,64 @@
+/************************************************************************
+
+    capturetimeline.h
+
+    Capture application for the Domesday Duplicator
+    DomesdayDuplicator - LaserDisc RF sampler
+    Copyright (C) 2018-2019 Simon Inns
+
+    This file is part of Domesday Duplicator.
+
+    Domesday Duplicator is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#ifndef CAPTURETIMELINE_H
+#define CAPTURETIMELINE_H
+
+#include <QString>
+#include <QFile>
+#include <QFileInfo>
+#include <QDebug>
+
+// Per-capture timeline written alongside the capture data (<capture name>.timeline)
+//
+// The timeline maps the player's position (CAV frame number or CLV time-code) to
+// the sample offset in the capture file at the time the position was read, so a
+// decoder can seek straight to a frame or chapter range.  One comma-separated line
+// is written each time the position changes:
+//
+//     <sample offset>,<frame|timecode>,<address>
+//
+// Positions are read over the serial link while the transfers are in flight, so
+// an offset is accurate to a few fields rather than to the sample.
+class CaptureTimeline
+{
+public:
+    explicit CaptureTimeline(QString captureFilename);
+    ~CaptureTimeline();
+
+    void append(qint64 samplePosition, bool isTimeCode, qint32 address);
+    bool isOpen(void);
+
+    static QString timelineFilename(QString captureFilename);
+
+private:
+    QFile timelineFile;
+    bool lastIsTimeCode;
+    qint32 lastAddress;
+};
+
+#endif // CAPTURETIMELINE_H
@@ -62,12 +62,21 @@ void Configuration::writeConfiguration(void)
     configuration->beginGroup("capture");
     configuration->setValue("captureDirectory", settings.capture.captureDirectory);
     configuration->setValue("captureFormat", convertCaptureFormatToInt(settings.capture.captureFormat));
+    configuration->setValue("continueOnOverflow", settings.capture.continueOnOverflow);
+    configuration->setValue("overflowGapBudget", settings.capture.overflowGapBudget);
+    configuration->setValue("armedCapture", settings.capture.armedCapture);
+    configuration->setValue("preRollTime", settings.capture.preRollTime);
+    configuration->setValue("signalLossTime", settings.capture.signalLossTime);
     configuration->endGroup();
 
     // USB
     configuration->beginGroup("usb");
     configuration->setValue("vid", settings.usb.vid);
     configuration->setValue("pid", settings.usb.pid);
+    configuration->setValue("transferGeometryHost", settings.usb.transferGeometryHost);
+    configuration->setValue("transferSize", settings.usb.transferSize);
+    configuration->setValue("simultaneousTransfers", settings.usb.simultaneousTransfers);
+    configuration->setValue("transferTimeout", settings.usb.transferTimeout);
     configuration->endGroup();
 
     // PIC
@@ -75,6 +84,24 @@ void Configuration::writeConfiguration(void)
     configuration->setValue("serialDevice", settings.pic.serialDevice);
     configuration->setValue("serialSpeed", convertSerialSpeedsToInt(settings.pic.serialSpeed));
     configuration->setValue("keyLock", settings.pic.keyLock);
+    configuration->setValue("connectedSerialDevice", settings.pic.connectedSerialDevice);
+    configuration->setValue("connectedSerialSpeed", convertSerialSpeedsToInt(settings.pic.connectedSerialSpeed));
+    configuration->endGroup();
+
+    // Performance
+    configuration->beginGroup("performance");
+    configuration->setValue("usbThreadCpus", settings.performance.usbThreadCpus);
+    configuration->setValue("usbThreadPriority", settings.performance.usbThreadPriority);
+    configuration->setValue("writerThreadCpus", settings.performance.writerThreadCpus);
+    configuration->setValue("writerThreadPriority", settings.performance.writerThreadPriority);
+    configuration->setValue("writerIoPriorityClass", settings.performance.writerIoPriorityClass);
+    configuration->setValue("writerIoPriorityLevel", settings.performance.writerIoPriorityLevel);
+    configuration->setValue("diskBufferNumaNode", settings.performance.diskBufferNumaNode);
+    configuration->setValue("playerThreadCpus", settings.performance.playerThreadCpus);
+    configuration->setValue("playerThreadPriority", settings.performance.playerThreadPriority);
+    configuration->setValue("guiThreadCpus", settings.performance.guiThreadCpus);
+    configuration->setValue("pipelinedConversion", settings.performance.pipelinedConversion);
+    configuration->setValue("inPlaceConversion", settings.performance.inPlaceConversion);
     configuration->endGroup();
 
     // Windows
@@ -101,12 +128,21 @@ void Configuration::readConfiguration(void)
     configuration->beginGroup("capture");
     settings.capture.captureDirectory = configuration->value("captureDirectory").toString();
     settings.capture.captureFormat = convertIntToCaptureFormat(configuration->value("captureFormat").toInt());
+    settings.capture.continueOnOverflow = configuration->value("continueOnOverflow", false).toBool();
+    settings.capture.overflowGapBudget = configuration->value("overflowGapBudget", 10).toInt();
+    settings.capture.armedCapture = configuration->value("armedCapture", false).toBool();
+    settings.capture.preRollTime = configuration->value("preRollTime", 1000).toInt();
+    settings.capture.signalLossTime = configuration->value("signalLossTime", 0).toInt();
     configuration->endGroup();
 
     // USB
     configuration->beginGroup("usb");
     settings.usb.vid = static_cast<quint16>(configuration->value("vid").toUInt());
     settings.usb.pid = static_cast<quint16>(configuration->value("pid").toUInt());
+    settings.usb.transferGeometryHost = configuration->value("transferGeometryHost", QString()).toString();
+    settings.usb.transferSize = configuration->value("transferSize", 16384 * 16).toInt();
+    settings.usb.simultaneousTransfers = configuration->value("simultaneousTransfers", 16).toInt();
+    settings.usb.transferTimeout = configuration->value("transferTimeout", 1000).toInt();
     configuration->endGroup();
 
     // PIC
@@ -114,6 +150,24 @@ void Configuration::readConfiguration(void)
     settings.pic.serialDevice = configuration->value("serialDevice").toString();
     settings.pic.serialSpeed = convertIntToSerialSpeeds(configuration->value("serialSpeed").toInt());
     settings.pic.keyLock = configuration->value("keyLock").toBool();
+    settings.pic.connectedSerialDevice = configuration->value("connectedSerialDevice", QString()).toString();
+    settings.pic.connectedSerialSpeed = convertIntToSerialSpeeds(configuration->value("connectedSerialSpeed", 4).toInt());
+    configuration->endGroup();
+
+    // Performance (added without a settings version change, so missing values are defaulted)
+    configuration->beginGroup("performance");
+    settings.performance.usbThreadCpus = configuration->value("usbThreadCpus", QString()).toString();
+    settings.performance.usbThreadPriority = configuration->value("usbThreadPriority", -1).toInt();
+    settings.performance.writerThreadCpus = configuration->value("writerThreadCpus", QString()).toString();
+    settings.performance.writerThreadPriority = configuration->value("writerThreadPriority", 0).toInt();
+    settings.performance.writerIoPriorityClass = configuration->value("writerIoPriorityClass", 0).toInt();
+    settings.performance.writerIoPriorityLevel = configuration->value("writerIoPriorityLevel", 0).toInt();
+    settings.performance.diskBufferNumaNode = configuration->value("diskBufferNumaNode", -1).toInt();
+    settings.performance.playerThreadCpus = configuration->value("playerThreadCpus", QString()).toString();
+    settings.performance.playerThreadPriority = configuration->value("playerThreadPriority", 0).toInt();
+    settings.performance.guiThreadCpus = configuration->value("guiThreadCpus", QString()).toString();
+    settings.performance.pipelinedConversion = configuration->value("pipelinedConversion", false).toBool();
+    settings.performance.inPlaceConversion = configuration->value("inPlaceConversion", true).toBool();
     configuration->endGroup();
 
     // Windows
@@ -134,15 +188,40 @@ void Configuration::setDefault(void)
     // Capture
     settings.capture.captureDirectory = QDir::homePath();
     settings.capture.captureFormat = CaptureFormat::tenBitPacked;
+    settings.capture.continueOnOverflow = false;
+    settings.capture.overflowGapBudget = 10;
+    settings.capture.armedCapture = false;
+    settings.capture.preRollTime = 1000;
+    settings.capture.signalLossTime = 0;
 
     // USB
     settings.usb.vid = 0x1D50;
     settings.usb.pid = 0x603B;
+    settings.usb.transferGeometryHost = QString();
+    settings.usb.transferSize = 16384 * 16;
+    settings.usb.simultaneousTransfers = 16;
+    settings.usb.transferTimeout = 1000;
 
     // PIC
     settings.pic.serialDevice = tr("");
     settings.pic.serialSpeed = SerialSpeeds::autoDetect;
     settings.pic.keyLock = false;
+    settings.pic.connectedSerialDevice = QString();
+    settings.pic.connectedSerialSpeed = SerialSpeeds::autoDetect;
+
+    // Performance
+    settings.performance.usbThreadCpus = QString();
+    settings.performance.usbThreadPriority = -1;
+    settings.performance.writerThreadCpus = QString();
+    settings.performance.writerThreadPriority = 0;
+    settings.performance.writerIoPriorityClass = 0;
+    settings.performance.writerIoPriorityLevel = 0;
+    settings.performance.diskBufferNumaNode = -1;
+    settings.performance.playerThreadCpus = QString();
+    settings.performance.playerThreadPriority = 0;
+    settings.performance.guiThreadCpus = QString();
+    settings.performance.pipelinedConversion = false;
+    settings.performance.inPlaceConversion = true;
 
     // Windows
     settings.windows.mainWindowGeometry = QByteArray();
@@ -228,6 +307,56 @@ Configuration::CaptureFormat Configuration::getCaptureFormat(void)
     return settings.capture.captureFormat;
 }
 
+void Configuration::setContinueOnOverflow(bool continueOnOverflow)
+{
+    settings.capture.continueOnOverflow = continueOnOverflow;
+}
+
+bool Configuration::getContinueOnOverflow(void)
+{
+    return settings.capture.continueOnOverflow;
+}
+
+void Configuration::setOverflowGapBudget(qint32 overflowGapBudget)
+{
+    settings.capture.overflowGapBudget = overflowGapBudget;
+}
+
+qint32 Configuration::getOverflowGapBudget(void)
+{
+    return settings.capture.overflowGapBudget;
+}
+
+void Configuration::setArmedCapture(bool armedCapture)
+{
+    settings.capture.armedCapture = armedCapture;
+}
+
+bool Configuration::getArmedCapture(void)
+{
+    return settings.capture.armedCapture;
+}
+
+void Configuration::setPreRollTime(qint32 preRollTime)
+{
+    settings.capture.preRollTime = preRollTime;
+}
+
+qint32 Configuration::getPreRollTime(void)
+{
+    return settings.capture.preRollTime;
+}
+
+void Configuration::setSignalLossTime(qint32 signalLossTime)
+{
+    settings.capture.signalLossTime = signalLossTime;
+}
+
+qint32 Configuration::getSignalLossTime(void)
+{
+    return settings.capture.signalLossTime;
+}
+
 // USB settings
 void Configuration::setUsbVid(quint16 vid)
 {
@@ -248,6 +377,53 @@ quint16 Configuration::getUsbPid(void)
     return settings.usb.pid;
 }
 
+void Configuration::setTransferGeometryHost(QString transferGeometryHost)
+{
+    settings.usb.transferGeometryHost = transferGeometryHost;
+}
+
+QString Configuration::getTransferGeometryHost(void)
+{
+    return settings.usb.transferGeometryHost;
+}
+
+// The calibrated transfer geometry only applies to the host it was calibrated on
+bool Configuration::isTransferGeometryCalibrated(void)
+{
+    return !settings.usb.transferGeometryHost.isEmpty() &&
+            settings.usb.transferGeometryHost == QSysInfo::machineHostName();
+}
+
+void Configuration::setTransferSize(qint32 transferSize)
+{
+    settings.usb.transferSize = transferSize;
+}
+
+qint32 Configuration::getTransferSize(void)
+{
+    return settings.usb.transferSize;
+}
+
+void Configuration::setSimultaneousTransfers(qint32 simultaneousTransfers)
+{
+    settings.usb.simultaneousTransfers = simultaneousTransfers;
+}
+
+qint32 Configuration::getSimultaneousTransfers(void)
+{
+    return settings.usb.simultaneousTransfers;
+}
+
+void Configuration::setTransferTimeout(qint32 transferTimeout)
+{
+    settings.usb.transferTimeout = transferTimeout;
+}
+
+qint32 Configuration::getTransferTimeout(void)
+{
+    return settings.usb.transferTimeout;
+}
+
 // PIC settings
 void Configuration::setSerialSpeed(SerialSpeeds serialSpeed)
 {
@@ -279,6 +455,141 @@ bool Configuration::getKeyLock(void)
     return settings.pic.keyLock;
 }
 
+void Configuration::setConnectedSerialPlayer(QString serialDevice, SerialSpeeds serialSpeed)
+{
+    settings.pic.connectedSerialDevice = serialDevice;
+    settings.pic.connectedSerialSpeed = serialSpeed;
+}
+
+// Returns the speed the player was last connected at on the serial device (auto-detect if the player
+// hasn't been connected on the device)
+Configuration::SerialSpeeds Configuration::getConnectedSerialSpeed(QString serialDevice)
+{
+    if (serialDevice != settings.pic.connectedSerialDevice) return SerialSpeeds::autoDetect;
+    return settings.pic.connectedSerialSpeed;
+}
+
+// Performance settings
+void Configuration::setUsbThreadCpus(QString usbThreadCpus)
+{
+    settings.performance.usbThreadCpus = usbThreadCpus;
+}
+
+QString Configuration::getUsbThreadCpus(void)
+{
+    return settings.performance.usbThreadCpus;
+}
+
+void Configuration::setUsbThreadPriority(qint32 usbThreadPriority)
+{
+    settings.performance.usbThreadPriority = usbThreadPriority;
+}
+
+qint32 Configuration::getUsbThreadPriority(void)
+{
+    return settings.performance.usbThreadPriority;
+}
+
+void Configuration::setWriterThreadCpus(QString writerThreadCpus)
+{
+    settings.performance.writerThreadCpus = writerThreadCpus;
+}
+
+QString Configuration::getWriterThreadCpus(void)
+{
+    return settings.performance.writerThreadCpus;
+}
+
+void Configuration::setWriterThreadPriority(qint32 writerThreadPriority)
+{
+    settings.performance.writerThreadPriority = writerThreadPriority;
+}
+
+qint32 Configuration::getWriterThreadPriority(void)
+{
+    return settings.performance.writerThreadPriority;
+}
+
+void Configuration::setWriterIoPriorityClass(qint32 writerIoPriorityClass)
+{
+    settings.performance.writerIoPriorityClass = writerIoPriorityClass;
+}
+
+qint32 Configuration::getWriterIoPriorityClass(void)
+{
+    return settings.performance.writerIoPriorityClass;
+}
+
+void Configuration::setWriterIoPriorityLevel(qint32 writerIoPriorityLevel)
+{
+    settings.performance.writerIoPriorityLevel = writerIoPriorityLevel;
+}
+
+qint32 Configuration::getWriterIoPriorityLevel(void)
+{
+    return settings.performance.writerIoPriorityLevel;
+}
+
+void Configuration::setDiskBufferNumaNode(qint32 diskBufferNumaNode)
+{
+    settings.performance.diskBufferNumaNode = diskBufferNumaNode;
+}
+
+qint32 Configuration::getDiskBufferNumaNode(void)
+{
+    return settings.performance.diskBufferNumaNode;
+}
+
+void Configuration::setPlayerThreadCpus(QString playerThreadCpus)
+{
+    settings.performance.playerThreadCpus = playerThreadCpus;
+}
+
+QString Configuration::getPlayerThreadCpus(void)
+{
+    return settings.performance.playerThreadCpus;
+}
+
+void Configuration::setPlayerThreadPriority(qint32 playerThreadPriority)
+{
+    settings.performance.playerThreadPriority = playerThreadPriority;
+}
+
+qint32 Configuration::getPlayerThreadPriority(void)
+{
+    return settings.performance.playerThreadPriority;
+}
+
+void Configuration::setGuiThreadCpus(QString guiThreadCpus)
+{
+    settings.performance.guiThreadCpus = guiThreadCpus;
+}
+
+QString Configuration::getGuiThreadCpus(void)
+{
+    return settings.performance.guiThreadCpus;
+}
+
+void Configuration::setPipelinedConversion(bool pipelinedConversion)
+{
+    settings.performance.pipelinedConversion = pipelinedConversion;
+}
+
+bool Configuration::getPipelinedConversion(void)
+{
+    return settings.performance.pipelinedConversion;
+}
+
+void Configuration::setInPlaceConversion(bool inPlaceConversion)
+{
+    settings.performance.inPlaceConversion = inPlaceConversion;
+}
+
+bool Configuration::getInPlaceConversion(void)
+{
+    return settings.performance.inPlaceConversion;
+}
+
 // Windows
 void Configuration::setMainWindowGeometry(QByteArray mainWindowGeometry)
 {
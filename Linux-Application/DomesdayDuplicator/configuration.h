@@ -34,6 +34,7 @@
 #include <QStandardPaths>
 #include <QApplication>
 #include <QDir>
+#include <QSysInfo>
 #include <QDebug>
 
 class Configuration : public QObject
@@ -68,16 +69,62 @@ public:
     QString getCaptureDirectory(void);
     void setCaptureFormat(CaptureFormat captureFormat);
     CaptureFormat getCaptureFormat(void);
+    void setContinueOnOverflow(bool continueOnOverflow);
+    bool getContinueOnOverflow(void);
+    void setOverflowGapBudget(qint32 overflowGapBudget);
+    qint32 getOverflowGapBudget(void);
+    void setArmedCapture(bool armedCapture);
+    bool getArmedCapture(void);
+    void setPreRollTime(qint32 preRollTime);
+    qint32 getPreRollTime(void);
+    void setSignalLossTime(qint32 signalLossTime);
+    qint32 getSignalLossTime(void);
     void setUsbVid(quint16 vid);
     quint16 getUsbVid(void);
     void setUsbPid(quint16 pid);
     quint16 getUsbPid(void);
+    void setTransferGeometryHost(QString transferGeometryHost);
+    QString getTransferGeometryHost(void);
+    bool isTransferGeometryCalibrated(void);
+    void setTransferSize(qint32 transferSize);
+    qint32 getTransferSize(void);
+    void setSimultaneousTransfers(qint32 simultaneousTransfers);
+    qint32 getSimultaneousTransfers(void);
+    void setTransferTimeout(qint32 transferTimeout);
+    qint32 getTransferTimeout(void);
     void setSerialSpeed(SerialSpeeds serialSpeed);
     SerialSpeeds getSerialSpeed(void);
     void setSerialDevice(QString serialDevice);
     QString getSerialDevice(void);
     void setKeyLock(bool keyLock);
     bool getKeyLock(void);
+    void setConnectedSerialPlayer(QString serialDevice, SerialSpeeds serialSpeed);
+    SerialSpeeds getConnectedSerialSpeed(QString serialDevice);
+
+    void setUsbThreadCpus(QString usbThreadCpus);
+    QString getUsbThreadCpus(void);
+    void setUsbThreadPriority(qint32 usbThreadPriority);
+    qint32 getUsbThreadPriority(void);
+    void setWriterThreadCpus(QString writerThreadCpus);
+    QString getWriterThreadCpus(void);
+    void setWriterThreadPriority(qint32 writerThreadPriority);
+    qint32 getWriterThreadPriority(void);
+    void setWriterIoPriorityClass(qint32 writerIoPriorityClass);
+    qint32 getWriterIoPriorityClass(void);
+    void setWriterIoPriorityLevel(qint32 writerIoPriorityLevel);
+    qint32 getWriterIoPriorityLevel(void);
+    void setDiskBufferNumaNode(qint32 diskBufferNumaNode);
+    qint32 getDiskBufferNumaNode(void);
+    void setPlayerThreadCpus(QString playerThreadCpus);
+    QString getPlayerThreadCpus(void);
+    void setPlayerThreadPriority(qint32 playerThreadPriority);
+    qint32 getPlayerThreadPriority(void);
+    void setGuiThreadCpus(QString guiThreadCpus);
+    QString getGuiThreadCpus(void);
+    void setPipelinedConversion(bool pipelinedConversion);
+    bool getPipelinedConversion(void);
+    void setInPlaceConversion(bool inPlaceConversion);
+    bool getInPlaceConversion(void);
 
     void setMainWindowGeometry(QByteArray mainWindowGeometry);
     QByteArray getMainWindowGeometry(void);
@@ -98,21 +145,52 @@ private:
     QSettings *configuration;
 
     // Note: Configuration is organised by the following top-level labels
-    // Capture, USB, PIC (player integrated capture)
+    // Capture, USB, PIC (player integrated capture), Performance
     struct Capture {
         QString captureDirectory;
         CaptureFormat captureFormat;
+        bool continueOnOverflow;        // Drop data and record a gap when the disk buffers overflow
+        qint32 overflowGapBudget;       // Total gap length (in seconds) before the capture is aborted
+        bool armedCapture;              // Keep the device streaming into the disk buffers between captures (configuration file only)
+        qint32 preRollTime;             // Data kept from before the capture is started when armed (in mS)
+        qint32 signalLossTime;          // Stop the capture after this long without RF (in seconds, 0 disables; configuration file only)
     };
 
     struct Usb {
         quint16 vid;    // Vendor ID of USB device
         quint16 pid;    // Product ID of USB device
+
+        // Transfer geometry chosen by the USB transfer calibration (only used on the calibrated host)
+        QString transferGeometryHost;   // Host name the transfer geometry was calibrated on
+        qint32 transferSize;            // Bytes per USB bulk transfer
+        qint32 simultaneousTransfers;   // Number of in-flight transfers
+        qint32 transferTimeout;         // Transfer timeout (in milliseconds)
     };
 
     struct Pic {
         QString serialDevice;
         SerialSpeeds serialSpeed;
         bool keyLock;
+        QString connectedSerialDevice;      // Serial device the player was last connected on
+        SerialSpeeds connectedSerialSpeed;  // Serial speed the player was last connected at (probed first when auto-detecting)
+    };
+
+    // Performance tuning applied while a capture is running.  These settings are
+    // only available in the configuration file (CPU lists are in the form
+    // "2,3" or "4-7", an empty list leaves the thread free to use any CPU)
+    struct Performance {
+        QString usbThreadCpus;
+        qint32 usbThreadPriority;       // SCHED_RR priority (-1 = automatic, 0 = normal scheduling)
+        QString writerThreadCpus;
+        qint32 writerThreadPriority;    // SCHED_RR priority (0 = normal scheduling)
+        qint32 writerIoPriorityClass;   // 0 = unchanged, 1 = real-time, 2 = best-effort, 3 = idle
+        qint32 writerIoPriorityLevel;   // 0 (highest) to 7 (lowest)
+        qint32 diskBufferNumaNode;      // -1 = local to the USB capture thread
+        QString playerThreadCpus;
+        qint32 playerThreadPriority;    // SCHED_RR priority (0 = normal scheduling)
+        QString guiThreadCpus;
+        bool pipelinedConversion;       // Convert each transfer as it arrives
+        bool inPlaceConversion;         // Convert within the disk buffers (rather than via a conversion buffer)
     };
 
     // Window geometry and settings
@@ -129,6 +207,7 @@ private:
         Capture capture;
         Usb usb;
         Pic pic;
+        Performance performance;
         Windows windows;
     } settings;
 
@@ -0,0 +1,147 @@
+/************************************************************************
+
+    crc32c.cpp
+
+    Capture application for the Domesday Duplicator
+    DomesdayDuplicator - LaserDisc RF sampler
+    Copyright (C) 2018-2019 Simon Inns
+
+    This file is part of Domesday Duplicator.
+
+    Domesday Duplicator is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+
+#include "crc32c.h"
+
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+// Reversed CRC-32C polynomial
+#define CRC32CPOLYNOMIAL 0x82F63B78
+
+// Lookup tables for the software implementation (built on first use)
+struct Crc32cTables {
+    quint32 table[8][256];
+
+    Crc32cTables()
+    {
+        for (quint32 byte = 0; byte < 256; byte++) {
+            quint32 crc = byte;
+            for (qint32 bit = 0; bit < 8; bit++) crc = (crc & 1) ? (crc >> 1) ^ CRC32CPOLYNOMIAL : crc >> 1;
+            table[0][byte] = crc;
+        }
+
+        for (quint32 byte = 0; byte < 256; byte++) {
+            for (qint32 slice = 1; slice < 8; slice++) {
+                table[slice][byte] = (table[slice - 1][byte] >> 8) ^ table[0][table[slice - 1][byte] & 0xFF];
+            }
+        }
+    }
+};
+
+#if defined(__x86_64__)
+// CRC-32C using the SSE 4.2 CRC32 instruction (8 bytes at a time)
+__attribute__((target("sse4.2")))
+static quint32 updateSse42(quint32 checksum, const unsigned char *data, qint64 length)
+{
+    quint64 crc = ~checksum;
+
+    while (length >= 8) {
+        quint64 word;
+        memcpy(&word, data, 8);
+        crc = _mm_crc32_u64(crc, word);
+        data += 8;
+        length -= 8;
+    }
+
+    quint32 crc32 = static_cast<quint32>(crc);
+    while (length-- > 0) crc32 = _mm_crc32_u8(crc32, *data++);
+
+    return ~crc32;
+}
+#elif defined(__ARM_FEATURE_CRC32)
+// CRC-32C using the ARMv8 CRC32C instructions (8 bytes at a time)
+static quint32 updateArm(quint32 checksum, const unsigned char *data, qint64 length)
+{
+    quint32 crc = ~checksum;
+
+    while (length >= 8) {
+        quint64 word;
+        memcpy(&word, data, 8);
+        crc = __crc32cd(crc, word);
+        data += 8;
+        length -= 8;
+    }
+
+    while (length-- > 0) crc = __crc32cb(crc, *data++);
+
+    return ~crc;
+}
+#endif
+
+// Continue a CRC-32C checksum over length bytes of data (start with a checksum of 0)
+quint32 Crc32c::update(quint32 checksum, const unsigned char *data, qint64 length)
+{
+#if defined(__x86_64__)
+    if (isHardwareAccelerated()) return updateSse42(checksum, data, length);
+#elif defined(__ARM_FEATURE_CRC32)
+    return updateArm(checksum, data, length);
+#endif
+
+    return updateSoftware(checksum, data, length);
+}
+
+// Returns true if the checksums are calculated with CRC instructions
+bool Crc32c::isHardwareAccelerated(void)
+{
+#if defined(__x86_64__)
+    static const bool isSse42 = __builtin_cpu_supports("sse4.2");
+    return isSse42;
+#elif defined(__ARM_FEATURE_CRC32)
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Software CRC-32C (slice-by-8)
+quint32 Crc32c::updateSoftware(quint32 checksum, const unsigned char *data, qint64 length)
+{
+    static const Crc32cTables tables;
+    quint32 crc = ~checksum;
+
+    while (length >= 8) {
+        quint32 low = crc ^ (static_cast<quint32>(data[0]) | (static_cast<quint32>(data[1]) << 8) |
+                (static_cast<quint32>(data[2]) << 16) | (static_cast<quint32>(data[3]) << 24));
+        crc = tables.table[7][low & 0xFF] ^ tables.table[6][(low >> 8) & 0xFF] ^
+                tables.table[5][(low >> 16) & 0xFF] ^ tables.table[4][low >> 24] ^
+                tables.table[3][data[4]] ^ tables.table[2][data[5]] ^
+                tables.table[1][data[6]] ^ tables.table[0][data[7]];
+        data += 8;
+        length -= 8;
+    }
+
+    while (length-- > 0) crc = (crc >> 8) ^ tables.table[0][(crc ^ *data++) & 0xFF];
+
+    return ~crc;
+}
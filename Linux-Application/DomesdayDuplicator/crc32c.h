@@ -0,0 +1,53 @@
+/************************************************************************
+
+    crc32c.h
+
+    Capture application for the Domesday Duplicator
+    DomesdayDuplicator - LaserDisc RF sampler
+    Copyright (C) 2018-2019 Simon Inns
+
+    This file is part of Domesday Duplicator.
+
+    Domesday Duplicator is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <QtGlobal>
+
+// CRC-32C (Castagnoli) checksums of capture data
+//
+// The CRC instructions of SSE 4.2 (x86-64, detected at run-time) or ARMv8 (when
+// the compiler targets them) are used where available, otherwise a slice-by-8
+// table implementation.  Checksums may be calculated in pieces by passing the
+// result for one piece as the initial value for the next:
+//
+//     quint32 checksum = Crc32c::update(0, first, firstLength);
+//     checksum = Crc32c::update(checksum, second, secondLength);
+class Crc32c
+{
+public:
+    static quint32 update(quint32 checksum, const unsigned char *data, qint64 length);
+    static bool isHardwareAccelerated(void);
+
+private:
+    static quint32 updateSoftware(quint32 checksum, const unsigned char *data, qint64 length);
+};
+
+#endif // CRC32C_H
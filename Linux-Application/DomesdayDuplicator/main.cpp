@@ -26,10 +26,12 @@
 ************************************************************************/
 
 #include "mainwindow.h"
+#include "capturebench.h"
 #include <QApplication>
 #include <QDebug>
 #include <QtGlobal>
 #include <QCommandLineParser>
+#include <QScopedPointer>
 
 // Global for debug output
 static bool showDebug = false;
@@ -70,12 +72,77 @@ void debugOutputHandler(QtMsgType type, const QMessageLogContext &context, const
     }
 }
 
+// Run the capture throughput bench without the GUI and print the report
+static int runCaptureBench(QCoreApplication &application, qint32 durationSeconds, bool isSynthetic)
+{
+    Configuration configuration;
+    UsbDevice *usbDevice = new UsbDevice(nullptr, configuration.getUsbVid(), configuration.getUsbPid());
+    CaptureBench captureBench(nullptr, usbDevice);
+    QObject::connect(&captureBench, &CaptureBench::benchComplete, &application, &QCoreApplication::quit);
+
+    // The synthetic source doesn't need a device
+    bool isBenchStarted = false;
+    if (!isSynthetic && !usbDevice->scanForDevice()) {
+        fprintf(stderr, "No Domesday Duplicator USB device is attached - use --synthetic to bench without one\n");
+    } else {
+        // Bench with the configured capture settings
+        CaptureThreadSettings threadSettings;
+        threadSettings.usbThreadCpus = configuration.getUsbThreadCpus();
+        threadSettings.usbThreadPriority = configuration.getUsbThreadPriority();
+        threadSettings.writerThreadCpus = configuration.getWriterThreadCpus();
+        threadSettings.writerThreadPriority = configuration.getWriterThreadPriority();
+        threadSettings.writerIoPriorityClass = configuration.getWriterIoPriorityClass();
+        threadSettings.writerIoPriorityLevel = configuration.getWriterIoPriorityLevel();
+        threadSettings.diskBufferNumaNode = configuration.getDiskBufferNumaNode();
+        usbDevice->setCaptureThreadSettings(threadSettings);
+        usbDevice->setPipelinedConversion(configuration.getPipelinedConversion());
+        usbDevice->setInPlaceConversion(configuration.getInPlaceConversion());
+        usbDevice->reserveCaptureBuffers();
+        usbDevice->setOverflowHandling(configuration.getContinueOnOverflow(), configuration.getOverflowGapBudget());
+
+        UsbTransferGeometry transferGeometry = UsbCapture::getDefaultTransferGeometry();
+        if (configuration.isTransferGeometryCalibrated()) {
+            transferGeometry.transferSize = configuration.getTransferSize();
+            transferGeometry.simultaneousTransfers = configuration.getSimultaneousTransfers();
+            transferGeometry.transferTimeout = configuration.getTransferTimeout();
+        }
+        usbDevice->setTransferGeometry(transferGeometry);
+
+        bool isCaptureFormat10Bit = configuration.getCaptureFormat() != Configuration::CaptureFormat::sixteenBitSigned;
+        bool isCaptureFormat10BitDecimated = configuration.getCaptureFormat() == Configuration::CaptureFormat::tenBitCdPacked;
+        isBenchStarted = captureBench.start(configuration.getCaptureDirectory(), isCaptureFormat10Bit,
+                                            isCaptureFormat10BitDecimated, durationSeconds, isSynthetic);
+        if (!isBenchStarted) fprintf(stderr, "%s\n", captureBench.getLastError().toLocal8Bit().constData());
+    }
+
+    if (isBenchStarted) {
+        application.exec();
+        fprintf(stdout, "%s\n", captureBench.getReport().toLocal8Bit().constData());
+
+        // Leave the device in normal capture mode
+        if (!isSynthetic) usbDevice->sendConfigurationCommand(false);
+    }
+
+    // Stop the libUSB event thread
+    if (usbDevice->isRunning()) usbDevice->stop();
+    usbDevice->wait();
+    delete usbDevice;
+
+    return (isBenchStarted && captureBench.getResult().isPassed) ? 0 : 1;
+}
+
 int main(int argc, char *argv[])
 {
     // Install the local debug message handler
     qInstallMessageHandler(debugOutputHandler);
 
-    QApplication a(argc, argv);
+    // The capture bench runs without a display
+    bool isBenchMode = false;
+    for (qint32 i = 1; i < argc; i++) {
+        if (QString(argv[i]) == "--bench" || QString(argv[i]).startsWith("--bench=")) isBenchMode = true;
+    }
+
+    QScopedPointer<QCoreApplication> a(isBenchMode ? new QCoreApplication(argc, argv) : new QApplication(argc, argv));
 
     // Set application name and version
     QCoreApplication::setApplicationName("DomesdayDuplicator");
@@ -98,8 +165,19 @@ int main(int argc, char *argv[])
                                        QCoreApplication::translate("main", "Show debug"));
     parser.addOption(showDebugOption);
 
+    // Option to bench the capture throughput without the GUI (--bench)
+    QCommandLineOption benchOption("bench",
+                                   QCoreApplication::translate("main", "Bench the capture throughput for <seconds> and exit"),
+                                   QCoreApplication::translate("main", "seconds"));
+    parser.addOption(benchOption);
+
+    // Option to bench with the synthetic source in place of the USB device (--synthetic)
+    QCommandLineOption syntheticOption("synthetic",
+                                       QCoreApplication::translate("main", "Bench using a synthetic source (no USB device needed)"));
+    parser.addOption(syntheticOption);
+
     // Process the command line arguments given by the user
-    parser.process(a);
+    parser.process(*a);
 
     // Get the configured settings from the parser
     bool isDebugOn = parser.isSet(showDebugOption);
@@ -107,9 +185,19 @@ int main(int argc, char *argv[])
     // Process the command line options
     if (isDebugOn) showDebug = true;
 
+    if (parser.isSet(benchOption)) {
+        bool isValid = false;
+        qint32 durationSeconds = parser.value(benchOption).toInt(&isValid);
+        if (!isValid || durationSeconds < 1) {
+            fprintf(stderr, "The bench duration must be a number of seconds\n");
+            return 1;
+        }
+        return runCaptureBench(*a, durationSeconds, parser.isSet(syntheticOption));
+    }
+
     qDebug() << "Starting main window process";
     MainWindow w;
     w.show();
 
-    return a.exec();
+    return a->exec();
 }
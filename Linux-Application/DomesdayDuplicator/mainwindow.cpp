@@ -29,6 +29,8 @@
 #include "ui_mainwindow.h"
 #include "usbcapture.h"
 #include <QFile>
+#include <QSysInfo>
+#include <QInputDialog>
 
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
@@ -63,11 +65,6 @@ MainWindow::MainWindow(QWidget *parent) :
             this, &MainWindow::stopAutomaticCaptureDialogSignalHandler);
     automaticCaptureDialog->setEnabled(false); // Disable the dialogue until a player is connected
 
-    // Set up a timer for updating the automatic capture status information
-    automaticCaptureTimer = new QTimer(this);
-    connect(automaticCaptureTimer, SIGNAL(timeout()), this, SLOT(updateAutomaticCaptureStatus()));
-    automaticCaptureTimer->start(100); // Update 10 times per second
-
     // Start the player control object
     playerControl = new PlayerControl(this);
     connect(playerControl, &PlayerControl::automaticCaptureComplete,
@@ -80,10 +77,17 @@ MainWindow::MainWindow(QWidget *parent) :
             this, &MainWindow::playerConnectedSignalHandler);
     connect(playerControl, &PlayerControl::playerDisconnected,
             this, &MainWindow::playerDisconnectedSignalHandler);
+    connect(playerControl, &PlayerControl::playerInformationChanged,
+            this, &MainWindow::playerInformationChangedSignalHandler);
+    connect(playerControl, &PlayerControl::automaticCaptureStatusChanged,
+            this, &MainWindow::updateAutomaticCaptureStatus);
+    updateAutomaticCaptureStatus(playerControl->getAutomaticCaptureStatus());
     startPlayerControl();
 
     // Set the capture flag to not running
     isCaptureRunning = false;
+    isCaptureArmed = false;
+    isUsbDeviceAttached = false;
 
     // Add a label to the status bar for displaying the USB device status
     usbStatusLabel = new QLabel;
@@ -93,29 +97,57 @@ MainWindow::MainWindow(QWidget *parent) :
     // Disable the capture button
     ui->capturePushButton->setEnabled(false);
 
-    // Disable the test mode option
+    // Disable the test mode and calibration options
     ui->actionTest_mode->setEnabled(false);
+    ui->actionCalibrate_USB_transfers->setEnabled(false);
 
     // Set up a timer for timing the capture duration
     captureDurationTimer = new QTimer(this);
     connect(captureDurationTimer, SIGNAL(timeout()), this, SLOT(updateCaptureDuration()));
 
+    // Set up a timer for arming the capture once the device is idle (see armCapture())
+    armCaptureTimer = new QTimer(this);
+    armCaptureTimer->setSingleShot(true);
+    armCaptureTimer->setInterval(500);
+    connect(armCaptureTimer, SIGNAL(timeout()), this, SLOT(armCapture()));
+
     // Set up the Domesday Duplicator USB device and connect the signal handlers
     usbDevice = new UsbDevice(this, configuration->getUsbVid(), configuration->getUsbPid());
     connect(usbDevice, &UsbDevice::deviceAttached, this, &MainWindow::deviceAttachedSignalHandler);
     connect(usbDevice, &UsbDevice::deviceDetached, this, &MainWindow::deviceDetachedSignalHandler);
+    connect(usbDevice, &UsbDevice::captureStatisticsChanged, this, &MainWindow::updateCaptureStatistics);
+    connect(usbDevice, &UsbDevice::captureThroughputWarning, this, &MainWindow::captureThroughputWarningSignalHandler);
+    connect(usbDevice, &UsbDevice::captureSignalLost, this, &MainWindow::captureSignalLostSignalHandler);
+    connect(usbDevice, &UsbDevice::transferCalibrationProgress, this, &MainWindow::transferCalibrationProgressSignalHandler);
+    connect(usbDevice, &UsbDevice::transferCalibrationComplete, this, &MainWindow::transferCalibrationCompleteSignalHandler);
+
+    // Set up the capture bench (it uses the synthetic source when no device is attached)
+    captureBench = new CaptureBench(this, usbDevice);
+    connect(captureBench, &CaptureBench::benchProgress, this, &MainWindow::captureBenchProgressSignalHandler);
+    connect(captureBench, &CaptureBench::benchComplete, this, &MainWindow::captureBenchCompleteSignalHandler);
+
+    // Player positions are stamped against the capture as they are read, so they are
+    // passed directly from the player control thread to build the capture timeline
+    connect(playerControl, &PlayerControl::playerPositionRead, usbDevice, &UsbDevice::recordPlayerPosition,
+            Qt::DirectConnection);
+
+    // Likewise, an armed capture's trigger is stamped as the player control asks for the capture
+    // to start (just before it starts the player), rather than when the request reaches the GUI
+    connect(playerControl, &PlayerControl::startCapture, usbDevice, &UsbDevice::markCaptureTrigger,
+            Qt::DirectConnection);
 
     // Since the device might already be attached, perform an initial scan for it
     usbDevice->scanForDevice();
 
-    // Set up a timer for updating capture results
-    captureStatusUpdateTimer = new QTimer(this);
-    connect(captureStatusUpdateTimer, SIGNAL(timeout()), this, SLOT(updateCaptureStatistics()));
+    // Get the capture buffers ready
+    reserveCaptureBuffers();
 
-    // Set up a timer for updating player control information
-    playerControlTimer = new QTimer(this);
-    connect(playerControlTimer, SIGNAL(timeout()), this, SLOT(updatePlayerControlInformation()));
-    playerControlTimer->start(100); // Update 10 times per second
+    // The player sends a notification each time its state or position changes; rather than updating the
+    // labels for every one, the notifications are coalesced by a single-shot timer (at most 10 updates per second)
+    playerControlUpdateTimer = new QTimer(this);
+    playerControlUpdateTimer->setSingleShot(true);
+    connect(playerControlUpdateTimer, SIGNAL(timeout()), this, SLOT(updatePlayerControlInformation()));
+    updatePlayerControlInformation();
 
     // Defaults for the remote control toggle settings
     remoteDisplayState = PlayerCommunication::DisplayState::off;
@@ -124,14 +156,13 @@ MainWindow::MainWindow(QWidget *parent) :
     remoteChapterFrameMode = PlayerCommunication::ChapterFrameMode::chapter;
     updatePlayerRemoteDialog();
 
-    // Storage space information
-    storageInfo = new QStorageInfo();
-    storageInfo->setPath(configuration->getCaptureDirectory());
-
-    // Storage information update timer
-    storageInfoTimer = new QTimer(this);
-    connect(storageInfoTimer, SIGNAL(timeout()), this, SLOT(updateStorageInformation()));
-    storageInfoTimer->start(200); // Update 5 times per second
+    // Storage space information (checked in the background by the storage monitor)
+    isStorageInfoValid = false;
+    storageBytesAvailable = 0;
+    storageMonitor = new StorageMonitor(this);
+    connect(storageMonitor, &StorageMonitor::storageInformationChanged,
+            this, &MainWindow::storageInformationChangedSignalHandler);
+    storageMonitor->setPath(configuration->getCaptureDirectory());
 
     // Set player as disconnected
     isPlayerConnected = false;
@@ -157,8 +188,10 @@ MainWindow::~MainWindow()
 
     // Ask the threads to stop
     qDebug() << "MainWindow::~MainWindow(): Quit selected; asking threads to stop...";
+    disarmCapture();
     if (playerControl->isRunning()) playerControl->stop();
     if (usbDevice->isRunning()) usbDevice->stop();
+    if (storageMonitor->isRunning()) storageMonitor->stop();
 
     // Schedule the objects for deletion
     playerControl->deleteLater();
@@ -167,6 +200,7 @@ MainWindow::~MainWindow()
     // Wait for the objects to be deleted
     playerControl->wait();
     usbDevice->wait();
+    storageMonitor->wait();
 
     // Delete the UI
     delete ui;
@@ -183,18 +217,23 @@ void MainWindow::deviceAttachedSignalHandler(void)
 
     // Show the device status in the status bar
     usbStatusLabel->setText(tr("Domesday Duplicator is connected via USB"));
+    isUsbDeviceAttached = true;
 
     // Set test mode unchecked in the menu
     ui->actionTest_mode->setChecked(false);
 
-    // Enable the capture button
-    ui->capturePushButton->setEnabled(true);
+    // Enable the capture button (unless a bench is running)
+    ui->capturePushButton->setEnabled(!captureBench->isRunning());
 
     // Enable the automatic capture dialogue
     if (isPlayerConnected) automaticCaptureDialog->setEnabled(true);
 
-    // Enable the test mode option
-    ui->actionTest_mode->setEnabled(true);
+    // Enable the test mode and calibration options
+    ui->actionTest_mode->setEnabled(!captureBench->isRunning());
+    ui->actionCalibrate_USB_transfers->setEnabled(!usbDevice->isTransferCalibrationRunning() && !captureBench->isRunning());
+
+    // Arm the capture (if configured)
+    requestArmedCapture();
 }
 
 // USB device detached signal handler
@@ -204,6 +243,8 @@ void MainWindow::deviceDetachedSignalHandler(void)
 
     // Show the device status in the status bar
     usbStatusLabel->setText(tr("No USB capture device is attached"));
+    isUsbDeviceAttached = false;
+    disarmCapture();
 
     // Disable the capture button
     ui->capturePushButton->setEnabled(false);
@@ -211,8 +252,9 @@ void MainWindow::deviceDetachedSignalHandler(void)
     // Disable the automatic capture dialogue
     automaticCaptureDialog->setEnabled(false);
 
-    // Disable the test mode option
+    // Disable the test mode and calibration options
     ui->actionTest_mode->setEnabled(false);
+    ui->actionCalibrate_USB_transfers->setEnabled(false);
 }
 
 // Configuration changed signal handler
@@ -227,7 +269,16 @@ void MainWindow::configurationChangedSignalHandler(void)
     startPlayerControl();
 
     // Update the target directory for the storage information
-    storageInfo->setPath(configuration->getCaptureDirectory());
+    storageMonitor->setPath(configuration->getCaptureDirectory());
+
+    // The capture format might have changed, so recalculate the time available
+    updateStorageInformation();
+
+    // The buffer placement might have changed (this has no effect during a capture)
+    reserveCaptureBuffers();
+
+    // Re-arm the capture with the new settings
+    requestArmedCapture();
 }
 
 // Remote control command signal handler
@@ -428,10 +479,10 @@ void MainWindow::stopAutomaticCaptureDialogSignalHandler(void)
     playerControl->stopAutomaticCapture();
 }
 
-// Update the automatic capture status (called by a timer)
-void MainWindow::updateAutomaticCaptureStatus(void)
+// Update the automatic capture status (called when the status changes)
+void MainWindow::updateAutomaticCaptureStatus(QString status)
 {
-    automaticCaptureDialog->updateStatus(playerControl->getAutomaticCaptureStatus());
+    automaticCaptureDialog->updateStatus(status);
 }
 
 // Handle the automatic capture complete signal from the player control object
@@ -474,6 +525,14 @@ void MainWindow::playerConnectedSignalHandler(void)
     if (ui->capturePushButton->isEnabled()) automaticCaptureDialog->setEnabled(true);
 
     isPlayerConnected = true;
+
+    // Remember the speed the player connected at, so it is tried first next time
+    Configuration::SerialSpeeds connectedSerialSpeed = convertSerialSpeed(playerControl->getSerialSpeed());
+    if (connectedSerialSpeed != Configuration::SerialSpeeds::autoDetect &&
+            connectedSerialSpeed != configuration->getConnectedSerialSpeed(configuration->getSerialDevice())) {
+        configuration->setConnectedSerialPlayer(configuration->getSerialDevice(), connectedSerialSpeed);
+        configuration->writeConfiguration();
+    }
 }
 
 // Signal handler for player disconnected signal from player control
@@ -489,9 +548,27 @@ void MainWindow::playerDisconnectedSignalHandler(void)
     isPlayerConnected = false;
 }
 
+// Signal handler for player information changed signal from player control
+void MainWindow::playerInformationChangedSignalHandler(void)
+{
+    // Coalesce the notifications; the labels are updated when the timer expires
+    if (!playerControlUpdateTimer->isActive()) playerControlUpdateTimer->start(100);
+}
+
+// Signal handler for storage information changed signal from the storage monitor
+void MainWindow::storageInformationChangedSignalHandler(bool isValid, qint64 bytesAvailable)
+{
+    isStorageInfoValid = isValid;
+    storageBytesAvailable = bytesAvailable;
+    updateStorageInformation();
+}
+
 // Update the capture statistics labels
 void MainWindow::updateCaptureStatistics(void)
 {
+    // Ignore notifications for disk buffers written after the capture was stopped
+    if (!isCaptureRunning) return;
+
     ui->numberOfTransfersLabel->setText(QString::number(usbDevice->getNumberOfTransfers()));
 
     // Calculate the captured data based on the sample format (i.e. size on disk)
@@ -503,6 +580,142 @@ void MainWindow::updateCaptureStatistics(void)
     else mbWritten = usbDevice->getNumberOfDiskBuffersWritten() * 10; // 10-bit 4:1 is 8MiB per buffer
 
     ui->numberOfDiskBuffersWrittenLabel->setText(QString::number(mbWritten) + (tr(" MiB")));
+
+    // Show the signal quality metrics for the last disk buffer written
+    SignalMetrics signalMetrics = usbDevice->getSignalMetrics();
+    if (signalMetrics.numberOfSamples == 0) {
+        ui->signalLevelLabel->setText(tr("Unknown"));
+    } else {
+        ui->signalLevelLabel->setText(tr("%1 to %2, DC offset %3, RMS %4")
+                                      .arg(signalMetrics.minimumValue)
+                                      .arg(signalMetrics.maximumValue)
+                                      .arg(signalMetrics.dcOffset, 0, 'f', 1)
+                                      .arg(signalMetrics.rms, 0, 'f', 1));
+    }
+
+    // Highlight clipping so it is noticed while the capture is running
+    qint64 totalClippedSamples = usbDevice->getTotalClippedSamples();
+    ui->clippingLabel->setText(tr("%1 samples (%2 low, %3 high in last buffer)")
+                               .arg(totalClippedSamples)
+                               .arg(signalMetrics.clippedLowCount)
+                               .arg(signalMetrics.clippedHighCount));
+    if (totalClippedSamples > 0) ui->clippingLabel->setStyleSheet("color: red");
+    else ui->clippingLabel->setStyleSheet("");
+
+    // Show the measured disk write performance
+    ThroughputStatistics throughputStatistics = usbDevice->getThroughputStatistics();
+    ui->diskWritesLabel->setText(tr("%1 MB/s, %2 mS per buffer (max %3 mS), %4 buffers waiting")
+                                 .arg(throughputStatistics.writeRate / 1000000.0, 0, 'f', 1)
+                                 .arg(throughputStatistics.averageWriteLatency, 0, 'f', 0)
+                                 .arg(throughputStatistics.maximumWriteLatency, 0, 'f', 0)
+                                 .arg(throughputStatistics.ringOccupancy, 0, 'f', 1));
+    qint32 numberOfGaps = usbDevice->getNumberOfGaps();
+    if (numberOfGaps > 0) ui->diskWritesLabel->setText(ui->diskWritesLabel->text() + tr(", %1 gaps").arg(numberOfGaps));
+    if (throughputStatistics.isOverflowPredicted || numberOfGaps > 0) ui->diskWritesLabel->setStyleSheet("color: red");
+    else ui->diskWritesLabel->setStyleSheet("");
+
+    // The time remaining depends on the measured write rate
+    updateStorageInformation();
+}
+
+// Disk write throughput warning signal handler
+void MainWindow::captureThroughputWarningSignalHandler(QString message)
+{
+    if (!isCaptureRunning) return;
+
+    ui->diskWritesLabel->setStyleSheet("color: red");
+    ui->statusBar->showMessage(message, 10000);
+}
+
+// Signal loss signal handler (the disc has ended or the RF has gone, so stop the capture)
+void MainWindow::captureSignalLostSignalHandler(QString message)
+{
+    if (!isCaptureRunning) return;
+
+    // 'Press' the capture button automatically
+    qDebug() << "MainWindow::captureSignalLostSignalHandler(): Stopping the capture -" << message;
+    on_capturePushButton_clicked();
+    ui->statusBar->showMessage(message);
+}
+
+// USB transfer calibration progress signal handler
+void MainWindow::transferCalibrationProgressSignalHandler(qint32 trialNumber, qint32 numberOfTrials)
+{
+    ui->statusBar->showMessage(tr("Calibrating USB transfers - trial %1 of %2").arg(trialNumber + 1).arg(numberOfTrials));
+    if (trialNumber >= numberOfTrials) ui->statusBar->clearMessage();
+}
+
+// USB transfer calibration complete signal handler
+void MainWindow::transferCalibrationCompleteSignalHandler(bool isSuccessful)
+{
+    ui->statusBar->clearMessage();
+
+    // Return the device to the selected test mode and re-enable the capture controls
+    if (isUsbDeviceAttached) {
+        usbDevice->sendConfigurationCommand(ui->actionTest_mode->isChecked());
+        ui->capturePushButton->setEnabled(true);
+        ui->actionTest_mode->setEnabled(true);
+        ui->actionCalibrate_USB_transfers->setEnabled(true);
+    }
+    ui->actionBench_capture_throughput->setEnabled(true);
+    requestArmedCapture();
+
+    QMessageBox messageBox;
+    if (!isSuccessful) {
+        messageBox.warning(this, "USB transfer calibration", usbDevice->getLastError());
+        messageBox.setFixedSize(500, 200);
+        return;
+    }
+
+    // Save the selected geometry for this host
+    UsbTransferGeometry transferGeometry = usbDevice->getCalibratedTransferGeometry();
+    configuration->setTransferGeometryHost(QSysInfo::machineHostName());
+    configuration->setTransferSize(transferGeometry.transferSize);
+    configuration->setSimultaneousTransfers(transferGeometry.simultaneousTransfers);
+    configuration->setTransferTimeout(transferGeometry.transferTimeout);
+    configuration->writeConfiguration();
+
+    // Show the selected geometry and how it performed
+    QString message = tr("Captures on this computer will use %1 transfers of %2 Kbytes with a %3 ms timeout.")
+            .arg(transferGeometry.simultaneousTransfers).arg(transferGeometry.transferSize / 1024).arg(transferGeometry.transferTimeout);
+    for (const TransferCalibrationResult &result : usbDevice->getTransferCalibrationResults()) {
+        if (result.transferGeometry.transferSize != transferGeometry.transferSize ||
+                result.transferGeometry.simultaneousTransfers != transferGeometry.simultaneousTransfers) continue;
+        message += "\n\n" + tr("Throughput %1 MB/s, completion jitter %2 ms, longest completion interval %3 ms.")
+                .arg(result.throughput, 0, 'f', 1).arg(result.intervalJitter, 0, 'f', 2).arg(result.maximumInterval, 0, 'f', 2);
+    }
+
+    messageBox.information(this, "USB transfer calibration", message);
+    messageBox.setFixedSize(500, 200);
+}
+
+// Capture bench progress signal handler
+void MainWindow::captureBenchProgressSignalHandler(qint32 secondsElapsed, qint32 durationSeconds)
+{
+    ui->statusBar->showMessage(tr("Benching capture throughput - %1 of %2 seconds").arg(secondsElapsed).arg(durationSeconds));
+}
+
+// Capture bench complete signal handler
+void MainWindow::captureBenchCompleteSignalHandler(bool isPassed)
+{
+    ui->statusBar->clearMessage();
+    restoreCaptureThreadTuning();
+
+    // Return the device to the selected test mode and re-enable the capture controls
+    if (isUsbDeviceAttached) {
+        if (!captureBench->getResult().isSynthetic) usbDevice->sendConfigurationCommand(ui->actionTest_mode->isChecked());
+        ui->capturePushButton->setEnabled(true);
+        ui->actionTest_mode->setEnabled(true);
+        ui->actionCalibrate_USB_transfers->setEnabled(true);
+    }
+    ui->actionBench_capture_throughput->setEnabled(true);
+    ui->actionPreferences->setEnabled(true);
+    requestArmedCapture();
+
+    QMessageBox messageBox;
+    if (isPassed) messageBox.information(this, "Capture throughput bench", captureBench->getReport());
+    else messageBox.warning(this, "Capture throughput bench", captureBench->getReport());
+    messageBox.setFixedSize(500, 200);
 }
 
 // Update the player control labels
@@ -538,14 +751,19 @@ void MainWindow::updatePlayerControlInformation(void)
 // Update the storage information labels
 void MainWindow::updateStorageInformation(void)
 {
-    storageInfo->refresh();
-    if (storageInfo->isValid()) {
-        qint64 availableMiBs = storageInfo->bytesAvailable() / 1024 / 1024;
+    if (isStorageInfoValid) {
+        qint64 availableMiBs = storageBytesAvailable / 1024 / 1024;
 
         qint64 availableSeconds = 0;
 
+        // During a capture use the measured write rate (once there is one)
+        double measuredWriteRate = 0.0;
+        if (isCaptureRunning) measuredWriteRate = usbDevice->getThroughputStatistics().writeRate;
+
         if (availableMiBs != 0) {
-            if (configuration->getCaptureFormat() == Configuration::CaptureFormat::sixteenBitSigned) {
+            if (measuredWriteRate > 0.0) {
+                availableSeconds = static_cast<qint64>(static_cast<double>(storageBytesAvailable) / measuredWriteRate);
+            } else if (configuration->getCaptureFormat() == Configuration::CaptureFormat::sixteenBitSigned) {
                 availableSeconds = availableMiBs / 64; // 16-bit is 64MiB per buffer
             } else if (configuration->getCaptureFormat() == Configuration::CaptureFormat::tenBitPacked) {
                 availableSeconds = availableMiBs / 40; // 10-bit is 40MiB per buffer
@@ -569,26 +787,42 @@ void MainWindow::updateStorageInformation(void)
 
 void MainWindow::startPlayerControl(void)
 {
-    // Get the configured serial speed
-    PlayerCommunication::SerialSpeed serialSpeed = PlayerCommunication::SerialSpeed::bps9600;
-    switch (configuration->getSerialSpeed()) {
-    case Configuration::SerialSpeeds::bps1200: serialSpeed = PlayerCommunication::SerialSpeed::bps1200;
-        break;
-    case Configuration::SerialSpeeds::bps2400: serialSpeed = PlayerCommunication::SerialSpeed::bps2400;
-        break;
-    case Configuration::SerialSpeeds::bps4800: serialSpeed = PlayerCommunication::SerialSpeed::bps4800;
-        break;
-    case Configuration::SerialSpeeds::bps9600: serialSpeed = PlayerCommunication::SerialSpeed::bps9600;
-        break;
-    case Configuration::SerialSpeeds::autoDetect: serialSpeed = PlayerCommunication::SerialSpeed::autoDetect;
-        break;
-    }
+    // Get the configured serial speed (and, when auto-detecting, the speed the player was last connected at)
+    PlayerCommunication::SerialSpeed serialSpeed = convertSerialSpeed(configuration->getSerialSpeed());
+    PlayerCommunication::SerialSpeed cachedSerialSpeed =
+            convertSerialSpeed(configuration->getConnectedSerialSpeed(configuration->getSerialDevice()));
 
     if (configuration->getSerialDevice().isEmpty())
         qDebug() << "MainWindow::startPlayerControl(): Player serial device is not configured in preferences";
 
     // Send the configuration to the player control
-    playerControl->configurePlayerCommunication(configuration->getSerialDevice(), serialSpeed);
+    playerControl->configurePlayerCommunication(configuration->getSerialDevice(), serialSpeed, cachedSerialSpeed);
+}
+
+// Convert a configured serial speed to the player communication's serial speed
+PlayerCommunication::SerialSpeed MainWindow::convertSerialSpeed(Configuration::SerialSpeeds serialSpeed)
+{
+    switch (serialSpeed) {
+    case Configuration::SerialSpeeds::bps1200: return PlayerCommunication::SerialSpeed::bps1200;
+    case Configuration::SerialSpeeds::bps2400: return PlayerCommunication::SerialSpeed::bps2400;
+    case Configuration::SerialSpeeds::bps4800: return PlayerCommunication::SerialSpeed::bps4800;
+    case Configuration::SerialSpeeds::bps9600: return PlayerCommunication::SerialSpeed::bps9600;
+    case Configuration::SerialSpeeds::autoDetect: return PlayerCommunication::SerialSpeed::autoDetect;
+    }
+    return PlayerCommunication::SerialSpeed::bps9600;
+}
+
+// Convert the player communication's serial speed to a configured serial speed
+Configuration::SerialSpeeds MainWindow::convertSerialSpeed(PlayerCommunication::SerialSpeed serialSpeed)
+{
+    switch (serialSpeed) {
+    case PlayerCommunication::SerialSpeed::bps1200: return Configuration::SerialSpeeds::bps1200;
+    case PlayerCommunication::SerialSpeed::bps2400: return Configuration::SerialSpeeds::bps2400;
+    case PlayerCommunication::SerialSpeed::bps4800: return Configuration::SerialSpeeds::bps4800;
+    case PlayerCommunication::SerialSpeed::bps9600: return Configuration::SerialSpeeds::bps9600;
+    case PlayerCommunication::SerialSpeed::autoDetect: return Configuration::SerialSpeeds::autoDetect;
+    }
+    return Configuration::SerialSpeeds::autoDetect;
 }
 
 // GUI Triggered action handlers --------------------------------------------------------------------------------------
@@ -612,6 +846,9 @@ void MainWindow::on_actionTest_mode_toggled(bool arg1)
         usbDevice->sendConfigurationCommand(false);
         ui->capturePushButton->setText("Capture");
     }
+
+    // An armed capture is streaming in the previous mode
+    requestArmedCapture();
 }
 
 // Menu option->Advanced naming
@@ -645,6 +882,87 @@ void MainWindow::on_actionPreferences_triggered()
     configurationDialog->show();
 }
 
+// Menu option: Edit->Calibrate USB transfers
+void MainWindow::on_actionCalibrate_USB_transfers_triggered()
+{
+    if (isCaptureRunning || usbDevice->isTransferCalibrationRunning()) return;
+
+    QMessageBox::StandardButton answer = QMessageBox::question(this, "USB transfer calibration",
+            tr("The calibration streams test data from the Domesday Duplicator with a range of USB transfer sizes and "
+               "queue depths, and selects the best for this computer.  It takes around a minute.\n\nStart the calibration?"),
+            QMessageBox::Yes | QMessageBox::No);
+    if (answer != QMessageBox::Yes) return;
+    disarmCapture();
+
+    // Calibrate with the event thread scheduled as it will be for a capture
+    CaptureThreadSettings threadSettings;
+    threadSettings.usbThreadCpus = configuration->getUsbThreadCpus();
+    threadSettings.usbThreadPriority = configuration->getUsbThreadPriority();
+    threadSettings.writerThreadCpus = configuration->getWriterThreadCpus();
+    threadSettings.writerThreadPriority = configuration->getWriterThreadPriority();
+    threadSettings.writerIoPriorityClass = configuration->getWriterIoPriorityClass();
+    threadSettings.writerIoPriorityLevel = configuration->getWriterIoPriorityLevel();
+    threadSettings.diskBufferNumaNode = configuration->getDiskBufferNumaNode();
+    usbDevice->setCaptureThreadSettings(threadSettings);
+
+    if (!usbDevice->startTransferCalibration()) {
+        requestArmedCapture();
+        QMessageBox messageBox;
+        messageBox.critical(this, "Error", usbDevice->getLastError());
+        messageBox.setFixedSize(500, 200);
+        return;
+    }
+
+    // No captures while calibrating
+    ui->capturePushButton->setEnabled(false);
+    ui->actionTest_mode->setEnabled(false);
+    ui->actionCalibrate_USB_transfers->setEnabled(false);
+    ui->actionBench_capture_throughput->setEnabled(false);
+    ui->statusBar->showMessage(tr("Calibrating USB transfers..."));
+}
+
+// Menu option: Edit->Bench capture throughput
+void MainWindow::on_actionBench_capture_throughput_triggered()
+{
+    if (isCaptureRunning || captureBench->isRunning()) return;
+
+    QString source = isUsbDeviceAttached ? tr("the Domesday Duplicator's test data") :
+                                           tr("a synthetic test pattern (no Domesday Duplicator is attached)");
+    bool isOk = false;
+    qint32 durationSeconds = QInputDialog::getInt(this, "Capture throughput bench",
+            tr("The bench captures %1 through the full capture pipeline to the capture directory, using the "
+               "current capture format and thread settings, then deletes the file.\n\nBench duration (seconds):").arg(source),
+            60, 5, 3600, 1, &isOk);
+    if (!isOk) return;
+    disarmCapture();
+
+    // Bench with the capture's own settings
+    applyCaptureThreadTuning();
+    usbDevice->setPipelinedConversion(configuration->getPipelinedConversion());
+    usbDevice->setInPlaceConversion(configuration->getInPlaceConversion());
+    usbDevice->setOverflowHandling(configuration->getContinueOnOverflow(), configuration->getOverflowGapBudget());
+    usbDevice->setTransferGeometry(getTransferGeometry());
+
+    bool isCaptureFormat10Bit = configuration->getCaptureFormat() != Configuration::CaptureFormat::sixteenBitSigned;
+    bool isCaptureFormat10BitDecimated = configuration->getCaptureFormat() == Configuration::CaptureFormat::tenBitCdPacked;
+    if (!captureBench->start(configuration->getCaptureDirectory(), isCaptureFormat10Bit, isCaptureFormat10BitDecimated,
+                             durationSeconds, !isUsbDeviceAttached)) {
+        restoreCaptureThreadTuning();
+        requestArmedCapture();
+        QMessageBox messageBox;
+        messageBox.critical(this, "Error", captureBench->getLastError());
+        messageBox.setFixedSize(500, 200);
+        return;
+    }
+
+    // No captures while benching
+    ui->capturePushButton->setEnabled(false);
+    ui->actionTest_mode->setEnabled(false);
+    ui->actionCalibrate_USB_transfers->setEnabled(false);
+    ui->actionBench_capture_throughput->setEnabled(false);
+    ui->actionPreferences->setEnabled(false);
+}
+
 // Main window - capture button clicked
 QString captureFilename;
 void MainWindow::on_capturePushButton_clicked()
@@ -652,10 +970,13 @@ void MainWindow::on_capturePushButton_clicked()
     if (!isCaptureRunning) {
         // Start capture
 
-        // Ensure that the test mode option matches the device configuration
+        // Ensure that the test mode option matches the device configuration (an armed capture is
+        // already streaming in the selected mode)
         bool isTestMode = ui->actionTest_mode->isChecked();
-        qDebug() << "MainWindow::on_capturePushButton_clicked(): Setting device's test mode flag to" << isTestMode;
-        usbDevice->sendConfigurationCommand(isTestMode);
+        if (!isCaptureArmed) {
+            qDebug() << "MainWindow::on_capturePushButton_clicked(): Setting device's test mode flag to" << isTestMode;
+            usbDevice->sendConfigurationCommand(isTestMode);
+        }
 
         // Construct the capture file path and name
 
@@ -671,8 +992,24 @@ void MainWindow::on_capturePushButton_clicked()
         qDebug() << "MainWindow::on_capturePushButton_clicked(): Starting capture to file:" << captureFilename;
         updateGuiForCaptureStart();
         isCaptureRunning = true;
-
-        if (configuration->getCaptureFormat() == Configuration::CaptureFormat::tenBitPacked) {
+        applyCaptureThreadTuning();
+        usbDevice->setPipelinedConversion(configuration->getPipelinedConversion());
+        usbDevice->setInPlaceConversion(configuration->getInPlaceConversion());
+        usbDevice->setOverflowHandling(configuration->getContinueOnOverflow(), configuration->getOverflowGapBudget());
+        usbDevice->setSignalLossStop(configuration->getSignalLossTime());
+        usbDevice->setTransferGeometry(getTransferGeometry());
+
+        if (isCaptureArmed) {
+            // The armed capture is already streaming - trigger it, so the pre-roll is written first
+            qDebug() << "MainWindow::on_capturePushButton_clicked(): Triggering the armed capture";
+            isCaptureArmed = false;
+            disconnect(usbDevice, &UsbDevice::transferFailed, this, &MainWindow::armedCaptureFailedSignalHandler);
+            ui->statusBar->clearMessage();
+            if (!usbDevice->triggerCapture(captureFilename)) {
+                transferFailedSignalHandler();
+                return;
+            }
+        } else if (configuration->getCaptureFormat() == Configuration::CaptureFormat::tenBitPacked) {
             qDebug() << "MainWindow::on_capturePushButton_clicked(): Starting transfer - 10-bit packed";
             usbDevice->startCapture(captureFilename, true, false, isTestMode);
         } else if (configuration->getCaptureFormat() == Configuration::CaptureFormat::tenBitCdPacked) {
@@ -685,9 +1022,10 @@ void MainWindow::on_capturePushButton_clicked()
 
         qDebug() << "MainWindow::on_capturePushButton_clicked(): Transfer started";
 
-        // Start a timer to display the capture statistics
+        // Reset the capture statistics (they are updated as each disk buffer is written)
         ui->durationLabel->setText(tr("00:00:00"));
-        captureStatusUpdateTimer->start(100); // Update 10 times a second (1000 / 10 = 100)
+        updateCaptureStatistics();
+        storageMonitor->setCaptureRunning(true);
 
         // Start the capture duration timer
         captureElapsedTime = QTime::fromString("00:00:00", "hh:mm:ss");
@@ -700,8 +1038,9 @@ void MainWindow::on_capturePushButton_clicked()
         playerControl->stopAutomaticCapture(); // Stop auto-capture if in progress
         usbDevice->stopCapture();
         isCaptureRunning = false;
-        captureStatusUpdateTimer->stop();
         captureDurationTimer->stop();
+        storageMonitor->setCaptureRunning(false);
+        restoreCaptureThreadTuning();
         disconnect(usbDevice, &UsbDevice::transferFailed, this, &MainWindow::transferFailedSignalHandler);
         // Rename output file if duration checkbox is clicked
         if (advancedNamingDialog->getDurationChecked()) {
@@ -720,12 +1059,83 @@ void MainWindow::on_capturePushButton_clicked()
             int durationIndex = durationFilename.lastIndexOf(".");
             durationFilename.insert(durationIndex, finalDuration);
             QFile::rename(captureFilename, durationFilename);
+            QFile::rename(CaptureLog::logFilename(captureFilename), CaptureLog::logFilename(durationFilename));
+            QFile::rename(CaptureManifest::manifestFilename(captureFilename), CaptureManifest::manifestFilename(durationFilename));
             qDebug() << "MainWindow::on_capturePushButton_clicked(): Renamed file to" << durationFilename;
         }
         updateGuiForCaptureStop();
+
+        // Arm the next capture once this one has finished
+        requestArmedCapture();
     }
 }
 
+// Get the configured CPU affinity and scheduling of the capture threads
+CaptureThreadSettings MainWindow::getCaptureThreadSettings(void)
+{
+    CaptureThreadSettings threadSettings;
+    threadSettings.usbThreadCpus = configuration->getUsbThreadCpus();
+    threadSettings.usbThreadPriority = configuration->getUsbThreadPriority();
+    threadSettings.writerThreadCpus = configuration->getWriterThreadCpus();
+    threadSettings.writerThreadPriority = configuration->getWriterThreadPriority();
+    threadSettings.writerIoPriorityClass = configuration->getWriterIoPriorityClass();
+    threadSettings.writerIoPriorityLevel = configuration->getWriterIoPriorityLevel();
+    threadSettings.diskBufferNumaNode = configuration->getDiskBufferNumaNode();
+    return threadSettings;
+}
+
+// Reserve the capture buffers for the configured settings in advance, so pressing capture
+// (or an automatic capture starting) doesn't wait for them to be allocated
+void MainWindow::reserveCaptureBuffers(void)
+{
+    usbDevice->setCaptureThreadSettings(getCaptureThreadSettings());
+    usbDevice->setInPlaceConversion(configuration->getInPlaceConversion());
+    usbDevice->setOverflowHandling(configuration->getContinueOnOverflow(), configuration->getOverflowGapBudget());
+    usbDevice->setTransferGeometry(getTransferGeometry());
+    usbDevice->reserveCaptureBuffers();
+}
+
+// Arm the capture (with the current settings) once the device is idle, if armed capture is configured
+void MainWindow::requestArmedCapture(void)
+{
+    disarmCapture();
+    if (configuration->getArmedCapture()) armCaptureTimer->start();
+}
+
+// Stop the armed capture (if there is one) without writing anything
+void MainWindow::disarmCapture(void)
+{
+    armCaptureTimer->stop();
+    if (!isCaptureArmed) return;
+
+    qDebug() << "MainWindow::disarmCapture(): Disarming the capture";
+    isCaptureArmed = false;
+    disconnect(usbDevice, &UsbDevice::transferFailed, this, &MainWindow::armedCaptureFailedSignalHandler);
+    usbDevice->disarmCapture();
+    ui->statusBar->clearMessage();
+}
+
+// Apply the configured CPU affinity and scheduling to the threads involved in a capture
+void MainWindow::applyCaptureThreadTuning(void)
+{
+    usbDevice->setCaptureThreadSettings(getCaptureThreadSettings());
+
+    // The player control thread applies its own settings
+    if (!configuration->getPlayerThreadCpus().isEmpty() || configuration->getPlayerThreadPriority() != 0)
+        playerControl->setThreadTuning(configuration->getPlayerThreadCpus(), configuration->getPlayerThreadPriority());
+
+    // Keep the GUI thread away from the capture CPUs
+    guiThreadTuning.apply(configuration->getGuiThreadCpus(), 0);
+}
+
+// Restore the original CPU affinity and scheduling once a capture has stopped
+// (the capture threads restore their own settings as they finish)
+void MainWindow::restoreCaptureThreadTuning(void)
+{
+    playerControl->restoreThreadTuning();
+    guiThreadTuning.restore();
+}
+
 // Limit duration checkbox state changed
 void MainWindow::on_limitDurationCheckBox_stateChanged(int arg1)
 {
@@ -746,10 +1156,12 @@ void MainWindow::transferFailedSignalHandler(void)
     // Stop capture - something has gone wrong
     usbDevice->stopCapture();
     isCaptureRunning = false;
-    captureStatusUpdateTimer->stop();
     captureDurationTimer->stop();
+    storageMonitor->setCaptureRunning(false);
+    restoreCaptureThreadTuning();
     disconnect(usbDevice, &UsbDevice::transferFailed, this, &MainWindow::transferFailedSignalHandler);
     updateGuiForCaptureStop();
+    requestArmedCapture();
 
     // Show an error
     QMessageBox messageBox;
@@ -757,6 +1169,51 @@ void MainWindow::transferFailedSignalHandler(void)
     messageBox.setFixedSize(500, 200);
 }
 
+// Armed capture failed notification signal handler (the stream stopped before the capture was triggered)
+void MainWindow::armedCaptureFailedSignalHandler(void)
+{
+    qDebug() << "MainWindow::armedCaptureFailedSignalHandler(): The armed capture failed -" << usbDevice->getLastError();
+    isCaptureArmed = false;
+    disconnect(usbDevice, &UsbDevice::transferFailed, this, &MainWindow::armedCaptureFailedSignalHandler);
+    usbDevice->stopCapture();
+
+    // It isn't re-armed until the next capture (or change of settings)
+    ui->statusBar->showMessage(tr("The armed capture stopped: %1").arg(usbDevice->getLastError()), 10000);
+}
+
+// Arm a capture whenever the device is idle (if configured).  The device streams into the disk buffers,
+// keeping the last few seconds, so starting a capture commits that pre-roll and carries on writing
+// rather than waiting for the stream to start
+void MainWindow::armCapture(void)
+{
+    if (!configuration->getArmedCapture() || isCaptureArmed || isCaptureRunning || !isUsbDeviceAttached) return;
+    if (usbDevice->isTransferCalibrationRunning() || captureBench->isRunning()) return;
+
+    // Wait for the last capture to finish
+    if (usbDevice->isCaptureRunning()) {
+        armCaptureTimer->start();
+        return;
+    }
+
+    bool isTestMode = ui->actionTest_mode->isChecked();
+    usbDevice->sendConfigurationCommand(isTestMode);
+    usbDevice->setCaptureThreadSettings(getCaptureThreadSettings());
+    usbDevice->setPipelinedConversion(configuration->getPipelinedConversion());
+    usbDevice->setInPlaceConversion(configuration->getInPlaceConversion());
+    usbDevice->setOverflowHandling(configuration->getContinueOnOverflow(), configuration->getOverflowGapBudget());
+    usbDevice->setSignalLossStop(configuration->getSignalLossTime());
+    usbDevice->setTransferGeometry(getTransferGeometry());
+
+    bool isCaptureFormat10Bit = configuration->getCaptureFormat() != Configuration::CaptureFormat::sixteenBitSigned;
+    bool isCaptureFormat10BitDecimated = configuration->getCaptureFormat() == Configuration::CaptureFormat::tenBitCdPacked;
+
+    qDebug() << "MainWindow::armCapture(): Arming the capture";
+    isCaptureArmed = true;
+    connect(usbDevice, &UsbDevice::transferFailed, this, &MainWindow::armedCaptureFailedSignalHandler);
+    usbDevice->armCapture(isCaptureFormat10Bit, isCaptureFormat10BitDecimated, isTestMode, configuration->getPreRollTime());
+    ui->statusBar->showMessage(tr("Capture armed"));
+}
+
 // Update the GUI when capture starts
 void MainWindow::updateGuiForCaptureStart(void)
 {
@@ -764,6 +1221,8 @@ void MainWindow::updateGuiForCaptureStart(void)
     ui->capturePushButton->setText(tr("Stop Capture"));
     ui->capturePushButton->setStyleSheet("background-color: red");
     ui->actionTest_mode->setEnabled(false);
+    ui->actionCalibrate_USB_transfers->setEnabled(false);
+    ui->actionBench_capture_throughput->setEnabled(false);
     ui->actionPreferences->setEnabled(false);
 
     // Make sure the configuration dialogue is closed
@@ -771,6 +1230,11 @@ void MainWindow::updateGuiForCaptureStart(void)
 
     // Reset the capture statistics
     ui->numberOfTransfersLabel->setText(tr("0"));
+    ui->signalLevelLabel->setText(tr("Unknown"));
+    ui->clippingLabel->setText(tr("0 samples"));
+    ui->clippingLabel->setStyleSheet("");
+    ui->diskWritesLabel->setText(tr("Unknown"));
+    ui->diskWritesLabel->setStyleSheet("");
 }
 
 // Update the GUI when capture stops, and flip rename var back to false
@@ -781,9 +1245,24 @@ void MainWindow::updateGuiForCaptureStop(void)
     else ui->capturePushButton->setText(tr("Capture"));
     ui->capturePushButton->setStyleSheet("background-color: none");
     ui->actionTest_mode->setEnabled(true);
+    ui->actionCalibrate_USB_transfers->setEnabled(true);
+    ui->actionBench_capture_throughput->setEnabled(true);
     ui->actionPreferences->setEnabled(true);
 }
 
+// Get the USB transfer geometry for captures (the calibrated geometry is only used on the host it was calibrated on)
+UsbTransferGeometry MainWindow::getTransferGeometry(void)
+{
+    if (!configuration->isTransferGeometryCalibrated()) return UsbCapture::getDefaultTransferGeometry();
+
+    UsbTransferGeometry transferGeometry;
+    transferGeometry.transferSize = configuration->getTransferSize();
+    transferGeometry.simultaneousTransfers = configuration->getSimultaneousTransfers();
+    transferGeometry.transferTimeout = configuration->getTransferTimeout();
+
+    return transferGeometry;
+}
+
 // Update the player remote control dialogue
 void MainWindow::updatePlayerRemoteDialog(void)
 {
@@ -38,11 +38,14 @@
 #include "configurationdialog.h"
 #include "configuration.h"
 #include "usbdevice.h"
+#include "capturebench.h"
 #include "playercommunication.h"
 #include "playercontrol.h"
 #include "playerremotedialog.h"
 #include "automaticcapturedialog.h"
 #include "advancednamingdialog.h"
+#include "storagemonitor.h"
+#include "threadtuning.h"
 
 namespace Ui {
 class MainWindow;
@@ -66,11 +69,19 @@ private slots:
                                                               qint32 startAddress, qint32 endAddress,
                                                               AutomaticCaptureDialog::DiscType discTypeParam);
     void stopAutomaticCaptureDialogSignalHandler(void);
-    void updateAutomaticCaptureStatus(void);
+    void updateAutomaticCaptureStatus(QString status);
     void automaticCaptureCompleteSignalHandler(bool success);
 
     void playerConnectedSignalHandler(void);
     void playerDisconnectedSignalHandler(void);
+    void playerInformationChangedSignalHandler(void);
+    void storageInformationChangedSignalHandler(bool isValid, qint64 bytesAvailable);
+    void captureThroughputWarningSignalHandler(QString message);
+    void captureSignalLostSignalHandler(QString message);
+    void transferCalibrationProgressSignalHandler(qint32 trialNumber, qint32 numberOfTrials);
+    void transferCalibrationCompleteSignalHandler(bool isSuccessful);
+    void captureBenchProgressSignalHandler(qint32 secondsElapsed, qint32 durationSeconds);
+    void captureBenchCompleteSignalHandler(bool isPassed);
 
     void startCaptureSignalHandler(void);
     void stopCaptureSignalHandler(void);
@@ -78,6 +89,8 @@ private slots:
     void updateCaptureStatistics(void);
     void updatePlayerControlInformation(void);
     void transferFailedSignalHandler(void);
+    void armedCaptureFailedSignalHandler(void);
+    void armCapture(void);
     void updateCaptureDuration(void);
     void updateStorageInformation(void);
 
@@ -90,12 +103,17 @@ private slots:
     void on_actionAutomatic_capture_triggered();
     void on_limitDurationCheckBox_stateChanged(int arg1);
     void on_actionAdvanced_naming_triggered();
+    void on_actionCalibrate_USB_transfers_triggered();
+    void on_actionBench_capture_throughput_triggered();
 
 private:
     Configuration *configuration;
     UsbDevice *usbDevice;
+    CaptureBench *captureBench;
     QLabel *usbStatusLabel;
-    QStorageInfo *storageInfo;
+    StorageMonitor *storageMonitor;
+    bool isStorageInfoValid;
+    qint64 storageBytesAvailable;
 
     Ui::MainWindow *ui;
     AboutDialog *aboutDialog;
@@ -106,14 +124,15 @@ private:
     AdvancedNamingDialog *advancedNamingDialog;
 
     bool isCaptureRunning;
-    QTimer *captureStatusUpdateTimer;
-    QTimer *playerControlTimer;
-    QTimer *automaticCaptureTimer;
+    bool isCaptureArmed;
+    QTimer *armCaptureTimer;
+    QTimer *playerControlUpdateTimer;
     QTimer *captureDurationTimer;
     QTime captureElapsedTime;
-    QTimer *storageInfoTimer;
+    ThreadTuning guiThreadTuning;
 
     bool isPlayerConnected;
+    bool isUsbDeviceAttached;
 
     // Remote control states
     PlayerCommunication::DisplayState remoteDisplayState;
@@ -124,7 +143,16 @@ private:
     void updateGuiForCaptureStart(void);
     void updateGuiForCaptureStop(void);
     void startPlayerControl(void);
+    PlayerCommunication::SerialSpeed convertSerialSpeed(Configuration::SerialSpeeds serialSpeed);
+    Configuration::SerialSpeeds convertSerialSpeed(PlayerCommunication::SerialSpeed serialSpeed);
+    CaptureThreadSettings getCaptureThreadSettings(void);
+    void reserveCaptureBuffers(void);
+    void requestArmedCapture(void);
+    void disarmCapture(void);
+    void applyCaptureThreadTuning(void);
+    void restoreCaptureThreadTuning(void);
     void updatePlayerRemoteDialog(void);
+    UsbTransferGeometry getTransferGeometry(void);
 };
 
 #endif // MAINWINDOW_H
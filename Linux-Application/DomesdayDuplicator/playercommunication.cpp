@@ -34,8 +34,24 @@
 #define N_TIMEOUT 5 * 1000
 #define L_TIMEOUT 30 * 1000
 
+// The player is found by sending the model name request at each serial speed in turn.  Each
+// attempt waits for the time taken to send the request and the response at the serial speed
+// (PROBE_CHARACTERS of 10 bits each) plus PROBE_RESPONSE_TIME, or for three times the round-trip
+// time of the request when the player was last connected at that speed, if that is longer
+#define PROBE_CHARACTERS 16
+#define PROBE_RESPONSE_TIME 100
+#define PROBE_ATTEMPTS 2
+
 PlayerCommunication::PlayerCommunication(QObject *parent) : QObject(parent)
 {
+    serialPort = nullptr;
+    stopMarkerState = StopMarkerState::noStopMarker;
+    probeLatency = -1;
+    probeLatencySerialSpeed = SerialSpeed::autoDetect;
+
+    // The transport timer measures the command round-trip times
+    transportTimer.start();
+    resetSerialLatencyStatistics();
 }
 
 PlayerCommunication::~PlayerCommunication()
@@ -66,14 +82,18 @@ PlayerCommunication::~PlayerCommunication()
 // setFramePosition(frameno) - Set the frame position to frameno
 // setTimeCodePosition(timecode) Set the timecode position to timecode
 //
-// setStopFrame(frameno) - Set the stop register (frames)
-// setStopTimeCode(timecode) - Set the stop registed (timecode)
+// setStopFrame(frameno) - Play to the stop marker (frames)
+// setStopTimeCode(timecode) - Play to the stop marker (timecode)
+// getStopMarkerState(timeout) - Returns set, reached or rejected
 //
 // setOnScreenDisplay(state) - Set the on screen display on or off
 // setAudio(audioMode) - Set the audio mode (channels 1 and 2 - on or off)
 // setKeylock(bool) - Set the panel key lock on or off
 //
-// Note: All methods provided by this class are blocking.
+// Note: All methods provided by this class are blocking.  Responses are collected
+// by the serial transport as they arrive and matched to the outstanding commands in
+// order, so several commands can be sent before their responses are read.  The
+// exception is the stop marker, which completes when the player reaches it.
 
 PlayerCommunication::PlayerType PlayerCommunication::playerCodeToType(const QString& playerCode) const
 {
@@ -148,13 +168,22 @@ QString PlayerCommunication::playerCodeToName(const QString &playerCode) const
 // Player connection and disconnection methods ------------------------------------------------------------------------
 
 // Connect to a LaserDisc player
-bool PlayerCommunication::connect(QString serialDevice, SerialSpeed serialSpeed)
+bool PlayerCommunication::connect(QString serialDevice, SerialSpeed serialSpeed, SerialSpeed cachedSerialSpeed)
 {
     bool connectionSuccessful = false;
 
     // Create the serial port object
     serialPort = new QSerialPort();
 
+    // Responses are parsed as they arrive.  The port is used from the player control
+    // thread, which has no event loop - waitForReadyRead() emits readyRead there, so
+    // a direct connection is required.
+    QObject::connect(serialPort, &QSerialPort::readyRead, this, &PlayerCommunication::serialReadyReadSignalHandler,
+                     Qt::DirectConnection);
+    resetSerialTransport();
+    resetSerialLatencyStatistics();
+    stopMarkerState = StopMarkerState::noStopMarker;
+
     // Configure the serial port object
     serialPort->setPortName(serialDevice);
     serialPort->setDataBits(QSerialPort::Data8);
@@ -163,79 +192,64 @@ bool PlayerCommunication::connect(QString serialDevice, SerialSpeed serialSpeed)
     serialPort->setFlowControl(QSerialPort::NoFlowControl);
     //qDebug() << "PlayerCommunication::connect(): Serial port name is" << serialDevice;
 
-    // Define our set of supported baud rates
-    SerialSpeed supportedBaudRates[] = { SerialSpeed::bps9600, SerialSpeed::bps4800, SerialSpeed::bps2400, SerialSpeed::bps1200 };
-    QSerialPort::BaudRate supportedBaudRatesNative[] = { QSerialPort::Baud9600, QSerialPort::Baud4800, QSerialPort::Baud2400, QSerialPort::Baud1200 };
-    unsigned int supportedBaudRatesCount = sizeof(supportedBaudRates) / sizeof(supportedBaudRates[0]);
-
-    // Determine which baud rates to use in the connection attempt, and the timeout and retry settings.
-    unsigned int baudRateIndex = 0;
-    unsigned int baudRateSearchEnd = 0;
-    unsigned int maxConnectAttempts = 1;
-    qint32 serialQueryTimeout = 1500;
-    switch (serialSpeed)
-    {
-    case SerialSpeed::autoDetect:
-        baudRateIndex = 0;
-        baudRateSearchEnd = supportedBaudRatesCount;
-        serialQueryTimeout = 250;
-        maxConnectAttempts = 3;
-        break;
-    case SerialSpeed::bps1200:
-        baudRateIndex = 3;
-        baudRateSearchEnd = baudRateIndex + 1;
-        break;
-    case SerialSpeed::bps2400:
-        baudRateIndex = 2;
-        baudRateSearchEnd = baudRateIndex + 1;
-        break;
-    case SerialSpeed::bps4800:
-        baudRateIndex = 1;
-        baudRateSearchEnd = baudRateIndex + 1;
-        break;
-    case SerialSpeed::bps9600:
-        baudRateIndex = 0;
-        baudRateSearchEnd = baudRateIndex + 1;
-        break;
+    // Probe the serial speed the player was last connected at first, then (when auto-detecting) the
+    // other supported speeds from the fastest
+    SerialSpeed supportedSerialSpeeds[] = { SerialSpeed::bps9600, SerialSpeed::bps4800, SerialSpeed::bps2400, SerialSpeed::bps1200 };
+    QVector<SerialSpeed> probeSerialSpeeds;
+    if (serialSpeed == SerialSpeed::autoDetect) {
+        if (cachedSerialSpeed != SerialSpeed::autoDetect) probeSerialSpeeds.append(cachedSerialSpeed);
+        for (SerialSpeed supportedSerialSpeed : supportedSerialSpeeds) {
+            if (supportedSerialSpeed != cachedSerialSpeed) probeSerialSpeeds.append(supportedSerialSpeed);
+        }
+    } else {
+        probeSerialSpeeds.append(serialSpeed);
+    }
+
+    // The port stays open while the baud rate is changed between probes
+    serialPort->setBaudRate(getBaudRate(probeSerialSpeeds.first()));
+    if (!serialPort->open(QIODevice::ReadWrite)) {
+        //qDebug() << "PlayerCommunication::connect(): Could not open serial port" << serialDevice;
+        return false;
     }
 
     // Attempt to connect to the player
     SerialSpeed detectedSerialSpeed = PlayerCommunication::SerialSpeed::autoDetect;
     QString responseString;
-    while (!connectionSuccessful && (baudRateIndex < baudRateSearchEnd)) {
+    for (qint32 speedNumber = 0; speedNumber < probeSerialSpeeds.size() && !connectionSuccessful; speedNumber++) {
         // Configure the baud rate of the serial port
-        serialPort->setBaudRate(supportedBaudRatesNative[baudRateIndex]);
-        if (!serialPort->open(QIODevice::ReadWrite)) {
-            ++baudRateIndex;
-            continue;
-        }
+        serialPort->setBaudRate(getBaudRate(probeSerialSpeeds[speedNumber]));
+        serialPort->clear();
+        qint32 probeTimeout = getProbeTimeout(probeSerialSpeeds[speedNumber]);
 
         // Attempt to retrieve the player version information
-        for (unsigned int i = 0; i < maxConnectAttempts; ++i) {
+        for (qint32 i = 0; i < PROBE_ATTEMPTS; ++i) {
             // Send the "LVP Model Name Request", as documented in the Pioneer Level III User's Manual for various
             // Laserdisc players.
+            qint64 probeStartTime = transportTimer.nsecsElapsed();
             sendSerialCommand("?X\r");
 
             // Attempt to retrieve the response to the model name request
-            QString response = getSerialResponse(serialQueryTimeout);
+            QString response = getSerialResponse(probeTimeout);
             if (!response.startsWith("P15") || (response.size() < 5)) {
                 continue;
             }
 
             // Retrieve the connection information, and flag that we've successfully connected to the player.
             responseString = response;
-            detectedSerialSpeed = supportedBaudRates[baudRateIndex];
+            detectedSerialSpeed = probeSerialSpeeds[speedNumber];
+            probeLatency = (transportTimer.nsecsElapsed() - probeStartTime) / 1000000;
+            probeLatencySerialSpeed = detectedSerialSpeed;
             connectionSuccessful = true;
             break;
         }
 
-        // If we failed to establish communication with the player, close the serial connection.
-        if (!connectionSuccessful) {
-            serialPort->close();
-        }
-        ++baudRateIndex;
+        // Discard anything left of a failed probe before trying the next speed
+        if (!connectionSuccessful) resetSerialTransport();
     }
 
+    // If we failed to establish communication with the player, close the serial connection.
+    if (!connectionSuccessful) serialPort->close();
+
     // Did the connection fail?
     if (!connectionSuccessful) {
         //qDebug() << "PlayerCommunication::connect(): Could not connect to LaserDisc player";
@@ -255,15 +269,48 @@ bool PlayerCommunication::connect(QString serialDevice, SerialSpeed serialSpeed)
     return true;
 }
 
+// Returns the baud rate of a serial speed
+qint32 PlayerCommunication::getBaudRate(SerialSpeed serialSpeed)
+{
+    switch (serialSpeed) {
+    case SerialSpeed::bps1200:
+        return QSerialPort::Baud1200;
+    case SerialSpeed::bps2400:
+        return QSerialPort::Baud2400;
+    case SerialSpeed::bps4800:
+        return QSerialPort::Baud4800;
+    case SerialSpeed::bps9600:
+    case SerialSpeed::autoDetect:
+        break;
+    }
+    return QSerialPort::Baud9600;
+}
+
+// Returns how long to wait for the player to answer a probe at a serial speed (in milliseconds)
+qint32 PlayerCommunication::getProbeTimeout(SerialSpeed serialSpeed)
+{
+    qint32 probeTimeout = (PROBE_CHARACTERS * 10 * 1000) / getBaudRate(serialSpeed) + PROBE_RESPONSE_TIME;
+    if (serialSpeed == probeLatencySerialSpeed && probeLatency * 3 > probeTimeout) {
+        probeTimeout = static_cast<qint32>(probeLatency * 3);
+    }
+    return probeTimeout;
+}
+
 // Disconnect from a LaserDisc player
 void PlayerCommunication::disconnect(void)
 {
     qDebug() << "PlayerCommunication::disconnect(): Disconnecting from serial port";
+    SerialLatencyStatistics latencyStatistics = getSerialLatencyStatistics();
+    qDebug() << "PlayerCommunication::disconnect():" << latencyStatistics.numberOfResponses << "responses (average" <<
+                latencyStatistics.averageLatency << "mS, maximum" << latencyStatistics.maximumLatency << "mS)," <<
+                latencyStatistics.numberOfTimeouts << "timeouts";
     currentPlayerName = "";
     currentPlayerVersionNumber = "";
     currentPlayerType = none;
     currentSerialSpeed = autoDetect;
     serialPort->close();
+    resetSerialTransport();
+    stopMarkerState = StopMarkerState::noStopMarker;
 }
 
 // Player command methods ---------------------------------------------------------------------------------------------
@@ -408,6 +455,7 @@ QString PlayerCommunication::getUserCode(void)
 qint32 PlayerCommunication::getMaximumFrameNumber(void)
 {
     sendSerialCommand("FR60000SE\r"); // Frame seek to impossible frame number
+    getSerialResponse(L_TIMEOUT);
 
     // Return the current frame number
     return getCurrentFrame();
@@ -416,6 +464,7 @@ qint32 PlayerCommunication::getMaximumFrameNumber(void)
 qint32 PlayerCommunication::getMaximumTimeCode(void)
 {
     sendSerialCommand("FR1595900SE\r"); // Frame seek to impossible time-code frame number
+    getSerialResponse(L_TIMEOUT);
 
     // Return the current time code
     return getCurrentTimeCode();
@@ -623,36 +672,26 @@ bool PlayerCommunication::setPositionChapter(qint32 address)
 
 bool PlayerCommunication::setStopFrame(qint32 frame)
 {
-    QString response;
-
-    (void)frame;
-    qDebug() << "PlayerCommunication::setStopFrame(): Called, but function is not implemented yet";
-
-    // Check for error in response
-    if (response.isEmpty() || response.contains("E", Qt::CaseSensitive)) {
-        // Error
-        return false;
-    }
-
-    // Command response ok
-    return true;
+    return setStopMarker(QString("FR%1PL\r").arg(frame));
 }
 
 bool PlayerCommunication::setStopTimeCode(qint32 timeCode)
 {
-    QString response;
-
-    (void)timeCode;
-    qDebug() << "PlayerCommunication::setStopTimeCode(): Called, but function is not implemented yet";
+    return setStopMarker(QString("FR%1PL\r").arg(timeCode));
+}
 
-    // Check for error in response
-    if (response.isEmpty() || response.contains("E", Qt::CaseSensitive)) {
-        // Error
-        return false;
+// Returns the state of the stop marker, waiting up to the timeout for the player to reach it.  Once
+// the player has reached (or rejected) the stop marker it is cleared
+PlayerCommunication::StopMarkerState PlayerCommunication::getStopMarkerState(qint32 timeoutInMilliseconds)
+{
+    // The completion response is collected by serialReadyReadSignalHandler()
+    if (stopMarkerState == StopMarkerState::stopMarkerSet && serialPort != nullptr && serialPort->isOpen()) {
+        serialPort->waitForReadyRead(timeoutInMilliseconds);
     }
 
-    // Command response ok
-    return true;
+    StopMarkerState state = stopMarkerState;
+    if (state != StopMarkerState::stopMarkerSet) stopMarkerState = StopMarkerState::noStopMarker;
+    return state;
 }
 
 bool PlayerCommunication::setOnScreenDisplay(DisplayState displayState)
@@ -753,44 +792,147 @@ bool PlayerCommunication::setSpeed(qint32 speed)
 
 // Serial read/write methods ------------------------------------------------------------------------------------------
 
-// Send a command via the serial connection
+// Send a command via the serial connection (the response is collected by getSerialResponse)
 void PlayerCommunication::sendSerialCommand(QString command)
 {
     //qDebug() << "PlayerCommunication::sendSerialCommand(): Sending command:" << command;
+    OutstandingCommand outstandingCommand;
+    outstandingCommand.command = command;
+    outstandingCommand.sentTime = transportTimer.nsecsElapsed();
+    outstandingCommand.isComplete = false;
+    outstandingCommands.enqueue(outstandingCommand);
+
     // Maximum command string length is 20 characters
     serialPort->write(command.toUtf8().left(20));
 }
 
-// Receive a response via the serial connection
+// Play to a stop marker.  The player plays on until it reaches the address, then still-frames (CAV)
+// or pauses (CLV) and returns the completion response.  That can be the length of the disc away, so
+// the response isn't waited for - it is picked out of the responses to the other commands sent in
+// the meantime (see isStopMarkerResponse()) and reported by getStopMarkerState()
+bool PlayerCommunication::setStopMarker(QString command)
+{
+    if (serialPort == nullptr || !serialPort->isOpen()) return false;
+
+    //qDebug() << "PlayerCommunication::setStopMarker(): Sending command:" << command;
+    stopMarkerState = StopMarkerState::stopMarkerSet;
+    serialPort->write(command.toUtf8().left(20));
+    return true;
+}
+
+// Returns true if a response is the stop marker's completion rather than the response to the oldest
+// outstanding command.  Only status requests (which never respond with a bare completion or error)
+// are sent while the stop marker is set, other than by the user
+bool PlayerCommunication::isStopMarkerResponse(const QString &response)
+{
+    if (stopMarkerState != StopMarkerState::stopMarkerSet) return false;
+    if (!response.startsWith("R") && !response.startsWith("E")) return false;
+
+    for (qint32 i = 0; i < outstandingCommands.size(); i++) {
+        if (!outstandingCommands[i].isComplete) return outstandingCommands[i].command.startsWith("?");
+    }
+    return true;
+}
+
+// Receive the response to the oldest outstanding command
+// The timeout is measured from when the command was sent.  Returns an empty string on timeout.
 QString PlayerCommunication::getSerialResponse(qint32 timeoutInMilliseconds)
 {
-    QString response;
+    if (outstandingCommands.isEmpty()) {
+        qDebug() << "PlayerCommunication::getSerialResponse(): No command is waiting for a response";
+        return QString();
+    }
+
+    // Wait for the response (waitForReadyRead returns as soon as data arrives)
+    while (!outstandingCommands.head().isComplete) {
+        qint64 remainingTime = static_cast<qint64>(timeoutInMilliseconds) -
+                (transportTimer.nsecsElapsed() - outstandingCommands.head().sentTime) / 1000000;
 
-    // Start the response timer
-    QElapsedTimer responseTimer;
-    responseTimer.start();
+        bool isDataReady = false;
+        if (remainingTime > 0) isDataReady = serialPort->waitForReadyRead(static_cast<int>(remainingTime));
 
-    bool responseComplete = false;
-    bool responseTimedOut = false;
-    while (!responseComplete) {
-        // Get any pending serial responses
-        if (serialPort->waitForReadyRead(100)) {
-            response.append(serialPort->readAll());
+        // Give up on timeout or if the port has failed
+        if (!isDataReady && !outstandingCommands.head().isComplete &&
+                (remainingTime <= 0 || (serialPort->error() != QSerialPort::NoError &&
+                                        serialPort->error() != QSerialPort::TimeoutError))) {
+            //qDebug() << "PlayerCommunication::getSerialResponse(): Serial response timed out!";
 
-            // Check for command response terminator (CR)
-            if (response.contains('\r')) responseComplete = true;
+            // A late response can't be matched to its command, so start again with an empty queue
+            numberOfTimeouts += outstandingCommands.size();
+            resetSerialTransport();
+            serialPort->clear();
+            return QString();
         }
+    }
 
-        // Check for response timeout
-        if ((responseTimer.elapsed() >= static_cast<qint64>(timeoutInMilliseconds)) && (!responseComplete)) {
-            responseTimedOut = true;
-            responseComplete = true;
-            //qDebug() << "PlayerCommunication::getSerialResponse(): Serial response timed out!";
+    return outstandingCommands.dequeue().response;
+}
+
+// Collect the responses received from the player (each is terminated by a CR)
+void PlayerCommunication::serialReadyReadSignalHandler(void)
+{
+    receiveBuffer.append(serialPort->readAll());
+
+    qint32 terminatorPosition;
+    while ((terminatorPosition = receiveBuffer.indexOf('\r')) >= 0) {
+        QString response = QString::fromLatin1(receiveBuffer.left(terminatorPosition + 1));
+        receiveBuffer.remove(0, terminatorPosition + 1);
+
+        // The stop marker completes between the other commands
+        if (isStopMarkerResponse(response)) {
+            if (response.startsWith("R")) stopMarkerState = StopMarkerState::stopMarkerReached;
+            else stopMarkerState = StopMarkerState::stopMarkerRejected;
+            continue;
         }
+
+        // Match the response to the oldest command still waiting for one
+        bool isMatched = false;
+        for (qint32 i = 0; i < outstandingCommands.size(); i++) {
+            if (!outstandingCommands[i].isComplete) {
+                outstandingCommands[i].isComplete = true;
+                outstandingCommands[i].response = response;
+
+                qint64 latency = transportTimer.nsecsElapsed() - outstandingCommands[i].sentTime;
+                numberOfResponses++;
+                totalLatency += latency;
+                if (minimumLatency < 0 || latency < minimumLatency) minimumLatency = latency;
+                if (latency > maximumLatency) maximumLatency = latency;
+
+                isMatched = true;
+                break;
+            }
+        }
+
+        if (!isMatched) qDebug() << "PlayerCommunication::serialReadyReadSignalHandler(): Unexpected response from player -" << response;
     }
+}
 
-    // If the response timed out, clear the response buffer
-    if (responseTimedOut) response.clear();
+// Discard any outstanding commands and partially received responses
+void PlayerCommunication::resetSerialTransport(void)
+{
+    outstandingCommands.clear();
+    receiveBuffer.clear();
+}
+
+void PlayerCommunication::resetSerialLatencyStatistics(void)
+{
+    numberOfResponses = 0;
+    numberOfTimeouts = 0;
+    totalLatency = 0;
+    minimumLatency = -1;
+    maximumLatency = 0;
+}
+
+// Return the round-trip latency statistics for the current connection
+SerialLatencyStatistics PlayerCommunication::getSerialLatencyStatistics(void)
+{
+    SerialLatencyStatistics latencyStatistics;
+    latencyStatistics.numberOfResponses = numberOfResponses;
+    latencyStatistics.numberOfTimeouts = numberOfTimeouts;
+    latencyStatistics.averageLatency = (numberOfResponses > 0) ?
+                (static_cast<double>(totalLatency) / numberOfResponses) / 1000000.0 : 0.0;
+    latencyStatistics.minimumLatency = (minimumLatency >= 0) ? static_cast<double>(minimumLatency) / 1000000.0 : 0.0;
+    latencyStatistics.maximumLatency = static_cast<double>(maximumLatency) / 1000000.0;
 
-    return response;
+    return latencyStatistics;
 }
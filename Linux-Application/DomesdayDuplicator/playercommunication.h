@@ -34,8 +34,19 @@
 #include <QTimer>
 #include <QTimerEvent>
 #include <QElapsedTimer>
+#include <QQueue>
+#include <QVector>
 #include <string>
 
+// Round-trip latency of the commands sent to the player
+struct SerialLatencyStatistics {
+    qint32 numberOfResponses;   // Number of commands that received a response
+    qint32 numberOfTimeouts;    // Number of commands that timed out
+    double averageLatency;      // Average time from sending a command to its response (mS)
+    double minimumLatency;      // Shortest round-trip time (mS)
+    double maximumLatency;      // Longest round-trip time (mS)
+};
+
 class PlayerCommunication : public QObject
 {
     Q_OBJECT
@@ -118,7 +129,14 @@ public:
         frame
     };
 
-    bool connect(QString serialDevice, SerialSpeed serialSpeed);
+    enum StopMarkerState {
+        noStopMarker,
+        stopMarkerSet,          // Playing to the stop marker
+        stopMarkerReached,      // The player has halted on the stop marker
+        stopMarkerRejected      // The player returned an error for the stop marker
+    };
+
+    bool connect(QString serialDevice, SerialSpeed serialSpeed, SerialSpeed cachedSerialSpeed = SerialSpeed::autoDetect);
     void disconnect(void);
     PlayerType getPlayerType(void);
     QString getPlayerName(void);
@@ -145,17 +163,22 @@ public:
 
     bool setStopFrame(qint32 frame);
     bool setStopTimeCode(qint32 timeCode);
+    StopMarkerState getStopMarkerState(qint32 timeoutInMilliseconds);
 
     bool setOnScreenDisplay(DisplayState displayState);
     bool setAudio(AudioState audioState);
     bool setKeyLock(KeyLockState keyLockState);
     bool setSpeed(qint32 speed);
 
+    SerialLatencyStatistics getSerialLatencyStatistics(void);
+
 signals:
 
 private:
     PlayerType playerCodeToType(const QString &playerCode) const;
     QString playerCodeToName(const QString& playerCode) const;
+    qint32 getBaudRate(SerialSpeed serialSpeed);
+    qint32 getProbeTimeout(SerialSpeed serialSpeed);
 
 private:
     QSerialPort *serialPort;
@@ -164,8 +187,40 @@ private:
     QString currentPlayerName;
     QString currentPlayerVersionNumber;
 
+    // Round-trip time of the model name request when the player was last connected (in mS)
+    qint64 probeLatency;
+    SerialSpeed probeLatencySerialSpeed;
+
+    // Serial transport
+    struct OutstandingCommand {
+        QString command;
+        qint64 sentTime;            // Time the command was sent (nS, from transportTimer)
+        bool isComplete;
+        QString response;
+    };
+
+    QQueue<OutstandingCommand> outstandingCommands;
+    QByteArray receiveBuffer;
+    QElapsedTimer transportTimer;
+
+    // The stop marker's completion response isn't matched to a command (see setStopMarker())
+    StopMarkerState stopMarkerState;
+
+    qint32 numberOfResponses;
+    qint32 numberOfTimeouts;
+    qint64 totalLatency;
+    qint64 minimumLatency;
+    qint64 maximumLatency;
+
     void sendSerialCommand(QString command);
+    bool setStopMarker(QString command);
+    bool isStopMarkerResponse(const QString &response);
     QString getSerialResponse(qint32 timeoutInMilliseconds);
+    void resetSerialTransport(void);
+    void resetSerialLatencyStatistics(void);
+
+private slots:
+    void serialReadyReadSignalHandler(void);
 
 public slots:
 };
@@ -27,18 +27,37 @@
 
 #include "playercontrol.h"
 
+// Status polling intervals (in milliseconds).  The player is polled quickly while it
+// is moving to a new position and slowly when it is parked, so the thread only wakes
+// as often as the player's state requires.  User commands wake the thread immediately.
+#define POLL_FAST 20            // Seeking, scanning or automatic capture in progress
+#define POLL_PLAYING 100        // Playing (keeps the position display current)
+#define POLL_PARKED 500         // Stopped, paused or still-frame
+#define FAST_POLL_PERIOD 2000   // Fast polling period following a command or a change of state
+#define RECONNECT_DELAY 200     // Delay between connection attempts
+
+// CAV discs are played to the stop marker from this many frames before the end address
+#define STOP_MARKER_FRAMES 300
+
 PlayerControl::PlayerControl(QObject *parent) : QThread(parent)
 {
     // Thread control variables
     reconnect = false;     // True causes disconnection from player
     abort = false;          // True shuts down the thread and exits
 
+    // Thread tuning variables
+    isThreadTuningPending = false;
+    isThreadTuningRequested = false;
+    threadTuningPriority = 0;
+
     // Player tracking variables
     isPlayerConnected = false;
     playerState = PlayerCommunication::PlayerState::unknownPlayerState;
     discType = PlayerCommunication::DiscType::unknownDiscType;
     timeCode = 0;
     frameNumber = 0;
+    nextPollTime = 0;
+    fastPollUntil = 0;
 
     // Initialise the player communication object
     playerCommunication = new PlayerCommunication();
@@ -47,6 +66,8 @@ PlayerControl::PlayerControl(QObject *parent) : QThread(parent)
     acStatus = tr("Idle");
     acInProgress = false;
     acCancelled = false;
+    acIsStopMarkerSet = false;
+    acIsStopMarkerSupported = true;
 }
 
 PlayerControl::~PlayerControl()
@@ -59,16 +80,19 @@ PlayerControl::~PlayerControl()
     wait();
 }
 
-// Method to set the player connection parameters
+// Method to set the player connection parameters.  When auto-detecting the serial speed, the
+// cached speed (the speed the player was last connected at on the device) is tried first
 void PlayerControl::configurePlayerCommunication(
         QString serialDevice,
-        PlayerCommunication::SerialSpeed serialSpeed)
+        PlayerCommunication::SerialSpeed serialSpeed,
+        PlayerCommunication::SerialSpeed cachedSerialSpeed)
 {
     QMutexLocker locker(&mutex);
 
     // Move all the parameters to be local
     this->serialDevice = serialDevice;
     this->serialSpeed = serialSpeed;
+    this->cachedSerialSpeed = cachedSerialSpeed;
 
     // Make sure the serial device string is not empty
     if (!serialDevice.isEmpty() && !serialDevice.contains("None", Qt::CaseInsensitive)) {
@@ -93,6 +117,25 @@ void PlayerControl::configurePlayerCommunication(
     }
 }
 
+// Set the CPU affinity and real-time priority of the control thread (applied by the thread
+// on its next pass through the control loop)
+void PlayerControl::setThreadTuning(QString cpuList, qint32 realtimePriority)
+{
+    QMutexLocker locker(&mutex);
+    threadTuningCpuList = cpuList;
+    threadTuningPriority = realtimePriority;
+    isThreadTuningRequested = true;
+    isThreadTuningPending = true;
+}
+
+// Return the control thread to its original CPU affinity and scheduling
+void PlayerControl::restoreThreadTuning(void)
+{
+    QMutexLocker locker(&mutex);
+    isThreadTuningRequested = false;
+    isThreadTuningPending = true;
+}
+
 // Main thread processing method
 void PlayerControl::run()
 {
@@ -103,18 +146,41 @@ void PlayerControl::run()
     discType = PlayerCommunication::DiscType::unknownDiscType;
     timeCode = 0;
     frameNumber = 0;
+    pollTimer.start();
+    nextPollTime = 0;
+    fastPollUntil = 0;
 
     // Process the player control loop until abort
     while(!abort) {
+        // Remember the player's state so changes can be notified
+        bool previousIsPlayerConnected = isPlayerConnected;
+        PlayerCommunication::PlayerState previousPlayerState = playerState;
+        PlayerCommunication::DiscType previousDiscType = discType;
+        qint32 previousFrameNumber = frameNumber;
+        qint32 previousTimeCode = timeCode;
+        QString previousAcStatus = acStatus;
+
+        // Apply any change to the thread tuning
+        mutex.lock();
+        if (isThreadTuningPending) {
+            threadTuning.restore();
+            if (isThreadTuningRequested) threadTuning.apply(threadTuningCpuList, threadTuningPriority);
+            isThreadTuningPending = false;
+        }
+        mutex.unlock();
+
         // Are we connected to the player?
         if (!isPlayerConnected && reconnect == false) {
             // Make sure the serial device string is not empty
             // otherwise don't attempt connect to the player
             if (!serialDevice.isEmpty()) {
                 // Connect to the player
-                if (playerCommunication->connect(serialDevice, serialSpeed)) {
-                    // Connection successful
+                if (playerCommunication->connect(serialDevice, serialSpeed, cachedSerialSpeed)) {
+                    // Connection successful (reconnections try the same speed first)
                     isPlayerConnected = true;
+                    cachedSerialSpeed = playerCommunication->getSerialSpeed();
+                    discType = PlayerCommunication::DiscType::unknownDiscType;
+                    nextPollTime = 0;
                     emit playerConnected();
                 }
             }
@@ -122,45 +188,15 @@ void PlayerControl::run()
 
         // If the player is connected, perform processing
         if (isPlayerConnected) {
-            // Perform player control processing here
-
-            // Get the player status
-            playerState = playerCommunication->getPlayerState();
-
-            // If we get an unknown state from the player, attempt to reconnect
-            if (playerState == PlayerCommunication::PlayerState::unknownPlayerState) reconnect = true;
-
-            // Get the disc type
-            discType = playerCommunication->getDiscType();
-
-            // Check we are in a valid state to read the frame/timecode
-            if (playerState == PlayerCommunication::PlayerState::pause ||
-                    playerState == PlayerCommunication::PlayerState::play ||
-                    playerState == PlayerCommunication::PlayerState::stillFrame) {
-
-                // Get the frame or time code
-                if (discType == PlayerCommunication::DiscType::CAV) {
-                    frameNumber = playerCommunication->getCurrentFrame();
-
-                    if (frameNumber == -1) {
-                        qDebug() << "PlayerControl::run(): Lost communication with player";
-                        reconnect = true;
-                    }
-                }
-
-                if (discType == PlayerCommunication::DiscType::CLV) {
-                    timeCode = playerCommunication->getCurrentTimeCode();
+            // User commands take priority over the status polls
+            processCommandQueue();
 
-                    if (timeCode == -1) {
-                        qDebug() << "PlayerControl::run(): Lost communication with player";
-                        reconnect = true;
-                    }
-                }
+            // Poll the player's status when due
+            if (!reconnect && pollTimer.elapsed() >= nextPollTime) {
+                pollPlayerStatus();
+                nextPollTime = pollTimer.elapsed() + getPollInterval();
             }
 
-            // Process the command queue
-            processCommandQueue();
-
             // Process automatic capture
             processAutomaticCapture();
         }
@@ -173,26 +209,44 @@ void PlayerControl::run()
             playerCommunication->disconnect();
         }
 
-        // Sleep the thread to save CPU
+        // Notify if anything displayed about the player has changed
+        if (isPlayerConnected != previousIsPlayerConnected || playerState != previousPlayerState ||
+                discType != previousDiscType || frameNumber != previousFrameNumber || timeCode != previousTimeCode) {
+            emit playerInformationChanged();
+        }
+        if (acStatus != previousAcStatus) emit automaticCaptureStatusChanged(acStatus);
+
+        // Sleep until the next status poll is due (or a command is queued)
+        qint64 waitTime = RECONNECT_DELAY;
         if (isPlayerConnected) {
-            // Sleep the thread for 100uS
-            this->usleep(100);
-        } else {
-            // Sleep the thread for 0.2 seconds
-            this->msleep(200);
+            waitTime = nextPollTime - pollTimer.elapsed();
+            if (acInProgress && waitTime > POLL_FAST) waitTime = POLL_FAST;
+        }
+
+        mutex.lock();
+        if (waitTime > 0 && commandQueue.isEmpty() && !abort && !reconnect && !isThreadTuningPending) {
+            condition.wait(&mutex, static_cast<unsigned long>(waitTime));
         }
+        mutex.unlock();
     }
 
     qDebug() << "PlayerControl::run(): Player control thread has stopped";
+    threadTuning.restore();
+    mutex.lock();
+    isThreadTuningPending = isThreadTuningRequested;
+    mutex.unlock();
     if (isPlayerConnected) playerCommunication->disconnect();
     isPlayerConnected = false;
     emit playerDisconnected();
+    emit playerInformationChanged();
 }
 
 void PlayerControl::stop(void)
 {
     qDebug() << "PlayerControl::stop(): Stopping player control thread";
+    QMutexLocker locker(&mutex);
     abort = true;
+    condition.wakeOne();
 }
 
 QString PlayerControl::getPlayerModelName(void)
@@ -223,6 +277,12 @@ QString PlayerControl::getSerialBaudRate(void)
     return "";
 }
 
+// Get the serial speed the player is connected at (auto-detect if it isn't connected)
+PlayerCommunication::SerialSpeed PlayerControl::getSerialSpeed(void)
+{
+    return playerCommunication->getSerialSpeed();
+}
+
 // Returns a string that indicates the player's status
 QString PlayerControl::getPlayerStatusInformation(void)
 {
@@ -289,60 +349,195 @@ PlayerCommunication::DiscType PlayerControl::getDiscType(void)
 
 // Process the queued commands ----------------------------------------------------------------------------------------
 
-// This method takes commands and parameters from the queue and passes them to
-// the appropriate command processing method
+// These methods take commands and parameters from the queue and pass them to the appropriate command processing
+// method.  A newly queued command supersedes any queued command of the same kind (so only the latest of a burst of
+// seeks is sent to the player) and the queue is emptied before the player's status is polled.
+
+// Queue a command and wake the control thread
+void PlayerControl::queueCommand(PlayerControl::Commands command, qint32 parameter)
+{
+    QMutexLocker locker(&mutex);
+
+    QueuedCommand queuedCommand;
+    queuedCommand.command = command;
+    queuedCommand.parameter = parameter;
+
+    // Step commands accumulate; any other command replaces a queued command of the same kind in
+    // its place in the queue (so it is still sent in order with the other queued commands)
+    bool isReplaced = false;
+    if (command != Commands::cmdStep) {
+        Commands commandGroup = getCommandGroup(command);
+        for (qint32 i = 0; i < commandQueue.size() && !isReplaced; i++) {
+            if (getCommandGroup(commandQueue[i].command) == commandGroup) {
+                commandQueue[i] = queuedCommand;
+                isReplaced = true;
+            }
+        }
+    }
+    if (!isReplaced) commandQueue.enqueue(queuedCommand);
+
+    condition.wakeOne();
+}
+
+// Returns the kind of a command (commands of the same kind supersede each other)
+PlayerControl::Commands PlayerControl::getCommandGroup(PlayerControl::Commands command)
+{
+    switch (command) {
+    // Commands that change the playing mode
+    case Commands::cmdSetPlayerState:
+    case Commands::cmdScan:
+    case Commands::cmdMultiSpeed:
+        return Commands::cmdSetPlayerState;
+    // Commands that seek
+    case Commands::cmdSetPositionFrame:
+    case Commands::cmdSetPositionTimeCode:
+    case Commands::cmdSetPositionChapter:
+        return Commands::cmdSetPositionFrame;
+    // Commands that set the stop marker
+    case Commands::cmdSetStopFrame:
+    case Commands::cmdSetStopTimeCode:
+        return Commands::cmdSetStopFrame;
+    default:
+        return command;
+    }
+}
 
 void PlayerControl::processCommandQueue(void)
 {
-    // If the queue has commands in it, process one
-    if (!commandQueue.isEmpty()) {
-        switch(commandQueue.dequeue()) {
+    bool isCommandProcessed = false;
+
+    // Process all of the queued commands
+    while (!abort && !reconnect) {
+        mutex.lock();
+        if (commandQueue.isEmpty()) {
+            mutex.unlock();
+            break;
+        }
+        QueuedCommand queuedCommand = commandQueue.dequeue();
+        mutex.unlock();
+
+        switch(queuedCommand.command) {
         case Commands::cmdSetTrayState:
-            processSetTrayState(parameterQueue.dequeue());
+            processSetTrayState(queuedCommand.parameter);
             break;
         case Commands::cmdSetPlayerState:
-            processSetPlayerState(parameterQueue.dequeue());
+            processSetPlayerState(queuedCommand.parameter);
             break;
         case Commands::cmdStep:
-            processStep(parameterQueue.dequeue());
+            processStep(queuedCommand.parameter);
             break;
         case Commands::cmdScan:
-            processScan(parameterQueue.dequeue());
+            processScan(queuedCommand.parameter);
             break;
         case Commands::cmdMultiSpeed:
-            processMultiSpeed(parameterQueue.dequeue());
+            processMultiSpeed(queuedCommand.parameter);
             break;
         case Commands::cmdSetPositionFrame:
-            processSetPositionFrame(parameterQueue.dequeue());
+            processSetPositionFrame(queuedCommand.parameter);
             break;
         case Commands::cmdSetPositionTimeCode:
-            processSetPositionTimeCode(parameterQueue.dequeue());
+            processSetPositionTimeCode(queuedCommand.parameter);
             break;
         case Commands::cmdSetPositionChapter:
-            processSetPositionChapter(parameterQueue.dequeue());
+            processSetPositionChapter(queuedCommand.parameter);
             break;
         case Commands::cmdSetStopFrame:
-            processSetStopFrame(parameterQueue.dequeue());
+            processSetStopFrame(queuedCommand.parameter);
             break;
         case Commands::cmdSetStopTimeCode:
-            processSetStopTimeCode(parameterQueue.dequeue());
+            processSetStopTimeCode(queuedCommand.parameter);
             break;
         case Commands::cmdSetOnScreenDisplay:
-            processSetOnScreenDisplay(parameterQueue.dequeue());
+            processSetOnScreenDisplay(queuedCommand.parameter);
             break;
         case Commands::cmdSetAudio:
-            processSetAudio(parameterQueue.dequeue());
+            processSetAudio(queuedCommand.parameter);
             break;
         case Commands::cmdSetKeyLock:
-            processSetKeyLock(parameterQueue.dequeue());
+            processSetKeyLock(queuedCommand.parameter);
             break;
         case Commands::cmdSetSpeed:
-            processSetSpeed(parameterQueue.dequeue());
+            processSetSpeed(queuedCommand.parameter);
             break;
         }
+
+        isCommandProcessed = true;
+    }
+
+    // Follow the player closely while it responds to the commands
+    if (isCommandProcessed) {
+        fastPollUntil = pollTimer.elapsed() + FAST_POLL_PERIOD;
+        nextPollTime = 0;
+    }
+}
+
+// Status polling methods ---------------------------------------------------------------------------------------------
+
+// Get the player's state and position
+void PlayerControl::pollPlayerStatus(void)
+{
+    PlayerCommunication::PlayerState previousPlayerState = playerState;
+    qint32 previousFrameNumber = frameNumber;
+    qint32 previousTimeCode = timeCode;
+
+    // Get the player status
+    playerState = playerCommunication->getPlayerState();
+
+    // If we get an unknown state from the player, attempt to reconnect
+    if (playerState == PlayerCommunication::PlayerState::unknownPlayerState) {
+        reconnect = true;
+        return;
+    }
+
+    // Get the disc type (this can only change along with the player state)
+    if (playerState != previousPlayerState || discType == PlayerCommunication::DiscType::unknownDiscType) {
+        discType = playerCommunication->getDiscType();
+    }
+
+    // Check we are in a valid state to read the frame/timecode
+    if (playerState == PlayerCommunication::PlayerState::pause ||
+            playerState == PlayerCommunication::PlayerState::play ||
+            playerState == PlayerCommunication::PlayerState::stillFrame) {
+
+        // Get the frame or time code
+        if (discType == PlayerCommunication::DiscType::CAV) {
+            frameNumber = playerCommunication->getCurrentFrame();
+
+            if (frameNumber == -1) {
+                qDebug() << "PlayerControl::pollPlayerStatus(): Lost communication with player";
+                reconnect = true;
+            } else {
+                emit playerPositionRead(discType, frameNumber);
+            }
+        }
+
+        if (discType == PlayerCommunication::DiscType::CLV) {
+            timeCode = playerCommunication->getCurrentTimeCode();
+
+            if (timeCode == -1) {
+                qDebug() << "PlayerControl::pollPlayerStatus(): Lost communication with player";
+                reconnect = true;
+            } else {
+                emit playerPositionRead(discType, timeCode);
+            }
+        }
+    }
+
+    // Poll quickly while the player changes state or moves without playing (i.e. seeking or scanning)
+    if (playerState != previousPlayerState || (playerState != PlayerCommunication::PlayerState::play &&
+            (frameNumber != previousFrameNumber || timeCode != previousTimeCode))) {
+        fastPollUntil = pollTimer.elapsed() + FAST_POLL_PERIOD;
     }
 }
 
+// Returns the time until the next status poll according to the player's state (in milliseconds)
+qint64 PlayerControl::getPollInterval(void)
+{
+    if (acInProgress || pollTimer.elapsed() < fastPollUntil) return POLL_FAST;
+    if (playerState == PlayerCommunication::PlayerState::play) return POLL_PLAYING;
+    return POLL_PARKED;
+}
+
 // Command processing methods -----------------------------------------------------------------------------------------
 
 // These private methods send the command to the player communication object
@@ -599,104 +794,106 @@ void PlayerControl::processSetSpeed(qint32 parameter1)
 
 void PlayerControl::setTrayState(PlayerCommunication::TrayState trayState)
 {
-    commandQueue.enqueue(Commands::cmdSetTrayState);
-    if (trayState == PlayerCommunication::TrayState::closed) parameterQueue.enqueue(0);
-    if (trayState == PlayerCommunication::TrayState::open) parameterQueue.enqueue(1);
-    if (trayState == PlayerCommunication::TrayState::unknownTrayState) parameterQueue.enqueue(0);
+    qint32 parameter = 0;
+    if (trayState == PlayerCommunication::TrayState::closed) parameter = 0;
+    if (trayState == PlayerCommunication::TrayState::open) parameter = 1;
+    if (trayState == PlayerCommunication::TrayState::unknownTrayState) parameter = 0;
+    queueCommand(Commands::cmdSetTrayState, parameter);
 }
 
 void PlayerControl::setPlayerState(PlayerCommunication::PlayerState playerState)
 {
-    commandQueue.enqueue(Commands::cmdSetPlayerState);
-    if (playerState == PlayerCommunication::PlayerState::pause) parameterQueue.enqueue(0);
-    if (playerState == PlayerCommunication::PlayerState::play) parameterQueue.enqueue(1);
-    if (playerState == PlayerCommunication::PlayerState::stillFrame) parameterQueue.enqueue(2);
-    if (playerState == PlayerCommunication::PlayerState::stop) parameterQueue.enqueue(3);
-    if (playerState == PlayerCommunication::PlayerState::unknownPlayerState) parameterQueue.enqueue(0);
+    qint32 parameter = 0;
+    if (playerState == PlayerCommunication::PlayerState::pause) parameter = 0;
+    if (playerState == PlayerCommunication::PlayerState::play) parameter = 1;
+    if (playerState == PlayerCommunication::PlayerState::stillFrame) parameter = 2;
+    if (playerState == PlayerCommunication::PlayerState::stop) parameter = 3;
+    if (playerState == PlayerCommunication::PlayerState::unknownPlayerState) parameter = 0;
+    queueCommand(Commands::cmdSetPlayerState, parameter);
 }
 
 void PlayerControl::step(PlayerCommunication::Direction direction)
 {
-    commandQueue.enqueue(Commands::cmdStep);
-    if (direction == PlayerCommunication::Direction::backwards) parameterQueue.enqueue(0);
-    if (direction == PlayerCommunication::Direction::forwards) parameterQueue.enqueue(1);
+    qint32 parameter = 0;
+    if (direction == PlayerCommunication::Direction::backwards) parameter = 0;
+    if (direction == PlayerCommunication::Direction::forwards) parameter = 1;
+    queueCommand(Commands::cmdStep, parameter);
 }
 
 void PlayerControl::scan(PlayerCommunication::Direction direction)
 {
-    commandQueue.enqueue(Commands::cmdScan);
-    if (direction == PlayerCommunication::Direction::backwards) parameterQueue.enqueue(0);
-    if (direction == PlayerCommunication::Direction::forwards) parameterQueue.enqueue(1);
+    qint32 parameter = 0;
+    if (direction == PlayerCommunication::Direction::backwards) parameter = 0;
+    if (direction == PlayerCommunication::Direction::forwards) parameter = 1;
+    queueCommand(Commands::cmdScan, parameter);
 }
 
 void PlayerControl::multiSpeed(PlayerCommunication::Direction direction)
 {
-    commandQueue.enqueue(Commands::cmdMultiSpeed);
-    if (direction == PlayerCommunication::Direction::backwards) parameterQueue.enqueue(0);
-    if (direction == PlayerCommunication::Direction::forwards) parameterQueue.enqueue(1);
+    qint32 parameter = 0;
+    if (direction == PlayerCommunication::Direction::backwards) parameter = 0;
+    if (direction == PlayerCommunication::Direction::forwards) parameter = 1;
+    queueCommand(Commands::cmdMultiSpeed, parameter);
 }
 
 void PlayerControl::setPositionFrame(qint32 address)
 {
-    commandQueue.enqueue(Commands::cmdSetPositionFrame);
-    parameterQueue.enqueue(address);
+    queueCommand(Commands::cmdSetPositionFrame, address);
 }
 
 void PlayerControl::setPositionTimeCode(qint32 address)
 {
-    commandQueue.enqueue(Commands::cmdSetPositionTimeCode);
-    parameterQueue.enqueue(address);
+    queueCommand(Commands::cmdSetPositionTimeCode, address);
 }
 
 void PlayerControl::setPositionChapter(qint32 address)
 {
-    commandQueue.enqueue(Commands::cmdSetPositionChapter);
-    parameterQueue.enqueue(address);
+    queueCommand(Commands::cmdSetPositionChapter, address);
 }
 
 void PlayerControl::setStopFrame(qint32 frame)
 {
-    commandQueue.enqueue(Commands::cmdSetStopFrame);
-    parameterQueue.enqueue(frame);
+    queueCommand(Commands::cmdSetStopFrame, frame);
 }
 
 void PlayerControl::setStopTimeCode(qint32 timeCode)
 {
-    commandQueue.enqueue(Commands::cmdSetStopTimeCode);
-    parameterQueue.enqueue(timeCode);
+    queueCommand(Commands::cmdSetStopTimeCode, timeCode);
 }
 
 void PlayerControl::setOnScreenDisplay(PlayerCommunication::DisplayState displayState)
 {
-    commandQueue.enqueue(Commands::cmdSetOnScreenDisplay);
-    if (displayState == PlayerCommunication::DisplayState::off) parameterQueue.enqueue(0);
-    if (displayState == PlayerCommunication::DisplayState::on) parameterQueue.enqueue(1);
-    if (displayState == PlayerCommunication::DisplayState::unknownDisplayState) parameterQueue.enqueue(0);
+    qint32 parameter = 0;
+    if (displayState == PlayerCommunication::DisplayState::off) parameter = 0;
+    if (displayState == PlayerCommunication::DisplayState::on) parameter = 1;
+    if (displayState == PlayerCommunication::DisplayState::unknownDisplayState) parameter = 0;
+    queueCommand(Commands::cmdSetOnScreenDisplay, parameter);
 }
 
 void PlayerControl::setAudio(PlayerCommunication::AudioState audioState)
 {
-    commandQueue.enqueue(Commands::cmdSetAudio);
-    if (audioState == PlayerCommunication::AudioState::audioOff) parameterQueue.enqueue(0);
-    if (audioState == PlayerCommunication::AudioState::analogCh1) parameterQueue.enqueue(1);
-    if (audioState == PlayerCommunication::AudioState::analogCh2) parameterQueue.enqueue(2);
-    if (audioState == PlayerCommunication::AudioState::analogStereo) parameterQueue.enqueue(3);
-    if (audioState == PlayerCommunication::AudioState::digitalCh1) parameterQueue.enqueue(4);
-    if (audioState == PlayerCommunication::AudioState::digitalCh2) parameterQueue.enqueue(5);
-    if (audioState == PlayerCommunication::AudioState::digitalStereo) parameterQueue.enqueue(6);
+    qint32 parameter = 0;
+    if (audioState == PlayerCommunication::AudioState::audioOff) parameter = 0;
+    if (audioState == PlayerCommunication::AudioState::analogCh1) parameter = 1;
+    if (audioState == PlayerCommunication::AudioState::analogCh2) parameter = 2;
+    if (audioState == PlayerCommunication::AudioState::analogStereo) parameter = 3;
+    if (audioState == PlayerCommunication::AudioState::digitalCh1) parameter = 4;
+    if (audioState == PlayerCommunication::AudioState::digitalCh2) parameter = 5;
+    if (audioState == PlayerCommunication::AudioState::digitalStereo) parameter = 6;
+    queueCommand(Commands::cmdSetAudio, parameter);
 }
 
 void PlayerControl::setKeyLock(PlayerCommunication::KeyLockState keyLockState)
 {
-    commandQueue.enqueue(Commands::cmdSetKeyLock);
-    if (keyLockState == PlayerCommunication::KeyLockState::locked) parameterQueue.enqueue(0);
-    if (keyLockState == PlayerCommunication::KeyLockState::unlocked) parameterQueue.enqueue(1);
+    qint32 parameter = 0;
+    if (keyLockState == PlayerCommunication::KeyLockState::locked) parameter = 0;
+    if (keyLockState == PlayerCommunication::KeyLockState::unlocked) parameter = 1;
+    queueCommand(Commands::cmdSetKeyLock, parameter);
 }
 
 void PlayerControl::setSpeed(qint32 speed)
 {
-    commandQueue.enqueue(Commands::cmdSetSpeed);
-    parameterQueue.enqueue(speed);
+    queueCommand(Commands::cmdSetSpeed, speed);
 }
 
 // Automatic capture methods ------------------------------------------------------------------------------------------
@@ -721,6 +918,8 @@ void PlayerControl::startAutomaticCapture(bool fromLeadIn, bool wholeDisc,
     acStartAddress = startAddress;
     acEndAddress = endAddress;
     acLastSeenAddress = -1;
+    acIsStopMarkerSet = false;
+    acIsStopMarkerSupported = true;
     acCaptureFromLeadIn = fromLeadIn;
     acCaptureWholeDisc = wholeDisc;
     acDiscType = discType;
@@ -737,6 +936,10 @@ void PlayerControl::startAutomaticCapture(bool fromLeadIn, bool wholeDisc,
                 "- endAddress =" << acEndAddress <<
                 "- discType =" << acDiscType <<
                 "- keyLock =" << acKeyLock;
+
+    // Wake the control thread to begin
+    QMutexLocker locker(&mutex);
+    condition.wakeOne();
 }
 
 // Public method to stop an automatic capture
@@ -752,6 +955,9 @@ void PlayerControl::stopAutomaticCapture(void)
 
     // Flag that the capture has been cancelled
     acCancelled = true;
+
+    QMutexLocker locker(&mutex);
+    condition.wakeOne();
 }
 
 // Public method to get the current automatic capture status
@@ -1081,22 +1287,56 @@ PlayerControl::AcStates PlayerControl::acStateWaitForEndAddress(void)
         return nextState;
     }
 
+    // Play to the end address with the player's stop marker, so the player halts on the end address
+    // and the capture is stopped by its completion response.  CAV discs are played with their stop
+    // codes disabled until they are close to the end address (playing to the stop marker obeys them)
+    if (acIsStopMarkerSupported && !acIsStopMarkerSet) {
+        if (acDiscType == PlayerCommunication::DiscType::CAV) {
+            if (acLastSeenAddress >= acEndAddress - STOP_MARKER_FRAMES) {
+                acIsStopMarkerSet = playerCommunication->setStopFrame(acEndAddress);
+            }
+        } else {
+            acIsStopMarkerSet = playerCommunication->setStopTimeCode(acEndAddress);
+        }
+    }
+
+    // Wait for the player to reach the stop marker (in place of the poll interval)
+    bool isStopMarkerReached = false;
+    if (acIsStopMarkerSet) {
+        PlayerCommunication::StopMarkerState stopMarkerState = playerCommunication->getStopMarkerState(POLL_FAST);
+        if (stopMarkerState == PlayerCommunication::StopMarkerState::stopMarkerReached) {
+            isStopMarkerReached = true;
+            acIsStopMarkerSet = false;
+        } else if (stopMarkerState != PlayerCommunication::StopMarkerState::stopMarkerSet) {
+            // The player carries on as it was, so just watch for the end address
+            qDebug() << "PlayerControl::acStateWaitForEndAddress(): The player rejected the stop marker; polling for the end address";
+            acIsStopMarkerSet = false;
+            acIsStopMarkerSupported = false;
+        }
+    }
+
     // Due to stop codes on CAVs it's possible the disc will still-frame
     // during capture.  Here we check for that and start the disc playing
-    // if it occurs
-    if (acDiscType == PlayerCommunication::DiscType::CAV) {
+    // if it occurs (to the stop marker, if it was set)
+    if (acDiscType == PlayerCommunication::DiscType::CAV && !isStopMarkerReached) {
         if (playerCommunication->getPlayerState() == PlayerCommunication::PlayerState::stillFrame) {
             qDebug() << "PlayerControl::acStateWaitForEndAddress(): The player put itself in still-frame; sending play command";
-            playerCommunication->setPlayerState(PlayerCommunication::PlayerState::play);
+            if (acIsStopMarkerSet) acIsStopMarkerSet = playerCommunication->setStopFrame(acEndAddress);
+            else playerCommunication->setPlayerState(PlayerCommunication::PlayerState::play);
 
             // Continue in the present state
             return nextState;
         }
     }
 
+    // The stop marker halts the player on the end address, so (unless the player plays past it) the
+    // end address is only taken as reached once the stop marker has completed.  A stop marker that
+    // completes short of the end address was halted by a stop code (or acknowledged by a player that
+    // doesn't wait for the address), so the end address is polled for from then on
     if (acDiscType == PlayerCommunication::DiscType::CAV) {
         qint32 currentAddress = playerCommunication->getCurrentFrame();
-        if (currentAddress >= acEndAddress) {
+        emit playerPositionRead(acDiscType, currentAddress);
+        if (acIsStopMarkerSet ? (currentAddress > acEndAddress) : (currentAddress >= acEndAddress)) {
             // Target frame number reached
             emit stopCapture();
 
@@ -1104,6 +1344,9 @@ PlayerControl::AcStates PlayerControl::acStateWaitForEndAddress(void)
             playerCommunication->setPlayerState(PlayerCommunication::PlayerState::stop);
 
             nextState = ac_finished_state;
+        } else if (isStopMarkerReached) {
+            qDebug() << "PlayerControl::acStateWaitForEndAddress(): The stop marker completed before the end address; polling for the end address";
+            acIsStopMarkerSupported = false;
         }
 
         if ((acLastSeenAddress - 1000) > currentAddress) {
@@ -1122,7 +1365,8 @@ PlayerControl::AcStates PlayerControl::acStateWaitForEndAddress(void)
         acLastSeenAddress = currentAddress;
     } else {
         qint32 currentAddress = playerCommunication->getCurrentTimeCode();
-        if (playerCommunication->getCurrentTimeCode() >= acEndAddress) {
+        emit playerPositionRead(acDiscType, currentAddress);
+        if (acIsStopMarkerSet ? (currentAddress > acEndAddress) : (currentAddress >= acEndAddress)) {
             // Target time code reached
             emit stopCapture();
 
@@ -1130,6 +1374,9 @@ PlayerControl::AcStates PlayerControl::acStateWaitForEndAddress(void)
             playerCommunication->setPlayerState(PlayerCommunication::PlayerState::pause);
 
             nextState = ac_finished_state;
+        } else if (isStopMarkerReached) {
+            qDebug() << "PlayerControl::acStateWaitForEndAddress(): The stop marker completed before the end address; polling for the end address";
+            acIsStopMarkerSupported = false;
         }
 
         if ((acLastSeenAddress - 1000) > currentAddress) {
@@ -34,9 +34,11 @@
 #include <QWaitCondition>
 #include <QString>
 #include <QQueue>
+#include <QElapsedTimer>
 #include <QDebug>
 
 #include "playercommunication.h"
+#include "threadtuning.h"
 
 class PlayerControl : public QThread
 {
@@ -49,11 +51,15 @@ public:
     void stop(void);
     void configurePlayerCommunication(
             QString serialDevice,
-            PlayerCommunication::SerialSpeed serialSpeed);
+            PlayerCommunication::SerialSpeed serialSpeed,
+            PlayerCommunication::SerialSpeed cachedSerialSpeed = PlayerCommunication::SerialSpeed::autoDetect);
+    void setThreadTuning(QString cpuList, qint32 realtimePriority);
+    void restoreThreadTuning(void);
 
     QString getPlayerModelName(void);
     QString getPlayerVersionNumber(void);
     QString getSerialBaudRate(void);
+    PlayerCommunication::SerialSpeed getSerialSpeed(void);
     QString getPlayerStatusInformation(void);
     QString getPlayerPositionInformation(void);
     PlayerCommunication::DiscType getDiscType(void);
@@ -106,6 +112,9 @@ signals:
 
     void playerConnected(void);
     void playerDisconnected(void);
+    void playerInformationChanged(void);
+    void automaticCaptureStatusChanged(QString status);
+    void playerPositionRead(PlayerCommunication::DiscType discType, qint32 address);
 
 protected:
     void run() override;
@@ -117,6 +126,13 @@ private:
     bool reconnect;
     bool abort;
 
+    // Thread tuning (applied by the control thread itself)
+    ThreadTuning threadTuning;
+    bool isThreadTuningPending;
+    bool isThreadTuningRequested;
+    QString threadTuningCpuList;
+    qint32 threadTuningPriority;
+
     bool isPlayerConnected;
     PlayerCommunication::PlayerState playerState;
     PlayerCommunication::DiscType discType;
@@ -125,6 +141,7 @@ private:
 
     QString serialDevice;
     PlayerCommunication::SerialSpeed serialSpeed;
+    PlayerCommunication::SerialSpeed cachedSerialSpeed;
     PlayerCommunication::PlayerType playerType;
 
     PlayerCommunication *playerCommunication;
@@ -136,6 +153,8 @@ private:
     qint32 acStartAddress;
     qint32 acEndAddress;
     qint32 acLastSeenAddress;
+    bool acIsStopMarkerSet;
+    bool acIsStopMarkerSupported;
     PlayerCommunication::DiscType acDiscType;
     bool acCaptureFromLeadIn;
     bool acCaptureWholeDisc;
@@ -159,11 +178,23 @@ private:
     AcStates acNextState;
     QString acErrorMessage;
 
-    // Command queue
-    QQueue<PlayerControl::Commands> commandQueue;
-    QQueue<qint32> parameterQueue;
+    // Command queue (protected by the mutex)
+    struct QueuedCommand {
+        PlayerControl::Commands command;
+        qint32 parameter;
+    };
+    QQueue<QueuedCommand> commandQueue;
+
+    // Status polling
+    QElapsedTimer pollTimer;
+    qint64 nextPollTime;        // Time the next status poll is due (mS, from pollTimer)
+    qint64 fastPollUntil;       // Poll quickly until this time (mS, from pollTimer)
 
+    void queueCommand(PlayerControl::Commands command, qint32 parameter);
+    static PlayerControl::Commands getCommandGroup(PlayerControl::Commands command);
     void processCommandQueue(void);
+    void pollPlayerStatus(void);
+    qint64 getPollInterval(void);
 
     void processSetTrayState(qint32 parameter1);
     void processSetPlayerState(qint32 parameter1);
@@ -0,0 +1,137 @@
+/************************************************************************
+
+    storagemonitor.cpp
+
+    Capture application for the Domesday Duplicator
+    DomesdayDuplicator - LaserDisc RF sampler
+    Copyright (C) 2018-2019 Simon Inns
+
+    This file is part of Domesday Duplicator.
+
+    Domesday Duplicator is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#include "storagemonitor.h"
+
+// Notes on the storage polling rate:
+//
+// Checking the free space is a statfs() call, so rather than polling at a fixed
+// rate the interval adapts to what is happening.  Whilst the free space is
+// changing (normally because a capture is writing to the disk) the space is
+// checked every MINIMUMINTERVAL milliseconds (or CAPTUREINTERVAL during a
+// capture).  Each check that finds no change doubles the interval up to
+// MAXIMUMINTERVAL, so an idle machine is only checked a couple of times a minute.
+//
+#define MINIMUMINTERVAL 2000
+#define CAPTUREINTERVAL 1000
+#define MAXIMUMINTERVAL 30000
+
+StorageMonitor::StorageMonitor(QObject *parent) : QThread(parent)
+{
+    // Thread control variables
+    refresh = false;
+    abort = false;
+
+    isCaptureRunning = false;
+}
+
+StorageMonitor::~StorageMonitor()
+{
+    mutex.lock();
+    abort = true;
+    condition.wakeOne();
+    mutex.unlock();
+
+    wait();
+}
+
+// Stop the monitoring thread
+void StorageMonitor::stop(void)
+{
+    QMutexLocker locker(&mutex);
+    abort = true;
+    condition.wakeOne();
+}
+
+// Set the path to monitor (the storage is checked immediately)
+void StorageMonitor::setPath(QString path)
+{
+    QMutexLocker locker(&mutex);
+    this->path = path;
+
+    if (!isRunning()) {
+        abort = false;
+        start(LowPriority);
+    } else {
+        refresh = true;
+        condition.wakeOne();
+    }
+}
+
+// Tell the monitor if a capture is running (the storage is checked immediately)
+void StorageMonitor::setCaptureRunning(bool isCaptureRunning)
+{
+    QMutexLocker locker(&mutex);
+    this->isCaptureRunning = isCaptureRunning;
+    refresh = true;
+    condition.wakeOne();
+}
+
+// Main thread processing method
+void StorageMonitor::run()
+{
+    qDebug() << "StorageMonitor::run(): Storage monitor thread has started";
+
+    bool lastIsValid = false;
+    qint64 lastMiBsAvailable = -1;
+    qint32 interval = MINIMUMINTERVAL;
+    bool isFirstCheck = true;
+
+    mutex.lock();
+    while (!abort) {
+        QString currentPath = path;
+        bool isCapturing = isCaptureRunning;
+        bool isRefreshForced = refresh;
+        refresh = false;
+        mutex.unlock();
+
+        // Check the available space
+        QStorageInfo storageInfo(currentPath);
+        bool isValid = storageInfo.isValid() && storageInfo.isReady();
+        qint64 bytesAvailable = isValid ? storageInfo.bytesAvailable() : 0;
+
+        // Only notify when the value (to the nearest MiB) has changed
+        qint64 miBsAvailable = bytesAvailable / 1024 / 1024;
+        bool isChanged = isFirstCheck || isValid != lastIsValid || miBsAvailable != lastMiBsAvailable;
+        if (isChanged || isRefreshForced) emit storageInformationChanged(isValid, bytesAvailable);
+        isFirstCheck = false;
+        lastIsValid = isValid;
+        lastMiBsAvailable = miBsAvailable;
+
+        // Adapt the polling interval
+        if (isCapturing) interval = CAPTUREINTERVAL;
+        else if (isChanged) interval = MINIMUMINTERVAL;
+        else interval = qMin(interval * 2, MAXIMUMINTERVAL);
+
+        // Wait for the next check (or until woken)
+        mutex.lock();
+        if (!abort && !refresh) condition.wait(&mutex, static_cast<unsigned long>(interval));
+    }
+    mutex.unlock();
+
+    qDebug() << "StorageMonitor::run(): Storage monitor thread has stopped";
+}
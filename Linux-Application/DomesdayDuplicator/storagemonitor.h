@@ -0,0 +1,68 @@
+/************************************************************************
+
+    storagemonitor.h
+
+    Capture application for the Domesday Duplicator
+    DomesdayDuplicator - LaserDisc RF sampler
+    Copyright (C) 2018-2019 Simon Inns
+
+    This file is part of Domesday Duplicator.
+
+    Domesday Duplicator is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#ifndef STORAGEMONITOR_H
+#define STORAGEMONITOR_H
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QStorageInfo>
+#include <QString>
+#include <QDebug>
+
+class StorageMonitor : public QThread
+{
+    Q_OBJECT
+
+public:
+    explicit StorageMonitor(QObject *parent = nullptr);
+    ~StorageMonitor() override;
+
+    void stop(void);
+    void setPath(QString path);
+    void setCaptureRunning(bool isCaptureRunning);
+
+signals:
+    void storageInformationChanged(bool isValid, qint64 bytesAvailable);
+
+protected:
+    void run() override;
+
+private:
+    // Thread control
+    QMutex mutex;
+    QWaitCondition condition;
+    bool refresh;
+    bool abort;
+
+    QString path;
+    bool isCaptureRunning;
+};
+
+#endif // STORAGEMONITOR_H
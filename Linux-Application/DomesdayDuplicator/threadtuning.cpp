@@ -0,0 +1,220 @@
+/************************************************************************
+
+    threadtuning.cpp
+
+    Capture application for the Domesday Duplicator
+    DomesdayDuplicator - LaserDisc RF sampler
+    Copyright (C) 2018-2019 Simon Inns
+
+    This file is part of Domesday Duplicator.
+
+    Domesday Duplicator is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#include "threadtuning.h"
+
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#include <sys/syscall.h>
+
+// The I/O priority and memory policy system calls have no glibc wrappers,
+// so the required constants are defined here (see ioprio_set(2) and mbind(2))
+#define IOPRIO_CLASS_SHIFT 13
+#define IOPRIO_WHO_PROCESS 1
+#define IOPRIO_PRIO_VALUE(ioClass, ioData) (((ioClass) << IOPRIO_CLASS_SHIFT) | (ioData))
+#define THREADTUNING_MPOL_BIND 2
+#endif
+
+ThreadTuning::ThreadTuning()
+{
+    isAffinityChanged = false;
+    isSchedulingChanged = false;
+    isIoPriorityChanged = false;
+}
+
+ThreadTuning::~ThreadTuning()
+{
+    if (isAffinityChanged || isSchedulingChanged || isIoPriorityChanged)
+        qDebug() << "ThreadTuning::~ThreadTuning(): Destroyed without restoring the original thread settings";
+}
+
+// Apply the requested settings to the calling thread
+//
+// cpuList: CPUs the thread may run on, such as "2,3" or "4-7" (empty leaves the affinity unchanged)
+// realtimePriority: SCHED_RR priority (0 leaves the scheduling unchanged, -1 selects 3/4 of the way through the range)
+// ioPriorityClass: 1 = real-time, 2 = best-effort or 3 = idle (0 leaves the I/O priority unchanged)
+// ioPriorityLevel: 0 (highest) to 7 (lowest) for the real-time and best-effort classes
+//
+// Returns false if any of the requested settings could not be applied
+bool ThreadTuning::apply(QString cpuList, qint32 realtimePriority, qint32 ioPriorityClass, qint32 ioPriorityLevel)
+{
+    bool isSuccess = true;
+
+#ifdef Q_OS_LINUX
+    // CPU affinity
+    if (!cpuList.trimmed().isEmpty()) {
+        QVector<qint32> cpus = parseCpuList(cpuList);
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        for (qint32 i = 0; i < cpus.size(); i++) {
+            if (cpus[i] >= 0 && cpus[i] < CPU_SETSIZE) CPU_SET(cpus[i], &cpuSet);
+        }
+
+        if (cpus.isEmpty()) {
+            qInfo() << "ThreadTuning::apply(): Ignoring invalid CPU list" << cpuList;
+            isSuccess = false;
+        } else if (sched_getaffinity(0, sizeof(originalAffinity), &originalAffinity) == -1 ||
+                   sched_setaffinity(0, sizeof(cpuSet), &cpuSet) == -1) {
+            qInfo() << "ThreadTuning::apply(): Unable to set the CPU affinity to" << cpuList;
+            isSuccess = false;
+        } else {
+            qDebug() << "ThreadTuning::apply(): CPU affinity set to" << cpuList;
+            isAffinityChanged = true;
+        }
+    }
+
+    // Real-time scheduling
+    if (realtimePriority != 0) {
+        originalSchedPolicy = sched_getscheduler(0);
+        if (originalSchedPolicy == -1) originalSchedPolicy = SCHED_OTHER;
+        if (sched_getparam(0, &originalSchedParam) == -1) originalSchedParam.sched_priority = 0;
+
+        int minSchedPriority = sched_get_priority_min(SCHED_RR);
+        int maxSchedPriority = sched_get_priority_max(SCHED_RR);
+        struct sched_param schedParams;
+        if (minSchedPriority == -1 || maxSchedPriority == -1) {
+            schedParams.sched_priority = 0;
+        } else if (realtimePriority < 0) {
+            // Put the priority about 3/4 of the way through its range
+            schedParams.sched_priority = (minSchedPriority + (3 * maxSchedPriority)) / 4;
+        } else {
+            schedParams.sched_priority = qBound(minSchedPriority, static_cast<int>(realtimePriority), maxSchedPriority);
+        }
+
+        if (sched_setscheduler(0, SCHED_RR, &schedParams) != -1) {
+            qDebug() << "ThreadTuning::apply(): Real-time scheduling enabled with priority" << schedParams.sched_priority;
+            isSchedulingChanged = true;
+        } else {
+            qInfo() << "ThreadTuning::apply(): Unable to enable real-time scheduling";
+            isSuccess = false;
+        }
+    }
+
+    // I/O priority
+    if (ioPriorityClass >= 1 && ioPriorityClass <= 3) {
+        originalIoPriority = static_cast<int>(syscall(SYS_ioprio_get, IOPRIO_WHO_PROCESS, 0));
+        qint32 ioPriorityData = (ioPriorityClass == 3) ? 0 : qBound(0, ioPriorityLevel, 7);
+
+        if (originalIoPriority != -1 &&
+                syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, IOPRIO_PRIO_VALUE(ioPriorityClass, ioPriorityData)) != -1) {
+            qDebug() << "ThreadTuning::apply(): I/O priority set to class" << ioPriorityClass << "level" << ioPriorityData;
+            isIoPriorityChanged = true;
+        } else {
+            qInfo() << "ThreadTuning::apply(): Unable to set the I/O priority";
+            isSuccess = false;
+        }
+    }
+#else
+    if (!cpuList.trimmed().isEmpty() || realtimePriority != 0 || ioPriorityClass != 0) {
+        qDebug() << "ThreadTuning::apply(): Thread tuning is only supported on Linux";
+        isSuccess = false;
+    }
+#endif
+
+    return isSuccess;
+}
+
+// Restore the settings the calling thread had before apply() was called
+void ThreadTuning::restore(void)
+{
+#ifdef Q_OS_LINUX
+    if (isIoPriorityChanged) {
+        if (syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, originalIoPriority) == -1)
+            qDebug() << "ThreadTuning::restore(): Unable to restore the original I/O priority";
+    }
+
+    if (isSchedulingChanged) {
+        if (sched_setscheduler(0, originalSchedPolicy, &originalSchedParam) == -1)
+            qDebug() << "ThreadTuning::restore(): Unable to restore the original scheduling policy";
+    }
+
+    if (isAffinityChanged) {
+        if (sched_setaffinity(0, sizeof(originalAffinity), &originalAffinity) == -1)
+            qDebug() << "ThreadTuning::restore(): Unable to restore the original CPU affinity";
+    }
+#endif
+
+    isAffinityChanged = false;
+    isSchedulingChanged = false;
+    isIoPriorityChanged = false;
+}
+
+// Parse a CPU list such as "0,2,4-7" (returns an empty vector if the list is invalid)
+QVector<qint32> ThreadTuning::parseCpuList(QString cpuList)
+{
+    QVector<qint32> cpus;
+
+    const QStringList ranges = cpuList.split(',');
+    for (const QString &range : ranges) {
+        QString trimmedRange = range.trimmed();
+        if (trimmedRange.isEmpty()) continue;
+
+        bool isFirstOk = false;
+        bool isLastOk = false;
+        qint32 first;
+        qint32 last;
+        if (trimmedRange.contains('-')) {
+            first = trimmedRange.section('-', 0, 0).trimmed().toInt(&isFirstOk);
+            last = trimmedRange.section('-', 1, 1).trimmed().toInt(&isLastOk);
+        } else {
+            first = trimmedRange.toInt(&isFirstOk);
+            last = first;
+            isLastOk = isFirstOk;
+        }
+
+        if (!isFirstOk || !isLastOk || first < 0 || last < first) return QVector<qint32>();
+        for (qint32 cpu = first; cpu <= last; cpu++) cpus.append(cpu);
+    }
+
+    return cpus;
+}
+
+// Bind a memory region to a NUMA node (must be called before the memory is first touched)
+bool ThreadTuning::bindMemoryToNode(void *address, size_t length, qint32 node)
+{
+#ifdef Q_OS_LINUX
+    if (node < 0 || node >= static_cast<qint32>(8 * sizeof(unsigned long)) - 1) return false;
+
+    // mbind requires a page aligned start address
+    quintptr pageSize = static_cast<quintptr>(sysconf(_SC_PAGESIZE));
+    quintptr start = (reinterpret_cast<quintptr>(address) + pageSize - 1) & ~(pageSize - 1);
+    quintptr end = (reinterpret_cast<quintptr>(address) + length) & ~(pageSize - 1);
+    if (end <= start) return false;
+
+    unsigned long nodeMask = 1UL << node;
+    if (syscall(SYS_mbind, start, end - start, THREADTUNING_MPOL_BIND, &nodeMask, 8 * sizeof(unsigned long), 0) == -1) {
+        qDebug() << "ThreadTuning::bindMemoryToNode(): Unable to bind memory to NUMA node" << node;
+        return false;
+    }
+    return true;
+#else
+    (void)address;
+    (void)length;
+    (void)node;
+    return false;
+#endif
+}
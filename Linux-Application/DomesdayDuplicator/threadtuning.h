@@ -0,0 +1,78 @@
+/************************************************************************
+
+    threadtuning.h
+
+    Capture application for the Domesday Duplicator
+    DomesdayDuplicator - LaserDisc RF sampler
+    Copyright (C) 2018-2019 Simon Inns
+
+    This file is part of Domesday Duplicator.
+
+    Domesday Duplicator is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#ifndef THREADTUNING_H
+#define THREADTUNING_H
+
+#include <QString>
+#include <QVector>
+#include <QDebug>
+
+#ifdef Q_OS_LINUX
+#include <sched.h>
+#endif
+
+// Scheduling settings for the capture pipeline threads (see Configuration)
+struct CaptureThreadSettings {
+    QString usbThreadCpus;          // CPU list for the USB capture and libUSB event threads (empty = any CPU)
+    qint32 usbThreadPriority;       // Real-time priority of the libUSB event thread during a capture (-1 = automatic, 0 = normal)
+    QString writerThreadCpus;       // CPU list for the disk writer thread
+    qint32 writerThreadPriority;    // Real-time priority of the disk writer thread
+    qint32 writerIoPriorityClass;   // I/O scheduling class of the disk writer (0 = unchanged, 1 = real-time, 2 = best-effort, 3 = idle)
+    qint32 writerIoPriorityLevel;   // I/O priority level of the disk writer (0 = highest to 7 = lowest)
+    qint32 diskBufferNumaNode;      // NUMA node for the disk buffers (-1 = local to the USB capture thread)
+};
+
+// Applies CPU affinity, real-time scheduling and I/O priority to the calling thread
+// and restores the original settings afterwards.  A ThreadTuning object must be
+// applied and restored by the same thread.
+class ThreadTuning
+{
+public:
+    ThreadTuning();
+    ~ThreadTuning();
+
+    bool apply(QString cpuList, qint32 realtimePriority, qint32 ioPriorityClass = 0, qint32 ioPriorityLevel = 0);
+    void restore(void);
+
+    static QVector<qint32> parseCpuList(QString cpuList);
+    static bool bindMemoryToNode(void *address, size_t length, qint32 node);
+
+private:
+    bool isAffinityChanged;
+    bool isSchedulingChanged;
+    bool isIoPriorityChanged;
+
+#ifdef Q_OS_LINUX
+    cpu_set_t originalAffinity;
+    int originalSchedPolicy;
+    struct sched_param originalSchedParam;
+    int originalIoPriority;
+#endif
+};
+
+#endif // THREADTUNING_H
@@ -0,0 +1,186 @@
+/************************************************************************
+
+    throughputmonitor.cpp
+
+    Capture application for the Domesday Duplicator
+    DomesdayDuplicator - LaserDisc RF sampler
+    Copyright (C) 2018-2019 Simon Inns
+
+    This file is part of Domesday Duplicator.
+
+    Domesday Duplicator is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#include "throughputmonitor.h"
+
+// Notes on overflow prediction:
+//
+// The monitor is sampled regularly with the number of bytes received from the
+// USB device and the number of bytes the disk writer has consumed from the disk
+// buffers.  The difference is the data waiting to be written (the ring occupancy).
+// A least-squares fit of the occupancy over the sliding window gives the rate at
+// which the disk buffers are filling; if it is positive the time remaining until
+// the free space in the disk buffers is used up is predicted.
+//
+// WINDOWLENGTH: The length of the sliding window (nS)
+// MINIMUMWINDOW: The minimum amount of data required before predicting (nS)
+// WARNINGPERIOD: An overflow predicted within this time raises a warning (seconds)
+//
+#define WINDOWLENGTH (10LL * 1000000000LL)
+#define MINIMUMWINDOW (4LL * 1000000000LL)
+#define WARNINGPERIOD 30.0
+
+ThroughputMonitor::ThroughputMonitor(qint64 diskBufferSize, qint32 numberOfDiskBuffers)
+{
+    this->diskBufferSize = diskBufferSize;
+    this->numberOfDiskBuffers = numberOfDiskBuffers;
+    reset();
+}
+
+// Clear all the samples and restart the time-base
+void ThroughputMonitor::reset(void)
+{
+    QMutexLocker locker(&mutex);
+
+    occupancySamples.clear();
+    bufferWriteSamples.clear();
+    elapsedTimer.start();
+
+    statistics.inputRate = 0.0;
+    statistics.writeRate = 0.0;
+    statistics.averageWriteLatency = 0.0;
+    statistics.maximumWriteLatency = 0.0;
+    statistics.ringOccupancy = 0.0;
+    statistics.occupancyTrend = 0.0;
+    statistics.secondsToOverflow = -1.0;
+    statistics.isOverflowPredicted = false;
+}
+
+// Add a sample of the bytes received from the device and the bytes consumed by the disk writer
+void ThroughputMonitor::addSample(qint64 bytesReceived, qint64 bytesConsumed)
+{
+    QMutexLocker locker(&mutex);
+
+    OccupancySample sample;
+    sample.timestamp = elapsedTimer.nsecsElapsed();
+    sample.bytesReceived = bytesReceived;
+    sample.bytesWaiting = bytesReceived - bytesConsumed;
+    if (sample.bytesWaiting < 0) sample.bytesWaiting = 0;
+    occupancySamples.enqueue(sample);
+
+    // Drop samples that have left the window
+    while (!occupancySamples.isEmpty() && occupancySamples.head().timestamp < sample.timestamp - WINDOWLENGTH)
+        occupancySamples.dequeue();
+
+    calculateStatistics();
+}
+
+// Add the result of writing a disk buffer
+void ThroughputMonitor::addBufferWrite(qint64 bytesWritten, qint64 writeTimeNs)
+{
+    QMutexLocker locker(&mutex);
+
+    BufferWriteSample sample;
+    sample.timestamp = elapsedTimer.nsecsElapsed();
+    sample.bytesWritten = bytesWritten;
+    sample.writeTime = writeTimeNs;
+    bufferWriteSamples.enqueue(sample);
+
+    // Drop samples that have left the window (but always keep the last one)
+    while (bufferWriteSamples.size() > 1 && bufferWriteSamples.head().timestamp < sample.timestamp - WINDOWLENGTH)
+        bufferWriteSamples.dequeue();
+
+    calculateStatistics();
+}
+
+// Return the current statistics
+ThroughputStatistics ThroughputMonitor::getStatistics(void)
+{
+    QMutexLocker locker(&mutex);
+    return statistics;
+}
+
+// Calculate the statistics from the samples in the window (mutex must be held)
+void ThroughputMonitor::calculateStatistics(void)
+{
+    // Disk write rate and latency
+    if (!bufferWriteSamples.isEmpty()) {
+        qint64 totalBytes = 0;
+        qint64 totalTime = 0;
+        qint64 maximumTime = 0;
+        for (qint32 i = 0; i < bufferWriteSamples.size(); i++) {
+            totalBytes += bufferWriteSamples[i].bytesWritten;
+            totalTime += bufferWriteSamples[i].writeTime;
+            if (bufferWriteSamples[i].writeTime > maximumTime) maximumTime = bufferWriteSamples[i].writeTime;
+        }
+
+        statistics.averageWriteLatency = (static_cast<double>(totalTime) / bufferWriteSamples.size()) / 1000000.0;
+        statistics.maximumWriteLatency = static_cast<double>(maximumTime) / 1000000.0;
+
+        // The sustained rate is taken over the time the samples span (the first sample's
+        // bytes were written before the span starts, so they are not counted)
+        qint64 span = bufferWriteSamples.last().timestamp - bufferWriteSamples.head().timestamp;
+        if (span > 0) {
+            statistics.writeRate = static_cast<double>(totalBytes - bufferWriteSamples.head().bytesWritten) /
+                    (static_cast<double>(span) / 1000000000.0);
+        }
+    }
+
+    // Ring occupancy and trend
+    if (occupancySamples.isEmpty()) return;
+    statistics.ringOccupancy = static_cast<double>(occupancySamples.last().bytesWaiting) / diskBufferSize;
+
+    qint64 span = occupancySamples.last().timestamp - occupancySamples.head().timestamp;
+    if (span < MINIMUMWINDOW || occupancySamples.size() < 3) {
+        statistics.occupancyTrend = 0.0;
+        statistics.secondsToOverflow = -1.0;
+        statistics.isOverflowPredicted = false;
+        return;
+    }
+
+    statistics.inputRate = static_cast<double>(occupancySamples.last().bytesReceived - occupancySamples.head().bytesReceived) /
+            (static_cast<double>(span) / 1000000000.0);
+
+    // Least-squares fit of the data waiting against time
+    double sumX = 0.0, sumY = 0.0, sumXX = 0.0, sumXY = 0.0;
+    double n = occupancySamples.size();
+    for (qint32 i = 0; i < occupancySamples.size(); i++) {
+        double x = static_cast<double>(occupancySamples[i].timestamp - occupancySamples.head().timestamp) / 1000000000.0;
+        double y = static_cast<double>(occupancySamples[i].bytesWaiting);
+        sumX += x;
+        sumY += y;
+        sumXX += x * x;
+        sumXY += x * y;
+    }
+    double denominator = (n * sumXX) - (sumX * sumX);
+    double fillRate = 0.0; // bytes per second
+    if (denominator > 0.0) fillRate = ((n * sumXY) - (sumX * sumY)) / denominator;
+    statistics.occupancyTrend = fillRate / diskBufferSize;
+
+    // Predict the time to overflow (ignoring trends that are less than 1% of the input rate)
+    double bytesFree = static_cast<double>((diskBufferSize * numberOfDiskBuffers) - occupancySamples.last().bytesWaiting);
+    if (bytesFree < 0.0) bytesFree = 0.0;
+    if (fillRate > (statistics.inputRate / 100.0) && fillRate > 0.0) {
+        statistics.secondsToOverflow = bytesFree / fillRate;
+    } else {
+        statistics.secondsToOverflow = -1.0;
+    }
+
+    // Warn if an overflow is predicted soon, or if there is less than one disk buffer free
+    statistics.isOverflowPredicted = (statistics.secondsToOverflow >= 0.0 && statistics.secondsToOverflow < WARNINGPERIOD) ||
+            (bytesFree < diskBufferSize);
+}
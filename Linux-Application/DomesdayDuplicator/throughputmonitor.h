@@ -0,0 +1,83 @@
+/************************************************************************
+
+    throughputmonitor.h
+
+    Capture application for the Domesday Duplicator
+    DomesdayDuplicator - LaserDisc RF sampler
+    Copyright (C) 2018-2019 Simon Inns
+
+    This file is part of Domesday Duplicator.
+
+    Domesday Duplicator is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#ifndef THROUGHPUTMONITOR_H
+#define THROUGHPUTMONITOR_H
+
+#include <QMutex>
+#include <QElapsedTimer>
+#include <QQueue>
+#include <QDebug>
+
+// Measured write throughput of a capture (taken over a sliding window)
+struct ThroughputStatistics {
+    double inputRate;               // Data received from the USB device (bytes per second)
+    double writeRate;               // Data written to disk in the output format (bytes per second)
+    double averageWriteLatency;     // Average time taken to write a disk buffer (mS)
+    double maximumWriteLatency;     // Longest time taken to write a disk buffer (mS)
+    double ringOccupancy;           // Data waiting in the disk buffers (as a number of disk buffers)
+    double occupancyTrend;          // Rate of change of the data waiting (disk buffers per second)
+    double secondsToOverflow;       // Predicted time until the disk buffers overflow (-1 if they are not filling)
+    bool isOverflowPredicted;       // True if an overflow is predicted within the warning period
+};
+
+class ThroughputMonitor
+{
+public:
+    explicit ThroughputMonitor(qint64 diskBufferSize, qint32 numberOfDiskBuffers);
+
+    void reset(void);
+    void addSample(qint64 bytesReceived, qint64 bytesConsumed);
+    void addBufferWrite(qint64 bytesWritten, qint64 writeTimeNs);
+    ThroughputStatistics getStatistics(void);
+
+private:
+    struct OccupancySample {
+        qint64 timestamp;       // nS since the monitor was reset
+        qint64 bytesReceived;
+        qint64 bytesWaiting;
+    };
+
+    struct BufferWriteSample {
+        qint64 timestamp;       // nS since the monitor was reset
+        qint64 bytesWritten;
+        qint64 writeTime;       // nS
+    };
+
+    QMutex mutex;
+    QElapsedTimer elapsedTimer;
+    qint64 diskBufferSize;
+    qint32 numberOfDiskBuffers;
+
+    QQueue<OccupancySample> occupancySamples;
+    QQueue<BufferWriteSample> bufferWriteSamples;
+    ThroughputStatistics statistics;
+
+    void calculateStatistics(void);
+};
+
+#endif // THROUGHPUTMONITOR_H
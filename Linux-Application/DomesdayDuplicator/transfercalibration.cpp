@@ -0,0 +1,403 @@
+/************************************************************************
+
+    transfercalibration.cpp
+
+    Capture application for the Domesday Duplicator
+    DomesdayDuplicator - LaserDisc RF sampler
+    Copyright (C) 2018-2019 Simon Inns
+
+    This file is part of Domesday Duplicator.
+
+    Domesday Duplicator is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+
+#include "transfercalibration.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <QElapsedTimer>
+
+// Each trial discards TRIALWARMUP ms of transfers and then measures for TRIALDURATION ms
+#define TRIALWARMUP 250
+#define TRIALDURATION 2000
+
+// The device delivers 40 MSPS of 16-bit samples.  To be selected a geometry must sustain at
+// least MINIMUMTHROUGHPUT of that rate, and the queued transfers should hold MINIMUMHEADROOM
+// times the longest time seen between transfer completions
+#define DEVICERATE (40000000.0 * 2.0)
+#define MINIMUMTHROUGHPUT 0.98
+#define MINIMUMHEADROOM 4.0
+
+// LibUSB call-back handling code -------------------------------------------------------------------------------------
+
+// State of a trial shared with its transfer call-backs (which run on the libUSB event thread)
+struct calibrationTrialStruct {
+    QElapsedTimer timer;
+    std::atomic<qint32> transfersInFlight;
+    std::atomic<bool> isMeasuring;
+    std::atomic<bool> isStopping;
+    std::atomic<bool> isFailed;
+
+    // Only accessed by the call-backs until the trial's transfers have drained (times in nS)
+    qint32 lastTestDataValue;
+    qint64 patternErrors;
+    qint64 bytesMeasured;
+    qint64 previousCompletion;
+    qint64 numberOfIntervals;
+    double intervalSum;
+    double intervalSquaredSum;
+    double maximumInterval;
+    double maximumLatency;
+};
+
+// User-data passed with each calibration transfer
+struct calibrationTransferStruct {
+    calibrationTrialStruct *trial;
+    qint64 submitTime;
+};
+
+// LibUSB transfer call-back handler for the calibration trials
+static void LIBUSB_CALL calibrationTransferCallback(struct libusb_transfer *transfer)
+{
+    calibrationTransferStruct *transferData = static_cast<calibrationTransferStruct *>(transfer->user_data);
+    calibrationTrialStruct *trial = transferData->trial;
+    qint64 completionTime = trial->timer.nsecsElapsed();
+
+    if (transfer->status != LIBUSB_TRANSFER_COMPLETED || transfer->actual_length != transfer->length) {
+        qDebug() << "calibrationTransferCallback(): Transfer failed with status" << transfer->status;
+        trial->isFailed = true;
+    } else {
+        // The test data is a 10-bit counter in 16-bit words - check that it runs through the transfer
+        // and on from the previous transfer (cheap enough not to disturb the timing)
+        const unsigned char *data = transfer->buffer;
+        qint32 length = transfer->actual_length;
+        qint32 firstValue = data[0] + data[1] * 256;
+        qint32 lastValue = data[length - 2] + data[length - 1] * 256;
+
+        if (trial->isMeasuring) {
+            if (trial->lastTestDataValue != -1 && firstValue != (trial->lastTestDataValue + 1) % 1024) trial->patternErrors++;
+            if (lastValue != (firstValue + (length / 2) - 1) % 1024) trial->patternErrors++;
+
+            // Record the completion interval and latency
+            if (trial->previousCompletion >= 0) {
+                double interval = static_cast<double>(completionTime - trial->previousCompletion);
+                trial->numberOfIntervals++;
+                trial->intervalSum += interval;
+                trial->intervalSquaredSum += interval * interval;
+                if (interval > trial->maximumInterval) trial->maximumInterval = interval;
+            }
+
+            double latency = static_cast<double>(completionTime - transferData->submitTime);
+            if (latency > trial->maximumLatency) trial->maximumLatency = latency;
+
+            trial->bytesMeasured += length;
+        }
+
+        trial->lastTestDataValue = lastValue;
+        trial->previousCompletion = completionTime;
+    }
+
+    // Re-submit the transfer until the trial stops
+    if (!trial->isStopping && !trial->isFailed) {
+        transferData->submitTime = trial->timer.nsecsElapsed();
+        if (libusb_submit_transfer(transfer) == 0) return;
+
+        qDebug() << "calibrationTransferCallback(): Transfer re-submission failed!";
+        trial->isFailed = true;
+    }
+
+    trial->transfersInFlight--;
+}
+
+// TransferCalibration class code -------------------------------------------------------------------------------------
+
+// Class constructor
+TransferCalibration::TransferCalibration(QObject *parent, libusb_device_handle *usbDeviceHandleParam) : QThread(parent)
+{
+    usbDeviceHandle = usbDeviceHandleParam;
+    threadAbort = false;
+    bestResult = -1;
+    lastError = tr("None");
+}
+
+// Class destructor
+TransferCalibration::~TransferCalibration()
+{
+    threadAbort = true;
+    this->wait();
+}
+
+// Stop the calibration (the current trial is abandoned)
+void TransferCalibration::stop(void)
+{
+    threadAbort = true;
+}
+
+// Get the results of the trials run so far
+QVector<TransferCalibrationResult> TransferCalibration::getResults(void)
+{
+    QMutexLocker locker(&resultsMutex);
+    return results;
+}
+
+// Returns true if the calibration found a usable geometry
+bool TransferCalibration::isBestGeometryFound(void)
+{
+    QMutexLocker locker(&resultsMutex);
+    return bestResult >= 0;
+}
+
+// Get the selected geometry (the timeout allows 4 times the longest latency seen, and at least a second)
+UsbTransferGeometry TransferCalibration::getBestGeometry(void)
+{
+    QMutexLocker locker(&resultsMutex);
+    if (bestResult < 0) return UsbCapture::getDefaultTransferGeometry();
+
+    UsbTransferGeometry transferGeometry = results[bestResult].transferGeometry;
+    qint32 latencyTimeout = static_cast<qint32>(std::ceil(results[bestResult].maximumLatency * 4.0 / 100.0)) * 100;
+    transferGeometry.transferTimeout = qMax(1000, latencyTimeout);
+
+    return transferGeometry;
+}
+
+// Get the last error
+QString TransferCalibration::getLastError(void)
+{
+    return lastError;
+}
+
+// Run the calibration thread
+void TransferCalibration::run(void)
+{
+    qDebug() << "TransferCalibration::run(): Starting USB transfer calibration";
+
+    // Build the list of geometries to try (skipping any that the usbfs memory limit won't allow)
+    QVector<UsbTransferGeometry> trials;
+    for (qint32 transferSize = MINTRANSFERSIZE; transferSize <= MAXTRANSFERSIZE; transferSize *= 2) {
+        for (qint32 simultaneousTransfers = MINSIMULTANEOUSTRANSFERS; simultaneousTransfers <= MAXSIMULTANEOUSTRANSFERS;
+             simultaneousTransfers *= 2) {
+            UsbTransferGeometry transferGeometry;
+            transferGeometry.transferSize = transferSize;
+            transferGeometry.simultaneousTransfers = simultaneousTransfers;
+            transferGeometry.transferTimeout = 1000;
+
+            if (UsbCapture::isTransferGeometryValid(transferGeometry)) trials.append(transferGeometry);
+        }
+    }
+
+    if (usbDeviceHandle == nullptr || trials.isEmpty()) {
+        lastError = tr("The USB device is not open");
+        if (trials.isEmpty()) lastError = tr("The usbfs memory limit does not allow any transfer geometry");
+        emit calibrationComplete(false);
+        return;
+    }
+
+    // Run the trials
+    for (qint32 trialNumber = 0; trialNumber < trials.size() && !threadAbort; trialNumber++) {
+        emit calibrationProgress(trialNumber, trials.size());
+
+        TransferCalibrationResult result = runTrial(trials[trialNumber]);
+        qDebug() << "TransferCalibration::run():" << result.transferGeometry.simultaneousTransfers << "x" <<
+                    result.transferGeometry.transferSize / 1024 << "Kbytes -" << (result.isSuccessful ? "OK" : "failed") <<
+                    "throughput" << result.throughput << "MB/s, interval" << result.meanInterval << "ms, jitter" <<
+                    result.intervalJitter << "ms, maximum interval" << result.maximumInterval << "ms, headroom" << result.headroom;
+
+        resultsMutex.lock();
+        results.append(result);
+        resultsMutex.unlock();
+    }
+
+    if (threadAbort) {
+        qDebug() << "TransferCalibration::run(): Calibration cancelled";
+        lastError = tr("The calibration was cancelled");
+        emit calibrationComplete(false);
+        return;
+    }
+
+    emit calibrationProgress(trials.size(), trials.size());
+
+    // Select the best geometry
+    resultsMutex.lock();
+    bestResult = selectBestResult();
+    resultsMutex.unlock();
+
+    if (bestResult < 0) {
+        qDebug() << "TransferCalibration::run(): No transfer geometry sustained the device's data rate";
+        lastError = tr("No transfer geometry sustained the device's data rate");
+        emit calibrationComplete(false);
+        return;
+    }
+
+    qDebug() << "TransferCalibration::run(): Calibration complete";
+    emit calibrationComplete(true);
+}
+
+// Stream the test data with the given geometry and measure the throughput and completion jitter
+TransferCalibrationResult TransferCalibration::runTrial(UsbTransferGeometry transferGeometry)
+{
+    TransferCalibrationResult result;
+    result.transferGeometry = transferGeometry;
+    result.isSuccessful = false;
+    result.throughput = 0.0;
+    result.meanInterval = 0.0;
+    result.intervalJitter = 0.0;
+    result.maximumInterval = 0.0;
+    result.maximumLatency = 0.0;
+    result.headroom = 0.0;
+
+    qint32 transferSize = transferGeometry.transferSize;
+    qint32 numberOfTransfers = transferGeometry.simultaneousTransfers;
+
+    calibrationTrialStruct trial;
+    trial.transfersInFlight = 0;
+    trial.isMeasuring = false;
+    trial.isStopping = false;
+    trial.isFailed = false;
+    trial.lastTestDataValue = -1;
+    trial.patternErrors = 0;
+    trial.bytesMeasured = 0;
+    trial.previousCompletion = -1;
+    trial.numberOfIntervals = 0;
+    trial.intervalSum = 0.0;
+    trial.intervalSquaredSum = 0.0;
+    trial.maximumInterval = 0.0;
+    trial.maximumLatency = 0.0;
+
+    unsigned char *trialBuffer = static_cast<unsigned char *>(malloc(static_cast<size_t>(transferSize) * numberOfTransfers));
+    if (trialBuffer == nullptr) {
+        qDebug() << "TransferCalibration::runTrial(): Could not allocate the transfer buffers";
+        return result;
+    }
+
+    QVector<struct libusb_transfer *> transfers(numberOfTransfers, nullptr);
+    QVector<calibrationTransferStruct> transferData(numberOfTransfers);
+
+    // Submit the transfers
+    trial.timer.start();
+    for (qint32 transferNumber = 0; transferNumber < numberOfTransfers && !trial.isFailed; transferNumber++) {
+        transfers[transferNumber] = libusb_alloc_transfer(0);
+        if (transfers[transferNumber] == nullptr) {
+            trial.isFailed = true;
+            break;
+        }
+
+        transferData[transferNumber].trial = &trial;
+        transferData[transferNumber].submitTime = trial.timer.nsecsElapsed();
+        libusb_fill_bulk_transfer(transfers[transferNumber], usbDeviceHandle, 0x81, trialBuffer + (transferSize * transferNumber),
+                                  transferSize, calibrationTransferCallback, &transferData[transferNumber],
+                                  static_cast<quint32>(transferGeometry.transferTimeout));
+        transfers[transferNumber]->flags = LIBUSB_TRANSFER_SHORT_NOT_OK;
+
+        qint32 resultCode = libusb_submit_transfer(transfers[transferNumber]);
+        if (resultCode < 0) {
+            qDebug() << "TransferCalibration::runTrial(): Transfer submission failed with error:" << libusb_error_name(resultCode);
+            trial.isFailed = true;
+        } else {
+            trial.transfersInFlight++;
+        }
+    }
+
+    // Let the transfers settle, then measure
+    qint64 measurementStart = 0;
+    qint64 measurementEnd = 0;
+    if (!trial.isFailed) {
+        this->msleep(TRIALWARMUP);
+
+        measurementStart = trial.timer.nsecsElapsed();
+        trial.isMeasuring = true;
+        while (!threadAbort && !trial.isFailed && (trial.timer.nsecsElapsed() - measurementStart) < TRIALDURATION * 1000000LL) {
+            this->msleep(10);
+        }
+        trial.isMeasuring = false;
+        measurementEnd = trial.timer.nsecsElapsed();
+    }
+
+    // Stop and wait for the in-flight transfers to drain (cancelling them if they stall)
+    trial.isStopping = true;
+    QElapsedTimer drainTimer;
+    drainTimer.start();
+    bool isCancelled = false;
+    while (trial.transfersInFlight > 0) {
+        if (!isCancelled && drainTimer.elapsed() > transferGeometry.transferTimeout + 1000) {
+            qDebug() << "TransferCalibration::runTrial(): Transfers did not drain - cancelling";
+            for (qint32 transferNumber = 0; transferNumber < numberOfTransfers; transferNumber++) {
+                if (transfers[transferNumber] != nullptr) libusb_cancel_transfer(transfers[transferNumber]);
+            }
+            isCancelled = true;
+        }
+        this->msleep(1);
+    }
+
+    for (qint32 transferNumber = 0; transferNumber < numberOfTransfers; transferNumber++) {
+        if (transfers[transferNumber] != nullptr) libusb_free_transfer(transfers[transferNumber]);
+    }
+    free(trialBuffer);
+
+    if (trial.patternErrors > 0) qDebug() << "TransferCalibration::runTrial():" << trial.patternErrors << "test data errors";
+
+    // Calculate the results (in Mbytes/second and milliseconds)
+    double measurementTime = static_cast<double>(measurementEnd - measurementStart) / 1e9;
+    if (measurementTime > 0.0) result.throughput = static_cast<double>(trial.bytesMeasured) / measurementTime / 1e6;
+
+    if (trial.numberOfIntervals > 0) {
+        double meanInterval = trial.intervalSum / trial.numberOfIntervals;
+        double variance = (trial.intervalSquaredSum / trial.numberOfIntervals) - (meanInterval * meanInterval);
+        result.meanInterval = meanInterval / 1e6;
+        result.intervalJitter = std::sqrt(qMax(variance, 0.0)) / 1e6;
+        result.maximumInterval = trial.maximumInterval / 1e6;
+    }
+    result.maximumLatency = trial.maximumLatency / 1e6;
+
+    if (result.maximumInterval > 0.0) {
+        double queuedTime = (static_cast<double>(transferSize) * numberOfTransfers / DEVICERATE) * 1000.0;
+        result.headroom = queuedTime / result.maximumInterval;
+    }
+
+    result.isSuccessful = !threadAbort && !trial.isFailed && trial.patternErrors == 0 && trial.numberOfIntervals > 0;
+    return result;
+}
+
+// Select the best result - the least in-flight memory that keeps up with the device with enough headroom
+// (lower jitter breaks ties).  If no geometry has enough headroom the one with the most is used.
+qint32 TransferCalibration::selectBestResult(void)
+{
+    qint32 best = -1;
+
+    for (qint32 resultNumber = 0; resultNumber < results.size(); resultNumber++) {
+        const TransferCalibrationResult &result = results[resultNumber];
+        if (!result.isSuccessful || result.throughput * 1e6 < DEVICERATE * MINIMUMTHROUGHPUT) continue;
+
+        if (best < 0) {
+            best = resultNumber;
+            continue;
+        }
+
+        const TransferCalibrationResult &current = results[best];
+        qint64 memory = static_cast<qint64>(result.transferGeometry.transferSize) * result.transferGeometry.simultaneousTransfers;
+        qint64 currentMemory = static_cast<qint64>(current.transferGeometry.transferSize) * current.transferGeometry.simultaneousTransfers;
+
+        if (result.headroom >= MINIMUMHEADROOM) {
+            if (current.headroom < MINIMUMHEADROOM || memory < currentMemory ||
+                    (memory == currentMemory && result.intervalJitter < current.intervalJitter)) best = resultNumber;
+        } else if (current.headroom < MINIMUMHEADROOM && result.headroom > current.headroom) {
+            best = resultNumber;
+        }
+    }
+
+    return best;
+}
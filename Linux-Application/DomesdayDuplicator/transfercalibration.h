@@ -0,0 +1,91 @@
+/************************************************************************
+
+    transfercalibration.h
+
+    Capture application for the Domesday Duplicator
+    DomesdayDuplicator - LaserDisc RF sampler
+    Copyright (C) 2018-2019 Simon Inns
+
+    This file is part of Domesday Duplicator.
+
+    Domesday Duplicator is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+
+#ifndef TRANSFERCALIBRATION_H
+#define TRANSFERCALIBRATION_H
+
+#include <QObject>
+#include <QThread>
+#include <QVector>
+#include <QMutex>
+#include <QDebug>
+
+#include <libusb.h>
+#include <atomic>
+
+#include "usbcapture.h"
+
+// The measured performance of a single transfer geometry
+struct TransferCalibrationResult {
+    UsbTransferGeometry transferGeometry;
+    bool isSuccessful;              // True if the trial ran without transfer or test data errors
+    double throughput;              // Sustained throughput (in Mbytes/second)
+    double meanInterval;            // Mean time between transfer completions (in ms)
+    double intervalJitter;          // Standard deviation of the time between completions (in ms)
+    double maximumInterval;         // Longest time between completions (in ms)
+    double maximumLatency;          // Longest time from submission to completion (in ms)
+    double headroom;                // Capture time held by the queued transfers / longest completion interval
+};
+
+// Sweeps the USB transfer size and queue depth against the device's test data pattern and
+// selects the geometry best suited to the host's USB controller.  The device must be open with
+// test mode selected, and libUSB events must be handled by another thread (see UsbDevice).
+class TransferCalibration : public QThread
+{
+    Q_OBJECT
+public:
+    explicit TransferCalibration(QObject *parent = nullptr, libusb_device_handle *usbDeviceHandleParam = nullptr);
+    ~TransferCalibration() override;
+
+    void stop(void);
+    QVector<TransferCalibrationResult> getResults(void);
+    bool isBestGeometryFound(void);
+    UsbTransferGeometry getBestGeometry(void);
+    QString getLastError(void);
+
+signals:
+    void calibrationProgress(qint32 trialNumber, qint32 numberOfTrials);
+    void calibrationComplete(bool isSuccessful);
+
+protected slots:
+    void run() override;
+
+private:
+    libusb_device_handle *usbDeviceHandle;
+    std::atomic<bool> threadAbort;
+
+    QMutex resultsMutex;
+    QVector<TransferCalibrationResult> results;
+    qint32 bestResult;
+    QString lastError;
+
+    TransferCalibrationResult runTrial(UsbTransferGeometry transferGeometry);
+    qint32 selectBestResult(void);
+};
+
+#endif // TRANSFERCALIBRATION_H
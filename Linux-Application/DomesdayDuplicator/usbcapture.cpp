@@ -28,34 +28,84 @@
 #include "usbcapture.h"
 
 #include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <QElapsedTimer>
 #include <sched.h>
+#include <time.h>
 #include <sys/mman.h>
 
 // Notes on transfer and disk buffering:
 //
-// TRANSFERSIZE: Each in-flight transfer returns 16 Kbytes * 16 (256 Kbytes)
-// SIMULTANEOUSTRANSFERS: There are 16 simultaneous in-flight transfers
-// TRANSFERSPERDISKBUFFER: There are 256 transfers per disk buffer (64 Mbytes)
+// DISKBUFFERSIZE: Each disk buffer is 64 Mbytes
 // NUMBEROFDISKBUFFERS: There are 4 disk buffers (256 Mbytes)
 //
-#define TRANSFERSIZE (16384 * 16)
-#define SIMULTANEOUSTRANSFERS 16
-#define TRANSFERSPERDISKBUFFER 256
+// The transfer geometry is set for each capture (see UsbTransferGeometry).  By default:
+//
+// transferSize: Each in-flight transfer returns 16 Kbytes * 16 (256 Kbytes)
+// simultaneousTransfers: There are 16 simultaneous in-flight transfers
+// transfersPerDiskBuffer: There are 256 transfers per disk buffer
+//
+#define DISKBUFFERSIZE (16384 * 16 * 256)
 #define NUMBEROFDISKBUFFERS 4
+#define MAXTRANSFERSPERDISKBUFFER (DISKBUFFERSIZE / MINTRANSFERSIZE)
+
+// When pipelined conversion is enabled, each transfer is converted as soon as it
+// arrives in blocks of CONVERSIONBLOCKSIZE (small enough to stay in the CPU cache
+// between test data verification, analysis and conversion).  The converted data is
+// collected and written once PIPELINEWRITESIZE is reached.
+//
+// With in-place conversion (the default) the data is converted within the disk buffer
+// it was received into.  The output is never larger than the input (16-bit samples are
+// rescaled where they are and 10-bit samples are packed forward) so converted data
+// never overwrites samples that haven't been converted yet.  Otherwise the data is
+// converted into a separate conversion buffer the size of a disk buffer.
+#define CONVERSIONBLOCKSIZE (16384 * 4)
+#define PIPELINEWRITESIZE (16384 * 16 * 16)
 
 // Note:
 //
 // When saving in 16-bit format, each disk buffer represents 64 Mbytes of data
 // When saving in 10-bit format, each disk buffer represents 40 Mbytes of data
 
+// The ADC sample rate and the number of samples in a disk buffer
+#define SAMPLERATE 40000000
+#define SAMPLESPERDISKBUFFER (DISKBUFFERSIZE / 2)
+
+// Signal loss detection.  Without RF (the disc has ended or the RF cable is unplugged) the ADC
+// only sees its own noise, a few codes RMS, where the RF of a playing disc is tens of codes or
+// more.  A disk buffer with an RMS below SIGNALLOSSRMS is taken to have no RF
+#define SIGNALLOSSRMS 8.0
+
 // Globals required for libUSB call-back handling ---------------------------------------------------------------------
 
 // Structure to contain the user-data passed during transfer call-backs
 struct transferUserDataStruct {
-    qint32 diskBufferTransferNumber;    // The transfer number of the transfer (0-2047)
+    qint32 diskBufferTransferNumber;    // The transfer number of the transfer within the disk buffer
     qint32 diskBufferNumber;            // The current target disk buffer number (0-3)
+    bool isDiscarding;                  // True if the data is being dropped following an overflow
+};
+
+// A player position reading for the capture timeline
+struct playerPositionStruct {
+    qint64 samplePosition;              // Number of samples captured when the position was read
+    bool isTimeCode;                    // True for a CLV time-code, false for a CAV frame number
+    qint32 address;                     // The frame number or time-code
 };
 
+// A gap in the capture caused by a disk buffer overflow (in ADC samples)
+struct captureGapStruct {
+    qint64 samplePosition;              // Number of samples captured before the gap
+    qint64 numberOfSamples;             // Number of samples dropped
+};
+
+// The transfer geometry of the current capture
+static qint32 transferSize = 16384 * 16;
+static qint32 simultaneousTransfers = 16;
+static qint32 transfersPerDiskBuffer = DISKBUFFERSIZE / (16384 * 16);
+static quint32 transferTimeout = 1000;
+
 // Flag to indicate if disk buffer processing is running
 static std::atomic<bool> isDiskBufferProcessRunning;
 
@@ -84,9 +134,41 @@ static statisticsStruct statistics;
 static unsigned char **diskBuffers = nullptr;
 static std::atomic<bool> isDiskBufferFull[NUMBEROFDISKBUFFERS];
 
-// Set up a pointer to the conversion buffer
+// Flags showing which transfers have been received (used by pipelined conversion)
+static std::atomic<bool> isTransferComplete[NUMBEROFDISKBUFFERS][MAXTRANSFERSPERDISKBUFFER];
+
+// Number of transfers consumed by the disk buffer processing
+static std::atomic<qint64> numberOfTransfersConsumed;
+
+// Set up a pointer to the conversion buffer (not allocated for in-place conversion)
 static unsigned char *conversionBuffer;
 
+// Continue-on-overflow handling.  When the disk buffer a transfer moves on to is
+// still full, the next disk buffer's worth of data is received into the discard
+// buffer and recorded as a gap.  The capture fails once the total length of the
+// gaps exceeds the budget (a negative budget disables continue-on-overflow).
+static unsigned char *discardBuffer = nullptr;
+static std::atomic<qint64> gapBudgetSamples;
+static std::atomic<bool> isDiskBufferDiscarding[NUMBEROFDISKBUFFERS];
+static std::atomic<qint64> numberOfDiskBuffersCaptured;
+static std::atomic<qint32> numberOfGaps;
+static std::atomic<qint64> totalGapSamples;
+static QVector<captureGapStruct> pendingCaptureGaps;
+static QMutex captureGapMutex;
+
+// Capture timeline.  Player positions are stamped with the number of transfers
+// captured so far and queued here until the capture thread writes them out.
+static std::atomic<qint64> numberOfTransfersCaptured;
+static std::atomic<bool> isTimelineRecording(false);
+static QVector<playerPositionStruct> pendingPlayerPositions;
+static QMutex playerPositionMutex;
+
+// Armed start.  An armed capture streams into the disk buffers without writing them, holding
+// the most recent as pre-roll, until it is triggered.  The trigger is stamped with the number
+// of samples received so far (in the same way as the player positions).
+static std::atomic<bool> isWaitingForTrigger(false);
+static std::atomic<qint64> triggerSamplePosition;
+
 // The flush count is used to set the number of discarded transfers
 // before disk buffering starts.  It seems to be necessary to discard
 // the first set of in-flight transfers as the FX3 doesn't return
@@ -96,9 +178,423 @@ static std::atomic<qint32> flushCounter;
 // Last error is a string used to communicate a failure reason to the GUI
 static QString lastError;
 
+// Signal quality metrics for the most recently written disk buffer
+static SignalMetrics latestSignalMetrics;
+static QMutex signalMetricsMutex;
+
+// Total number of clipped samples (code 0 or 1023) seen during the capture
+static std::atomic<qint64> totalClippedSamples;
+
+// Monitor for the disk write throughput and disk buffer occupancy
+static ThroughputMonitor throughputMonitor(DISKBUFFERSIZE, NUMBEROFDISKBUFFERS);
+
+// Time spent converting disk buffers to the capture format
+static std::atomic<qint64> totalConversionTime;
+static std::atomic<qint32> numberOfConversions;
+
+// Per-stage measurements of the capture (in nS).  The completion interval statistics are
+// only accessed from the transfer completion context until the transfers have drained.
+static std::atomic<qint64> completionCpuTime;
+static std::atomic<qint64> writerCpuTime;
+static qint64 previousCompletionTime;
+static qint64 numberOfCompletionIntervals;
+static double completionIntervalSum;
+static double completionIntervalSquaredSum;
+static double maximumCompletionInterval;
+static double peakRingOccupancy;
+static CaptureStageStatistics latestStageStatistics;
+
+// Time the first transfer of the capture completed (-1 until it has)
+static std::atomic<qint64> firstTransferTime;
+
+// Times the first and last transfers kept in the capture completed (-1 until they have), and
+// the time the disk writer has spent writing the capture file (in nS)
+static std::atomic<qint64> firstCapturedTransferTime;
+static std::atomic<qint64> lastCapturedTransferTime;
+static std::atomic<qint64> totalWriteTime;
+static QMutex stageStatisticsMutex;
+
+// Get the CPU time used by the calling thread (in nS)
+static qint64 threadCpuTime(void)
+{
+    struct timespec time;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) == -1) return 0;
+    return static_cast<qint64>(time.tv_sec) * 1000000000LL + time.tv_nsec;
+}
+
+// Get the monotonic clock time (in nS)
+static qint64 monotonicTime(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return static_cast<qint64>(time.tv_sec) * 1000000000LL + time.tv_nsec;
+}
+
+
+// Buffer memory allocation -------------------------------------------------------------------------------------------
+
+// The disk and conversion buffers are streamed through in their entirety for every disk buffer,
+// so they are backed by huge pages where possible to reduce TLB misses.  Explicit (hugetlbfs)
+// pages are tried first, then transparent huge pages and finally normal pages.
+#define HUGEPAGESIZE (2 * 1024 * 1024)
+
+enum bufferPageModeEnum {
+    bufferPageModeNormal,
+    bufferPageModeTransparentHuge,
+    bufferPageModeExplicitHuge
+};
+
+// Page mode of each disk buffer and of the conversion buffer
+static bufferPageModeEnum diskBufferPageMode[NUMBEROFDISKBUFFERS];
+static bufferPageModeEnum conversionBufferPageMode;
+
+// Allocate a buffer (returns nullptr on failure)
+static unsigned char *allocateBufferMemory(size_t size, bufferPageModeEnum *pageMode)
+{
+#if defined(Q_OS_LINUX) && defined(MAP_HUGETLB)
+    // Explicit huge pages (requires pages reserved via /proc/sys/vm/nr_hugepages)
+    if ((size % HUGEPAGESIZE) == 0) {
+        void *buffer = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (buffer != MAP_FAILED) {
+            *pageMode = bufferPageModeExplicitHuge;
+            return static_cast<unsigned char *>(buffer);
+        }
+    }
+#endif
+
+#if defined(Q_OS_LINUX) && defined(MADV_HUGEPAGE)
+    // Transparent huge pages (the buffer must be huge page aligned for the kernel to use them)
+    void *alignedBuffer = nullptr;
+    if (posix_memalign(&alignedBuffer, HUGEPAGESIZE, size) == 0) {
+        if (madvise(alignedBuffer, size, MADV_HUGEPAGE) == 0) *pageMode = bufferPageModeTransparentHuge;
+        else *pageMode = bufferPageModeNormal;
+        return static_cast<unsigned char *>(alignedBuffer);
+    }
+#endif
+
+    // Normal pages
+    *pageMode = bufferPageModeNormal;
+    return static_cast<unsigned char *>(malloc(size));
+}
+
+// Free a buffer allocated with allocateBufferMemory
+static void freeBufferMemory(unsigned char *buffer, size_t size, bufferPageModeEnum pageMode)
+{
+    if (buffer == nullptr) return;
+
+    if (pageMode == bufferPageModeExplicitHuge) (void) munmap(buffer, size);
+    else free(buffer);
+}
+
+// Describe the least capable page mode in use (for the log)
+static QString bufferPageModeDescription(void)
+{
+    bufferPageModeEnum pageMode = diskBufferPageMode[0];
+    for (qint32 bufferNumber = 1; bufferNumber < NUMBEROFDISKBUFFERS; bufferNumber++) {
+        if (diskBufferPageMode[bufferNumber] < pageMode) pageMode = diskBufferPageMode[bufferNumber];
+    }
+
+    // Converting in place doesn't use the conversion buffer
+    if (conversionBuffer != nullptr && conversionBufferPageMode < pageMode) pageMode = conversionBufferPageMode;
+
+    switch (pageMode) {
+    case bufferPageModeExplicitHuge:
+        return "explicit huge pages";
+    case bufferPageModeTransparentHuge:
+        return "transparent huge pages";
+    default:
+        return "normal pages";
+    }
+}
+
+// Buffer pool --------------------------------------------------------------------------------------------------------
+
+// The disk buffers (and the conversion and discard buffers, when they are used) are allocated,
+// placed, locked and faulted in once and then leased to each capture in turn, so starting a capture doesn't
+// wait for hundreds of Mbytes of memory to be faulted in.  The pool is kept until
+// UsbCapture::releaseBufferPool() is called (or it is needed with different settings).
+struct bufferPoolStruct {
+    bool isAllocated;
+    bool isLeased;
+    bool isLocked;                      // True if the buffers are locked into memory
+    qint32 diskBufferNumaNode;          // The settings the disk buffers were placed with
+    QString usbThreadCpus;
+    unsigned char *diskBuffers[NUMBEROFDISKBUFFERS];
+    bufferPageModeEnum diskBufferPageMode[NUMBEROFDISKBUFFERS];
+    unsigned char *conversionBuffer;
+    bufferPageModeEnum conversionBufferPageMode;
+    unsigned char *discardBuffer;
+    qint64 discardBufferSize;
+    bufferPageModeEnum discardBufferPageMode;
+};
+static bufferPoolStruct bufferPool;
+static QMutex bufferPoolMutex;
+
+// How the buffers were obtained for the current capture (for the capture log)
+static bool isBufferPoolReused;
+static qint64 bufferLeaseTime;
+
+// Lock a buffer into memory, preventing it from being paged out.  Locking also faults the
+// buffer in; if it can't be locked (and tryMlock is cleared) the pages are touched instead
+static void prefaultBufferMemory(unsigned char *buffer, size_t size, bool *tryMlock)
+{
+    if (*tryMlock) {
+        if (mlock(buffer, size) == 0) return;
+
+        // Continue anyway, but print a warning
+        qInfo() << "prefaultBufferMemory(): Unable to lock capture buffer into memory";
+        *tryMlock = false;
+    }
+
+    memset(buffer, 0, size);
+}
+
+// Free the discard buffer in the pool (the pool mutex must be held and the pool must not be leased)
+static void freeDiscardBuffer(void)
+{
+    if (bufferPool.discardBuffer == nullptr) return;
+
+    (void) munlock(bufferPool.discardBuffer, static_cast<size_t>(bufferPool.discardBufferSize));
+    freeBufferMemory(bufferPool.discardBuffer, static_cast<size_t>(bufferPool.discardBufferSize), bufferPool.discardBufferPageMode);
+    bufferPool.discardBuffer = nullptr;
+    bufferPool.discardBufferSize = 0;
+}
+
+// Free the buffers in the pool (the pool mutex must be held and the pool must not be leased)
+static void freeBufferPool(void)
+{
+    for (qint32 bufferNumber = 0; bufferNumber < NUMBEROFDISKBUFFERS; bufferNumber++) {
+        if (bufferPool.diskBuffers[bufferNumber] == nullptr) continue;
+
+        // Don't keep the buffer in RAM any more (silently ignoring failure)
+        (void) munlock(bufferPool.diskBuffers[bufferNumber], DISKBUFFERSIZE);
+        freeBufferMemory(bufferPool.diskBuffers[bufferNumber], DISKBUFFERSIZE, bufferPool.diskBufferPageMode[bufferNumber]);
+        bufferPool.diskBuffers[bufferNumber] = nullptr;
+    }
+
+    if (bufferPool.conversionBuffer != nullptr) {
+        (void) munlock(bufferPool.conversionBuffer, DISKBUFFERSIZE);
+        freeBufferMemory(bufferPool.conversionBuffer, DISKBUFFERSIZE, bufferPool.conversionBufferPageMode);
+        bufferPool.conversionBuffer = nullptr;
+    }
+
+    freeDiscardBuffer();
+    bufferPool.isAllocated = false;
+}
+
+// Make sure the pool holds buffers placed for the given settings (the pool mutex must be held and
+// the pool must not be leased).  The discard buffer is only kept if discardBufferSize isn't 0.
+// Returns false if the memory could not be allocated
+static bool reserveBufferPoolLocked(const CaptureThreadSettings &threadSettings, bool isConversionBufferRequired,
+                                    qint64 discardBufferSize)
+{
+    // Replace disk buffers placed for other settings
+    if (bufferPool.isAllocated && (bufferPool.diskBufferNumaNode != threadSettings.diskBufferNumaNode ||
+                                   bufferPool.usbThreadCpus != threadSettings.usbThreadCpus)) {
+        qDebug() << "reserveBufferPoolLocked(): The buffer placement settings have changed - reallocating the buffer pool";
+        freeBufferPool();
+    }
+
+    // Nothing to do if the pool already holds the required buffers
+    if (bufferPool.isAllocated && isConversionBufferRequired == (bufferPool.conversionBuffer != nullptr) &&
+            discardBufferSize == bufferPool.discardBufferSize) return true;
+
+    // Fault the buffers in from the capture CPUs, so (unless a NUMA node is configured) the memory
+    // is local to the CPUs that will fill it
+    ThreadTuning allocationThreadTuning;
+    allocationThreadTuning.apply(threadSettings.usbThreadCpus, 0);
+    QElapsedTimer allocationTimer;
+    allocationTimer.start();
+    bool isSuccessful = true;
+
+    if (!bufferPool.isAllocated) {
+        bool tryMlock = true;
+        for (qint32 bufferNumber = 0; bufferNumber < NUMBEROFDISKBUFFERS; bufferNumber++) {
+            bufferPool.diskBuffers[bufferNumber] = allocateBufferMemory(DISKBUFFERSIZE, &bufferPool.diskBufferPageMode[bufferNumber]);
+            if (bufferPool.diskBuffers[bufferNumber] == nullptr) {
+                qDebug() << "reserveBufferPoolLocked(): Disk buffer memory allocation failed!";
+                isSuccessful = false;
+                break;
+            }
+
+            // Place the buffer on the configured NUMA node (this must happen before it is faulted in)
+            if (threadSettings.diskBufferNumaNode >= 0 &&
+                    !ThreadTuning::bindMemoryToNode(bufferPool.diskBuffers[bufferNumber], DISKBUFFERSIZE,
+                                                    threadSettings.diskBufferNumaNode)) {
+                qInfo() << "reserveBufferPoolLocked(): Unable to place disk buffer on NUMA node" << threadSettings.diskBufferNumaNode;
+            }
+
+            prefaultBufferMemory(bufferPool.diskBuffers[bufferNumber], DISKBUFFERSIZE, &tryMlock);
+        }
+
+        if (isSuccessful) {
+            bufferPool.isAllocated = true;
+            bufferPool.isLocked = tryMlock;
+            bufferPool.diskBufferNumaNode = threadSettings.diskBufferNumaNode;
+            bufferPool.usbThreadCpus = threadSettings.usbThreadCpus;
+        } else {
+            freeBufferPool();
+        }
+    }
+
+    // The conversion buffer is only kept while it is needed
+    if (isSuccessful && isConversionBufferRequired && bufferPool.conversionBuffer == nullptr) {
+        bufferPool.conversionBuffer = allocateBufferMemory(DISKBUFFERSIZE, &bufferPool.conversionBufferPageMode);
+        if (bufferPool.conversionBuffer == nullptr) {
+            qDebug() << "reserveBufferPoolLocked(): Conversion buffer memory allocation failed!";
+            isSuccessful = false;
+        } else {
+            bool tryMlock = bufferPool.isLocked;
+            prefaultBufferMemory(bufferPool.conversionBuffer, DISKBUFFERSIZE, &tryMlock);
+        }
+    } else if (!isConversionBufferRequired && bufferPool.conversionBuffer != nullptr) {
+        (void) munlock(bufferPool.conversionBuffer, DISKBUFFERSIZE);
+        freeBufferMemory(bufferPool.conversionBuffer, DISKBUFFERSIZE, bufferPool.conversionBufferPageMode);
+        bufferPool.conversionBuffer = nullptr;
+    }
+
+    // The discard buffer is only kept while continuing after an overflow (at the size for the transfers)
+    if (discardBufferSize != bufferPool.discardBufferSize) freeDiscardBuffer();
+    if (isSuccessful && discardBufferSize > 0 && bufferPool.discardBuffer == nullptr) {
+        bufferPool.discardBuffer = allocateBufferMemory(static_cast<size_t>(discardBufferSize), &bufferPool.discardBufferPageMode);
+        if (bufferPool.discardBuffer == nullptr) {
+            qDebug() << "reserveBufferPoolLocked(): Discard buffer memory allocation failed!";
+            isSuccessful = false;
+        } else {
+            bufferPool.discardBufferSize = discardBufferSize;
+            bool tryMlock = bufferPool.isLocked;
+            prefaultBufferMemory(bufferPool.discardBuffer, static_cast<size_t>(discardBufferSize), &tryMlock);
+        }
+    }
+
+    allocationThreadTuning.restore();
+    if (allocationTimer.elapsed() > 0) {
+        qDebug() << "reserveBufferPoolLocked(): Buffer pool ready in" << allocationTimer.elapsed() << "mS" <<
+                    (bufferPool.isLocked ? "(locked into memory)" : "(not locked)");
+    }
+
+    return isSuccessful;
+}
+
 
 // LibUSB call-back handling code -------------------------------------------------------------------------------------
 
+// Account for a completed transfer and advance its user data to the transfer's next slot in the
+// disk buffers (used for both USB transfers and the synthetic test data source)
+static void completeTransfer(transferUserDataStruct *transferUserData)
+{
+    qint64 cpuStartTime = threadCpuTime();
+    if (firstTransferTime < 0) firstTransferTime = monotonicTime();
+
+    // Increment the total number of successful transfers
+    statistics.transferCount++;
+
+    // Are we flushing the buffers or writing to disk?
+    if (flushCounter >= simultaneousTransfers) {
+        // Record the time between transfer completions
+        qint64 completionTime = monotonicTime();
+        if (previousCompletionTime >= 0) {
+            double interval = static_cast<double>(completionTime - previousCompletionTime);
+            numberOfCompletionIntervals++;
+            completionIntervalSum += interval;
+            completionIntervalSquaredSum += interval * interval;
+            if (interval > maximumCompletionInterval) maximumCompletionInterval = interval;
+        }
+        previousCompletionTime = completionTime;
+
+        // Count the transfers kept in the capture (for the timeline and the stage measurements)
+        if (!transferUserData->isDiscarding && !captureComplete) {
+            if (firstCapturedTransferTime < 0) firstCapturedTransferTime = completionTime;
+            lastCapturedTransferTime = completionTime;
+            numberOfTransfersCaptured++;
+        }
+
+        // Last transfer in the disk buffer?
+        if (transferUserData->diskBufferTransferNumber == (transfersPerDiskBuffer - 1)) {
+            if (!transferUserData->isDiscarding) {
+                // Mark the disk buffer as full (before the transfer is marked, so the flag can't be cleared early)
+                isDiskBufferFull[transferUserData->diskBufferNumber] = true;
+                isTransferComplete[transferUserData->diskBufferNumber][transferUserData->diskBufferTransferNumber] = true;
+                numberOfDiskBuffersCaptured++;
+            } else {
+                // The disk buffer's worth of data has been dropped - record the gap
+                captureGapStruct gap;
+                gap.samplePosition = numberOfDiskBuffersCaptured * SAMPLESPERDISKBUFFER;
+                gap.numberOfSamples = SAMPLESPERDISKBUFFER;
+                captureGapMutex.lock();
+                pendingCaptureGaps.append(gap);
+                captureGapMutex.unlock();
+                numberOfGaps++;
+                totalGapSamples += gap.numberOfSamples;
+
+                if (totalGapSamples > gapBudgetSamples) {
+                    qDebug() << "completeTransfer(): Disk buffer overflow gap budget exceeded!";
+                    lastError = "Overflow of the disk buffer exceeded the permitted gaps (your hard-drive/computer's write speed may be too slow)!";
+                    transferFailure = true;
+                }
+            }
+
+            // If transfer is aborting, mark the capture as complete now the disk buffer is full
+            if (transferAbort) captureComplete = true;
+        } else if (!captureComplete && !transferUserData->isDiscarding) {
+            // Mark the transfer as received (transfers after the end of the capture are discarded)
+            isTransferComplete[transferUserData->diskBufferNumber][transferUserData->diskBufferTransferNumber] = true;
+        }
+
+        // Point to the next slot for the transfer in the disk buffer
+        transferUserData->diskBufferTransferNumber += simultaneousTransfers;
+
+        // Check that the current disk buffer hasn't been exceeded
+        if (transferUserData->diskBufferTransferNumber >= transfersPerDiskBuffer) {
+            // Select the next disk buffer.  A dropped disk buffer's data never reaches its slot, so
+            // the data following the gap is aimed at the same slot (keeping the disk buffers in the
+            // order the writer expects them)
+            if (!transferUserData->isDiscarding) {
+                transferUserData->diskBufferNumber++;
+                if (transferUserData->diskBufferNumber == NUMBEROFDISKBUFFERS) transferUserData->diskBufferNumber = 0;
+            }
+
+            // Wrap the transfer number back to the start of the disk buffer
+            transferUserData->diskBufferTransferNumber -= transfersPerDiskBuffer;
+
+            if (gapBudgetSamples < 0) {
+                // Ensure selected disk buffer is free
+                if (isDiskBufferFull[transferUserData->diskBufferNumber]) {
+                    // Buffer is full - flag an overflow error
+                    qDebug() << "completeTransfer(): Disk buffer overflow error!";
+                    lastError = "Overflow of the disk buffer (your hard-drive/computer's write speed may be too slow)!";
+                    transferFailure = true;
+                }
+            } else {
+                // The first transfer into the disk buffer decides if its data is kept or
+                // dropped (transfers complete in order, so the others follow it)
+                if (transferUserData->diskBufferTransferNumber == 0) {
+                    isDiskBufferDiscarding[transferUserData->diskBufferNumber] = isDiskBufferFull[transferUserData->diskBufferNumber].load();
+                    if (isDiskBufferDiscarding[transferUserData->diskBufferNumber])
+                        qDebug() << "completeTransfer(): Disk buffer overflow - dropping disk buffer" << transferUserData->diskBufferNumber;
+                }
+                transferUserData->isDiscarding = isDiskBufferDiscarding[transferUserData->diskBufferNumber];
+            }
+        }
+    } else {
+        // Only flushing the buffer at the moment
+        flushCounter++;
+    }
+
+    completionCpuTime += threadCpuTime() - cpuStartTime;
+}
+
+// Get the buffer the transfer should receive its next data into
+static unsigned char *getTransferBuffer(const transferUserDataStruct *transferUserData)
+{
+    // Data being dropped is received into this transfer's slot of the discard buffer
+    if (transferUserData->isDiscarding) {
+        return discardBuffer + (transferSize * (transferUserData->diskBufferTransferNumber % simultaneousTransfers));
+    }
+
+    return diskBuffers[transferUserData->diskBufferNumber] + (transferSize * transferUserData->diskBufferTransferNumber);
+}
+
 // LibUSB transfer call-back handler (called when an in-flight transfer completes)
 static void LIBUSB_CALL bulkTransferCallback(struct libusb_transfer *transfer)
 {    
@@ -152,52 +648,14 @@ static void LIBUSB_CALL bulkTransferCallback(struct libusb_transfer *transfer)
     // Reduce the number of requests in-flight.
     transfersInFlight--;
 
-    // Increment the total number of successful transfers
-    statistics.transferCount++;
-
-    // Are we flushing the buffers or writing to disk?
-    if (flushCounter >= SIMULTANEOUSTRANSFERS) {
-        // Last transfer in the disk buffer?
-        if (transferUserData->diskBufferTransferNumber == (TRANSFERSPERDISKBUFFER - 1)) {
-            // Mark the disk buffer as full
-            isDiskBufferFull[transferUserData->diskBufferNumber] = true;
-
-            // If transfer is aborting, mark the capture as complete now the disk buffer is full
-            if (transferAbort) captureComplete = true;
-        }
-
-        // Point to the next slot for the transfer in the disk buffer
-        transferUserData->diskBufferTransferNumber += SIMULTANEOUSTRANSFERS;
-
-        // Check that the current disk buffer hasn't been exceeded
-        if (transferUserData->diskBufferTransferNumber >= TRANSFERSPERDISKBUFFER) {
-            // Select the next disk buffer
-            transferUserData->diskBufferNumber++;
-            if (transferUserData->diskBufferNumber == NUMBEROFDISKBUFFERS) transferUserData->diskBufferNumber = 0;
-
-            // Ensure selected disk buffer is free
-            if (isDiskBufferFull[transferUserData->diskBufferNumber]) {
-                // Buffer is full - flag an overflow error
-                qDebug() << "bulkTransferCallback(): Disk buffer overflow error!";
-                lastError = "Overflow of the disk buffer (your hard-drive/computer's write speed may be too slow)!";
-                transferFailure = true;
-            }
-
-            // Wrap the transfer number back to the start of the disk buffer
-            transferUserData->diskBufferTransferNumber -= TRANSFERSPERDISKBUFFER;
-        }
-    } else {
-        // Only flushing the buffer at the moment
-        flushCounter++;
-    }
+    // Account for the transfer
+    completeTransfer(transferUserData);
 
     // If the capture is not complete, resubmit the transfer to libUSB
     if (!captureComplete) {
         libusb_fill_bulk_transfer(transfer, transfer->dev_handle, transfer->endpoint,
-                                  reinterpret_cast<unsigned char *>(diskBuffers[transferUserData->diskBufferNumber] +
-                                  (TRANSFERSIZE * transferUserData->diskBufferTransferNumber)),
-                                  transfer->length, bulkTransferCallback,
-                                  transfer->user_data, 1000);
+                                  getTransferBuffer(transferUserData), transfer->length, bulkTransferCallback,
+                                  transfer->user_data, transferTimeout);
 
         if (libusb_submit_transfer(transfer) == 0) {
             transfersInFlight++;
@@ -210,6 +668,106 @@ static void LIBUSB_CALL bulkTransferCallback(struct libusb_transfer *transfer)
 }
 
 
+// Signal metrics helpers --------------------------------------------------------------------------------------------
+
+// Running totals used to build the signal metrics for a disk buffer
+struct signalMetricsAccumulatorStruct {
+    qint64 numberOfSamples;
+    quint64 sum;
+    quint64 sumOfSquares;
+    qint64 clippedLowCount;
+    qint64 clippedHighCount;
+    quint32 minimumValue;
+    quint32 maximumValue;
+};
+
+// Reset a signal metrics accumulator
+static void resetSignalMetrics(signalMetricsAccumulatorStruct *accumulator)
+{
+    accumulator->numberOfSamples = 0;
+    accumulator->sum = 0;
+    accumulator->sumOfSquares = 0;
+    accumulator->clippedLowCount = 0;
+    accumulator->clippedHighCount = 0;
+    accumulator->minimumValue = 1023;
+    accumulator->maximumValue = 0;
+}
+
+// Add a block of 10-bit samples (little-endian 16-bit words) to a signal metrics accumulator
+//
+// The samples are processed in short runs using 32-bit accumulators and no
+// data-dependent branches, which lets the compiler vectorise the inner loop.
+// A run of 2048 samples is the longest that can't overflow the 32-bit sum of
+// squares (2048 * 1023^2 < 2^32).
+static void accumulateSignalMetrics(const quint16 *samples, qint64 numberOfSamples, signalMetricsAccumulatorStruct *accumulator)
+{
+    const qint64 runLength = 2048;
+
+    for (qint64 runStart = 0; runStart < numberOfSamples; runStart += runLength) {
+        qint64 runEnd = runStart + runLength;
+        if (runEnd > numberOfSamples) runEnd = numberOfSamples;
+
+        quint32 sum = 0;
+        quint32 sumOfSquares = 0;
+        quint32 clippedLowCount = 0;
+        quint32 clippedHighCount = 0;
+        quint32 minimumValue = accumulator->minimumValue;
+        quint32 maximumValue = accumulator->maximumValue;
+
+        for (qint64 sampleNumber = runStart; sampleNumber < runEnd; sampleNumber++) {
+            quint32 value = samples[sampleNumber] & 0x03FF;
+            sum += value;
+            sumOfSquares += value * value;
+            clippedLowCount += (value == 0) ? 1 : 0;
+            clippedHighCount += (value == 1023) ? 1 : 0;
+            minimumValue = (value < minimumValue) ? value : minimumValue;
+            maximumValue = (value > maximumValue) ? value : maximumValue;
+        }
+
+        accumulator->sum += sum;
+        accumulator->sumOfSquares += sumOfSquares;
+        accumulator->clippedLowCount += clippedLowCount;
+        accumulator->clippedHighCount += clippedHighCount;
+        accumulator->minimumValue = minimumValue;
+        accumulator->maximumValue = maximumValue;
+    }
+
+    accumulator->numberOfSamples += numberOfSamples;
+}
+
+// Accumulated totals for the disk buffer being processed
+static signalMetricsAccumulatorStruct diskBufferSignalMetrics;
+
+// Turn the accumulated totals into signal metrics
+static SignalMetrics calculateSignalMetrics(const signalMetricsAccumulatorStruct *accumulator)
+{
+    SignalMetrics metrics;
+    metrics.numberOfSamples = accumulator->numberOfSamples;
+    metrics.clippedLowCount = accumulator->clippedLowCount;
+    metrics.clippedHighCount = accumulator->clippedHighCount;
+
+    if (accumulator->numberOfSamples == 0) {
+        metrics.minimumValue = 0;
+        metrics.maximumValue = 0;
+        metrics.dcOffset = 0.0;
+        metrics.rms = 0.0;
+        return metrics;
+    }
+
+    metrics.minimumValue = static_cast<qint32>(accumulator->minimumValue);
+    metrics.maximumValue = static_cast<qint32>(accumulator->maximumValue);
+
+    double mean = static_cast<double>(accumulator->sum) / static_cast<double>(accumulator->numberOfSamples);
+    double meanOfSquares = static_cast<double>(accumulator->sumOfSquares) / static_cast<double>(accumulator->numberOfSamples);
+    double variance = meanOfSquares - (mean * mean);
+    if (variance < 0.0) variance = 0.0;
+
+    metrics.dcOffset = mean - 512.0;
+    metrics.rms = std::sqrt(variance);
+    return metrics;
+}
+
+
 // UsbCapture class code ----------------------------------------------------------------------------------------------
 
 UsbCapture::UsbCapture(QObject *parent, libusb_context *libUsbContextParam,
@@ -248,6 +806,94 @@ UsbCapture::UsbCapture(QObject *parent, libusb_context *libUsbContextParam,
     // Initialise the test data sequence
     savedTestDataValue = -1;
 
+    // Reset the signal metrics
+    signalMetricsMutex.lock();
+    signalMetricsAccumulatorStruct emptyAccumulator;
+    resetSignalMetrics(&emptyAccumulator);
+    latestSignalMetrics = calculateSignalMetrics(&emptyAccumulator);
+    signalMetricsMutex.unlock();
+    totalClippedSamples = 0;
+
+    // Reset the throughput monitor
+    throughputMonitor.reset();
+    totalConversionTime = 0;
+    numberOfConversions = 0;
+    numberOfTransfersConsumed = 0;
+    resetSignalMetrics(&diskBufferSignalMetrics);
+
+    // Reset the stage measurements (the start latency is measured from the capture request)
+    captureRequestTime = monotonicTime();
+    firstTransferTime = -1;
+    firstCapturedTransferTime = -1;
+    lastCapturedTransferTime = -1;
+    totalWriteTime = 0;
+    completionCpuTime = 0;
+    writerCpuTime = 0;
+    previousCompletionTime = -1;
+    numberOfCompletionIntervals = 0;
+    completionIntervalSum = 0.0;
+    completionIntervalSquaredSum = 0.0;
+    maximumCompletionInterval = 0.0;
+    peakRingOccupancy = 0.0;
+
+    // Convert whole disk buffers in place by default
+    isPipelinedConversion = false;
+    isInPlaceConversion = true;
+
+    // Capture from the USB device by default
+    isSyntheticSource = false;
+
+    // Start writing straight away by default
+    isArmedStart = false;
+    isWaitingForTrigger = false;
+    triggerSamplePosition = -1;
+    preRollDiskBuffers = 0;
+    oldestHeldDiskBuffer = 0;
+    nextHeldDiskBuffer = 0;
+    numberOfHeldDiskBuffers = 0;
+    numberOfPreRollBuffersReleased = 0;
+    captureOriginSamples = 0;
+    firstDiskBufferNumber = 0;
+
+    // Keep capturing without RF by default
+    signalLossLimitSamples = -1;
+    signalAbsentSamples = 0;
+    signalAbsentPosition = 0;
+    isSignalLost = false;
+
+    // Fail on a disk buffer overflow by default
+    gapBudgetSamples = -1;
+    numberOfDiskBuffersCaptured = 0;
+    numberOfGaps = 0;
+    totalGapSamples = 0;
+    captureGapMutex.lock();
+    pendingCaptureGaps.clear();
+    captureGapMutex.unlock();
+
+    // Reset the capture timeline
+    numberOfTransfersCaptured = 0;
+    playerPositionMutex.lock();
+    pendingPlayerPositions.clear();
+    playerPositionMutex.unlock();
+
+    // The capture log and timeline are opened when the capture thread starts (and the manifest
+    // when the disk writer opens the capture file)
+    captureLog = nullptr;
+    captureTimeline = nullptr;
+    captureManifest = nullptr;
+
+    // Default thread settings (real-time scheduling for the capture thread only)
+    threadSettings.usbThreadCpus = QString();
+    threadSettings.usbThreadPriority = -1;
+    threadSettings.writerThreadCpus = QString();
+    threadSettings.writerThreadPriority = 0;
+    threadSettings.writerIoPriorityClass = 0;
+    threadSettings.writerIoPriorityLevel = 0;
+    threadSettings.diskBufferNumaNode = -1;
+
+    // Use the default transfer geometry unless another is set
+    setTransferGeometry(getDefaultTransferGeometry());
+
     // Clear the transfer failure flag
     transferFailure = false;
 
@@ -265,10 +911,7 @@ UsbCapture::~UsbCapture()
     transferAbort = true;
     this->wait();
 
-    // Close the USB device
-    libusb_close(usbDeviceHandle);
-
-    // Destroy the device handle
+    // The device handle belongs to the UsbDevice object (which keeps it open between captures)
     usbDeviceHandle = nullptr;
 }
 
@@ -277,63 +920,45 @@ void UsbCapture::run(void)
 {
     // Set up the libusb transfers
     struct libusb_transfer **usbTransfers = nullptr;
-    usbTransfers = static_cast<struct libusb_transfer **>(calloc(SIMULTANEOUSTRANSFERS, sizeof(struct libusb_transfer *)));
+    usbTransfers = static_cast<struct libusb_transfer **>(calloc(simultaneousTransfers, sizeof(struct libusb_transfer *)));
 
     // Set up the user-data for the transfers
-    transferUserDataStruct transferUserData[SIMULTANEOUSTRANSFERS];
+    QVector<transferUserDataStruct> transferUserData(simultaneousTransfers);
 
     // Set up the USB transfer buffers
     qDebug() << "UsbCapture::run(): Setting up the transfers";
 
+    // Apply the CPU affinity for this thread.  This is done before the disk buffers are allocated so
+    // that (unless a NUMA node is configured) the buffer memory is faulted in on the node local to
+    // the capture CPUs.  Transfer completions are handled by the UsbDevice libUSB event thread, which
+    // takes the real-time priority - this thread only performs the background tasks
+    ThreadTuning usbThreadTuning;
+    usbThreadTuning.apply(threadSettings.usbThreadCpus, 0);
+
     // Allocate the memory required for the disk buffers
     allocateDiskBuffers();
 
-    // Launch a thread for writing disk buffers to disk
-#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
-    QFuture<void> future = QtConcurrent::run(this, &UsbCapture::runDiskBuffers);
-#else
-    QFuture<void> future = QtConcurrent::run(&UsbCapture::runDiskBuffers, this);
-#endif
+    // Open the capture log and start writing (an armed capture waits until it is triggered)
+    if (!isArmedStart) startDiskWriter();
     connect(this, SIGNAL(finished()), this, SLOT(deleteLater()));
 
-    // Claim the required USB device interface for the transfer
-    qint32 claimResult = libusb_claim_interface(usbDeviceHandle, 0);
-    if (claimResult < 0) {
-        qDebug() << "UsbCapture::run(): USB interface claim failed (connected via USB2?) with error:" << libusb_error_name(claimResult);
-        lastError = tr("Could not claim USB interface - Ensure the Duplicator is plugged into a USB3 port - LibUSB reports: ") + libusb_error_name(claimResult);
-        transferFailure = true;
-
-        // We can't continue... clean-up and give up
-        emit transferFailed();
-        freeDiskBuffers();
-        return;
-    }
+    // Note: The USB device interface is claimed by the UsbDevice object when it opens the device
 
-    // Save the current scheduling policy and parameters
-    int oldSchedPolicy = sched_getscheduler(0);
-    if (oldSchedPolicy == -1) oldSchedPolicy = SCHED_OTHER;
-    struct sched_param oldSchedParam;
-    if (sched_getparam(0, &oldSchedParam) == -1) oldSchedParam.sched_priority = 0;
-
-    // Enable real-time scheduling for this thread
-    int minSchedPriority = sched_get_priority_min(SCHED_RR);
-    int maxSchedPriority = sched_get_priority_max(SCHED_RR);
-    struct sched_param schedParams;
-    if (minSchedPriority == -1 || maxSchedPriority == -1) {
-        schedParams.sched_priority = 0;
-    } else {
-        // Put the priority about 3/4 of the way through its range
-        schedParams.sched_priority = (minSchedPriority + (3 * maxSchedPriority)) / 4;
-    }
-    if (sched_setscheduler(0, SCHED_RR, &schedParams) != -1) {
-        qDebug() << "UsbCapture::run(): Real-time scheduling enabled with priority" << schedParams.sched_priority;
-    } else {
-        // Continue anyway, but print a warning
-        qInfo() << "UsbCapture::run(): Unable to enable real-time scheduling for capture thread";
+    // Without a USB device the test data is generated by a synthetic source instead
+    qint64 captureStartTime = monotonicTime();
+    QFuture<void> syntheticSourceFuture;
+    if (isSyntheticSource && !transferFailure) {
+        qDebug() << "UsbCapture::run(): Starting the synthetic test data source";
+        transfersInFlight = simultaneousTransfers;
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+        syntheticSourceFuture = QtConcurrent::run(this, &UsbCapture::runSyntheticSource);
+#else
+        syntheticSourceFuture = QtConcurrent::run(&UsbCapture::runSyntheticSource, this);
+#endif
     }
 
-    // Set up the initial transfers
-    for (qint32 transferNumber = 0; transferNumber < SIMULTANEOUSTRANSFERS; transferNumber++) {
+    // Set up the initial transfers (unless the disk buffers couldn't be allocated)
+    for (qint32 transferNumber = 0; transferNumber < simultaneousTransfers && !isSyntheticSource && !transferFailure; transferNumber++) {
         usbTransfers[transferNumber] = libusb_alloc_transfer(0);
 
         // Check USB transfer allocation was successful
@@ -345,21 +970,22 @@ void UsbCapture::run(void)
             // Set up the user-data for the initial transfers
             transferUserData[transferNumber].diskBufferTransferNumber = transferNumber;
             transferUserData[transferNumber].diskBufferNumber = 0;
+            transferUserData[transferNumber].isDiscarding = false;
 
             // Set transfer flag to cause transfer error if there is a short packet
             usbTransfers[transferNumber]->flags = LIBUSB_TRANSFER_SHORT_NOT_OK;
 
             // Configure the transfer with a 1 second timeout (targeted to disk buffer 0)
             libusb_fill_bulk_transfer(usbTransfers[transferNumber], usbDeviceHandle, 0x81,
-                                      reinterpret_cast<unsigned char *>(diskBuffers[0] + (TRANSFERSIZE * transferNumber)),
-                                      TRANSFERSIZE, bulkTransferCallback, &transferUserData[transferNumber], 1000);
+                                      reinterpret_cast<unsigned char *>(diskBuffers[0] + (transferSize * transferNumber)),
+                                      transferSize, bulkTransferCallback, &transferUserData[transferNumber], transferTimeout);
         }
     }
 
-    if (!transferFailure) {
+    if (!transferFailure && !isSyntheticSource) {
         // Submit the transfers via libUSB
         qDebug() << "UsbCapture::run(): Submitting the transfers";
-        for (qint32 currentTransferNumber = 0; currentTransferNumber < SIMULTANEOUSTRANSFERS; currentTransferNumber++) {
+        for (qint32 currentTransferNumber = 0; currentTransferNumber < simultaneousTransfers; currentTransferNumber++) {
             qint32 resultCode = libusb_submit_transfer(usbTransfers[currentTransferNumber]);
 
             if (resultCode >= 0) {
@@ -374,15 +1000,84 @@ void UsbCapture::run(void)
         }
     }
 
-    // Use a 1 second timeout for the libusb_handle_events_timeout call
-    struct timeval libusbHandleTimeout;
-    libusbHandleTimeout.tv_sec  = 1;
-    libusbHandleTimeout.tv_usec = 0;
+    // An armed capture holds the pre-roll until it is triggered, then writes from the oldest disk buffer held
+    qint64 preRollTransfersConsumed = 0;
+    if (isArmedStart) {
+        qInfo() << "UsbCapture::run(): Capture armed with" << preRollDiskBuffers << "disk buffers of pre-roll";
+        while (isWaitingForTrigger && !transferAbort && !transferFailure) {
+            holdPreRoll();
+            this->msleep(1);
+        }
+
+        if (!isWaitingForTrigger && !transferAbort && !transferFailure) {
+            firstDiskBufferNumber = oldestHeldDiskBuffer;
+            captureOriginSamples = numberOfPreRollBuffersReleased * SAMPLESPERDISKBUFFER;
+            preRollTransfersConsumed = numberOfTransfersConsumed.load() +
+                    static_cast<qint64>(numberOfHeldDiskBuffers) * transfersPerDiskBuffer;
+            startDiskWriter();
+
+            // Record where the trigger falls in the capture file
+            qint64 triggerOffset = triggerSamplePosition - captureOriginSamples;
+            QString message = QString("Armed start: triggered at sample %1 of the capture file (%2 seconds of pre-roll)")
+                    .arg(captureFileSamples(triggerOffset))
+                    .arg(static_cast<double>(triggerOffset) / SAMPLERATE, 0, 'f', 3);
+            qInfo() << "UsbCapture::run():" << message;
+            captureLog->append(message);
+        }
+    }
+
+    // Sample the throughput 4 times a second
+    QElapsedTimer throughputSampleTimer;
+    throughputSampleTimer.start();
+    bool isThroughputWarningActive = false;
+    bool isStartLatencyLogged = false;
 
     // Perform background tasks whilst transfers are proceeding
     while(!transferAbort && !transferFailure) {
-        // Process libUSB events
-        libusb_handle_events_timeout(libUsbContext, &libusbHandleTimeout);
+        // The libUSB events are processed by the UsbDevice event thread - just pace the background tasks
+        this->msleep(20);
+
+        // Record any gaps caused by disk buffer overflows and the player's position
+        logCaptureGaps();
+        writeCaptureTimeline();
+
+        // Record how long the capture took to start
+        if (!isStartLatencyLogged && firstTransferTime >= 0) {
+            isStartLatencyLogged = true;
+            double startLatency = static_cast<double>(firstTransferTime - captureRequestTime) / 1000000.0;
+            qInfo() << "UsbCapture::run(): First transfer completed" << startLatency << "mS after the capture was requested";
+            captureLog->append(QString("Capture start: first transfer completed %1 mS after the capture was requested")
+                               .arg(startLatency, 0, 'f', 1));
+        }
+
+        // Update the throughput monitor and warn if the disk buffers are predicted to overflow
+        if (throughputSampleTimer.elapsed() >= 250) {
+            throughputSampleTimer.restart();
+            qint64 bytesReceived = static_cast<qint64>(statistics.transferCount.load() - flushCounter.load()) * transferSize -
+                    totalGapSamples.load() * 2;
+            // The pre-roll held when an armed capture is triggered isn't a backlog of the disk
+            // writer, so it counts as consumed from the trigger on
+            qint64 bytesConsumed = qMax(numberOfTransfersConsumed.load(), preRollTransfersConsumed) * transferSize;
+            throughputMonitor.addSample(bytesReceived, bytesConsumed);
+
+            ThroughputStatistics throughputStatistics = throughputMonitor.getStatistics();
+            if (throughputStatistics.ringOccupancy > peakRingOccupancy) peakRingOccupancy = throughputStatistics.ringOccupancy;
+            if (throughputStatistics.isOverflowPredicted && !isThroughputWarningActive) {
+                QString message;
+                if (throughputStatistics.secondsToOverflow >= 0.0) {
+                    message = tr("Disk writes are not keeping up - disk buffer overflow predicted in %1 seconds")
+                            .arg(throughputStatistics.secondsToOverflow, 0, 'f', 0);
+                } else {
+                    message = tr("Disk writes are not keeping up - the disk buffers are almost full");
+                }
+                qInfo() << "UsbCapture::run():" << message;
+                captureLog->append(message);
+                emit throughputWarning(message);
+            } else if (!throughputStatistics.isOverflowPredicted && isThroughputWarningActive) {
+                captureLog->append("Disk writes have recovered");
+            }
+            isThroughputWarningActive = throughputStatistics.isOverflowPredicted;
+        }
     }
 
     // Aborting transfer - wait for in-flight transfers to complete
@@ -391,19 +1086,25 @@ void UsbCapture::run(void)
     transferAbort = true;
 
     while(transfersInFlight > 0) {
-        // Process libUSB events
-        libusb_handle_events_timeout(libUsbContext, &libusbHandleTimeout);
+        // The in-flight transfers complete on the libUSB event thread (an armed capture that
+        // wasn't triggered keeps releasing its disk buffers until they have)
+        if (isWaitingForTrigger) holdPreRoll();
+        this->msleep(1);
     }
+    isWaitingForTrigger = false;
+    syntheticSourceFuture.waitForFinished();
+    logCaptureGaps();
+    isTimelineRecording = false;
+    writeCaptureTimeline();
 
-    // Return to the original scheduling policy while we're cleaning up
-    if (sched_setscheduler(0, oldSchedPolicy, &oldSchedParam) == -1) {
-        qDebug() << "UsbCapture::run(): Unable to restore original scheduling policy";
-    }
+    // Return to the original scheduling policy and affinity while we're cleaning up
+    usbThreadTuning.restore();
 
     // Deallocate transfers
     qDebug() << "UsbCapture::run(): Transfer stopping - Freeing transfer buffers...";
-    for (qint32 transferNumber = 0; transferNumber < SIMULTANEOUSTRANSFERS; transferNumber++)
-         libusb_free_transfer(usbTransfers[transferNumber]);
+    for (qint32 transferNumber = 0; transferNumber < simultaneousTransfers; transferNumber++) {
+        if (usbTransfers[transferNumber] != nullptr) libusb_free_transfer(usbTransfers[transferNumber]);
+    }
 
     // Aborting transfer - wait for disk buffer processing thread to complete
     qDebug() << "UsbCapture::run(): Transfer stopping - waiting for disk buffer processing to complete...";
@@ -412,17 +1113,20 @@ void UsbCapture::run(void)
         sched_yield();
     }
 
+    // Record the measurements of each stage of the capture
+    recordStageStatistics(captureStartTime);
+
     // If the transfer failed, emit a notification signal to the parent object
     if (transferFailure) {
         qDebug() << "UsbCapture::run(): Transfer failed - emitting notification signal";
         emit transferFailed();
     }
 
-    // Release the USB interface
-    qint32 releaseResult = libusb_release_interface(usbDeviceHandle, 0);
-    if (releaseResult < 0) {
-        qDebug() << "UsbCapture::run(): USB interface release failed with error:" << libusb_error_name(releaseResult);
-    }
+    // Close the capture log and timeline
+    delete captureTimeline;
+    captureTimeline = nullptr;
+    delete captureLog;
+    captureLog = nullptr;
 
     // Free the disk buffers
     freeDiskBuffers();
@@ -432,84 +1136,160 @@ void UsbCapture::run(void)
                 numberOfDiskBuffersWritten << "disk buffers written";
 }
 
-// Allocate memory for the disk buffers
-// Note: Using vectors would be neater, but they are just too slow
-void UsbCapture::allocateDiskBuffers(void)
+// Open the capture log and timeline, and launch the thread that writes the disk buffers to the capture file
+void UsbCapture::startDiskWriter(void)
 {
-    qDebug() << "UsbCapture::allocateDiskBuffers(): Allocating" << (1ULL * TRANSFERSIZE * TRANSFERSPERDISKBUFFER * NUMBEROFDISKBUFFERS) / (1024 * 1024) << "MiB memory for disk buffers";
-    // Allocate the disk buffers
-    diskBuffers = static_cast<unsigned char **>(calloc(NUMBEROFDISKBUFFERS, sizeof(unsigned char *)));
-    if (diskBuffers != nullptr) {
-        bool tryMlock = true;
-        for (quint32 bufferNumber = 0; bufferNumber < NUMBEROFDISKBUFFERS; bufferNumber++) {
+    // Open the capture log
+    captureLog = new CaptureLog(filename);
+    if (isTestData) captureLog->append("Capturing test data");
+    if (isSyntheticSource) captureLog->append("Test data is generated by the synthetic source");
+    captureLog->append("Capture buffers are backed by " + bufferPageModeDescription());
+    captureLog->append(QString("USB transfers: %1 x %2 Kbytes with a %3 ms timeout")
+                       .arg(simultaneousTransfers).arg(transferSize / 1024).arg(transferTimeout));
+    captureLog->append(QString("Capture buffers %1 in %2 mS")
+                       .arg(isBufferPoolReused ? "leased from the buffer pool" : "allocated").arg(bufferLeaseTime));
+    captureLog->append(QString("Checksums: CRC-32C (%1) recorded in %2")
+                       .arg(Crc32c::isHardwareAccelerated() ? "hardware" : "software")
+                       .arg(QFileInfo(CaptureManifest::manifestFilename(filename)).fileName()));
+
+    // Open the capture timeline and start recording the player's position
+    captureTimeline = new CaptureTimeline(filename);
+    isTimelineRecording = true;
+
+    // Launch a thread for writing disk buffers to disk (flagged as running from now, so stopping
+    // straight after an armed capture is triggered still waits for it)
+    isDiskBufferProcessRunning = true;
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+    QFuture<void> future = QtConcurrent::run(this, &UsbCapture::runDiskBuffers);
+#else
+    QFuture<void> future = QtConcurrent::run(&UsbCapture::runDiskBuffers, this);
+#endif
+}
 
-            diskBuffers[bufferNumber] = static_cast<unsigned char *>(malloc(TRANSFERSIZE * TRANSFERSPERDISKBUFFER));
-            isDiskBufferFull[bufferNumber] = false;
+// Hold the most recent full disk buffers of an armed capture as pre-roll, releasing the oldest
+// (without writing it) once more are held than the pre-roll needs
+void UsbCapture::holdPreRoll(void)
+{
+    // The disk buffers fill in turn
+    while (numberOfHeldDiskBuffers < NUMBEROFDISKBUFFERS && isDiskBufferFull[nextHeldDiskBuffer]) {
+        nextHeldDiskBuffer = (nextHeldDiskBuffer + 1) % NUMBEROFDISKBUFFERS;
+        numberOfHeldDiskBuffers++;
+    }
 
-            if (diskBuffers[bufferNumber] == nullptr) {
-                // Memory allocation has failed
-                qDebug() << "UsbCapture::allocateDiskBuffers(): Disk buffer memory allocation failed!";
-                lastError = tr("Failed to allocated required memory for disk buffers!");
-                transferFailure = true;
-                break;
-            }
+    // Once the capture is triggered the disk buffers held are kept for writing
+    while (numberOfHeldDiskBuffers > preRollDiskBuffers && isWaitingForTrigger) {
+        for (qint32 transferNumber = 0; transferNumber < transfersPerDiskBuffer; transferNumber++)
+            isTransferComplete[oldestHeldDiskBuffer][transferNumber] = false;
+        isDiskBufferFull[oldestHeldDiskBuffer] = false;
+        numberOfTransfersConsumed += transfersPerDiskBuffer;
+        numberOfPreRollBuffersReleased++;
 
-            // Lock the buffer into memory, preventing it from being paged out
-            if (tryMlock && mlock(diskBuffers[bufferNumber], TRANSFERSIZE * TRANSFERSPERDISKBUFFER) == -1) {
-                // Continue anyway, but print a warning
-                qInfo() << "UsbCapture::allocateDiskBuffers(): Unable to lock disk buffer into memory";
-                tryMlock = false;
-            }
-        }
-        if (tryMlock) qDebug() << "UsbCapture::allocateDiskBuffers(): Locked disk buffers into memory";
-    } else {
-        // Memory allocation has failed
-        qDebug() << "UsbCapture::allocateDiskBuffers(): Disk buffer array allocation failed!";
-        lastError = tr("Failed to allocated required memory for disk buffers!");
-        transferFailure = true;
+        oldestHeldDiskBuffer = (oldestHeldDiskBuffer + 1) % NUMBEROFDISKBUFFERS;
+        numberOfHeldDiskBuffers--;
     }
+}
 
-    // Allocate the conversion buffer
-    conversionBuffer = static_cast<unsigned char *>(malloc(TRANSFERSIZE * TRANSFERSPERDISKBUFFER));
-    if (conversionBuffer == nullptr) {
-        qDebug() << "UsbCapture::allocateDiskBuffers(): Conversion buffer memory allocation failed!";
-        lastError = tr("Failed to allocated required memory for data conversion buffers!");
+// Lease the disk buffers (and the conversion and discard buffers, if used) from the buffer pool.  If they
+// weren't reserved in advance with matching settings they are allocated now
+void UsbCapture::allocateDiskBuffers(void)
+{
+    QElapsedTimer leaseTimer;
+    leaseTimer.start();
+
+    // Dropped data is only received into the discard buffer when continuing after an overflow
+    qint64 discardBufferSize = (gapBudgetSamples >= 0) ? static_cast<qint64>(transferSize) * simultaneousTransfers : 0;
+
+    bufferPoolMutex.lock();
+    isBufferPoolReused = bufferPool.isAllocated && bufferPool.diskBufferNumaNode == threadSettings.diskBufferNumaNode &&
+            bufferPool.usbThreadCpus == threadSettings.usbThreadCpus &&
+            (isInPlaceConversion || bufferPool.conversionBuffer != nullptr) &&
+            bufferPool.discardBufferSize == discardBufferSize;
+    if (!isBufferPoolReused) {
+        qDebug() << "UsbCapture::allocateDiskBuffers(): Allocating" << (1ULL * DISKBUFFERSIZE * NUMBEROFDISKBUFFERS) / (1024 * 1024) << "MiB memory for disk buffers";
+    }
+
+    if (!reserveBufferPoolLocked(threadSettings, !isInPlaceConversion, discardBufferSize)) {
+        bufferPoolMutex.unlock();
+        lastError = tr("Failed to allocated required memory for disk buffers!");
         transferFailure = true;
+    } else {
+        bufferPool.isLeased = true;
+        bufferPoolMutex.unlock();
+
+        diskBuffers = bufferPool.diskBuffers;
+        for (qint32 bufferNumber = 0; bufferNumber < NUMBEROFDISKBUFFERS; bufferNumber++) {
+            diskBufferPageMode[bufferNumber] = bufferPool.diskBufferPageMode[bufferNumber];
+            isDiskBufferFull[bufferNumber] = false;
+            isDiskBufferDiscarding[bufferNumber] = false;
+            for (qint32 transferNumber = 0; transferNumber < transfersPerDiskBuffer; transferNumber++)
+                isTransferComplete[bufferNumber][transferNumber] = false;
+        }
+        if (bufferPool.isLocked) qDebug() << "UsbCapture::allocateDiskBuffers(): Disk buffers are locked into memory";
+
+        conversionBuffer = isInPlaceConversion ? nullptr : bufferPool.conversionBuffer;
+        conversionBufferPageMode = bufferPool.conversionBufferPageMode;
+        qInfo() << "UsbCapture::allocateDiskBuffers(): Buffers are backed by" << bufferPageModeDescription();
+
+        // The buffer that receives dropped data when continuing after an overflow
+        discardBuffer = bufferPool.discardBuffer;
     }
+    bufferLeaseTime = leaseTimer.elapsed();
 }
 
-// Free memory used for the disk buffers
+// Return the disk buffers to the buffer pool
 void UsbCapture::freeDiskBuffers(void)
 {
-    qDebug() << "UsbCapture::freeDiskBuffers(): Freeing disk buffer memory";
-    // Free up the allocated disk buffers
+    qDebug() << "UsbCapture::freeDiskBuffers(): Returning the disk buffers to the buffer pool";
     if (diskBuffers != nullptr) {
-        for (qint32 bufferNumber = 0; bufferNumber < NUMBEROFDISKBUFFERS; bufferNumber++) {
-            // Don't keep the buffer in RAM any more (silently ignoring failure)
-            (void) munlock(diskBuffers[bufferNumber], TRANSFERSIZE * TRANSFERSPERDISKBUFFER);
-
-            if (diskBuffers[bufferNumber] != nullptr) {
-                free(diskBuffers[bufferNumber]);
-            }
-            diskBuffers[bufferNumber] = nullptr;
-        }
-        free(diskBuffers);
-        diskBuffers = nullptr;
+        bufferPoolMutex.lock();
+        bufferPool.isLeased = false;
+        bufferPoolMutex.unlock();
     }
-
-    // Free up the temporary disk buffer
-    free(conversionBuffer);
+    diskBuffers = nullptr;
     conversionBuffer = nullptr;
+    discardBuffer = nullptr;
 
     qDebug() << "Setting finished variable for mainwindow";
     isOkToRename = true;
 }
 
+// Reserve the capture buffers in advance (for the given thread settings, see allocateDiskBuffers()),
+// so the next capture can start without allocating them.  This may be called from any thread, but
+// has no effect while a capture is using the buffers.  Returns false if the memory could not be allocated
+bool UsbCapture::reserveBufferPool(CaptureThreadSettings threadSettings, bool isConversionBufferRequired,
+                                   qint64 discardBufferSize)
+{
+    QMutexLocker locker(&bufferPoolMutex);
+    if (bufferPool.isLeased) return true;
+
+    return reserveBufferPoolLocked(threadSettings, isConversionBufferRequired, discardBufferSize);
+}
+
+// Free the reserved capture buffers (when the application has finished capturing)
+void UsbCapture::releaseBufferPool(void)
+{
+    QMutexLocker locker(&bufferPoolMutex);
+    if (bufferPool.isLeased) {
+        qDebug() << "UsbCapture::releaseBufferPool(): The buffer pool is in use by a capture";
+        return;
+    }
+
+    if (bufferPool.isAllocated) qDebug() << "UsbCapture::releaseBufferPool(): Releasing the buffer pool";
+    freeBufferPool();
+}
+
 // Thread for processing disk buffers
 void UsbCapture::runDiskBuffers(void)
 {
     qDebug() << "UsbCapture::runDiskBuffers(): Thread started";
 
+    qint64 cpuStartTime = threadCpuTime();
+
+    // Apply the CPU affinity, scheduling and I/O priority for the disk writer
+    ThreadTuning writerThreadTuning;
+    writerThreadTuning.apply(threadSettings.writerThreadCpus, threadSettings.writerThreadPriority,
+                             threadSettings.writerIoPriorityClass, threadSettings.writerIoPriorityLevel);
+
     // Open the capture file
     QFile outputFile(filename);
     if(!outputFile.open(QFile::WriteOnly | QFile::Truncate)) {
@@ -518,60 +1298,227 @@ void UsbCapture::runDiskBuffers(void)
         transferFailure = true;
     }
 
-    // Process the disk buffers until the transfer is complete or fails
+    // Open the checksum manifest for the capture file
+    captureManifest = new CaptureManifest(filename);
+
+    // Process the captured data until the transfer is complete or fails
     isDiskBufferProcessRunning = true;
+    if (isPipelinedConversion) processTransfers(&outputFile);
+    else processDiskBuffers(&outputFile);
+
+    // Close the capture file. QFile::close ignores errors, so flush first.
+    QElapsedTimer flushTimer;
+    flushTimer.start();
+    if (!outputFile.flush()) {
+        lastError = tr("Unable to write captured data to the destination file");
+        transferFailure = true;
+    }
+    outputFile.close();
+    totalWriteTime += flushTimer.nsecsElapsed();
+    captureManifest->close();
+    delete captureManifest;
+    captureManifest = nullptr;
+
+    // Record the outcome in the capture log
+    ThroughputStatistics throughputStatistics = throughputMonitor.getStatistics();
+    captureLog->append(QString("Capture stopped after %1 disk buffers, %2 clipped samples in total")
+                       .arg(numberOfDiskBuffersWritten.load()).arg(totalClippedSamples.load()));
+    captureLog->append(QString("Disk writes: %1 MB/s, average write latency %2 mS, maximum write latency %3 mS")
+                       .arg(throughputStatistics.writeRate / 1000000.0, 0, 'f', 1)
+                       .arg(throughputStatistics.averageWriteLatency, 0, 'f', 1)
+                       .arg(throughputStatistics.maximumWriteLatency, 0, 'f', 1));
+    if (numberOfConversions > 0) {
+        captureLog->append(QString("Conversion: average %1 mS per disk buffer (%2, %3)")
+                           .arg(static_cast<double>(totalConversionTime.load()) / numberOfConversions.load() / 1000000.0, 0, 'f', 1)
+                           .arg(isInPlaceConversion ? "in place" : "via the conversion buffer")
+                           .arg(bufferPageModeDescription()));
+    }
+    if (numberOfGaps > 0) {
+        captureLog->append(QString("Gaps: %1 totalling %2 samples (%3 seconds)")
+                           .arg(numberOfGaps.load()).arg(captureFileSamples(totalGapSamples.load()))
+                           .arg(static_cast<double>(totalGapSamples.load()) / SAMPLERATE, 0, 'f', 3));
+    }
+    if (transferFailure) captureLog->append("Capture failed: " + lastError);
+
+    // Restore the original thread settings (the writer runs on a reused thread pool thread)
+    writerThreadTuning.restore();
+    writerCpuTime = threadCpuTime() - cpuStartTime;
+
+    // Flag that the thread is complete
+    isDiskBufferProcessRunning = false;
+    qDebug() << "UsbCapture::runDiskBuffers(): Thread stopped";
+}
+
+// Generate the test data ramp at the device's data rate in place of the USB device.  Each generated
+// transfer is accounted for exactly as a completed USB transfer, so the rest of the pipeline runs as
+// it would for a real capture (used to bench the host without the hardware).
+void UsbCapture::runSyntheticSource(void)
+{
+    qDebug() << "UsbCapture::runSyntheticSource(): Thread started";
+
+    // The transfers are generated in turn in the same order the USB transfers would complete
+    QVector<transferUserDataStruct> transferUserData(simultaneousTransfers);
+    for (qint32 transferNumber = 0; transferNumber < simultaneousTransfers; transferNumber++) {
+        transferUserData[transferNumber].diskBufferTransferNumber = transferNumber;
+        transferUserData[transferNumber].diskBufferNumber = 0;
+        transferUserData[transferNumber].isDiscarding = false;
+    }
+
+    // Nanoseconds of samples held in each transfer
+    double transferTime = static_cast<double>(transferSize) * 1000000000.0 / (SAMPLERATE * 2.0);
+
+    QElapsedTimer sourceTimer;
+    sourceTimer.start();
+    qint64 numberOfTransfersGenerated = 0;
+    qint32 testDataValue = 0;
+
+    while (!captureComplete && !transferFailure) {
+        // Wait until the transfer is due
+        qint64 waitTime = static_cast<qint64>(numberOfTransfersGenerated * transferTime) - sourceTimer.nsecsElapsed();
+        if (waitTime > 1000) QThread::usleep(static_cast<unsigned long>(waitTime / 1000));
+
+        // Fill the transfer with the 10-bit test data ramp (as 16-bit little-endian words)
+        transferUserDataStruct *userData = &transferUserData[numberOfTransfersGenerated % simultaneousTransfers];
+        unsigned char *transferBuffer = getTransferBuffer(userData);
+        for (qint32 pointer = 0; pointer < transferSize; pointer += 2) {
+            transferBuffer[pointer] = static_cast<unsigned char>(testDataValue & 0xFF);
+            transferBuffer[pointer + 1] = static_cast<unsigned char>(testDataValue >> 8);
+            testDataValue = (testDataValue + 1) & 0x3FF;
+        }
+
+        completeTransfer(userData);
+        numberOfTransfersGenerated++;
+    }
+
+    // Nothing is left in-flight
+    transfersInFlight = 0;
+    qDebug() << "UsbCapture::runSyntheticSource(): Thread stopped after" << numberOfTransfersGenerated << "transfers";
+}
+
+// Write each disk buffer to disk once it is full
+void UsbCapture::processDiskBuffers(QFile *outputFile)
+{
+    // The disk buffers are written in the order they fill (an armed capture starts with the oldest pre-roll)
+    qint32 diskBufferNumber = firstDiskBufferNumber;
+
+    // Process the disk buffers until the transfer is complete or fails
     while(!captureComplete && !transferFailure) {
-        for (qint32 diskBufferNumber = 0; diskBufferNumber < NUMBEROFDISKBUFFERS; diskBufferNumber++) {
-            if (isDiskBufferFull[diskBufferNumber] && !transferFailure) {
-                // Write the buffer
-                if (transferAbort) qDebug() << "UsbCapture::runDiskBuffers(): Transfer abort flagged, writing disk buffer" << diskBufferNumber;
-                writeBufferToDisk(&outputFile, diskBufferNumber);
-
-                // Mark it as empty
-                isDiskBufferFull[diskBufferNumber] = false;
-
-                // Increment the statistics
-                numberOfDiskBuffersWritten++;
-            } else if (!captureComplete) {
-                // Sleep the thread for 100 uS to keep the CPU usage down
-                usleep(100);
+        if (isDiskBufferFull[diskBufferNumber]) {
+            // Write the buffer
+            if (transferAbort) qDebug() << "UsbCapture::processDiskBuffers(): Transfer abort flagged, writing disk buffer" << diskBufferNumber;
+            writeBufferToDisk(outputFile, diskBufferNumber);
 
-                // Then try the same buffer again, so we don't skip any
-                diskBufferNumber--;
-            }
+            // Mark it as empty
+            isDiskBufferFull[diskBufferNumber] = false;
 
-            // Check for transfer failure before continuing...
-            if (transferFailure) break;
+            // Increment the statistics
+            numberOfDiskBuffersWritten++;
+            emit statisticsChanged();
+
+            diskBufferNumber = (diskBufferNumber + 1) % NUMBEROFDISKBUFFERS;
+        } else {
+            // Sleep the thread for 100 uS to keep the CPU usage down, then try the same buffer again
+            usleep(100);
         }
     }
 
-    // Ensure all disk buffers are written before quitting the thread
-    if (!transferFailure) {
-        for (qint32 diskBufferNumber = 0; diskBufferNumber < NUMBEROFDISKBUFFERS; diskBufferNumber++) {
-            if (isDiskBufferFull[diskBufferNumber] && !transferFailure) {
-                // Write the buffer
-                qDebug() << "UsbCapture::runDiskBuffers(): Capture complete flagged, writing disk buffer" << diskBufferNumber;
-                writeBufferToDisk(&outputFile, diskBufferNumber);
+    // Ensure all disk buffers are written (in order) before quitting the thread
+    for (qint32 i = 0; i < NUMBEROFDISKBUFFERS && !transferFailure; i++) {
+        if (!isDiskBufferFull[diskBufferNumber]) break;
+
+        // Write the buffer
+        qDebug() << "UsbCapture::processDiskBuffers(): Capture complete flagged, writing disk buffer" << diskBufferNumber;
+        writeBufferToDisk(outputFile, diskBufferNumber);
+
+        // Mark it as empty
+        isDiskBufferFull[diskBufferNumber] = false;
+
+        // Increment the statistics
+        numberOfDiskBuffersWritten++;
+        emit statisticsChanged();
 
-                // Mark it as empty
-                isDiskBufferFull[diskBufferNumber] = false;
+        diskBufferNumber = (diskBufferNumber + 1) % NUMBEROFDISKBUFFERS;
+    }
+}
 
-                // Increment the statistics
-                numberOfDiskBuffersWritten++;
+// Convert and write each transfer as it arrives (pipelined conversion)
+void UsbCapture::processTransfers(QFile *outputFile)
+{
+    qint32 diskBufferNumber = firstDiskBufferNumber;
+    qint32 transferNumber = 0;
+    qint32 stagedBytes = 0;
+
+    // Converted data waiting to be written starts here in the current disk buffer (when
+    // converting in place) or at the start of the conversion buffer
+    qint32 stagedOffset = 0;
+    unsigned char *stagingBuffer = (isInPlaceConversion && diskBuffers != nullptr) ? diskBuffers[diskBufferNumber] : conversionBuffer;
+
+    while (!transferFailure) {
+        if (!isTransferComplete[diskBufferNumber][transferNumber]) {
+            // The transfer is flagged before captureComplete is set, so check it again before finishing
+            if (captureComplete) {
+                if (!isTransferComplete[diskBufferNumber][transferNumber]) break;
+            } else {
+                // Sleep the thread for 100 uS to keep the CPU usage down
+                usleep(100);
             }
+            continue;
         }
-    }
 
-    // Close the capture file. QFile::close ignores errors, so flush first.
-    if (!outputFile.flush()) {
-        lastError = tr("Unable to write captured data to the destination file");
-        transferFailure = true;
+        // Verify, analyse and convert the transfer a cache-sized block at a time
+        const unsigned char *transferData = diskBuffers[diskBufferNumber] + (transferSize * transferNumber);
+        for (qint32 blockPointer = 0; blockPointer < transferSize && !transferFailure; blockPointer += CONVERSIONBLOCKSIZE) {
+            if (isTestData && !verifyTestData(transferData + blockPointer, CONVERSIONBLOCKSIZE)) break;
+            analyseSamples(transferData + blockPointer, CONVERSIONBLOCKSIZE);
+
+            QElapsedTimer conversionTimer;
+            conversionTimer.start();
+            stagedBytes += convertSamples(transferData + blockPointer, CONVERSIONBLOCKSIZE, stagingBuffer + stagedBytes);
+            totalConversionTime += conversionTimer.nsecsElapsed();
+        }
+        if (transferFailure) break;
+
+        // Release the transfer
+        isTransferComplete[diskBufferNumber][transferNumber] = false;
+        numberOfTransfersConsumed++;
+
+        // Write the converted data once enough has been collected (converting in place, the
+        // disk buffer can't be released until all of its converted data is written)
+        transferNumber++;
+        if (stagedBytes >= PIPELINEWRITESIZE || (isInPlaceConversion && transferNumber == transfersPerDiskBuffer)) {
+            writeConversionBuffer(outputFile, stagingBuffer, stagedBytes);
+            if (isInPlaceConversion) {
+                stagedOffset += stagedBytes;
+                stagingBuffer = diskBuffers[diskBufferNumber] + stagedOffset;
+            }
+            stagedBytes = 0;
+        }
+
+        // Last transfer in the disk buffer?
+        if (transferNumber == transfersPerDiskBuffer) {
+            publishSignalMetrics();
+            numberOfConversions++;
+
+            // Mark the disk buffer as empty
+            isDiskBufferFull[diskBufferNumber] = false;
+
+            // Increment the statistics
+            numberOfDiskBuffersWritten++;
+            emit statisticsChanged();
+
+            // Move to the next disk buffer
+            transferNumber = 0;
+            diskBufferNumber++;
+            if (diskBufferNumber == NUMBEROFDISKBUFFERS) diskBufferNumber = 0;
+            if (isInPlaceConversion) {
+                stagedOffset = 0;
+                stagingBuffer = diskBuffers[diskBufferNumber];
+            }
+        }
     }
-    outputFile.close();
 
-    // Flag that the thread is complete
-    isDiskBufferProcessRunning = false;
-    qDebug() << "UsbCapture::runDiskBuffers(): Thread stopped";
+    // Write any remaining converted data
+    if (!transferFailure && stagedBytes > 0) writeConversionBuffer(outputFile, stagingBuffer, stagedBytes);
 }
 
 // Write a disk buffer to disk
@@ -580,136 +1527,506 @@ void UsbCapture::writeBufferToDisk(QFile *outputFile, qint32 diskBufferNumber)
     // Is this test data?
     if (isTestData) {
         // Verify the data
-        qint32 currentValue = savedTestDataValue;
+        if (!verifyTestData(diskBuffers[diskBufferNumber], DISKBUFFERSIZE)) return;
+        qDebug() << "UsbCapture::writeBufferToDisk(): Verified test data OK - current value" << savedTestDataValue;
+    }
 
-        for (qint32 pointer = 0; pointer < (TRANSFERSIZE * TRANSFERSPERDISKBUFFER); pointer += 2) {
-            // Get the original 10-bit unsigned value from the disk data buffer
-            qint32 originalValue = diskBuffers[diskBufferNumber][pointer];
-            originalValue += diskBuffers[diskBufferNumber][pointer+1] * 256;
+    // Gather the signal quality metrics for the buffer
+    analyseSamples(diskBuffers[diskBufferNumber], DISKBUFFERSIZE);
+    publishSignalMetrics();
+
+    // Convert the data to 10 or 16 bit format
+    unsigned char *convertedData = isInPlaceConversion ? diskBuffers[diskBufferNumber] : conversionBuffer;
+    QElapsedTimer conversionTimer;
+    conversionTimer.start();
+    qint32 numberOfConvertedBytes = convertSamples(diskBuffers[diskBufferNumber], DISKBUFFERSIZE, convertedData);
+    totalConversionTime += conversionTimer.nsecsElapsed();
+    numberOfConversions++;
+
+    // Write the converted data to disk
+    writeConversionBuffer(outputFile, convertedData, numberOfConvertedBytes);
+    numberOfTransfersConsumed += transfersPerDiskBuffer;
+}
 
-            if (currentValue == -1) {
-                // Initial data word
-                currentValue = originalValue;
-            } else {
-                currentValue++;
-                if (currentValue == 1024) currentValue = 0;
+// Verify a block of test data (a 10-bit counter) continuing from the previous block
+bool UsbCapture::verifyTestData(const unsigned char *data, qint32 length)
+{
+    qint32 currentValue = savedTestDataValue;
 
-                if (currentValue != originalValue) {
-                    // Data error
-                    qDebug() << "UsbCapture::writeBufferToDisk(): Data error! Expecting" << currentValue << "but got" << originalValue;
-                    lastError = tr("Test data verification error!");
-                    transferFailure = true;
-                    return;
-                }
+    for (qint32 pointer = 0; pointer < length; pointer += 2) {
+        // Get the original 10-bit unsigned value from the disk data buffer
+        qint32 originalValue = data[pointer];
+        originalValue += data[pointer+1] * 256;
+
+        if (currentValue == -1) {
+            // Initial data word
+            currentValue = originalValue;
+        } else {
+            currentValue++;
+            if (currentValue == 1024) currentValue = 0;
+
+            if (currentValue != originalValue) {
+                // Data error
+                qDebug() << "UsbCapture::verifyTestData(): Data error! Expecting" << currentValue << "but got" << originalValue;
+                lastError = tr("Test data verification error!");
+                transferFailure = true;
+                return false;
             }
         }
-
-        qDebug() << "UsbCapture::writeBufferToDisk(): Verified test data OK - current value" << currentValue;
-        savedTestDataValue = currentValue;
     }
 
-    // Write the data in 10 or 16 bit format
+    savedTestDataValue = currentValue;
+    return true;
+}
+
+// Convert a block of samples to the capture format, returning the number of bytes output
+// Note: length must be a multiple of 32 bytes (one group of decimated samples).  The output may
+// be the input (each group of samples is read before its output is written, and the output is
+// never larger than the input)
+qint32 UsbCapture::convertSamples(const unsigned char *input, qint32 length, unsigned char *output)
+{
     if (isCaptureFormat10Bit) {
         if (!isCaptureFormat10BitDecimated) {
-            // Translate the data in the disk buffer to unsigned 10-bit packed data
-            quint32 conversionBufferPointer = 0;
+            // Translate the data to unsigned 10-bit packed data
+            qint32 outputPointer = 0;
 
-            for (qint32 diskBufferPointer = 0; diskBufferPointer < (TRANSFERSIZE * TRANSFERSPERDISKBUFFER); diskBufferPointer += 8) {
+            for (qint32 inputPointer = 0; inputPointer < length; inputPointer += 8) {
                 quint32 originalWords[4];
 
                 // Get the original 4 10-bit words
-                originalWords[0]  = diskBuffers[diskBufferNumber][diskBufferPointer + 0];
-                originalWords[0] += diskBuffers[diskBufferNumber][diskBufferPointer + 1] * 256;
-                originalWords[1]  = diskBuffers[diskBufferNumber][diskBufferPointer + 2];
-                originalWords[1] += diskBuffers[diskBufferNumber][diskBufferPointer + 3] * 256;
-                originalWords[2]  = diskBuffers[diskBufferNumber][diskBufferPointer + 4];
-                originalWords[2] += diskBuffers[diskBufferNumber][diskBufferPointer + 5] * 256;
-                originalWords[3]  = diskBuffers[diskBufferNumber][diskBufferPointer + 6];
-                originalWords[3] += diskBuffers[diskBufferNumber][diskBufferPointer + 7] * 256;
+                originalWords[0]  = input[inputPointer + 0];
+                originalWords[0] += input[inputPointer + 1] * 256;
+                originalWords[1]  = input[inputPointer + 2];
+                originalWords[1] += input[inputPointer + 3] * 256;
+                originalWords[2]  = input[inputPointer + 4];
+                originalWords[2] += input[inputPointer + 5] * 256;
+                originalWords[3]  = input[inputPointer + 6];
+                originalWords[3] += input[inputPointer + 7] * 256;
 
                 // Convert into 5 bytes of packed 10-bit data
-                conversionBuffer[conversionBufferPointer + 0]  = static_cast<unsigned char>((originalWords[0] & 0x03FC) >> 2);
-                conversionBuffer[conversionBufferPointer + 1]  = static_cast<unsigned char>((originalWords[0] & 0x0003) << 6);
-                conversionBuffer[conversionBufferPointer + 1] += static_cast<unsigned char>((originalWords[1] & 0x03F0) >> 4);
-                conversionBuffer[conversionBufferPointer + 2]  = static_cast<unsigned char>((originalWords[1] & 0x000F) << 4);
-                conversionBuffer[conversionBufferPointer + 2] += static_cast<unsigned char>((originalWords[2] & 0x03C0) >> 6);
-                conversionBuffer[conversionBufferPointer + 3]  = static_cast<unsigned char>((originalWords[2] & 0x003F) << 2);
-                conversionBuffer[conversionBufferPointer + 3] += static_cast<unsigned char>((originalWords[3] & 0x0300) >> 8);
-                conversionBuffer[conversionBufferPointer + 4]  = static_cast<unsigned char>((originalWords[3] & 0x00FF));
-
-                // Increment the conversion buffer pointer
-                conversionBufferPointer += 5;
+                output[outputPointer + 0]  = static_cast<unsigned char>((originalWords[0] & 0x03FC) >> 2);
+                output[outputPointer + 1]  = static_cast<unsigned char>((originalWords[0] & 0x0003) << 6);
+                output[outputPointer + 1] += static_cast<unsigned char>((originalWords[1] & 0x03F0) >> 4);
+                output[outputPointer + 2]  = static_cast<unsigned char>((originalWords[1] & 0x000F) << 4);
+                output[outputPointer + 2] += static_cast<unsigned char>((originalWords[2] & 0x03C0) >> 6);
+                output[outputPointer + 3]  = static_cast<unsigned char>((originalWords[2] & 0x003F) << 2);
+                output[outputPointer + 3] += static_cast<unsigned char>((originalWords[3] & 0x0300) >> 8);
+                output[outputPointer + 4]  = static_cast<unsigned char>((originalWords[3] & 0x00FF));
+
+                // Increment the output pointer
+                outputPointer += 5;
             }
 
-            // Write the conversion buffer to disk
-            writeConversionBuffer(outputFile, conversionBufferPointer);
+            return outputPointer;
         } else {
-            // Translate the data in the disk buffer to unsigned 10-bit packed data with 4:1 decimation
-            quint32 conversionBufferPointer = 0;
+            // Translate the data to unsigned 10-bit packed data with 4:1 decimation
+            qint32 outputPointer = 0;
 
-            for (qint32 diskBufferPointer = 0; diskBufferPointer < (TRANSFERSIZE * TRANSFERSPERDISKBUFFER); diskBufferPointer += (8 * 4)) {
+            for (qint32 inputPointer = 0; inputPointer < length; inputPointer += (8 * 4)) {
                 quint32 originalWords[4];
 
                 // Get the original 4 10-bit words
-                originalWords[0]  = diskBuffers[diskBufferNumber][diskBufferPointer + 0];
-                originalWords[0] += diskBuffers[diskBufferNumber][diskBufferPointer + 1] * 256;
+                originalWords[0]  = input[inputPointer + 0];
+                originalWords[0] += input[inputPointer + 1] * 256;
 
-                originalWords[1]  = diskBuffers[diskBufferNumber][diskBufferPointer + 2 + 4];
-                originalWords[1] += diskBuffers[diskBufferNumber][diskBufferPointer + 3 + 4] * 256;
+                originalWords[1]  = input[inputPointer + 2 + 4];
+                originalWords[1] += input[inputPointer + 3 + 4] * 256;
 
-                originalWords[2]  = diskBuffers[diskBufferNumber][diskBufferPointer + 4 + 8];
-                originalWords[2] += diskBuffers[diskBufferNumber][diskBufferPointer + 5 + 8] * 256;
+                originalWords[2]  = input[inputPointer + 4 + 8];
+                originalWords[2] += input[inputPointer + 5 + 8] * 256;
 
-                originalWords[3]  = diskBuffers[diskBufferNumber][diskBufferPointer + 6 + 12];
-                originalWords[3] += diskBuffers[diskBufferNumber][diskBufferPointer + 7 + 12] * 256;
+                originalWords[3]  = input[inputPointer + 6 + 12];
+                originalWords[3] += input[inputPointer + 7 + 12] * 256;
 
                 // Convert into 5 bytes of packed 10-bit data
-                conversionBuffer[conversionBufferPointer + 0]  = static_cast<unsigned char>((originalWords[0] & 0x03FC) >> 2);
-                conversionBuffer[conversionBufferPointer + 1]  = static_cast<unsigned char>((originalWords[0] & 0x0003) << 6);
-                conversionBuffer[conversionBufferPointer + 1] += static_cast<unsigned char>((originalWords[1] & 0x03F0) >> 4);
-                conversionBuffer[conversionBufferPointer + 2]  = static_cast<unsigned char>((originalWords[1] & 0x000F) << 4);
-                conversionBuffer[conversionBufferPointer + 2] += static_cast<unsigned char>((originalWords[2] & 0x03C0) >> 6);
-                conversionBuffer[conversionBufferPointer + 3]  = static_cast<unsigned char>((originalWords[2] & 0x003F) << 2);
-                conversionBuffer[conversionBufferPointer + 3] += static_cast<unsigned char>((originalWords[3] & 0x0300) >> 8);
-                conversionBuffer[conversionBufferPointer + 4]  = static_cast<unsigned char>((originalWords[3] & 0x00FF));
-
-                // Increment the conversion buffer pointer
-                conversionBufferPointer += 5;
+                output[outputPointer + 0]  = static_cast<unsigned char>((originalWords[0] & 0x03FC) >> 2);
+                output[outputPointer + 1]  = static_cast<unsigned char>((originalWords[0] & 0x0003) << 6);
+                output[outputPointer + 1] += static_cast<unsigned char>((originalWords[1] & 0x03F0) >> 4);
+                output[outputPointer + 2]  = static_cast<unsigned char>((originalWords[1] & 0x000F) << 4);
+                output[outputPointer + 2] += static_cast<unsigned char>((originalWords[2] & 0x03C0) >> 6);
+                output[outputPointer + 3]  = static_cast<unsigned char>((originalWords[2] & 0x003F) << 2);
+                output[outputPointer + 3] += static_cast<unsigned char>((originalWords[3] & 0x0300) >> 8);
+                output[outputPointer + 4]  = static_cast<unsigned char>((originalWords[3] & 0x00FF));
+
+                // Increment the output pointer
+                outputPointer += 5;
             }
 
-            // Write the conversion buffer to disk
-            writeConversionBuffer(outputFile, conversionBufferPointer);
-        }
-    } else {
-        // Translate the data in the disk buffer to scaled 16-bit signed data
-        for (qint32 pointer = 0; pointer < (TRANSFERSIZE * TRANSFERSPERDISKBUFFER); pointer += 2) {
-            // Get the original 10-bit unsigned value from the disk data buffer
-            quint32 originalValue = diskBuffers[diskBufferNumber][pointer];
-            originalValue += diskBuffers[diskBufferNumber][pointer+1] * 256;
-
-            // Sign and scale the data to 16-bits
-            qint32 signedValue = static_cast<qint32>(originalValue - 512);
-            signedValue = signedValue * 64;
-
-            conversionBuffer[pointer] = static_cast<unsigned char>(signedValue & 0x00FF);
-            conversionBuffer[pointer+1] = static_cast<unsigned char>((signedValue & 0xFF00) >> 8);
+            return outputPointer;
         }
+    }
+
+    // Translate the data to scaled 16-bit signed data
+    for (qint32 pointer = 0; pointer < length; pointer += 2) {
+        // Get the original 10-bit unsigned value from the disk data buffer
+        quint32 originalValue = input[pointer];
+        originalValue += input[pointer+1] * 256;
 
-        // Write the conversion buffer to disk
-        writeConversionBuffer(outputFile, TRANSFERSIZE * TRANSFERSPERDISKBUFFER);
+        // Sign and scale the data to 16-bits
+        qint32 signedValue = static_cast<qint32>(originalValue - 512);
+        signedValue = signedValue * 64;
+
+        output[pointer] = static_cast<unsigned char>(signedValue & 0x00FF);
+        output[pointer+1] = static_cast<unsigned char>((signedValue & 0xFF00) >> 8);
     }
+
+    return length;
 }
 
-void UsbCapture::writeConversionBuffer(QFile *outputFile, qint32 numBytes)
+// Add a block of samples to the signal quality metrics for the current disk buffer
+void UsbCapture::analyseSamples(const unsigned char *data, qint32 length)
 {
-    qint64 bytesWritten = outputFile->write(reinterpret_cast<const char *>(conversionBuffer), sizeof(unsigned char) * numBytes);
+    accumulateSignalMetrics(reinterpret_cast<const quint16 *>(data), length / 2, &diskBufferSignalMetrics);
+}
+
+// Publish the signal quality metrics for the current disk buffer and start a new one
+void UsbCapture::publishSignalMetrics(void)
+{
+    SignalMetrics metrics = calculateSignalMetrics(&diskBufferSignalMetrics);
+    resetSignalMetrics(&diskBufferSignalMetrics);
+
+    signalMetricsMutex.lock();
+    latestSignalMetrics = metrics;
+    signalMetricsMutex.unlock();
+    totalClippedSamples += metrics.clippedLowCount + metrics.clippedHighCount;
+
+    captureLog->append(QString("Buffer %1: min %2, max %3, DC offset %4, RMS %5, clipped low %6, clipped high %7")
+                       .arg(numberOfDiskBuffersWritten.load())
+                       .arg(metrics.minimumValue).arg(metrics.maximumValue)
+                       .arg(metrics.dcOffset, 0, 'f', 2).arg(metrics.rms, 0, 'f', 2)
+                       .arg(metrics.clippedLowCount).arg(metrics.clippedHighCount));
+
+    detectSignalLoss(metrics);
+}
+
+// Stop the capture once a run of disk buffers without RF lasts for the signal loss time.  The
+// capture is stopped by the GUI (in the same way as a time limited capture)
+void UsbCapture::detectSignalLoss(const SignalMetrics &metrics)
+{
+    if (signalLossLimitSamples < 0 || isSignalLost) return;
+
+    if (metrics.rms >= SIGNALLOSSRMS) {
+        signalAbsentSamples = 0;
+        return;
+    }
+
+    // Note where the RF went, in case it doesn't come back
+    if (signalAbsentSamples == 0) signalAbsentPosition = static_cast<qint64>(numberOfDiskBuffersWritten.load()) * SAMPLESPERDISKBUFFER;
+    signalAbsentSamples += metrics.numberOfSamples;
+    if (signalAbsentSamples < signalLossLimitSamples) return;
+
+    isSignalLost = true;
+    QString message = QString("Signal lost: no RF (RMS below %1) since sample %2 of the capture file (%3 seconds) - stopping the capture")
+            .arg(SIGNALLOSSRMS, 0, 'f', 1)
+            .arg(captureFileSamples(signalAbsentPosition))
+            .arg(static_cast<double>(signalAbsentPosition) / SAMPLERATE, 0, 'f', 3);
+    qInfo() << "UsbCapture::detectSignalLoss():" << message;
+    captureLog->append(message);
+    emit signalLost(tr("No RF signal for %1 seconds - the capture was stopped")
+                    .arg(static_cast<double>(signalAbsentSamples) / SAMPLERATE, 0, 'f', 0));
+}
+
+// Write converted data to the capture file
+void UsbCapture::writeConversionBuffer(QFile *outputFile, const unsigned char *data, qint32 numBytes)
+{
+    QElapsedTimer writeTimer;
+    writeTimer.start();
+    qint64 bytesWritten = outputFile->write(reinterpret_cast<const char *>(data), sizeof(unsigned char) * numBytes);
+    qint64 writeTime = writeTimer.nsecsElapsed();
+    throughputMonitor.addBufferWrite(bytesWritten, writeTime);
+    totalWriteTime += writeTime;
     //qDebug() << "UsbCapture::writeBufferToDisk(): 10-bit - Written" << bytesWritten << "bytes to disk";
 
     // Check for a short write (which shouldn't happen, because outputFile is buffered) or a filesystem error
     if (bytesWritten != numBytes) {
         lastError = tr("Unable to write captured data to the destination file");
         transferFailure = true;
+        return;
+    }
+
+    // Checksum the data while it is still in the cache
+    captureManifest->append(data, numBytes);
+}
+
+// Record the gaps caused by disk buffer overflows in the capture log
+void UsbCapture::logCaptureGaps(void)
+{
+    // An armed capture that wasn't triggered has no capture log
+    if (captureLog == nullptr) return;
+
+    captureGapMutex.lock();
+    QVector<captureGapStruct> gaps = pendingCaptureGaps;
+    pendingCaptureGaps.clear();
+    captureGapMutex.unlock();
+
+    for (qint32 i = 0; i < gaps.size(); i++) {
+        // Positions are counted from the start of the stream, which an armed capture may not have kept
+        gaps[i].samplePosition -= captureOriginSamples;
+        if (gaps[i].samplePosition < 0) continue;
+
+        QString message = QString("Gap: %1 samples dropped at sample %2 of the capture file (%3 seconds)")
+                .arg(captureFileSamples(gaps[i].numberOfSamples))
+                .arg(captureFileSamples(gaps[i].samplePosition))
+                .arg(static_cast<double>(gaps[i].samplePosition) / SAMPLERATE, 0, 'f', 3);
+        qInfo() << "UsbCapture::logCaptureGaps():" << message;
+        captureLog->append(message);
+    }
+
+    if (!gaps.isEmpty()) emit statisticsChanged();
+}
+
+// Write the queued player positions to the capture timeline
+void UsbCapture::writeCaptureTimeline(void)
+{
+    if (captureTimeline == nullptr) return;
+
+    playerPositionMutex.lock();
+    QVector<playerPositionStruct> positions = pendingPlayerPositions;
+    pendingPlayerPositions.clear();
+    playerPositionMutex.unlock();
+
+    for (qint32 i = 0; i < positions.size(); i++) {
+        // Positions read before the start of an armed capture's pre-roll are dropped
+        qint64 samplePosition = positions[i].samplePosition - captureOriginSamples;
+        if (samplePosition < 0) continue;
+        captureTimeline->append(captureFileSamples(samplePosition), positions[i].isTimeCode, positions[i].address);
+    }
+}
+
+// Record the player's position against the number of samples captured so far (thread-safe;
+// called from the player control thread as each position is read)
+void UsbCapture::recordPlayerPosition(bool isTimeCode, qint32 address)
+{
+    if (!isTimelineRecording || address < 0) return;
+
+    playerPositionStruct position;
+    position.samplePosition = numberOfTransfersCaptured.load() * (transferSize / 2);
+    position.isTimeCode = isTimeCode;
+    position.address = address;
+
+    QMutexLocker locker(&playerPositionMutex);
+    pendingPlayerPositions.append(position);
+}
+
+// Stamp the trigger of an armed capture with the number of samples received so far (thread-safe;
+// only the first stamp counts, so the player control can stamp it as it starts the player)
+void UsbCapture::markTrigger(void)
+{
+    if (!isWaitingForTrigger) return;
+
+    qint64 unmarked = -1;
+    triggerSamplePosition.compare_exchange_strong(unmarked, numberOfTransfersCaptured.load() * (transferSize / 2));
+}
+
+// Returns true while an armed capture is waiting to be triggered
+bool UsbCapture::isArmed(void)
+{
+    return isWaitingForTrigger;
+}
+
+// Convert a number of ADC samples to the number of samples in the capture file
+qint64 UsbCapture::captureFileSamples(qint64 numberOfSamples)
+{
+    // The 4:1 decimated format keeps one sample in four
+    if (isCaptureFormat10Bit && isCaptureFormat10BitDecimated) return numberOfSamples / 4;
+    return numberOfSamples;
+}
+
+// Continue after a disk buffer overflow, dropping data, until the total length of the gaps exceeds
+// the budget (call before starting)
+void UsbCapture::setOverflowHandling(bool continueOnOverflow, qint32 gapBudgetSeconds)
+{
+    if (continueOnOverflow) gapBudgetSamples = static_cast<qint64>(qMax(gapBudgetSeconds, 0)) * SAMPLERATE;
+    else gapBudgetSamples = -1;
+}
+
+// Stop the capture after signalLossTime seconds without RF (0 keeps capturing; call before starting)
+void UsbCapture::setSignalLossStop(qint32 signalLossTime)
+{
+    if (signalLossTime > 0) signalLossLimitSamples = static_cast<qint64>(signalLossTime) * SAMPLERATE;
+    else signalLossLimitSamples = -1;
+}
+
+// Record the measurements of each stage of the capture (called once the transfers have drained
+// and the disk writer has stopped)
+void UsbCapture::recordStageStatistics(qint64 captureStartTime)
+{
+    CaptureStageStatistics stageStatistics;
+    stageStatistics.captureTime = static_cast<double>(monotonicTime() - captureStartTime) / 1000000000.0;
+    stageStatistics.bytesReceived = numberOfTransfersCaptured.load() * transferSize;
+    stageStatistics.receiveTime = 0.0;
+    stageStatistics.writeTime = static_cast<double>(totalWriteTime.load()) / 1000000000.0;
+    stageStatistics.bytesWritten = QFileInfo(filename).size();
+    stageStatistics.completionCpuTime = static_cast<double>(completionCpuTime.load()) / 1000000000.0;
+    stageStatistics.writerCpuTime = static_cast<double>(writerCpuTime.load()) / 1000000000.0;
+    stageStatistics.conversionTime = static_cast<double>(totalConversionTime.load()) / 1000000000.0;
+    stageStatistics.peakRingOccupancy = peakRingOccupancy;
+    stageStatistics.meanCompletionInterval = 0.0;
+    stageStatistics.completionJitter = 0.0;
+    stageStatistics.maximumCompletionInterval = maximumCompletionInterval / 1000000.0;
+    stageStatistics.numberOfGaps = numberOfGaps;
+    stageStatistics.startLatency = (firstTransferTime >= 0) ?
+                static_cast<double>(firstTransferTime - captureRequestTime) / 1000000.0 : -1.0;
+    stageStatistics.isSuccessful = !transferFailure;
+
+    // The transfers kept span one completion interval fewer than their number
+    qint64 numberOfTransfers = numberOfTransfersCaptured.load();
+    if (numberOfTransfers > 1) {
+        stageStatistics.receiveTime = static_cast<double>(lastCapturedTransferTime - firstCapturedTransferTime) *
+                numberOfTransfers / (numberOfTransfers - 1) / 1000000000.0;
+    }
+
+    if (numberOfCompletionIntervals > 0) {
+        double meanInterval = completionIntervalSum / numberOfCompletionIntervals;
+        double variance = (completionIntervalSquaredSum / numberOfCompletionIntervals) - (meanInterval * meanInterval);
+        stageStatistics.meanCompletionInterval = meanInterval / 1000000.0;
+        stageStatistics.completionJitter = std::sqrt(qMax(variance, 0.0)) / 1000000.0;
+    }
+
+    // An armed capture that wasn't triggered has no capture log
+    if (captureLog != nullptr) {
+        captureLog->append(QString("Transfer completions: mean interval %1 mS, jitter %2 mS, longest interval %3 mS")
+                           .arg(stageStatistics.meanCompletionInterval, 0, 'f', 2)
+                           .arg(stageStatistics.completionJitter, 0, 'f', 2)
+                           .arg(stageStatistics.maximumCompletionInterval, 0, 'f', 2));
+    }
+
+    stageStatisticsMutex.lock();
+    latestStageStatistics = stageStatistics;
+    stageStatisticsMutex.unlock();
+}
+
+// Get the measurements of each stage of the last capture
+CaptureStageStatistics UsbCapture::getStageStatistics(void)
+{
+    QMutexLocker locker(&stageStatisticsMutex);
+    return latestStageStatistics;
+}
+
+// Generate the test data in place of the USB device for the next capture (test data captures only)
+void UsbCapture::setSyntheticSource(bool isSyntheticSourceParam)
+{
+    isSyntheticSource = isSyntheticSourceParam;
+}
+
+// Get the default transfer geometry (used until the transfers have been calibrated)
+UsbTransferGeometry UsbCapture::getDefaultTransferGeometry(void)
+{
+    UsbTransferGeometry transferGeometry;
+    transferGeometry.transferSize = 16384 * 16;
+    transferGeometry.simultaneousTransfers = 16;
+    transferGeometry.transferTimeout = 1000;
+
+    return transferGeometry;
+}
+
+// Check that a transfer geometry fits the disk buffers and the usbfs memory limit
+bool UsbCapture::isTransferGeometryValid(UsbTransferGeometry transferGeometry)
+{
+    qint32 size = transferGeometry.transferSize;
+    if (size < MINTRANSFERSIZE || size > MAXTRANSFERSIZE || (size & (size - 1)) != 0) {
+        qDebug() << "UsbCapture::isTransferGeometryValid(): Invalid transfer size of" << size << "bytes";
+        return false;
+    }
+
+    if (transferGeometry.simultaneousTransfers < MINSIMULTANEOUSTRANSFERS ||
+            transferGeometry.simultaneousTransfers > MAXSIMULTANEOUSTRANSFERS) {
+        qDebug() << "UsbCapture::isTransferGeometryValid(): Invalid number of simultaneous transfers" << transferGeometry.simultaneousTransfers;
+        return false;
+    }
+
+    if (transferGeometry.transferTimeout < 100) {
+        qDebug() << "UsbCapture::isTransferGeometryValid(): Invalid transfer timeout of" << transferGeometry.transferTimeout << "ms";
+        return false;
     }
+
+    // All of the in-flight transfers are allocated from the usbfs memory pool
+    qint64 usbfsMemoryLimit = getUsbfsMemoryLimit();
+    qint64 inFlightBytes = static_cast<qint64>(size) * transferGeometry.simultaneousTransfers;
+    if (usbfsMemoryLimit > 0 && inFlightBytes > usbfsMemoryLimit) {
+        qDebug() << "UsbCapture::isTransferGeometryValid():" << inFlightBytes << "bytes of in-flight transfers exceeds the usbfs memory limit of" <<
+                    usbfsMemoryLimit << "bytes";
+        return false;
+    }
+
+    return true;
+}
+
+// Get the kernel's limit on memory used for USB transfers in bytes (0 = unlimited or unknown)
+qint64 UsbCapture::getUsbfsMemoryLimit(void)
+{
+#ifdef Q_OS_LINUX
+    QFile usbfsMemoryFile("/sys/module/usbcore/parameters/usbfs_memory_mb");
+    if (usbfsMemoryFile.open(QIODevice::ReadOnly)) {
+        bool isValid = false;
+        qint64 megabytes = usbfsMemoryFile.readAll().trimmed().toLongLong(&isValid);
+        if (isValid && megabytes > 0) return megabytes * 1024 * 1024;
+    }
+#endif
+
+    return 0;
+}
+
+// Set the transfer geometry for the next capture (call before starting - returns false and keeps
+// the current geometry if the requested one is invalid)
+bool UsbCapture::setTransferGeometry(UsbTransferGeometry transferGeometry)
+{
+    if (!isTransferGeometryValid(transferGeometry)) return false;
+
+    transferSize = transferGeometry.transferSize;
+    simultaneousTransfers = transferGeometry.simultaneousTransfers;
+    transfersPerDiskBuffer = DISKBUFFERSIZE / transferSize;
+    transferTimeout = static_cast<quint32>(transferGeometry.transferTimeout);
+
+    qDebug() << "UsbCapture::setTransferGeometry(): Using" << simultaneousTransfers << "transfers of" << transferSize / 1024 <<
+                "Kbytes with a" << transferTimeout << "ms timeout";
+    return true;
+}
+
+// Arm the capture rather than starting to write straight away (call before starting).  The transfers
+// run as usual, but the disk buffers are only held as pre-roll (whole disk buffers covering at least
+// preRollTime mS, leaving two for the incoming data) until triggerCapture() is called
+void UsbCapture::setArmedStart(bool isArmedStartParam, qint32 preRollTime)
+{
+    isArmedStart = isArmedStartParam;
+    isWaitingForTrigger = isArmedStart;
+
+    qint64 preRollSamples = static_cast<qint64>(qMax(preRollTime, 0)) * (SAMPLERATE / 1000);
+    preRollDiskBuffers = static_cast<qint32>((preRollSamples + SAMPLESPERDISKBUFFER - 1) / SAMPLESPERDISKBUFFER);
+    if (preRollDiskBuffers > NUMBEROFDISKBUFFERS - 2) {
+        qDebug() << "UsbCapture::setArmedStart(): Pre-roll limited to" << NUMBEROFDISKBUFFERS - 2 << "disk buffers";
+        preRollDiskBuffers = NUMBEROFDISKBUFFERS - 2;
+    }
+}
+
+// Trigger an armed capture.  The capture file is created now and starts with the pre-roll held when
+// the trigger was stamped.  Returns false if the capture isn't waiting for a trigger
+bool UsbCapture::triggerCapture(QString filenameParam)
+{
+    if (!isWaitingForTrigger) return false;
+
+    markTrigger();
+    filename = filenameParam;
+    isWaitingForTrigger = false;
+    return true;
+}
+
+// Set the CPU affinity, scheduling and memory placement for the capture threads (call before starting)
+void UsbCapture::setThreadSettings(CaptureThreadSettings threadSettingsParam)
+{
+    threadSettings = threadSettingsParam;
+}
+
+// Select conversion of each transfer as it arrives rather than of whole disk buffers (call before starting)
+void UsbCapture::setPipelinedConversion(bool isPipelinedConversionParam)
+{
+    isPipelinedConversion = isPipelinedConversionParam;
+}
+
+// Select conversion within the disk buffers (otherwise a separate conversion buffer is used)
+void UsbCapture::setInPlaceConversion(bool isInPlaceConversionParam)
+{
+    isInPlaceConversion = isInPlaceConversionParam;
 }
 
 // Start capturing
@@ -742,6 +2059,31 @@ qint32 UsbCapture::getNumberOfDiskBuffersWritten(void)
     return numberOfDiskBuffersWritten;
 }
 
+// Return the signal quality metrics for the most recently written disk buffer
+SignalMetrics UsbCapture::getSignalMetrics(void)
+{
+    QMutexLocker locker(&signalMetricsMutex);
+    return latestSignalMetrics;
+}
+
+// Return the measured throughput statistics for the capture
+ThroughputStatistics UsbCapture::getThroughputStatistics(void)
+{
+    return throughputMonitor.getStatistics();
+}
+
+// Return the number of gaps caused by disk buffer overflows
+qint32 UsbCapture::getNumberOfGaps(void)
+{
+    return numberOfGaps;
+}
+
+// Return the total number of clipped samples in the capture
+qint64 UsbCapture::getTotalClippedSamples(void)
+{
+    return totalClippedSamples;
+}
+
 // Return the last error text
 QString UsbCapture::getLastError(void)
 {
@@ -36,6 +36,56 @@
 #include <QtConcurrent/QtConcurrent>
 
 #include <libusb.h>
+#include <atomic>
+
+#include "capturelog.h"
+#include "capturetimeline.h"
+#include "capturemanifest.h"
+#include "throughputmonitor.h"
+#include "threadtuning.h"
+
+// Signal quality metrics for a disk buffer of captured samples
+struct SignalMetrics {
+    qint64 numberOfSamples;     // Number of samples the metrics cover
+    qint32 minimumValue;        // Lowest 10-bit sample value
+    qint32 maximumValue;        // Highest 10-bit sample value
+    qint64 clippedLowCount;     // Number of samples at code 0
+    qint64 clippedHighCount;    // Number of samples at code 1023
+    double dcOffset;            // Mean sample value relative to mid-scale (512)
+    double rms;                 // RMS of the signal about its mean (in codes)
+};
+
+// Measurements of each stage of the capture pipeline (see the capture bench)
+struct CaptureStageStatistics {
+    double captureTime;                 // Time from the start of the transfers until they drained (in seconds)
+    qint64 bytesReceived;               // Data kept from the USB device (or synthetic source)
+    qint64 bytesWritten;                // Size of the capture file
+    double receiveTime;                 // Time taken to receive the data kept, from the first transfer to the last (in seconds)
+    double writeTime;                   // Time the disk writer spent writing and flushing the capture file (in seconds)
+    double completionCpuTime;           // CPU time used accounting for completed transfers (in seconds)
+    double writerCpuTime;               // CPU time used by the disk writer thread (in seconds)
+    double conversionTime;              // Time spent converting to the capture format (in seconds)
+    double peakRingOccupancy;           // Most data waiting in the disk buffers (as a number of disk buffers)
+    double meanCompletionInterval;      // Mean time between transfer completions (in mS)
+    double completionJitter;            // Standard deviation of the time between completions (in mS)
+    double maximumCompletionInterval;   // Longest time between completions (in mS)
+    qint32 numberOfGaps;                // Number of disk buffers dropped following an overflow
+    double startLatency;                // Time from the capture request to the first completed transfer (in mS, -1 if none)
+    bool isSuccessful;                  // True if the capture completed without failing
+};
+
+// USB bulk transfer geometry used by a capture
+struct UsbTransferGeometry {
+    qint32 transferSize;            // Bytes per transfer (a power of 2 from MINTRANSFERSIZE to MAXTRANSFERSIZE)
+    qint32 simultaneousTransfers;   // Number of in-flight transfers
+    qint32 transferTimeout;         // Transfer timeout (in milliseconds)
+};
+
+// Limits of the transfer geometry (transfers are a multiple of the 16 Kbyte burst size)
+#define MINTRANSFERSIZE (16384 * 4)
+#define MAXTRANSFERSIZE (16384 * 64)
+#define MINSIMULTANEOUSTRANSFERS 4
+#define MAXSIMULTANEOUSTRANSFERS 64
 
 class UsbCapture : public QThread
 {
@@ -47,21 +97,48 @@ public:
                         bool isTestData = false);
     ~UsbCapture() override;
 
+    void setThreadSettings(CaptureThreadSettings threadSettingsParam);
+    void setPipelinedConversion(bool isPipelinedConversionParam);
+    void setInPlaceConversion(bool isInPlaceConversionParam);
+    void setOverflowHandling(bool continueOnOverflow, qint32 gapBudgetSeconds);
+    void setSignalLossStop(qint32 signalLossTime);
+    bool setTransferGeometry(UsbTransferGeometry transferGeometry);
+    void setSyntheticSource(bool isSyntheticSourceParam);
+    void setArmedStart(bool isArmedStartParam, qint32 preRollTime);
+    bool triggerCapture(QString filenameParam);
     void startTransfer(void);
     void stopTransfer(void);
     qint32 getNumberOfTransfers(void);
     qint32 getNumberOfDiskBuffersWritten(void);
     QString getLastError(void);
     static bool getOkToRename();
+    static SignalMetrics getSignalMetrics(void);
+    static ThroughputStatistics getThroughputStatistics(void);
+    static qint64 getTotalClippedSamples(void);
+    static qint32 getNumberOfGaps(void);
+    static void recordPlayerPosition(bool isTimeCode, qint32 address);
+    static void markTrigger(void);
+    static bool isArmed(void);
+    static UsbTransferGeometry getDefaultTransferGeometry(void);
+    static bool isTransferGeometryValid(UsbTransferGeometry transferGeometry);
+    static qint64 getUsbfsMemoryLimit(void);
+    static CaptureStageStatistics getStageStatistics(void);
+    static bool reserveBufferPool(CaptureThreadSettings threadSettings, bool isConversionBufferRequired,
+                                  qint64 discardBufferSize);
+    static void releaseBufferPool(void);
 
 signals:
     void transferFailed(void);
+    void statisticsChanged(void);
+    void throughputWarning(QString message);
+    void signalLost(QString message);
 
 public slots:
 
 protected slots:
     void run() override;
     void runDiskBuffers(void);
+    void runSyntheticSource(void);
 
 protected:
     libusb_context *libUsbContext;
@@ -70,12 +147,45 @@ protected:
     bool isCaptureFormat10Bit;
     bool isCaptureFormat10BitDecimated;
     bool isTestData;
+    CaptureThreadSettings threadSettings;
+    bool isPipelinedConversion;
+    bool isInPlaceConversion;
+    bool isSyntheticSource;
+    bool isArmedStart;
 
 private:
-    qint32 numberOfDiskBuffersWritten;
+    std::atomic<qint32> numberOfDiskBuffersWritten;
     qint32 savedTestDataValue;
+    qint64 captureRequestTime;
+    CaptureLog *captureLog;
+    CaptureTimeline *captureTimeline;
+    CaptureManifest *captureManifest;
+    qint32 preRollDiskBuffers;
+    qint32 oldestHeldDiskBuffer;
+    qint32 nextHeldDiskBuffer;
+    qint32 numberOfHeldDiskBuffers;
+    qint64 numberOfPreRollBuffersReleased;
+    qint64 captureOriginSamples;
+    qint32 firstDiskBufferNumber;
+    qint64 signalLossLimitSamples;
+    qint64 signalAbsentSamples;
+    qint64 signalAbsentPosition;
+    bool isSignalLost;
+    void startDiskWriter(void);
+    void holdPreRoll(void);
+    void processDiskBuffers(QFile *outputFile);
+    void processTransfers(QFile *outputFile);
     void writeBufferToDisk(QFile *outputFile, qint32 diskBufferNumber);
-    void writeConversionBuffer(QFile *outputFile, qint32 numBytes);
+    bool verifyTestData(const unsigned char *data, qint32 length);
+    qint32 convertSamples(const unsigned char *input, qint32 length, unsigned char *output);
+    void analyseSamples(const unsigned char *data, qint32 length);
+    void publishSignalMetrics(void);
+    void detectSignalLoss(const SignalMetrics &metrics);
+    void logCaptureGaps(void);
+    void writeCaptureTimeline(void);
+    void recordStageStatistics(qint64 captureStartTime);
+    qint64 captureFileSamples(qint64 numberOfSamples);
+    void writeConversionBuffer(QFile *outputFile, const unsigned char *data, qint32 numBytes);
 
     void allocateDiskBuffers(void);
     void freeDiskBuffers(void);
@@ -48,6 +48,9 @@ static int LIBUSB_CALL hotplug_callback_attach(libusb_context *ctx, libusb_devic
 
     qDebug() << "hotplug_callback_attach(): Device attached with VID =" << desc.idVendor << "and PID =" << desc.idProduct;
 
+    // The open device handle (if any) no longer refers to the attached device
+    usbDevice->invalidateDeviceHandle();
+
     // Send a signal indicating a device is attached
     emit usbDevice->deviceAttached();
 
@@ -75,6 +78,9 @@ static int LIBUSB_CALL hotplug_callback_detach(libusb_context *ctx, libusb_devic
 
     qDebug() << "hotplug_callback_detach(): Device detached with VID =" << desc.idVendor << "and PID =" << desc.idProduct;
 
+    // The open device handle (if any) no longer refers to the attached device
+    usbDevice->invalidateDeviceHandle();
+
     // Send a signal indicating a device is detached
     emit usbDevice->deviceDetached();
 
@@ -91,12 +97,35 @@ UsbDevice::UsbDevice(QObject *parent, quint16 vid, quint16 pid) : QThread (paren
     deviceVid = vid;
     devicePid = pid;
 
-    // Set up the libUSB event polling thread flags
+    // The device is opened when first used and then kept open
+    usbDeviceHandle = nullptr;
+    isDeviceHandleStale = false;
+
+    // Set up the libUSB event thread flags (the thread runs at normal priority until a capture starts)
     threadAbort = false;
+    eventThreadPriority = 0;
+    eventThreadTuningGeneration = 0;
 
     // Set the last error string
     lastError = tr("None");
 
+    // Default capture thread settings (real-time scheduling for the capture thread only)
+    captureThreadSettings.usbThreadCpus = QString();
+    captureThreadSettings.usbThreadPriority = -1;
+    captureThreadSettings.writerThreadCpus = QString();
+    captureThreadSettings.writerThreadPriority = 0;
+    captureThreadSettings.writerIoPriorityClass = 0;
+    captureThreadSettings.writerIoPriorityLevel = 0;
+    captureThreadSettings.diskBufferNumaNode = -1;
+    isCapturePipelinedConversion = false;
+    isCaptureInPlaceConversion = true;
+    isCaptureContinueOnOverflow = false;
+    captureGapBudgetSeconds = 0;
+    captureSignalLossTime = 0;
+    captureTransferGeometry = UsbCapture::getDefaultTransferGeometry();
+    isCaptureSyntheticSource = false;
+    calibratedTransferGeometry = UsbCapture::getDefaultTransferGeometry();
+
     // Initialise libUSB
     responseCode = libusb_init(&libUsbContext);
     if (responseCode < 0) {
@@ -136,7 +165,7 @@ UsbDevice::UsbDevice(QObject *parent, quint16 vid, quint16 pid) : QThread (paren
         }
     }
 
-    // Now start a thread to poll for attach/detach events)
+    // Now start the libUSB event thread (handles hot-plug events and capture transfer completions)
     connect(this, SIGNAL(finished()), this, SLOT(deleteLater()));
     this->start();
 }
@@ -144,65 +173,96 @@ UsbDevice::UsbDevice(QObject *parent, quint16 vid, quint16 pid) : QThread (paren
 // Class destructor
 UsbDevice::~UsbDevice()
 {
+    // Stop any transfer calibration (its transfers need the event thread to drain)
+    if (!transferCalibration.isNull()) {
+        transferCalibration->stop();
+        transferCalibration->wait();
+        delete transferCalibration;
+    }
+
     // Stop the libUSB event processing thread
     threadAbort = true;
     this->wait();
 
+    // Close the USB device
+    close();
+
+    // Free the capture buffers (once any reservation in progress has finished)
+    captureBufferReservation.waitForFinished();
+    UsbCapture::releaseBufferPool();
+
     // Delete the libUSB context
     libusb_exit(libUsbContext);
 }
 
-// Run the hot-plug detection thread
+// Run the libUSB event thread
+// This is the only thread that handles libUSB events for the context - hot-plug callbacks and the
+// capture's transfer completion callbacks are all dispatched from here.  During a capture the
+// thread takes on the USB capture thread's CPU affinity and real-time priority.
 void UsbDevice::run(void)
 {
     qint32 responseCode;
+    bool isHotplugSupported = libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG);
     bool currentDeviceState = false;
     bool previousDeviceState = false;
 
-    // If hot-plug events are supported, use them
-    if (libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG)) {
-        // Use a 1 second timeout for the libusb_handle_events_timeout call
-        struct timeval libusbHandleTimeout;
-        libusbHandleTimeout.tv_sec  = 1;
-        libusbHandleTimeout.tv_usec = 0;
-
-        // Process until the thread abort flag is set
-        qDebug() << "UsbDevice::run(): libUSB event poll thread started (using hot-plug events)";
-        while(!threadAbort) {
-            // Process the libUSB events
-            responseCode = libusb_handle_events_timeout(libUsbContext, &libusbHandleTimeout);
-            if (responseCode < 0) {
-                qDebug() << "UsbDevice::run(): libusb_handle_events returned an error!";
-            }
+    ThreadTuning eventThreadTuning;
+    qint32 appliedTuningGeneration = 0;
 
-            // Sleep the thread for 0.25 seconds to save CPU
-            this->msleep(250);
-        }
+    // Use a 100ms timeout for the libusb_handle_events_timeout_completed call (so the thread
+    // abort flag and tuning requests are checked regularly when the bus is idle)
+    struct timeval libusbHandleTimeout;
+    libusbHandleTimeout.tv_sec  = 0;
+    libusbHandleTimeout.tv_usec = 100000;
+
+    // Time between device searches when hot-plug events are not supported
+    QElapsedTimer searchTimer;
+    searchTimer.start();
+
+    if (isHotplugSupported) {
+        qDebug() << "UsbDevice::run(): libUSB event thread started (using hot-plug events)";
     } else {
-        // Hot-plug events are not supported
         qDebug() << "UsbDevice::run(): Warning, no hot-plug support.  Application will only detect device attached event";
+    }
+
+    // Process until the thread abort flag is set
+    while (!threadAbort) {
+        // Apply any change to the requested scheduling of this thread
+        if (eventThreadTuningGeneration != appliedTuningGeneration) {
+            eventThreadTuningMutex.lock();
+            appliedTuningGeneration = eventThreadTuningGeneration;
+            QString cpuList = eventThreadCpus;
+            qint32 realtimePriority = eventThreadPriority;
+            eventThreadTuningMutex.unlock();
+
+            eventThreadTuning.restore();
+            if (!cpuList.trimmed().isEmpty() || realtimePriority != 0) eventThreadTuning.apply(cpuList, realtimePriority);
+        }
 
-        while (!threadAbort) {
-            // If the device isn't attached, search for it
-            if (currentDeviceState == false) {
-                currentDeviceState = searchForAttachedDevice();
-                // Get the current device state
-
-                // Attached?
-                if (currentDeviceState == true && previousDeviceState == false) {
-                    // Device attached
-                    emit deviceAttached();
-                }
+        // Process the libUSB events
+        responseCode = libusb_handle_events_timeout_completed(libUsbContext, &libusbHandleTimeout, nullptr);
+        if (responseCode < 0 && responseCode != LIBUSB_ERROR_INTERRUPTED) {
+            qDebug() << "UsbDevice::run(): libusb_handle_events returned an error!" << libusb_error_name(responseCode);
+        }
+
+        // If hot-plug events are not supported and the device isn't attached, search for it
+        if (!isHotplugSupported && !currentDeviceState && searchTimer.elapsed() >= 500) {
+            searchTimer.restart();
+            currentDeviceState = searchForAttachedDevice();
+
+            // Attached?
+            if (currentDeviceState == true && previousDeviceState == false) {
+                // Device attached
+                emit deviceAttached();
             }
 
             // Store the current device state
             previousDeviceState = currentDeviceState;
-
-            this->msleep(500);
         }
     }
 
-    qDebug() << "UsbDevice::run(): libUSB event poll thread stopped";
+    eventThreadTuning.restore();
+    qDebug() << "UsbDevice::run(): libUSB event thread stopped";
 }
 
 void UsbDevice::stop(void)
@@ -211,33 +271,53 @@ void UsbDevice::stop(void)
     threadAbort = true;
 }
 
+// Request CPU affinity and real-time priority for the libUSB event thread (an empty CPU list
+// and a priority of 0 return the thread to its original scheduling)
+void UsbDevice::setEventThreadTuning(QString cpuList, qint32 realtimePriority)
+{
+    eventThreadTuningMutex.lock();
+    eventThreadCpus = cpuList;
+    eventThreadPriority = realtimePriority;
+    eventThreadTuningGeneration++;
+    eventThreadTuningMutex.unlock();
+}
+
 // Scan for the target USB device (detects device and emits signal)
 bool UsbDevice::scanForDevice(void)
 {
     qDebug() << "UsbDevice::scanForDevice(): Scanning for the USB device...";
 
-    // Attempt to open the USB device
-    // Open the USB device
-    bool result = open();
-    if (usbDeviceHandle == nullptr) return false;
+    // Attempt to open the USB device (it is kept open for later commands and captures)
+    if (!open()) return false;
 
-    // Device found, close it and return
-    close();
     emit deviceAttached();
-    return result;
+    return true;
 }
 
-// Poll for the target USB device (just detection)
+// Poll for the target USB device (just detection - the device is not opened)
 bool UsbDevice::searchForAttachedDevice(void)
 {
-    // Attempt to find and open the USB device
-    // Open the USB device
-    bool result = open();
-    if (usbDeviceHandle == nullptr) return false;
+    libusb_device **usbDevices;
+    bool isFound = false;
 
-    // Device found, close it and return
-    close();
-    return result;
+    ssize_t deviceCount = libusb_get_device_list(libUsbContext, &usbDevices);
+    if (deviceCount < 0) {
+        qDebug() << "UsbDevice::searchForAttachedDevice(): libusb_get_device_list returned an error!";
+        return false;
+    }
+
+    for (ssize_t deviceNumber = 0; deviceNumber < deviceCount; deviceNumber++) {
+        struct libusb_device_descriptor deviceDescriptor;
+        if (libusb_get_device_descriptor(usbDevices[deviceNumber], &deviceDescriptor) < 0) continue;
+
+        if (deviceVid == deviceDescriptor.idVendor && devicePid == deviceDescriptor.idProduct) {
+            isFound = true;
+            break;
+        }
+    }
+
+    libusb_free_device_list(usbDevices, 1);
+    return isFound;
 }
 
 // Send a configuration command to the USB device
@@ -254,14 +334,27 @@ void UsbDevice::sendConfigurationCommand(bool testMode)
     sendVendorSpecificCommand(0xB6, configurationFlags);
 }
 
-// Open the USB device
+// Flag that the device has been attached or detached, so the open handle must be replaced
+// before it is next used (called from the libUSB hot-plug callbacks)
+void UsbDevice::invalidateDeviceHandle(void)
+{
+    isDeviceHandleStale = true;
+}
+
+// Open the USB device and claim its interface
+// The device is kept open for the session - it is only re-opened following a hot-plug
+// event or a failed command, so commands and captures start with the device ready.
 bool UsbDevice::open(void)
 {
+    // Replace the handle if the device has changed (but never while a capture or calibration is using it)
+    if (!isDeviceInUse() && isDeviceHandleStale.exchange(false)) close();
+
+    // Already open?
+    if (usbDeviceHandle != nullptr) return true;
+
     libusb_device **usbDevices;
     libusb_device *usbDevice;
 
-    usbDeviceHandle = nullptr;
-
     qint32 responseCode;
     ssize_t deviceCount;
 
@@ -271,7 +364,8 @@ bool UsbDevice::open(void)
     deviceCount = libusb_get_device_list(libUsbContext, &usbDevices);
     if (deviceCount < 0) {
         qDebug() << "UsbDevice::open(): libusb_get_device_list returned an error!";
-        return usbDeviceHandle;
+        lastError = tr("Could not list the attached USB devices");
+        return false;
     }
 
     // Search the attached devices for the target device
@@ -292,6 +386,7 @@ bool UsbDevice::open(void)
             responseCode = libusb_open(usbDevice, &usbDeviceHandle);
             if (responseCode < 0) {
                 qDebug() << "UsbDevice::open(): Found device with matching VID/PID, but attempting to open it failed!" << libusb_error_name(responseCode);
+                lastError = tr("Could not open the USB device - LibUSB reports: ") + libusb_error_name(responseCode);
                 usbDeviceHandle = nullptr;
             } else isSuccess = true;
 
@@ -303,99 +398,229 @@ bool UsbDevice::open(void)
     // Free up the device list
     libusb_free_device_list(usbDevices, 1);
 
-    return isSuccess;
+    if (!isSuccess) return false;
+
+    // Claim the required USB device interface (held until the device is closed)
+    qint32 claimResult = libusb_claim_interface(usbDeviceHandle, 0);
+    if (claimResult < 0) {
+        qDebug() << "UsbDevice::open(): USB interface claim failed (connected via USB2?) with error:" << libusb_error_name(claimResult);
+        lastError = tr("Could not claim USB interface - Ensure the Duplicator is plugged into a USB3 port - LibUSB reports: ") + libusb_error_name(claimResult);
+        libusb_close(usbDeviceHandle);
+        usbDeviceHandle = nullptr;
+        return false;
+    }
+
+    qDebug() << "UsbDevice::open(): USB device opened and interface claimed";
+    return true;
+}
+
+// Returns true if a capture or transfer calibration is using the open device handle
+bool UsbDevice::isDeviceInUse(void)
+{
+    return (!usbCapture.isNull() && usbCapture->isRunning()) ||
+            (!transferCalibration.isNull() && transferCalibration->isRunning());
 }
 
 // Close the USB device
 void UsbDevice::close(void)
 {
+    if (usbDeviceHandle == nullptr) return;
+
+    // Release the USB interface
+    qint32 releaseResult = libusb_release_interface(usbDeviceHandle, 0);
+    if (releaseResult < 0) {
+        qDebug() << "UsbDevice::close(): USB interface release failed with error:" << libusb_error_name(releaseResult);
+    }
+
     libusb_close(usbDeviceHandle);
+    usbDeviceHandle = nullptr;
 }
 
 // Set a vendor-specific USB command to the attached device
 bool UsbDevice::sendVendorSpecificCommand(quint8 command, quint16 value)
 {
-    qint32 responseCode;
-    bool result = true;
-
-    // Open the USB device
-    result = open();
-
-    if (result) {
-        // Did we get a valid device handle?
-        if (usbDeviceHandle != nullptr) {
-            // Claim the required USB device interface for the transfer
-            qint32 claimResult = libusb_claim_interface(usbDeviceHandle, 0);
-            if (claimResult < 0) {
-                qDebug() << "UsbDevice::sendVendorSpecificCommand(): USB interface claim failed (connected via USB2?) with error:" << libusb_error_name(claimResult);
-
-                // We can't continue... clean-up and give up
-                close();
-                return false;
-            }
+    // Open the USB device (if it isn't already)
+    if (!open()) {
+        qDebug() << "UsbDevice::sendVendorSpecificCommand(): Sending vendor specific command failed, could not open USB device!";
+        return false;
+    }
 
-            // Perform a control transfer of type 0x40 (vendor specific command with no data packets)
-            responseCode = libusb_control_transfer(usbDeviceHandle, 0x40,
-                                                   command, value,
-                                                   0, nullptr, 0, 1000);
-            if (responseCode < 0) {
-                qDebug() << "UsbDevice::sendVendorSpecificCommand(): libusb_control_transfer failed with" << libusb_error_name(responseCode);
-                result = false;
-            }
-        } else {
-            qDebug() << "UsbDevice::sendVendorSpecificCommand(): Failed to open USB device";
-            result = false;
-        }
+    // Perform a control transfer of type 0x40 (vendor specific command with no data packets)
+    qint32 responseCode = libusb_control_transfer(usbDeviceHandle, 0x40, command, value, 0, nullptr, 0, 1000);
 
-        // Release the USB interface
-        qint32 releaseResult = libusb_release_interface(usbDeviceHandle, 0);
-        if (releaseResult < 0) {
-            qDebug() << "UsbDevice::sendVendorSpecificCommand(): USB interface release failed with error:" << libusb_error_name(releaseResult);
-        }
-
-        // Close the USB device
+    // If the device has gone away since it was opened, re-open it and try again
+    if (responseCode == LIBUSB_ERROR_NO_DEVICE || responseCode == LIBUSB_ERROR_IO) {
+        qDebug() << "UsbDevice::sendVendorSpecificCommand(): Device handle is no longer valid - re-opening the USB device";
         close();
-    } else {
-        qDebug() << "UsbDevice::sendVendorSpecificCommand(): Sending vendor specific command failed, could not open USB device!";
+        if (open()) responseCode = libusb_control_transfer(usbDeviceHandle, 0x40, command, value, 0, nullptr, 0, 1000);
     }
 
-    return result;
+    if (responseCode < 0) {
+        qDebug() << "UsbDevice::sendVendorSpecificCommand(): libusb_control_transfer failed with" << libusb_error_name(responseCode);
+        return false;
+    }
+
+    return true;
+}
+
+// Set the CPU affinity, scheduling and memory placement used by the next capture
+void UsbDevice::setCaptureThreadSettings(CaptureThreadSettings threadSettings)
+{
+    captureThreadSettings = threadSettings;
+}
+
+// Generate the data for the next test data capture with a synthetic source instead of the USB device
+void UsbDevice::setSyntheticSource(bool isSyntheticSource)
+{
+    isCaptureSyntheticSource = isSyntheticSource;
+}
+
+// Set the USB transfer geometry used by the next capture
+void UsbDevice::setTransferGeometry(UsbTransferGeometry transferGeometry)
+{
+    captureTransferGeometry = transferGeometry;
+}
+
+// Select conversion of each transfer as it arrives for the next capture
+void UsbDevice::setPipelinedConversion(bool isPipelinedConversion)
+{
+    isCapturePipelinedConversion = isPipelinedConversion;
+}
+
+// Select conversion within the disk buffers (rather than via a conversion buffer) for the next capture
+void UsbDevice::setInPlaceConversion(bool isInPlaceConversion)
+{
+    isCaptureInPlaceConversion = isInPlaceConversion;
 }
 
-// Start capturing from the USB device
-void UsbDevice::startCapture(QString filename, bool isCaptureFormat10Bit, bool isCaptureFormat10BitDecimated, bool isTestMode)
+// Reserve the buffers for the next capture in the background (using the capture thread settings,
+// conversion mode, overflow handling and transfer geometry already set), so starting the capture
+// doesn't have to wait for them
+void UsbDevice::reserveCaptureBuffers(void)
+{
+    // Dropped data is received into a buffer for all the in-flight transfers
+    qint64 discardBufferSize = 0;
+    if (isCaptureContinueOnOverflow) {
+        discardBufferSize = static_cast<qint64>(captureTransferGeometry.transferSize) * captureTransferGeometry.simultaneousTransfers;
+    }
+
+    captureBufferReservation.waitForFinished();
+    captureBufferReservation = QtConcurrent::run(&UsbCapture::reserveBufferPool, captureThreadSettings,
+                                                 !isCaptureInPlaceConversion, discardBufferSize);
+}
+
+// Select how disk buffer overflows are handled for the next capture
+void UsbDevice::setOverflowHandling(bool continueOnOverflow, qint32 gapBudgetSeconds)
+{
+    isCaptureContinueOnOverflow = continueOnOverflow;
+    captureGapBudgetSeconds = gapBudgetSeconds;
+}
+
+// Select how long the next capture continues without RF before it is stopped (0 never stops)
+void UsbDevice::setSignalLossStop(qint32 signalLossTime)
+{
+    captureSignalLossTime = signalLossTime;
+}
+
+// Start capturing from the USB device (with a pre-roll time the capture is armed instead, see armCapture())
+void UsbDevice::startCapture(QString filename, bool isCaptureFormat10Bit, bool isCaptureFormat10BitDecimated, bool isTestMode,
+                             qint32 preRollTime)
 {
     qDebug() << "UsbDevice::startCapture(): Starting capture";
 
-    // Open the USB device
-    qDebug() << "UsbDevice::startCapture(): Opening the capture device";
-    bool result = open();
-
-    if (result) {
-        // Create the capture object
-        qDebug() << "UsbDevice::startCapture(): Creating the capture object";
-        usbCapture = new UsbCapture(this, libUsbContext, usbDeviceHandle, filename,
-                                    isCaptureFormat10Bit, isCaptureFormat10BitDecimated, isTestMode);
-
-        // Did we get a valid device handle?
-        if (usbDeviceHandle != nullptr) {
-            qDebug() << "UsbDevice::startCapture(): Starting capture process with start()";
-            usbCapture->start();
-        } else {
-            qDebug() << "UsbDevice::startCapture(): Invalid device handle... cannot start capture!";
-        }
+    // The synthetic source replaces the USB device for test data captures
+    bool isSynthetic = isCaptureSyntheticSource && isTestMode;
 
-        // Connect to the transfer failure notification signal
-        connect(usbCapture, &UsbCapture::transferFailed, this, &UsbDevice::transferFailedSignalHandler);
-    } else {
+    // Make sure the USB device is open (it normally already is) and not being calibrated
+    if (isTransferCalibrationRunning()) lastError = tr("The USB device is busy with the USB transfer calibration");
+    if (isTransferCalibrationRunning() || (!isSynthetic && !open())) {
         qDebug() << "UsbDevice::startCapture(): Could not open USB device... cannot start capture!";
+
+        // Report the failure once the caller has connected to the failure signal
+        QMetaObject::invokeMethod(this, "transferFailed", Qt::QueuedConnection);
+        return;
     }
+
+    // Transfer completions are handled by the libUSB event thread, so give it the USB capture
+    // thread's scheduling for the duration of the capture
+    setEventThreadTuning(captureThreadSettings.usbThreadCpus, captureThreadSettings.usbThreadPriority);
+
+    // Create the capture object
+    qDebug() << "UsbDevice::startCapture(): Creating the capture object";
+    usbCapture = new UsbCapture(this, libUsbContext, isSynthetic ? nullptr : usbDeviceHandle, filename,
+                                isCaptureFormat10Bit, isCaptureFormat10BitDecimated, isTestMode);
+    usbCapture->setSyntheticSource(isSynthetic);
+    usbCapture->setThreadSettings(captureThreadSettings);
+    usbCapture->setPipelinedConversion(isCapturePipelinedConversion);
+    usbCapture->setInPlaceConversion(isCaptureInPlaceConversion);
+    usbCapture->setOverflowHandling(isCaptureContinueOnOverflow, captureGapBudgetSeconds);
+    usbCapture->setSignalLossStop(captureSignalLossTime);
+    if (preRollTime >= 0) usbCapture->setArmedStart(true, preRollTime);
+    if (!usbCapture->setTransferGeometry(captureTransferGeometry)) {
+        qDebug() << "UsbDevice::startCapture(): The configured transfer geometry is not valid - using the default";
+    }
+
+    // Connect to the transfer failure notification signal
+    connect(usbCapture, &UsbCapture::transferFailed, this, &UsbDevice::transferFailedSignalHandler);
+    connect(usbCapture, &UsbCapture::finished, this, &UsbDevice::captureFinishedSignalHandler);
+
+    // Pass on the statistics changed notification
+    connect(usbCapture, &UsbCapture::statisticsChanged, this, &UsbDevice::captureStatisticsChanged);
+    connect(usbCapture, &UsbCapture::throughputWarning, this, &UsbDevice::captureThroughputWarning);
+    connect(usbCapture, &UsbCapture::signalLost, this, &UsbDevice::captureSignalLost);
+
+    qDebug() << "UsbDevice::startCapture(): Starting capture process with start()";
+    usbCapture->start();
+}
+
+// Start streaming from the USB device without writing a capture file, keeping (at least) the last
+// preRollTime mS in the disk buffers until the capture is triggered.  Stopping the capture before
+// it is triggered disarms it
+void UsbDevice::armCapture(bool isCaptureFormat10Bit, bool isCaptureFormat10BitDecimated, bool isTestMode, qint32 preRollTime)
+{
+    qDebug() << "UsbDevice::armCapture(): Arming capture with" << preRollTime << "mS of pre-roll";
+    startCapture(QString(), isCaptureFormat10Bit, isCaptureFormat10BitDecimated, isTestMode, qMax(preRollTime, 0));
+}
+
+// Trigger the armed capture, writing it (from the pre-roll on) to the given file.  Returns false
+// if there is no armed capture waiting for a trigger (the last error is set if it failed)
+bool UsbDevice::triggerCapture(QString filename)
+{
+    if (usbCapture.isNull()) return false;
+
+    if (!usbCapture->triggerCapture(filename)) {
+        lastError = usbCapture->getLastError();
+        return false;
+    }
+
+    qDebug() << "UsbDevice::triggerCapture(): Armed capture triggered";
+    return true;
+}
+
+// Returns true while an armed capture is waiting to be triggered
+bool UsbDevice::isCaptureArmed(void)
+{
+    return !usbCapture.isNull() && UsbCapture::isArmed();
+}
+
+// Stop the armed capture without writing anything.  This waits for the stream to stop, so the
+// device is free for another capture, the transfer calibration or the bench straight away
+void UsbDevice::disarmCapture(void)
+{
+    if (usbCapture.isNull()) return;
+
+    qDebug() << "UsbDevice::disarmCapture(): Disarming capture";
+    usbCapture->stopTransfer();
+    usbCapture->wait();
+    delete usbCapture;
 }
 
 // Stop capturing from the USB device
 void UsbDevice::stopCapture(void)
 {
-     // Stop the capture (closes the USB device)
+    if (usbCapture.isNull()) return;
+
+    // Stop the capture (the USB device remains open)
     usbCapture->stopTransfer();
 
     // Destroy the capture object
@@ -407,27 +632,162 @@ void UsbDevice::transferFailedSignalHandler(void)
 {
     // Retransmit signal to parent object
     qDebug() << "UsbDevice::transferFailedSignalHandler(): Transfer failed signal received from UsbCapture";
-    lastError = usbCapture->getLastError();
+    if (!usbCapture.isNull()) lastError = usbCapture->getLastError();
+
+    // Re-open the device before it is next used, in case the failure left the handle unusable
+    invalidateDeviceHandle();
     emit transferFailed();
 }
 
+// Handle the capture thread finishing (normally or following a failure)
+void UsbDevice::captureFinishedSignalHandler(void)
+{
+    // Return the libUSB event thread to its normal scheduling
+    qDebug() << "UsbDevice::captureFinishedSignalHandler(): Capture thread finished";
+    setEventThreadTuning(QString(), 0);
+    emit captureFinished();
+}
+
 // Get capture statistics
 qint32 UsbDevice::getNumberOfTransfers(void)
 {
-    if (usbCapture == nullptr) return 0;
+    if (usbCapture.isNull()) return 0;
 
     return usbCapture->getNumberOfTransfers();
 }
 
 qint32 UsbDevice::getNumberOfDiskBuffersWritten(void)
 {
-    if (usbCapture == nullptr) return 0;
+    if (usbCapture.isNull()) return 0;
 
     return usbCapture->getNumberOfDiskBuffersWritten();
 }
 
+SignalMetrics UsbDevice::getSignalMetrics(void)
+{
+    return UsbCapture::getSignalMetrics();
+}
+
+ThroughputStatistics UsbDevice::getThroughputStatistics(void)
+{
+    return UsbCapture::getThroughputStatistics();
+}
+
+qint64 UsbDevice::getTotalClippedSamples(void)
+{
+    return UsbCapture::getTotalClippedSamples();
+}
+
+qint32 UsbDevice::getNumberOfGaps(void)
+{
+    return UsbCapture::getNumberOfGaps();
+}
+
+// Get the measurements of each stage of the last capture
+CaptureStageStatistics UsbDevice::getCaptureStageStatistics(void)
+{
+    return UsbCapture::getStageStatistics();
+}
+
+// Returns true if a capture object exists (the capture is running or still finishing)
+bool UsbDevice::isCaptureRunning(void)
+{
+    return !usbCapture.isNull();
+}
+
+// Stamp the trigger of the armed capture as the player is started (called directly from the
+// player control thread, ahead of the queued request to start the capture)
+void UsbDevice::markCaptureTrigger(void)
+{
+    UsbCapture::markTrigger();
+}
+
+// Record a player position reading in the timeline of the running capture (called directly
+// from the player control thread, so the reading is stamped as soon as it is made)
+void UsbDevice::recordPlayerPosition(PlayerCommunication::DiscType discType, qint32 address)
+{
+    if (discType == PlayerCommunication::DiscType::unknownDiscType) return;
+    UsbCapture::recordPlayerPosition(discType == PlayerCommunication::DiscType::CLV, address);
+}
+
 // Return the last recorded error message
 QString UsbDevice::getLastError(void)
 {
     return lastError;
 }
+
+// USB transfer calibration -------------------------------------------------------------------------------------------
+
+// Start calibrating the USB transfer geometry (the device is put into test mode - the caller
+// should restore its test mode setting when the calibration completes)
+bool UsbDevice::startTransferCalibration(void)
+{
+    if (isDeviceInUse()) {
+        lastError = tr("The USB device is busy");
+        return false;
+    }
+
+    if (!open()) {
+        qDebug() << "UsbDevice::startTransferCalibration(): Could not open USB device... cannot start calibration!";
+        return false;
+    }
+
+    // The calibration streams the device's test data pattern
+    if (!sendVendorSpecificCommand(0xB6, 1)) {
+        lastError = tr("Could not select the device's test mode");
+        return false;
+    }
+
+    // Measure with the event thread scheduled as it would be for a capture
+    setEventThreadTuning(captureThreadSettings.usbThreadCpus, captureThreadSettings.usbThreadPriority);
+
+    qDebug() << "UsbDevice::startTransferCalibration(): Starting USB transfer calibration";
+    transferCalibrationResults.clear();
+    transferCalibration = new TransferCalibration(this, usbDeviceHandle);
+    connect(transferCalibration, &TransferCalibration::calibrationProgress, this, &UsbDevice::transferCalibrationProgress);
+    connect(transferCalibration, &TransferCalibration::calibrationComplete, this, &UsbDevice::calibrationCompleteSignalHandler);
+    transferCalibration->start();
+
+    return true;
+}
+
+// Stop the USB transfer calibration (transferCalibrationComplete is emitted when it has stopped)
+void UsbDevice::stopTransferCalibration(void)
+{
+    if (!transferCalibration.isNull()) transferCalibration->stop();
+}
+
+// Returns true if the USB transfer calibration is running
+bool UsbDevice::isTransferCalibrationRunning(void)
+{
+    return !transferCalibration.isNull();
+}
+
+// Get the results of the last USB transfer calibration
+QVector<TransferCalibrationResult> UsbDevice::getTransferCalibrationResults(void)
+{
+    return transferCalibrationResults;
+}
+
+// Get the transfer geometry selected by the last successful USB transfer calibration
+UsbTransferGeometry UsbDevice::getCalibratedTransferGeometry(void)
+{
+    return calibratedTransferGeometry;
+}
+
+// Handle the calibration complete signal from the transfer calibration thread
+void UsbDevice::calibrationCompleteSignalHandler(bool isSuccessful)
+{
+    qDebug() << "UsbDevice::calibrationCompleteSignalHandler(): USB transfer calibration complete - success is" << isSuccessful;
+
+    // Collect the results and dispose of the calibration thread
+    transferCalibrationResults = transferCalibration->getResults();
+    if (isSuccessful) calibratedTransferGeometry = transferCalibration->getBestGeometry();
+    else lastError = transferCalibration->getLastError();
+
+    transferCalibration->wait();
+    delete transferCalibration;
+
+    setEventThreadTuning(QString(), 0);
+    emit transferCalibrationComplete(isSuccessful);
+}
@@ -32,9 +32,17 @@
 #include <QDebug>
 #include <QThread>
 #include <QWaitCondition>
+#include <QPointer>
+#include <QMutex>
+#include <QElapsedTimer>
+
+#include <atomic>
 
 #include <libusb.h>
 #include "usbcapture.h"
+#include "playercommunication.h"
+#include "threadtuning.h"
+#include "transfercalibration.h"
 
 class UsbDevice : public QThread
 {
@@ -47,19 +55,53 @@ public:
 
     bool scanForDevice(void);
     void sendConfigurationCommand(bool testMode);
-
-    void startCapture(QString filename, bool isCaptureFormat10Bit, bool isCaptureFormat10BitDecimated, bool isTestMode);
+    void invalidateDeviceHandle(void);
+
+    void setCaptureThreadSettings(CaptureThreadSettings threadSettings);
+    void setPipelinedConversion(bool isPipelinedConversion);
+    void setInPlaceConversion(bool isInPlaceConversion);
+    void reserveCaptureBuffers(void);
+    void setOverflowHandling(bool continueOnOverflow, qint32 gapBudgetSeconds);
+    void setSignalLossStop(qint32 signalLossTime);
+    void setTransferGeometry(UsbTransferGeometry transferGeometry);
+    void setSyntheticSource(bool isSyntheticSource);
+    void startCapture(QString filename, bool isCaptureFormat10Bit, bool isCaptureFormat10BitDecimated, bool isTestMode,
+                      qint32 preRollTime = -1);
+    void armCapture(bool isCaptureFormat10Bit, bool isCaptureFormat10BitDecimated, bool isTestMode, qint32 preRollTime);
+    bool triggerCapture(QString filename);
+    bool isCaptureArmed(void);
+    void disarmCapture(void);
     void stopCapture(void);
     qint32 getNumberOfTransfers(void);
     qint32 getNumberOfDiskBuffersWritten(void);
+    SignalMetrics getSignalMetrics(void);
+    ThroughputStatistics getThroughputStatistics(void);
+    qint64 getTotalClippedSamples(void);
+    qint32 getNumberOfGaps(void);
+    CaptureStageStatistics getCaptureStageStatistics(void);
+    bool isCaptureRunning(void);
     QString getLastError(void);
 
+    bool startTransferCalibration(void);
+    void stopTransferCalibration(void);
+    bool isTransferCalibrationRunning(void);
+    QVector<TransferCalibrationResult> getTransferCalibrationResults(void);
+    UsbTransferGeometry getCalibratedTransferGeometry(void);
+
 signals:
     void deviceAttached(void);
     void deviceDetached(void);
     void transferFailed(void);
+    void captureStatisticsChanged(void);
+    void captureThroughputWarning(QString message);
+    void captureSignalLost(QString message);
+    void captureFinished(void);
+    void transferCalibrationProgress(qint32 trialNumber, qint32 numberOfTrials);
+    void transferCalibrationComplete(bool isSuccessful);
 
 public slots:
+    void recordPlayerPosition(PlayerCommunication::DiscType discType, qint32 address);
+    void markCaptureTrigger(void);
 
 protected slots:
     void run() override;
@@ -67,18 +109,42 @@ protected slots:
 protected:
     libusb_context *libUsbContext;
     libusb_device_handle *usbDeviceHandle;
-    bool threadAbort;
+    std::atomic<bool> isDeviceHandleStale;
+    std::atomic<bool> threadAbort;
 
 private slots:
     void transferFailedSignalHandler(void);
+    void captureFinishedSignalHandler(void);
+    void calibrationCompleteSignalHandler(bool isSuccessful);
 
 private:
     quint16 deviceVid;
     quint16 devicePid;
 
-    UsbCapture *usbCapture;
+    QPointer<UsbCapture> usbCapture;
+    CaptureThreadSettings captureThreadSettings;
+    bool isCapturePipelinedConversion;
+    bool isCaptureInPlaceConversion;
+    bool isCaptureContinueOnOverflow;
+    qint32 captureGapBudgetSeconds;
+    qint32 captureSignalLossTime;
+    UsbTransferGeometry captureTransferGeometry;
+    bool isCaptureSyntheticSource;
+    QFuture<bool> captureBufferReservation;
+
+    QPointer<TransferCalibration> transferCalibration;
+    QVector<TransferCalibrationResult> transferCalibrationResults;
+    UsbTransferGeometry calibratedTransferGeometry;
     QString lastError;
 
+    // Scheduling requested for the libUSB event thread (applied by the thread itself)
+    QMutex eventThreadTuningMutex;
+    QString eventThreadCpus;
+    qint32 eventThreadPriority;
+    std::atomic<qint32> eventThreadTuningGeneration;
+
+    void setEventThreadTuning(QString cpuList, qint32 realtimePriority);
+    bool isDeviceInUse(void);
     bool open(void);
     void close(void);
     bool sendVendorSpecificCommand(quint8 command, quint16 value);
@@ -0,0 +1,207 @@
+
+/************************************************************************
+
+    main.cpp
+
+    dddplayer - Domesday Duplicator virtual LaserDisc player
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of Domesday Duplicator.
+
+    Domesday Duplicator is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QtGlobal>
+#include <QCommandLineParser>
+#include <QFile>
+
+#include <signal.h>
+#include <unistd.h>
+
+#include "virtualplayer.h"
+
+// Global for debug output
+static bool showDebug = false;
+
+// Qt debug message handler
+void debugOutputHandler(QtMsgType type, const QMessageLogContext &context, const QString &msg)
+{
+    // Use:
+    // context.file - to show the filename
+    // context.line - to show the line number
+    // context.function - to show the function name
+
+    QByteArray localMsg = msg.toLocal8Bit();
+    switch (type) {
+    case QtDebugMsg: // These are debug messages meant for developers
+        if (showDebug) {
+            // If the code was compiled as 'release' the context.file will be NULL
+            if (context.file != nullptr) fprintf(stderr, "Debug: [%s:%d] %s\n", context.file, context.line, localMsg.constData());
+            else fprintf(stderr, "Debug: %s\n", localMsg.constData());
+        }
+        break;
+    case QtInfoMsg: // These are information messages meant for end-users
+        if (context.file != nullptr) fprintf(stderr, "Info: [%s:%d] %s\n", context.file, context.line, localMsg.constData());
+        else fprintf(stderr, "Info: %s\n", localMsg.constData());
+        break;
+    case QtWarningMsg:
+        if (context.file != nullptr) fprintf(stderr, "Warning: [%s:%d] %s\n", context.file, context.line, localMsg.constData());
+        else fprintf(stderr, "Warning: %s\n", localMsg.constData());
+        break;
+    case QtCriticalMsg:
+        if (context.file != nullptr) fprintf(stderr, "Critical: [%s:%d] %s\n", context.file, context.line, localMsg.constData());
+        else fprintf(stderr, "Critical: %s\n", localMsg.constData());
+        break;
+    case QtFatalMsg:
+        if (context.file != nullptr) fprintf(stderr, "Fatal: [%s:%d] %s\n", context.file, context.line, localMsg.constData());
+        else fprintf(stderr, "Fatal: %s\n", localMsg.constData());
+        abort();
+    }
+}
+
+// Remove the link to the pseudo-terminal when interrupted (only async-signal-safe calls are used)
+static char linkFileName[4096] = "";
+
+void quitSignalHandler(int)
+{
+    if (linkFileName[0] != '\0') unlink(linkFileName);
+    _exit(0);
+}
+
+int main(int argc, char *argv[])
+{
+    // Install the local debug message handler
+    qInstallMessageHandler(debugOutputHandler);
+
+    QCoreApplication a(argc, argv);
+
+    // Set application name and version
+    QCoreApplication::setApplicationName("dddplayer");
+    QCoreApplication::setApplicationVersion("1.0");
+    QCoreApplication::setOrganizationDomain("domesday86.com");
+
+    // Set up the command line parser
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+                "Domesday Duplicator virtual LaserDisc player\n"
+                "\n"
+                "Emulates a Pioneer LaserDisc player on a pseudo-terminal, so that\n"
+                "player control and automatic capture can be tested without a player\n"
+                "\n"
+                "(c)2018 Simon Inns\n"
+                "GPLv3 Open-Source - https://www.domesday86.com");
+    parser.addHelpOption();
+    parser.addVersionOption();
+
+    // Option to show debug (-d)
+    QCommandLineOption showDebugOption(QStringList() << "d" << "debug",
+                                       QCoreApplication::translate("main", "Show debug (including each command and response)"));
+    parser.addOption(showDebugOption);
+
+    // Option to create a link to the pseudo-terminal (-l)
+    QCommandLineOption linkOption(QStringList() << "l" << "link",
+                QCoreApplication::translate("main", "Create a symbolic link to the pseudo-terminal (e.g. /tmp/ttyLD)"),
+                QCoreApplication::translate("main", "file"));
+    parser.addOption(linkOption);
+
+    // Option to select the player model (-p)
+    QCommandLineOption playerOption(QStringList() << "p" << "player",
+                QCoreApplication::translate("main", "Player model code reported to ?X (default 15, LD-V4300D)"),
+                QCoreApplication::translate("main", "code"), "15");
+    parser.addOption(playerOption);
+
+    // Option to load a CLV disc (-c)
+    QCommandLineOption clvOption(QStringList() << "c" << "clv",
+                QCoreApplication::translate("main", "Load a CLV disc (default is CAV)"));
+    parser.addOption(clvOption);
+
+    // Option to load a PAL disc
+    QCommandLineOption palOption(QStringList() << "pal",
+                QCoreApplication::translate("main", "Load a PAL disc (25 frames per second, default is NTSC)"));
+    parser.addOption(palOption);
+
+    // Option to set the disc length (-n)
+    QCommandLineOption lengthOption(QStringList() << "n" << "length",
+                QCoreApplication::translate("main", "Disc length in frames (default 54000)"),
+                QCoreApplication::translate("main", "frames"), "54000");
+    parser.addOption(lengthOption);
+
+    // Option to set the response latency (-t)
+    QCommandLineOption latencyOption(QStringList() << "t" << "latency",
+                QCoreApplication::translate("main", "Command response latency in milliseconds (default 10)"),
+                QCoreApplication::translate("main", "ms"), "10");
+    parser.addOption(latencyOption);
+
+    // Options to set the mechanism timing
+    QCommandLineOption spinUpOption(QStringList() << "spin-up",
+                QCoreApplication::translate("main", "Time to spin up the disc in milliseconds (default 2000)"),
+                QCoreApplication::translate("main", "ms"), "2000");
+    parser.addOption(spinUpOption);
+
+    QCommandLineOption seekOption(QStringList() << "seek",
+                QCoreApplication::translate("main", "Time to seek in milliseconds (default 500)"),
+                QCoreApplication::translate("main", "ms"), "500");
+    parser.addOption(seekOption);
+
+    // Option to set the baud rate (-b)
+    QCommandLineOption baudOption(QStringList() << "b" << "baud",
+                QCoreApplication::translate("main", "Baud rate: 1200, 2400, 4800 or 9600 (default 9600)"),
+                QCoreApplication::translate("main", "rate"), "9600");
+    parser.addOption(baudOption);
+
+    // Process the command line arguments given by the user
+    parser.process(a);
+
+    // Process the command line options
+    if (parser.isSet(showDebugOption)) showDebug = true;
+
+    qint32 baudRate = parser.value(baudOption).toInt();
+    if (baudRate != 1200 && baudRate != 2400 && baudRate != 4800 && baudRate != 9600) {
+        // Quit with error
+        qCritical("The baud rate must be 1200, 2400, 4800 or 9600");
+        return -1;
+    }
+
+    qint32 numberOfFrames = parser.value(lengthOption).toInt();
+    if (numberOfFrames < 1) {
+        // Quit with error
+        qCritical("The disc length must be at least 1 frame");
+        return -1;
+    }
+
+    // Initialise the virtual player
+    VirtualPlayer virtualPlayer;
+    virtualPlayer.setPlayerCode(parser.value(playerOption));
+    virtualPlayer.setDisc(parser.isSet(clvOption) ? VirtualPlayer::CLV : VirtualPlayer::CAV,
+                          numberOfFrames, parser.isSet(palOption));
+    virtualPlayer.setResponseLatency(parser.value(latencyOption).toInt());
+    virtualPlayer.setMechanismTimes(parser.value(spinUpOption).toInt(), parser.value(seekOption).toInt());
+    virtualPlayer.setBaudRate(baudRate);
+
+    if (!virtualPlayer.open(parser.value(linkOption))) {
+        // Quit with error
+        qCritical("Could not create the pseudo-terminal");
+        return -1;
+    }
+    qInfo() << "Virtual player is listening on" << virtualPlayer.getDeviceName();
+
+    // Run until interrupted
+    qstrncpy(linkFileName, QFile::encodeName(parser.value(linkOption)).constData(), sizeof(linkFileName));
+    signal(SIGINT, quitSignalHandler);
+    signal(SIGTERM, quitSignalHandler);
+    return a.exec();
+}
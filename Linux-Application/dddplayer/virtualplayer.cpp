@@ -0,0 +1,484 @@
+/************************************************************************
+
+    virtualplayer.cpp
+
+    dddplayer - Domesday Duplicator virtual LaserDisc player
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of Domesday Duplicator.
+
+    Domesday Duplicator is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#include "virtualplayer.h"
+
+#include <QFile>
+#include <QFileInfo>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+// Scan rate (as a multiple of normal speed) and chapter length used by the emulation
+#define SCANSPEED 20
+#define CHAPTERLENGTH (5 * 60)
+
+VirtualPlayer::VirtualPlayer(QObject *parent) : QObject(parent)
+{
+    // Default to an LD-V4300D with a one hour NTSC CAV disc loaded
+    playerCode = "15";
+    discType = CAV;
+    numberOfFrames = 54000;
+    isPal = false;
+    responseLatency = 10;
+    spinUpTime = 2000;
+    seekTime = 500;
+    baudRate = 9600;
+
+    masterFd = -1;
+    slaveFd = -1;
+    readNotifier = nullptr;
+
+    clock.start();
+    responseTimer = new QTimer(this);
+    responseTimer->setSingleShot(true);
+    connect(responseTimer, &QTimer::timeout, this, &VirtualPlayer::responseTimerSignalHandler);
+    busyUntil = 0;
+
+    playerState = park;
+    transitionState = park;
+    transitionTime = 0;
+    position = 1.0;
+    positionTime = 0;
+    speedRegister = 60;
+    speed = 0.0;
+    numberOfCommands = 0;
+
+    isStopMarkerSet = false;
+    stopMarkerFrame = 0;
+    stopMarkerTimer = new QTimer(this);
+    connect(stopMarkerTimer, &QTimer::timeout, this, &VirtualPlayer::stopMarkerTimerSignalHandler);
+}
+
+VirtualPlayer::~VirtualPlayer()
+{
+    qDebug() << "VirtualPlayer::~VirtualPlayer():" << numberOfCommands << "commands processed";
+
+    if (!linkName.isEmpty()) QFile::remove(linkName);
+    if (slaveFd >= 0) close(slaveFd);
+    if (masterFd >= 0) close(masterFd);
+}
+
+// Configuration methods ----------------------------------------------------------------------------------------------
+
+// Set the two digit player model code returned by ?X (e.g. "15" for an LD-V4300D)
+void VirtualPlayer::setPlayerCode(QString playerCodeParam)
+{
+    playerCode = playerCodeParam;
+}
+
+// Set the type and length of the loaded disc
+void VirtualPlayer::setDisc(DiscType discTypeParam, qint32 numberOfFramesParam, bool isPalParam)
+{
+    discType = discTypeParam;
+    numberOfFrames = qMax(numberOfFramesParam, 1);
+    isPal = isPalParam;
+}
+
+// Set the time the player takes to respond to a command (in milliseconds)
+void VirtualPlayer::setResponseLatency(qint32 milliseconds)
+{
+    responseLatency = qMax(milliseconds, 0);
+}
+
+// Set the time taken to spin up the disc and to seek (in milliseconds)
+void VirtualPlayer::setMechanismTimes(qint32 spinUpMilliseconds, qint32 seekMilliseconds)
+{
+    spinUpTime = qMax(spinUpMilliseconds, 0);
+    seekTime = qMax(seekMilliseconds, 0);
+}
+
+// Set the baud rate the player communicates at (commands sent at any other rate are ignored)
+void VirtualPlayer::setBaudRate(qint32 baudRateParam)
+{
+    baudRate = baudRateParam;
+}
+
+// Pseudo-terminal methods --------------------------------------------------------------------------------------------
+
+// Create the pseudo-terminal (and optionally a symbolic link to it with a fixed name)
+bool VirtualPlayer::open(QString linkNameParam)
+{
+    masterFd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (masterFd < 0 || grantpt(masterFd) != 0 || unlockpt(masterFd) != 0) {
+        qDebug() << "VirtualPlayer::open(): Could not create a pseudo-terminal";
+        return false;
+    }
+    deviceName = QString::fromLocal8Bit(ptsname(masterFd));
+
+    // Keep the slave side open so the terminal survives the application closing and
+    // re-opening it (as it does while detecting the baud rate)
+    slaveFd = ::open(deviceName.toLocal8Bit().constData(), O_RDWR | O_NOCTTY);
+    if (slaveFd < 0) {
+        qDebug() << "VirtualPlayer::open(): Could not open" << deviceName;
+        return false;
+    }
+
+    // Start in raw mode, so nothing is echoed before the application configures the port
+    struct termios terminalSettings;
+    if (tcgetattr(slaveFd, &terminalSettings) == 0) {
+        cfmakeraw(&terminalSettings);
+        tcsetattr(slaveFd, TCSANOW, &terminalSettings);
+    }
+
+    fcntl(masterFd, F_SETFL, fcntl(masterFd, F_GETFL) | O_NONBLOCK);
+    readNotifier = new QSocketNotifier(masterFd, QSocketNotifier::Read, this);
+    connect(readNotifier, &QSocketNotifier::activated, this, &VirtualPlayer::readSignalHandler);
+
+    // Create the link (only ever replacing an existing link, never a file)
+    if (!linkNameParam.isEmpty()) {
+        if (QFileInfo(linkNameParam).isSymLink()) QFile::remove(linkNameParam);
+        if (!QFile::link(deviceName, linkNameParam)) {
+            qDebug() << "VirtualPlayer::open(): Could not create the link" << linkNameParam;
+            return false;
+        }
+        linkName = linkNameParam;
+    }
+
+    return true;
+}
+
+// Returns the name of the pseudo-terminal device the application should connect to
+QString VirtualPlayer::getDeviceName(void)
+{
+    if (!linkName.isEmpty()) return linkName;
+    return deviceName;
+}
+
+// Read commands from the pseudo-terminal (each is terminated by a CR)
+void VirtualPlayer::readSignalHandler(void)
+{
+    char buffer[256];
+    ssize_t bytesRead;
+    while ((bytesRead = read(masterFd, buffer, sizeof(buffer))) > 0) {
+        receiveBuffer.append(buffer, static_cast<qint32>(bytesRead));
+    }
+
+    qint32 terminatorPosition;
+    while ((terminatorPosition = receiveBuffer.indexOf('\r')) >= 0) {
+        QByteArray command = receiveBuffer.left(terminatorPosition);
+        receiveBuffer.remove(0, terminatorPosition + 1);
+
+        // A real player can't decode characters sent at the wrong baud rate
+        if (!isBaudRateMatched()) {
+            qDebug() << "VirtualPlayer::readSignalHandler(): Ignoring" << command << "- sent at the wrong baud rate";
+            continue;
+        }
+
+        qint64 mechanismTime = 0;
+        QByteArray response = processCommand(command, &mechanismTime);
+        qDebug() << "VirtualPlayer::readSignalHandler():" << command << "->" << response;
+
+        // A play to an address is acknowledged once the address is reached
+        if (!response.isEmpty()) scheduleResponse(response, mechanismTime + (command.size() + 1) * 10000 / baudRate);
+    }
+
+    // Commands are at most 20 characters - discard anything that isn't terminated
+    if (receiveBuffer.size() > 64) receiveBuffer.clear();
+}
+
+// Returns true if the application has configured the terminal for the player's baud rate
+bool VirtualPlayer::isBaudRateMatched(void)
+{
+    struct termios terminalSettings;
+    if (tcgetattr(slaveFd, &terminalSettings) != 0) return true;
+
+    speed_t expectedSpeed = B9600;
+    if (baudRate == 1200) expectedSpeed = B1200;
+    if (baudRate == 2400) expectedSpeed = B2400;
+    if (baudRate == 4800) expectedSpeed = B4800;
+
+    return cfgetospeed(&terminalSettings) == expectedSpeed;
+}
+
+// Queue a response to be sent once the player has finished the command (responses are sent in order)
+void VirtualPlayer::scheduleResponse(QByteArray response, qint64 mechanismTime)
+{
+    qint64 transmitTime = (response.size() + 1) * 10000 / baudRate;
+
+    ScheduledResponse scheduledResponse;
+    scheduledResponse.dueTime = qMax(clock.elapsed(), busyUntil) + responseLatency + mechanismTime + transmitTime;
+    scheduledResponse.response = response + "\r";
+    scheduledResponses.enqueue(scheduledResponse);
+    busyUntil = scheduledResponse.dueTime;
+
+    if (!responseTimer->isActive()) responseTimerSignalHandler();
+}
+
+// Send the responses that are due
+void VirtualPlayer::responseTimerSignalHandler(void)
+{
+    qint64 now = clock.elapsed();
+    while (!scheduledResponses.isEmpty() && scheduledResponses.head().dueTime <= now) {
+        QByteArray response = scheduledResponses.dequeue().response;
+        if (write(masterFd, response.constData(), static_cast<size_t>(response.size())) != response.size()) {
+            qDebug() << "VirtualPlayer::responseTimerSignalHandler(): Could not write the response" << response;
+        }
+    }
+
+    if (!scheduledResponses.isEmpty()) {
+        responseTimer->start(static_cast<int>(scheduledResponses.head().dueTime - now));
+    }
+}
+
+// Follow the playback while playing to an address, so the player halts (and acknowledges
+// the command) when the address is reached
+void VirtualPlayer::stopMarkerTimerSignalHandler(void)
+{
+    updatePlayback();
+    if (!isStopMarkerSet) stopMarkerTimer->stop();
+}
+
+// Player emulation methods -------------------------------------------------------------------------------------------
+
+// Process a command and return the player's response.  A command can contain several
+// operations, each an optional decimal argument followed by a two letter op-code
+// (e.g. "FR12345SE").  The time the mechanism takes to carry out the command is
+// returned in mechanismTime.  An empty response is returned for a play to an address,
+// which is acknowledged once the address is reached.
+QByteArray VirtualPlayer::processCommand(QByteArray command, qint64 *mechanismTime)
+{
+    updatePlayback();
+    numberOfCommands++;
+
+    QByteArray response = "R";
+    bool isChapterAddressing = false;
+    bool isSpinning = (playerState != doorOpen && playerState != park);
+    qint32 index = 0;
+
+    while (index < command.size()) {
+        // Queries return data in place of the acknowledgement
+        if (command.at(index) == '?' || command.at(index) == '$') {
+            QByteArray query = command.mid(index, 2);
+            index += 2;
+            updatePlayback();
+
+            if (query == "?X") {
+                // Model name request
+                response = "P15" + playerCode.toLatin1() + "01";
+            } else if (query == "?P") {
+                // Player active mode request
+                switch (playerState) {
+                case doorOpen: response = "P00"; break;
+                case park: response = "P01"; break;
+                case setUp: response = "P02"; break;
+                case play: response = "P04"; break;
+                case still: response = "P05"; break;
+                case pause: response = "P06"; break;
+                case search: response = "P07"; break;
+                case scan: response = "P08"; break;
+                case multiSpeed: response = "P09"; break;
+                }
+            } else if (query == "?F") {
+                // Frame number (CAV) or time-code (CLV) request
+                if (playerState == doorOpen || playerState == park) return "E04";
+                qint32 frame = static_cast<qint32>(position);
+                if (discType == CAV) response = QString("%1").arg(frame, 5, 10, QChar('0')).toLatin1();
+                else response = QString("%1").arg(frameToTimeCode(frame), 7, 10, QChar('0')).toLatin1();
+            } else if (query == "?D") {
+                // Disc status request
+                if (playerState == doorOpen) return "E04";
+                response = (discType == CAV) ? "00000" : "01000";
+            } else if (query == "$Y") {
+                // User code request
+                response = "DDD00";
+            } else {
+                return "E04";
+            }
+            continue;
+        }
+
+        // Get the argument (if any) and the op-code
+        qint32 argumentStart = index;
+        while (index < command.size() && command.at(index) >= '0' && command.at(index) <= '9') index++;
+        bool hasArgument = index > argumentStart;
+        qint32 argument = command.mid(argumentStart, index - argumentStart).toInt();
+
+        if (index + 2 > command.size()) return "E04";
+        QByteArray opCode = command.mid(index, 2);
+        index += 2;
+
+        // Any other motion command replaces a play to an address (which is then never acknowledged)
+        if (opCode == "SE" || opCode == "PL" || opCode == "PA" || opCode == "ST" || opCode == "SF" ||
+                opCode == "SR" || opCode == "NF" || opCode == "NR" || opCode == "MF" || opCode == "MR" ||
+                opCode == "MB" || opCode == "RJ" || opCode == "OP") {
+            isStopMarkerSet = false;
+        }
+
+        if (opCode == "FR") {
+            isChapterAddressing = false;
+        } else if (opCode == "CH") {
+            isChapterAddressing = true;
+        } else if (opCode == "SE") {
+            // Search to a frame, time-code or chapter
+            if (!hasArgument || playerState == doorOpen) return "E04";
+            qint32 frame;
+            if (isChapterAddressing) frame = (argument - 1) * CHAPTERLENGTH * framesPerSecond() + 1;
+            else if (discType == CLV) frame = timeCodeToFrame(argument);
+            else frame = argument;
+            position = qBound(1, frame, numberOfFrames);
+
+            qint64 duration = seekTime + (isSpinning ? 0 : spinUpTime);
+            beginTransition(isSpinning ? search : setUp, duration, (discType == CAV) ? still : pause);
+            *mechanismTime += duration;
+            isSpinning = true;
+        } else if (opCode == "PL") {
+            // Play (spinning up the disc if required), to a frame or time-code if one is given
+            if (playerState == doorOpen || (hasArgument && isChapterAddressing)) return "E04";
+            if (hasArgument) {
+                stopMarkerFrame = qBound(1, (discType == CLV) ? timeCodeToFrame(argument) : argument, numberOfFrames);
+                isStopMarkerSet = true;
+                stopMarkerTimer->start(1000 / framesPerSecond());
+                response.clear();
+            }
+            if (!isSpinning) {
+                position = 1.0;
+                beginTransition(setUp, spinUpTime, play);
+                *mechanismTime += spinUpTime;
+                isSpinning = true;
+            } else {
+                setPlayerState(play, framesPerSecond());
+            }
+        } else if (opCode == "PA" || opCode == "ST") {
+            // Pause or still-frame
+            if (!isSpinning) return "E04";
+            setPlayerState((opCode == "PA") ? pause : still, 0.0);
+        } else if (opCode == "SF" || opCode == "SR") {
+            // Step forwards or backwards one frame
+            if (playerState != still && playerState != pause) return "E04";
+            position = qBound(1.0, position + ((opCode == "SF") ? 1.0 : -1.0), static_cast<double>(numberOfFrames));
+            setPlayerState(still, 0.0);
+        } else if (opCode == "NF" || opCode == "NR") {
+            // Scan forwards or backwards
+            if (!isSpinning) return "E04";
+            setPlayerState(scan, ((opCode == "NF") ? 1.0 : -1.0) * SCANSPEED * framesPerSecond());
+        } else if (opCode == "MF" || opCode == "MR" || opCode == "MB") {
+            // Multi-speed playback at the rate set by SP
+            if (!isSpinning) return "E04";
+            double rate = static_cast<double>(framesPerSecond() * speedRegister) / 60.0;
+            setPlayerState(multiSpeed, (opCode == "MF") ? rate : -rate);
+        } else if (opCode == "SP") {
+            if (!hasArgument) return "E04";
+            speedRegister = argument;
+        } else if (opCode == "RJ") {
+            // Reject - stop the disc
+            if (playerState == doorOpen) return "E04";
+            position = 1.0;
+            setPlayerState(park, 0.0);
+            isSpinning = false;
+        } else if (opCode == "OP") {
+            setPlayerState(doorOpen, 0.0);
+            isSpinning = false;
+        } else if (opCode == "CO") {
+            if (playerState == doorOpen) setPlayerState(park, 0.0);
+        } else if (opCode == "DS" || opCode == "AD" || opCode == "KL" || opCode == "RB") {
+            // Display, audio, key-lock and audio during multi-speed settings are accepted but have no effect
+        } else {
+            return "E04";
+        }
+    }
+
+    return response;
+}
+
+// Bring the playback state up to date with the clock
+void VirtualPlayer::updatePlayback(void)
+{
+    qint64 now = clock.elapsed();
+
+    // Complete the set up or search (playback starts when it completes)
+    if ((playerState == setUp || playerState == search) && now >= transitionTime) {
+        positionTime = transitionTime;
+        setPlayerState(transitionState, (transitionState == play) ? framesPerSecond() : 0.0);
+    }
+
+    // Move the position (stopping at either end of the disc)
+    if (speed != 0.0 && now > positionTime) {
+        double previousPosition = position;
+        position += speed * static_cast<double>(now - positionTime) / 1000.0;
+
+        // Halt on the address being played to, and acknowledge the play command
+        if (isStopMarkerSet && playerState == play && position >= stopMarkerFrame) {
+            if (previousPosition < stopMarkerFrame) position = stopMarkerFrame;
+            setPlayerState((discType == CAV) ? still : pause, 0.0);
+            isStopMarkerSet = false;
+            scheduleResponse("R", 0);
+        }
+
+        if (position >= numberOfFrames || position < 1.0) {
+            position = qBound(1.0, position, static_cast<double>(numberOfFrames));
+            setPlayerState((discType == CAV) ? still : pause, 0.0);
+        }
+    }
+    positionTime = now;
+}
+
+// Change the player state and playback rate
+void VirtualPlayer::setPlayerState(PlayerState state, double speedParam)
+{
+    playerState = state;
+    speed = speedParam;
+}
+
+// Enter a set up or search state that completes after a time
+void VirtualPlayer::beginTransition(PlayerState intermediateState, qint64 duration, PlayerState finalState)
+{
+    setPlayerState(intermediateState, 0.0);
+    transitionState = finalState;
+    transitionTime = qMax(clock.elapsed(), busyUntil) + duration;
+}
+
+// Returns the disc's frame rate
+qint32 VirtualPlayer::framesPerSecond(void)
+{
+    if (isPal) return 25;
+    return 30;
+}
+
+// Convert a frame number into a HMMSSFF time-code
+qint32 VirtualPlayer::frameToTimeCode(qint32 frame)
+{
+    qint32 fps = framesPerSecond();
+    qint32 frameIndex = frame - 1;
+    qint32 hours = frameIndex / (fps * 3600);
+    qint32 minutes = (frameIndex / (fps * 60)) % 60;
+    qint32 seconds = (frameIndex / fps) % 60;
+    qint32 frames = frameIndex % fps;
+
+    return (hours * 1000000) + (minutes * 10000) + (seconds * 100) + frames;
+}
+
+// Convert a HMMSSFF time-code into a frame number
+qint32 VirtualPlayer::timeCodeToFrame(qint32 timeCode)
+{
+    qint32 fps = framesPerSecond();
+    qint32 hours = timeCode / 1000000;
+    qint32 minutes = (timeCode / 10000) % 100;
+    qint32 seconds = (timeCode / 100) % 100;
+    qint32 frames = timeCode % 100;
+
+    return (((hours * 3600) + (minutes * 60) + seconds) * fps) + frames + 1;
+}
@@ -0,0 +1,135 @@
+/************************************************************************
+
+    virtualplayer.h
+
+    dddplayer - Domesday Duplicator virtual LaserDisc player
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of Domesday Duplicator.
+
+    Domesday Duplicator is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#ifndef VIRTUALPLAYER_H
+#define VIRTUALPLAYER_H
+
+#include <QObject>
+#include <QDebug>
+#include <QTimer>
+#include <QQueue>
+#include <QElapsedTimer>
+#include <QSocketNotifier>
+
+// Emulation of a Pioneer LD-V/CLD-V series LaserDisc player on a pseudo-terminal
+//
+// The player implements the subset of the Pioneer serial command set used by the
+// capture application.  Disc playback is modelled against the real-time clock, so
+// the reported position advances while the disc is playing, and commands take the
+// time a real player would to spin up or seek before they are acknowledged.
+class VirtualPlayer : public QObject
+{
+    Q_OBJECT
+public:
+    enum DiscType {
+        CAV,
+        CLV
+    };
+
+    explicit VirtualPlayer(QObject *parent = nullptr);
+    ~VirtualPlayer() override;
+
+    void setPlayerCode(QString playerCodeParam);
+    void setDisc(DiscType discTypeParam, qint32 numberOfFramesParam, bool isPalParam);
+    void setResponseLatency(qint32 milliseconds);
+    void setMechanismTimes(qint32 spinUpMilliseconds, qint32 seekMilliseconds);
+    void setBaudRate(qint32 baudRateParam);
+
+    bool open(QString linkName);
+    QString getDeviceName(void);
+
+private slots:
+    void readSignalHandler(void);
+    void responseTimerSignalHandler(void);
+    void stopMarkerTimerSignalHandler(void);
+
+private:
+    // Player mechanism states (reported by ?P as Pxx)
+    enum PlayerState {
+        doorOpen,       // P00
+        park,           // P01
+        setUp,          // P02
+        play,           // P04
+        still,          // P05
+        pause,          // P06
+        search,         // P07
+        scan,           // P08
+        multiSpeed      // P09
+    };
+
+    // A response waiting for its simulated processing time to elapse
+    struct ScheduledResponse {
+        qint64 dueTime;         // Time to send the response (mS, from clock)
+        QByteArray response;
+    };
+
+    // Configuration
+    QString playerCode;
+    DiscType discType;
+    qint32 numberOfFrames;
+    bool isPal;
+    qint32 responseLatency;
+    qint32 spinUpTime;
+    qint32 seekTime;
+    qint32 baudRate;
+
+    // Pseudo-terminal
+    qint32 masterFd;
+    qint32 slaveFd;
+    QString deviceName;
+    QString linkName;
+    QSocketNotifier *readNotifier;
+    QByteArray receiveBuffer;
+
+    // Response scheduling
+    QElapsedTimer clock;
+    QQueue<ScheduledResponse> scheduledResponses;
+    QTimer *responseTimer;
+    qint64 busyUntil;
+
+    // Disc playback
+    PlayerState playerState;
+    PlayerState transitionState;    // State to enter once the current set up or search completes
+    qint64 transitionTime;          // Time the set up or search completes (mS, from clock)
+    double position;                // Current frame (1 to numberOfFrames)
+    qint64 positionTime;            // Time the position was last updated (mS, from clock)
+    qint32 speedRegister;           // Multi-speed playback rate (60 = normal speed)
+    double speed;                   // Current playback rate (frames per second, negative for reverse)
+    bool isStopMarkerSet;           // True while playing to an address (FRxxxxxPL)
+    qint32 stopMarkerFrame;         // Frame the player halts on when playing to an address
+    QTimer *stopMarkerTimer;
+    qint32 numberOfCommands;
+
+    void updatePlayback(void);
+    void setPlayerState(PlayerState state, double speedParam);
+    void beginTransition(PlayerState intermediateState, qint64 duration, PlayerState finalState);
+    QByteArray processCommand(QByteArray command, qint64 *mechanismTime);
+    bool isBaudRateMatched(void);
+    void scheduleResponse(QByteArray response, qint64 mechanismTime);
+    qint32 framesPerSecond(void);
+    qint32 frameToTimeCode(qint32 frame);
+    qint32 timeCodeToFrame(qint32 timeCode);
+};
+
+#endif // VIRTUALPLAYER_H
@@ -79,41 +79,8 @@ void AnalyseTestData::run()
     qDebug() << "AnalyseTestData::run(): Thread running";
 
     while(!abort) {
-        // Lock and copy all parameters to 'thread-safe' variables
-        mutex.lock();
-        inputFilenameTs = this->inputFilename;
-        isInputTenBitTs = this->isInputTenBit;
-        startTimeTs = this->startTime;
-        endTimeTs = this->endTime;
-        mutex.unlock();
-
-        // Start the sample conversion
-        if (analyseSampleStart()) {
-            // Process the conversion until completed
-            bool notComplete = true;
-            qreal percentageCompleteReal = 0;
-            qint32 percentageComplete = 0;
-
-            while (notComplete && !cancel) {
-                notComplete = analyseSampleProcess();
-
-                // Calculate the completion percentage
-                percentageCompleteReal = (100 / static_cast<qreal>(samplesToAnalyseTs)) * static_cast<qreal>(numberOfSampleProcessedTs);
-                percentageComplete = static_cast<qint32>(percentageCompleteReal);
-                qDebug() << "FileConverter::run(): Processed" << numberOfSampleProcessedTs << "of" <<
-                            samplesToAnalyseTs << "(" << percentageComplete << "%)";
-
-                // Emit a signal showing the progress
-                emit percentageProcessed(percentageComplete);
-            }
-
-            // Stop the sample analysis
-            analyseSampleStop();
-
-            // Reset the cancel flag
-            if (cancel) qDebug() << "AnalyseTestData::run(): Conversion cancelled";
-            cancel = false;
-        }
+        // Perform the analysis
+        processAnalysis();
 
         // Emit a signal showing the analysis is complete if the test was successful
         // (otherwise the testFailed signal indicates completion)
@@ -128,6 +95,66 @@ void AnalyseTestData::run()
     qDebug() << "AnalyseTestData::run(): Thread aborted";
 }
 
+// Analyse the input file on the calling thread (rather than the analyser's own thread).
+// Returns true if the test data was valid throughout
+bool AnalyseTestData::analyseFile(QString inputFilename,
+                                  QTime startTime, QTime endTime,
+                                  bool isInputTenBit)
+{
+    mutex.lock();
+    this->inputFilename = inputFilename;
+    this->isInputTenBit = isInputTenBit;
+    this->startTime = startTime;
+    this->endTime = endTime;
+    mutex.unlock();
+
+    return processAnalysis();
+}
+
+// Perform an analysis with the current parameters.  Returns true if the analysis
+// completed and the test data was valid
+bool AnalyseTestData::processAnalysis(void)
+{
+    // Lock and copy all parameters to 'thread-safe' variables
+    mutex.lock();
+    inputFilenameTs = this->inputFilename;
+    isInputTenBitTs = this->isInputTenBit;
+    startTimeTs = this->startTime;
+    endTimeTs = this->endTime;
+    mutex.unlock();
+
+    // Start the sample analysis
+    if (!analyseSampleStart()) return false;
+
+    // Process the analysis until completed
+    bool notComplete = true;
+    qreal percentageCompleteReal = 0;
+    qint32 percentageComplete = 0;
+
+    while (notComplete && !cancel) {
+        notComplete = analyseSampleProcess();
+
+        // Calculate the completion percentage
+        percentageCompleteReal = (100 / static_cast<qreal>(samplesToAnalyseTs)) * static_cast<qreal>(numberOfSampleProcessedTs);
+        percentageComplete = static_cast<qint32>(percentageCompleteReal);
+        qDebug() << "AnalyseTestData::processAnalysis(): Processed" << numberOfSampleProcessedTs << "of" <<
+                    samplesToAnalyseTs << "(" << percentageComplete << "%)";
+
+        // Emit a signal showing the progress
+        emit percentageProcessed(percentageComplete);
+    }
+
+    // Stop the sample analysis
+    analyseSampleStop();
+    bool isSuccessful = !cancel && testSuccessful;
+
+    // Reset the cancel flag
+    if (cancel) qDebug() << "AnalyseTestData::processAnalysis(): Analysis cancelled";
+    cancel = false;
+
+    return isSuccessful;
+}
+
 // Function sets the cancel flag (which terminates the analysis if in progress)
 void AnalyseTestData::cancelAnalysis()
 {
@@ -142,6 +169,12 @@ void AnalyseTestData::quit()
     abort = true;
 }
 
+// Get the number of samples processed by the last (or current) analysis
+qint64 AnalyseTestData::getNumberOfSamplesProcessed(void)
+{
+    return numberOfSampleProcessedTs;
+}
+
 // File conversion methods --------------------------------------------------------------------------------------------
 
 // Open the files and get ready to convert
@@ -159,7 +192,7 @@ bool AnalyseTestData::analyseSampleStart(void)
         qDebug() << "AnalyseTestData::analyseSampleStart(): Could not open input sample file!";
 
         // Destroy the input sample object
-        inputSample->deleteLater();
+        delete inputSample;
         return false;
     }
 
@@ -244,7 +277,7 @@ bool AnalyseTestData::analyseSampleProcess(void)
 void AnalyseTestData::analyseSampleStop(void)
 {
     // Destroy the input sample object
-    inputSample->deleteLater();
+    delete inputSample;
 }
 
 // Analyse the test data for integrity
@@ -51,8 +51,13 @@ public:
                           QTime startTime, QTime endTime,
                           bool isInputTenBit);
 
+    bool analyseFile(QString inputFilename,
+                     QTime startTime, QTime endTime,
+                     bool isInputTenBit);
+
     void cancelAnalysis();
     void quit();
+    qint64 getNumberOfSamplesProcessed(void);
 
 signals:
     void percentageProcessed(qint32);
@@ -92,6 +97,7 @@ private:
     bool firstTest;
     bool testSuccessful;
 
+    bool processAnalysis(void);
     bool analyseSampleStart(void);
     bool analyseSampleProcess(void);
     void analyseSampleStop(void);
@@ -0,0 +1,401 @@
+/************************************************************************
+
+    batchqueue.cpp
+
+    Utilities for Domesday Duplicator
+    DomesdayDuplicator - LaserDisc RF sampler
+    Copyright (C) 2019 Simon Inns
+
+    This file is part of Domesday Duplicator.
+
+    Domesday Duplicator is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+
+#include "batchqueue.h"
+#include "fileconverter.h"
+#include "analysetestdata.h"
+#include "inputsample.h"
+#include "waveformcache.h"
+#include "checksumverifier.h"
+
+// Signal regions reported by overview jobs - at least 1 second with an RMS of 20 codes or more
+// (the RF from a disc; an idle player or an empty input is well below this)
+#define OVERVIEWMINIMUMRMS 20.0f
+#define OVERVIEWMINIMUMLENGTH 40000000
+
+BatchQueue::BatchQueue(QObject *parent) : QObject(parent)
+{
+    nextJobNumber = 0;
+    numberOfWorkersRunning = 0;
+    isCancelled = false;
+    batchElapsedTime = 0;
+
+    // Each conversion also uses the global thread pool, so by default only a couple of
+    // files are processed at once (the disks are usually the limit)
+    workerThreadPool.setMaxThreadCount(2);
+}
+
+BatchQueue::~BatchQueue()
+{
+    // Let the running jobs finish
+    cancel();
+    workerThreadPool.waitForDone();
+}
+
+// Set the number of files processed at once
+void BatchQueue::setNumberOfWorkers(qint32 numberOfWorkers)
+{
+    workerThreadPool.setMaxThreadCount(qMax(1, numberOfWorkers));
+}
+
+// Get the number of files processed at once
+qint32 BatchQueue::getNumberOfWorkers(void)
+{
+    return workerThreadPool.maxThreadCount();
+}
+
+// Queue a conversion (the start and end times trim the output).  Returns the job number
+qint32 BatchQueue::addConversion(QString inputFilename, QString outputFilename, bool isInputTenBit, bool isOutputTenBit,
+                                 QTime startTime, QTime endTime)
+{
+    BatchJob job;
+    job.type = BatchJob::JobType::convert;
+    job.inputFilename = inputFilename;
+    job.outputFilename = outputFilename;
+    job.isInputTenBit = isInputTenBit;
+    job.isOutputTenBit = isOutputTenBit;
+    job.startTime = startTime;
+    job.endTime = endTime;
+    job.state = BatchJob::JobState::queued;
+    job.bytesProcessed = 0;
+    job.elapsedTime = 0;
+
+    QMutexLocker locker(&mutex);
+    jobs.append(job);
+    return jobs.size() - 1;
+}
+
+// Queue a test data verification.  Returns the job number
+qint32 BatchQueue::addVerification(QString inputFilename, bool isInputTenBit, QTime startTime, QTime endTime)
+{
+    BatchJob job;
+    job.type = BatchJob::JobType::verify;
+    job.inputFilename = inputFilename;
+    job.isInputTenBit = isInputTenBit;
+    job.isOutputTenBit = isInputTenBit;
+    job.startTime = startTime;
+    job.endTime = endTime;
+    job.state = BatchJob::JobState::queued;
+    job.bytesProcessed = 0;
+    job.elapsedTime = 0;
+
+    QMutexLocker locker(&mutex);
+    jobs.append(job);
+    return jobs.size() - 1;
+}
+
+// Queue a waveform overview (building or updating the capture's overview cache).  Returns the job number
+qint32 BatchQueue::addOverview(QString inputFilename, bool isInputTenBit)
+{
+    BatchJob job;
+    job.type = BatchJob::JobType::overview;
+    job.inputFilename = inputFilename;
+    job.isInputTenBit = isInputTenBit;
+    job.isOutputTenBit = isInputTenBit;
+    job.state = BatchJob::JobState::queued;
+    job.bytesProcessed = 0;
+    job.elapsedTime = 0;
+
+    QMutexLocker locker(&mutex);
+    jobs.append(job);
+    return jobs.size() - 1;
+}
+
+// Queue a verification of a capture against its checksum manifest.  Returns the job number
+qint32 BatchQueue::addChecksumVerification(QString inputFilename, bool isInputTenBit)
+{
+    BatchJob job;
+    job.type = BatchJob::JobType::checksum;
+    job.inputFilename = inputFilename;
+    job.isInputTenBit = isInputTenBit;
+    job.isOutputTenBit = isInputTenBit;
+    job.state = BatchJob::JobState::queued;
+    job.bytesProcessed = 0;
+    job.elapsedTime = 0;
+
+    QMutexLocker locker(&mutex);
+    jobs.append(job);
+    return jobs.size() - 1;
+}
+
+// Start processing the queued jobs
+void BatchQueue::start(void)
+{
+    QMutexLocker locker(&mutex);
+    if (numberOfWorkersRunning > 0) return;
+
+    isCancelled = false;
+    batchTimer.start();
+
+    // Start a worker for each thread (each takes jobs from the queue until it is empty)
+    qint32 numberOfWorkers = qMax(1, qMin(workerThreadPool.maxThreadCount(), jobs.size() - nextJobNumber));
+    qDebug() << "BatchQueue::start(): Starting" << numberOfWorkers << "workers for" << jobs.size() - nextJobNumber << "jobs";
+    numberOfWorkersRunning = numberOfWorkers;
+    for (qint32 worker = 0; worker < numberOfWorkers; worker++) {
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+        QtConcurrent::run(&workerThreadPool, this, &BatchQueue::runWorker);
+#else
+        QtConcurrent::run(&workerThreadPool, &BatchQueue::runWorker, this);
+#endif
+    }
+}
+
+// Stop starting queued jobs (the jobs already running are completed)
+void BatchQueue::cancel(void)
+{
+    QMutexLocker locker(&mutex);
+    isCancelled = true;
+}
+
+// Returns true if jobs are being processed
+bool BatchQueue::isRunning(void)
+{
+    QMutexLocker locker(&mutex);
+    return numberOfWorkersRunning > 0;
+}
+
+// Get the number of jobs in the queue (including completed jobs)
+qint32 BatchQueue::getNumberOfJobs(void)
+{
+    QMutexLocker locker(&mutex);
+    return jobs.size();
+}
+
+// Get a job (and its current state)
+BatchJob BatchQueue::getJob(qint32 jobNumber)
+{
+    QMutexLocker locker(&mutex);
+    return jobs[jobNumber];
+}
+
+// Get a one line report of a job
+QString BatchQueue::getJobReport(qint32 jobNumber)
+{
+    BatchJob job = getJob(jobNumber);
+
+    QString state;
+    switch (job.state) {
+    case BatchJob::JobState::queued:
+        state = tr("queued");
+        break;
+    case BatchJob::JobState::running:
+        state = tr("running");
+        break;
+    case BatchJob::JobState::succeeded:
+        state = (job.type == BatchJob::JobType::verify || job.type == BatchJob::JobType::checksum) ? tr("passed") : tr("done");
+        break;
+    case BatchJob::JobState::failed:
+        state = tr("FAILED");
+        break;
+    }
+
+    QString description;
+    if (job.type == BatchJob::JobType::verify) description = tr("verify %1").arg(job.inputFilename);
+    else if (job.type == BatchJob::JobType::overview) description = tr("overview %1").arg(job.inputFilename);
+    else if (job.type == BatchJob::JobType::checksum) description = tr("checksums %1").arg(job.inputFilename);
+    else description = tr("convert %1 -> %2").arg(job.inputFilename, job.outputFilename);
+
+    double seconds = static_cast<double>(job.elapsedTime) / 1000.0;
+    double rate = (seconds > 0.0) ? (static_cast<double>(job.bytesProcessed) / 1000000.0) / seconds : 0.0;
+
+    QString report = tr("Job %1 [%2] %3: %4 MB in %5 s (%6 MB/s)")
+            .arg(jobNumber + 1).arg(state).arg(description)
+            .arg(static_cast<double>(job.bytesProcessed) / 1000000.0, 0, 'f', 1)
+            .arg(seconds, 0, 'f', 1).arg(rate, 0, 'f', 1);
+    if (!job.result.isEmpty()) report += tr(" - %1").arg(job.result);
+
+    return report;
+}
+
+// Get a summary of the whole batch
+QString BatchQueue::getReport(void)
+{
+    QMutexLocker locker(&mutex);
+
+    qint32 numberOfSucceeded = 0;
+    qint32 numberOfFailed = 0;
+    qint64 totalBytes = 0;
+    qint64 totalJobTime = 0;
+    for (qint32 jobNumber = 0; jobNumber < jobs.size(); jobNumber++) {
+        if (jobs[jobNumber].state == BatchJob::JobState::succeeded) numberOfSucceeded++;
+        if (jobs[jobNumber].state == BatchJob::JobState::failed) numberOfFailed++;
+        totalBytes += jobs[jobNumber].bytesProcessed;
+        totalJobTime += jobs[jobNumber].elapsedTime;
+    }
+
+    qint64 elapsedTime = (numberOfWorkersRunning > 0) ? batchTimer.elapsed() : batchElapsedTime;
+    double seconds = static_cast<double>(elapsedTime) / 1000.0;
+    double rate = (seconds > 0.0) ? (static_cast<double>(totalBytes) / 1000000.0) / seconds : 0.0;
+
+    // The speed-up is how much faster the batch ran than the jobs would have one at a time
+    double speedUp = (elapsedTime > 0) ? static_cast<double>(totalJobTime) / static_cast<double>(elapsedTime) : 0.0;
+
+    return tr("Batch: %1 jobs (%2 succeeded, %3 failed), %4 MB in %5 s with %6 workers - %7 MB/s aggregate (%8x)")
+            .arg(jobs.size()).arg(numberOfSucceeded).arg(numberOfFailed)
+            .arg(static_cast<double>(totalBytes) / 1000000.0, 0, 'f', 1)
+            .arg(seconds, 0, 'f', 1).arg(workerThreadPool.maxThreadCount())
+            .arg(rate, 0, 'f', 1).arg(speedUp, 0, 'f', 2);
+}
+
+// Worker thread - runs queued jobs until there are none left
+void BatchQueue::runWorker(void)
+{
+    bool isBatchSuccessful = true;
+
+    while (true) {
+        // Take the next job
+        mutex.lock();
+        if (isCancelled || nextJobNumber >= jobs.size()) {
+            mutex.unlock();
+            break;
+        }
+        qint32 jobNumber = nextJobNumber++;
+        jobs[jobNumber].state = BatchJob::JobState::running;
+        BatchJob job = jobs[jobNumber];
+        mutex.unlock();
+
+        // Run it
+        QElapsedTimer jobTimer;
+        jobTimer.start();
+        bool isSuccessful = runJob(job);
+        job.elapsedTime = jobTimer.elapsed();
+        job.state = isSuccessful ? BatchJob::JobState::succeeded : BatchJob::JobState::failed;
+        if (!isSuccessful) isBatchSuccessful = false;
+
+        mutex.lock();
+        jobs[jobNumber] = job;
+        mutex.unlock();
+
+        emit jobComplete(jobNumber, isSuccessful);
+    }
+
+    // The last worker to finish completes the batch
+    mutex.lock();
+    numberOfWorkersRunning--;
+    bool isLastWorker = (numberOfWorkersRunning == 0);
+    if (isLastWorker) {
+        batchElapsedTime = batchTimer.elapsed();
+        for (qint32 jobNumber = 0; jobNumber < jobs.size(); jobNumber++) {
+            if (jobs[jobNumber].state != BatchJob::JobState::succeeded) isBatchSuccessful = false;
+        }
+    }
+    mutex.unlock();
+
+    if (isLastWorker) {
+        qDebug() << "BatchQueue::runWorker(): Batch complete";
+        emit batchComplete(isBatchSuccessful);
+    }
+}
+
+// Run a job on the calling thread.  Returns true on success
+bool BatchQueue::runJob(BatchJob &job)
+{
+    // Overviews always cover the whole capture (only the blocks not already cached are scanned)
+    if (job.type == BatchJob::JobType::overview) {
+        qDebug() << "BatchQueue::runJob(): Building the overview of" << job.inputFilename;
+        WaveformCache waveformCache;
+        bool isSuccessful = waveformCache.open(job.inputFilename, job.isInputTenBit);
+        job.bytesProcessed = samplesToBytes(waveformCache.getNumberOfSamplesScanned(), job.isInputTenBit);
+        if (!isSuccessful) return false;
+
+        QVector<WaveformRegion> regions = waveformCache.findSignalRegions(OVERVIEWMINIMUMRMS, OVERVIEWMINIMUMLENGTH);
+        QStringList regionList;
+        for (qint32 region = 0; region < regions.size(); region++) {
+            regionList.append(tr("%1-%2").arg(samplesToTime(regions[region].startSample),
+                                              samplesToTime(regions[region].endSample)));
+        }
+        if (regionList.isEmpty()) job.result = tr("no signal found");
+        else job.result = tr("signal %1").arg(regionList.join(", "));
+
+        return true;
+    }
+
+    // Checksums always cover the whole capture file
+    if (job.type == BatchJob::JobType::checksum) {
+        qDebug() << "BatchQueue::runJob(): Verifying the checksums of" << job.inputFilename;
+        ChecksumVerifier checksumVerifier;
+        bool isSuccessful = checksumVerifier.verifyFile(job.inputFilename);
+        job.bytesProcessed = checksumVerifier.getBytesVerified();
+
+        QVector<ChecksumMismatch> mismatches = checksumVerifier.getMismatches();
+        QStringList mismatchList;
+        for (qint32 mismatch = 0; mismatch < mismatches.size(); mismatch++) {
+            mismatchList.append(tr("%1-%2").arg(mismatches[mismatch].offset)
+                                .arg(mismatches[mismatch].offset + mismatches[mismatch].length - 1));
+        }
+        if (isSuccessful) job.result = tr("%1 blocks match").arg(checksumVerifier.getNumberOfBlocks());
+        else if (mismatchList.isEmpty()) job.result = checksumVerifier.getLastError();
+        else job.result = tr("mismatching bytes %1").arg(mismatchList.join(", "));
+
+        return isSuccessful;
+    }
+
+    // Default to the whole input file
+    QTime startTime = job.startTime.isNull() ? QTime(0, 0, 0) : job.startTime;
+    QTime endTime = job.endTime;
+    if (endTime.isNull()) {
+        InputSample inputSample(nullptr, job.inputFilename, job.isInputTenBit);
+        if (!inputSample.isInputSampleValid()) {
+            qDebug() << "BatchQueue::runJob(): Could not open" << job.inputFilename;
+            return false;
+        }
+        endTime = QTime(0, 0, 0).addSecs(static_cast<qint32>(inputSample.getNumberOfSamples() / 40000000));
+    }
+
+    qDebug() << "BatchQueue::runJob(): Processing" << job.inputFilename << "from" << startTime << "to" << endTime;
+
+    bool isSuccessful;
+    if (job.type == BatchJob::JobType::verify) {
+        AnalyseTestData analyseTestData;
+        isSuccessful = analyseTestData.analyseFile(job.inputFilename, startTime, endTime, job.isInputTenBit);
+        job.bytesProcessed = samplesToBytes(analyseTestData.getNumberOfSamplesProcessed(), job.isInputTenBit);
+    } else {
+        FileConverter fileConverter;
+        isSuccessful = fileConverter.convertFile(job.inputFilename, job.outputFilename, startTime, endTime,
+                                                 job.isInputTenBit, job.isOutputTenBit);
+        job.bytesProcessed = samplesToBytes(fileConverter.getNumberOfSamplesProcessed(), job.isInputTenBit);
+    }
+
+    return isSuccessful;
+}
+
+// This function takes a number of samples and returns the number of
+// bytes they occupy in the input file
+qint64 BatchQueue::samplesToBytes(qint64 numberOfSamples, bool isTenBit)
+{
+    // Every 4 10-bit samples requires 5 bytes, 16-bit samples require 2 bytes
+    if (isTenBit) return (numberOfSamples / 4) * 5;
+    return numberOfSamples * 2;
+}
+
+// This function takes a number of samples and returns the
+// capture time they represent as hh:mm:ss
+QString BatchQueue::samplesToTime(qint64 numberOfSamples)
+{
+    return QTime(0, 0, 0).addSecs(static_cast<qint32>(numberOfSamples / 40000000)).toString("hh:mm:ss");
+}
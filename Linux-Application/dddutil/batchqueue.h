@@ -0,0 +1,119 @@
+/************************************************************************
+
+    batchqueue.h
+
+    Utilities for Domesday Duplicator
+    DomesdayDuplicator - LaserDisc RF sampler
+    Copyright (C) 2019 Simon Inns
+
+    This file is part of Domesday Duplicator.
+
+    Domesday Duplicator is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+
+#ifndef BATCHQUEUE_H
+#define BATCHQUEUE_H
+
+#include <QObject>
+#include <QThreadPool>
+#include <QMutex>
+#include <QVector>
+#include <QString>
+#include <QStringList>
+#include <QTime>
+#include <QElapsedTimer>
+#include <QDebug>
+#include <QtConcurrent/QtConcurrent>
+
+// A conversion (or trim), test data verification, waveform overview or checksum verification in a batch
+struct BatchJob {
+    enum JobType {
+        convert,
+        verify,
+        overview,
+        checksum
+    };
+
+    enum JobState {
+        queued,
+        running,
+        succeeded,
+        failed
+    };
+
+    JobType type;
+    QString inputFilename;
+    QString outputFilename;     // Conversions only
+    bool isInputTenBit;
+    bool isOutputTenBit;        // Conversions only
+    QTime startTime;            // Null to start at the beginning of the input file
+    QTime endTime;              // Null to end at the end of the input file
+
+    JobState state;
+    qint64 bytesProcessed;      // Input sample data processed
+    qint64 elapsedTime;         // Time the job took (in milliseconds)
+    QString result;             // Overviews and checksums only - the signal regions or mismatches found
+};
+
+// Runs a queue of conversion, verification, overview and checksum jobs across a number of worker threads
+class BatchQueue : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit BatchQueue(QObject *parent = nullptr);
+    ~BatchQueue() override;
+
+    void setNumberOfWorkers(qint32 numberOfWorkers);
+    qint32 getNumberOfWorkers(void);
+    qint32 addConversion(QString inputFilename, QString outputFilename, bool isInputTenBit, bool isOutputTenBit,
+                         QTime startTime = QTime(), QTime endTime = QTime());
+    qint32 addVerification(QString inputFilename, bool isInputTenBit,
+                           QTime startTime = QTime(), QTime endTime = QTime());
+    qint32 addOverview(QString inputFilename, bool isInputTenBit);
+    qint32 addChecksumVerification(QString inputFilename, bool isInputTenBit);
+
+    void start(void);
+    void cancel(void);
+    bool isRunning(void);
+    qint32 getNumberOfJobs(void);
+    BatchJob getJob(qint32 jobNumber);
+    QString getJobReport(qint32 jobNumber);
+    QString getReport(void);
+
+signals:
+    void jobComplete(qint32 jobNumber, bool isSuccessful);
+    void batchComplete(bool isSuccessful);
+
+private:
+    QThreadPool workerThreadPool;
+    QMutex mutex;
+    QVector<BatchJob> jobs;
+    qint32 nextJobNumber;
+    qint32 numberOfWorkersRunning;
+    bool isCancelled;
+    QElapsedTimer batchTimer;
+    qint64 batchElapsedTime;
+
+    void runWorker(void);
+    bool runJob(BatchJob &job);
+    qint64 samplesToBytes(qint64 numberOfSamples, bool isTenBit);
+    QString samplesToTime(qint64 numberOfSamples);
+};
+
+#endif // BATCHQUEUE_H
@@ -0,0 +1,224 @@
+/************************************************************************
+
+    checksumverifier.cpp
+
+    Utilities for Domesday Duplicator
+    DomesdayDuplicator - LaserDisc RF sampler
+    Copyright (C) 2019 Simon Inns
+
+    This file is part of Domesday Duplicator.
+
+    Domesday Duplicator is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+
+#include "checksumverifier.h"
+
+ChecksumVerifier::ChecksumVerifier(QObject *parent) : QObject(parent)
+{
+    totalLength = -1;
+    verifyEntries = nullptr;
+    nextEntry = 0;
+    bytesVerified = 0;
+    lastError = tr("None");
+}
+
+// Verify a capture file against its manifest.  Returns true if every block matches
+// and the file is the length recorded in the manifest
+bool ChecksumVerifier::verifyFile(QString captureFilename)
+{
+    this->captureFilename = captureFilename;
+    mismatches.clear();
+    bytesVerified = 0;
+
+    if (!QFileInfo::exists(captureFilename)) {
+        qDebug() << "ChecksumVerifier::verifyFile(): Could not find" << captureFilename;
+        lastError = tr("Could not find %1").arg(captureFilename);
+        return false;
+    }
+    if (!loadManifest(manifestFilename(captureFilename))) return false;
+
+    qDebug() << "ChecksumVerifier::verifyFile(): Verifying" << entries.size() << "blocks of" << captureFilename <<
+                "(checksums are" << (Crc32c::isHardwareAccelerated() ? "hardware accelerated)" : "calculated in software)");
+
+    // Check the blocks in parallel
+    verifyEntries = entries.data();
+    nextEntry = 0;
+    QVector<QFuture<void>> verifyFutures;
+    for (qint32 task = 0; task < qMax(1, QThread::idealThreadCount()); task++) {
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+        verifyFutures.append(QtConcurrent::run(this, &ChecksumVerifier::runVerify));
+#else
+        verifyFutures.append(QtConcurrent::run(&ChecksumVerifier::runVerify, this));
+#endif
+    }
+
+    // Report the progress until the verification is complete
+    qint64 manifestLength = entries.isEmpty() ? 0 : entries.last().offset + entries.last().length;
+    for (qint32 task = 0; task < verifyFutures.size(); task++) {
+        while (!verifyFutures[task].isFinished()) {
+            if (manifestLength > 0) emit verifyProgress(static_cast<qint32>((bytesVerified * 100) / manifestLength));
+            QThread::msleep(100);
+        }
+    }
+    emit verifyProgress(100);
+    verifyEntries = nullptr;
+
+    // Collect the mismatching blocks (adjacent blocks are reported as one range)
+    for (qint32 entry = 0; entry < entries.size(); entry++) {
+        if (!entries[entry].isMatch) addMismatch(entries[entry].offset, entries[entry].length);
+    }
+
+    // Any data beyond the end of the manifest doesn't match either
+    qint64 captureLength = QFileInfo(captureFilename).size();
+    if (totalLength >= 0 && captureLength > totalLength) addMismatch(totalLength, captureLength - totalLength);
+
+    if (!mismatches.isEmpty()) {
+        qDebug() << "ChecksumVerifier::verifyFile():" << mismatches.size() << "ranges of" << captureFilename << "do not match";
+        lastError = tr("%1 ranges do not match the manifest").arg(mismatches.size());
+        return false;
+    }
+
+    // A manifest without a total is from a capture that didn't close the file
+    if (totalLength < 0) {
+        qDebug() << "ChecksumVerifier::verifyFile(): The manifest for" << captureFilename << "is incomplete";
+        lastError = tr("The manifest is incomplete (the capture was not closed)");
+        return false;
+    }
+
+    qDebug() << "ChecksumVerifier::verifyFile():" << captureFilename << "matches its manifest";
+    return true;
+}
+
+// Return the manifest file name for a capture file (the capture name with a .manifest suffix)
+QString ChecksumVerifier::manifestFilename(QString captureFilename)
+{
+    QFileInfo captureFileInfo(captureFilename);
+    return captureFileInfo.path() + "/" + captureFileInfo.completeBaseName() + ".manifest";
+}
+
+// Get the number of blocks in the manifest
+qint32 ChecksumVerifier::getNumberOfBlocks(void)
+{
+    return entries.size();
+}
+
+// Get the number of bytes of the capture file that have been checked
+qint64 ChecksumVerifier::getBytesVerified(void)
+{
+    return bytesVerified;
+}
+
+// Get the ranges of the capture file that don't match the manifest
+QVector<ChecksumMismatch> ChecksumVerifier::getMismatches(void)
+{
+    return mismatches;
+}
+
+// Get the last error
+QString ChecksumVerifier::getLastError(void)
+{
+    return lastError;
+}
+
+// Read the manifest (lines of <offset>,<length>,<crc32c> followed by total,<length>)
+bool ChecksumVerifier::loadManifest(QString filename)
+{
+    entries.clear();
+    totalLength = -1;
+
+    QFile manifestFile(filename);
+    if (!manifestFile.open(QFile::ReadOnly | QFile::Text)) {
+        qDebug() << "ChecksumVerifier::loadManifest(): Could not open" << filename;
+        lastError = tr("Could not open the manifest %1").arg(filename);
+        return false;
+    }
+
+    QTextStream manifestStream(&manifestFile);
+    qint32 lineNumber = 0;
+    while (!manifestStream.atEnd()) {
+        QString line = manifestStream.readLine().trimmed();
+        lineNumber++;
+        if (line.isEmpty() || line.startsWith("#")) continue;
+
+        QStringList fields = line.split(",");
+        bool isValid = false;
+        if (fields.size() == 2 && fields[0] == "total") {
+            totalLength = fields[1].toLongLong(&isValid);
+        } else if (fields.size() == 3) {
+            ManifestEntry entry;
+            bool isOffsetValid, isLengthValid, isChecksumValid;
+            entry.offset = fields[0].toLongLong(&isOffsetValid);
+            entry.length = fields[1].toLongLong(&isLengthValid);
+            entry.checksum = fields[2].toUInt(&isChecksumValid, 16);
+            entry.isMatch = false;
+            isValid = isOffsetValid && isLengthValid && isChecksumValid && entry.offset >= 0 && entry.length > 0;
+            if (isValid) entries.append(entry);
+        }
+
+        if (!isValid) {
+            qDebug() << "ChecksumVerifier::loadManifest(): Invalid line" << lineNumber << "in" << filename;
+            lastError = tr("Line %1 of the manifest %2 is invalid").arg(lineNumber).arg(filename);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Verification task - checks blocks until none are left
+void ChecksumVerifier::runVerify(void)
+{
+    // Each task reads through its own file handle
+    QFile captureFile(captureFilename);
+    bool isOpen = captureFile.open(QFile::ReadOnly | QFile::Unbuffered);
+    QByteArray blockData;
+
+    while (true) {
+        qint32 entry = nextEntry++;
+        if (entry >= entries.size()) break;
+
+        ManifestEntry &manifestEntry = verifyEntries[entry];
+        if (blockData.size() < manifestEntry.length) blockData.resize(static_cast<qint32>(manifestEntry.length));
+
+        // A block that can't be read in full (for example, the file is truncated) doesn't match
+        if (isOpen && captureFile.seek(manifestEntry.offset) &&
+                captureFile.read(blockData.data(), manifestEntry.length) == manifestEntry.length) {
+            quint32 checksum = Crc32c::update(0, reinterpret_cast<const unsigned char *>(blockData.constData()),
+                                              manifestEntry.length);
+            manifestEntry.isMatch = (checksum == manifestEntry.checksum);
+        } else {
+            manifestEntry.isMatch = false;
+        }
+
+        bytesVerified += manifestEntry.length;
+    }
+}
+
+// Record a mismatching range (extending the previous range if they are adjacent)
+void ChecksumVerifier::addMismatch(qint64 offset, qint64 length)
+{
+    if (!mismatches.isEmpty() && mismatches.last().offset + mismatches.last().length == offset) {
+        mismatches.last().length += length;
+        return;
+    }
+
+    ChecksumMismatch mismatch;
+    mismatch.offset = offset;
+    mismatch.length = length;
+    mismatches.append(mismatch);
+}
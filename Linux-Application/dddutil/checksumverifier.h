@@ -0,0 +1,96 @@
+/************************************************************************
+
+    checksumverifier.h
+
+    Utilities for Domesday Duplicator
+    DomesdayDuplicator - LaserDisc RF sampler
+    Copyright (C) 2019 Simon Inns
+
+    This file is part of Domesday Duplicator.
+
+    Domesday Duplicator is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+
+#ifndef CHECKSUMVERIFIER_H
+#define CHECKSUMVERIFIER_H
+
+#include <QObject>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QVector>
+#include <QThread>
+#include <QDebug>
+#include <QtConcurrent/QtConcurrent>
+
+#include <atomic>
+
+#include "crc32c.h"
+
+// A range of a capture file that doesn't match its manifest
+struct ChecksumMismatch {
+    qint64 offset;
+    qint64 length;
+};
+
+// Verifies a capture file against the checksum manifest written by the capture
+// application (<capture name>.manifest).  Each block in the manifest is re-read and
+// checksummed (CRC-32C), with the blocks spread across the global thread pool.
+class ChecksumVerifier : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ChecksumVerifier(QObject *parent = nullptr);
+
+    bool verifyFile(QString captureFilename);
+    static QString manifestFilename(QString captureFilename);
+
+    qint32 getNumberOfBlocks(void);
+    qint64 getBytesVerified(void);
+    QVector<ChecksumMismatch> getMismatches(void);
+    QString getLastError(void);
+
+signals:
+    void verifyProgress(qint32 percentage);
+
+private:
+    struct ManifestEntry {
+        qint64 offset;
+        qint64 length;
+        quint32 checksum;
+        bool isMatch;
+    };
+
+    QString captureFilename;
+    QVector<ManifestEntry> entries;
+    qint64 totalLength;
+    QVector<ChecksumMismatch> mismatches;
+    QString lastError;
+
+    // Parallel verification state
+    ManifestEntry *verifyEntries;
+    std::atomic<qint32> nextEntry;
+    std::atomic<qint64> bytesVerified;
+
+    bool loadManifest(QString filename);
+    void runVerify(void);
+    void addMismatch(qint64 offset, qint64 length);
+};
+
+#endif // CHECKSUMVERIFIER_H
@@ -22,6 +22,9 @@ DEFINES += QT_DEPRECATED_WARNINGS
 
 CONFIG += c++11
 
+# The checksums are calculated by the capture application's CRC-32C implementation
+INCLUDEPATH += "$$PWD/../DomesdayDuplicator"
+
 SOURCES += \
         main.cpp \
         mainwindow.cpp \
@@ -30,7 +33,11 @@ SOURCES += \
     progressdialog.cpp \
     sampledetails.cpp \
     analysetestdata.cpp \
-    inputsample.cpp
+    inputsample.cpp \
+    batchqueue.cpp \
+    waveformcache.cpp \
+    ../DomesdayDuplicator/crc32c.cpp \
+    checksumverifier.cpp
 
 HEADERS += \
         mainwindow.h \
@@ -39,7 +46,11 @@ HEADERS += \
     progressdialog.h \
     sampledetails.h \
     analysetestdata.h \
-    inputsample.h
+    inputsample.h \
+    batchqueue.h \
+    waveformcache.h \
+    ../DomesdayDuplicator/crc32c.h \
+    checksumverifier.h
 
 FORMS += \
         mainwindow.ui \
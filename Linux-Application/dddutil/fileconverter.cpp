@@ -27,12 +27,71 @@
 
 #include "fileconverter.h"
 
+// Conversion pipeline buffers - each holds PIPELINEBUFFERSAMPLES samples (a multiple of 4 so
+// that 10-bit packing is never split between buffers).  PIPELINEBUFFERS allows one buffer to
+// be read, one converted and one written with one spare
+#define PIPELINEBUFFERSAMPLES (8 * 1024 * 1024)
+#define PIPELINEBUFFERS 4
+
+// Convert samples from the input file format to the output file format.  Each group of 4
+// samples is unpacked to 10-bit values and then packed into the output format
+static void convertSamples(const char *input, char *output, qint32 numberOfSamples, bool isInputTenBit, bool isOutputTenBit)
+{
+    const quint8 *inputBytes = reinterpret_cast<const quint8 *>(input);
+    quint8 *outputBytes = reinterpret_cast<quint8 *>(output);
+    quint16 word[4];
+
+    for (qint32 samplePointer = 0; samplePointer < numberOfSamples; samplePointer += 4) {
+        qint32 groupSize = qMin(4, numberOfSamples - samplePointer);
+
+        // 10-bit output is only written in whole groups of 4 samples
+        if (groupSize < 4 && isOutputTenBit) break;
+
+        // Unpack the input samples (see InputSample::read())
+        if (isInputTenBit) {
+            const quint8 *packed = inputBytes + ((samplePointer / 4) * 5);
+            word[0] = static_cast<quint16>((packed[0] * 4) + ((packed[1] & 0xC0) >> 6));
+            word[1] = static_cast<quint16>(((packed[1] & 0x3F) * 16) + ((packed[2] & 0xF0) >> 4));
+            word[2] = static_cast<quint16>(((packed[2] & 0x0F) * 64) + ((packed[3] & 0xFC) >> 2));
+            word[3] = static_cast<quint16>(((packed[3] & 0x03) * 256) + packed[4]);
+        } else {
+            for (qint32 i = 0; i < groupSize; i++) {
+                const quint8 *sample = inputBytes + ((samplePointer + i) * 2);
+                qint16 signedSample = static_cast<qint16>(sample[0] | (sample[1] << 8));
+                word[i] = static_cast<quint16>((signedSample >> 6) + 512);
+            }
+        }
+
+        // Pack the output samples
+        if (isOutputTenBit) {
+            quint8 *packed = outputBytes + ((samplePointer / 4) * 5);
+            packed[0] = static_cast<quint8>((word[0] & 0x03FC) >> 2);
+            packed[1] = static_cast<quint8>(((word[0] & 0x0003) << 6) + ((word[1] & 0x03F0) >> 4));
+            packed[2] = static_cast<quint8>(((word[1] & 0x000F) << 4) + ((word[2] & 0x03C0) >> 6));
+            packed[3] = static_cast<quint8>(((word[2] & 0x003F) << 2) + ((word[3] & 0x0300) >> 8));
+            packed[4] = static_cast<quint8>(word[3] & 0x00FF);
+        } else {
+            for (qint32 i = 0; i < groupSize; i++) {
+                // -512 from 10-bit data to move centre-point to 0 and then *64 to scale to 16-bit
+                quint16 scaledSample = static_cast<quint16>((word[i] - 512) * 64);
+                outputBytes[(samplePointer + i) * 2] = static_cast<quint8>(scaledSample & 0x00FF);
+                outputBytes[((samplePointer + i) * 2) + 1] = static_cast<quint8>(scaledSample >> 8);
+            }
+        }
+    }
+}
+
 FileConverter::FileConverter(QObject *parent) : QThread(parent)
 {
     // Thread control variables
     restart = false; // Setting this to true starts a conversion
     cancel = false; // Setting this to true cancels the conversion in progress
     abort = false; // Setting this to true ends the thread process
+
+    // The reader and writer stages each run on their own thread
+    pipelineThreadPool.setMaxThreadCount(2);
+    numberOfSampleProcessedTs = 0;
+    isWriteFailedTs = false;
 }
 
 FileConverter::~FileConverter()
@@ -81,43 +140,8 @@ void FileConverter::run()
     qDebug() << "FileConverter::run(): Thread running";
 
     while(!abort) {
-        // Lock and copy all parameters to 'thread-safe' variables
-        mutex.lock();
-        inputFilenameTs = this->inputFilename;
-        outputFilenameTs = this->outputFilename;
-        isInputTenBitTs = this->isInputTenBit;
-        isOutputTenBitTs = this->isOutputTenBit;
-        startTimeTs = this->startTime;
-        endTimeTs = this->endTime;
-        mutex.unlock();
-
-        // Start the sample conversion
-        if (convertSampleStart()) {
-            // Process the conversion until completed
-            bool notComplete = true;
-            qreal percentageCompleteReal = 0;
-            qint32 percentageComplete = 0;
-
-            while (notComplete && !cancel) {
-                notComplete = convertSampleProcess();
-
-                // Calculate the completion percentage
-                percentageCompleteReal = (100 / static_cast<qreal>(samplesToConvertTs)) * static_cast<qreal>(numberOfSampleProcessedTs);
-                percentageComplete = static_cast<qint32>(percentageCompleteReal);
-                qDebug() << "FileConverter::run(): Processed" << numberOfSampleProcessedTs << "of" <<
-                            samplesToConvertTs << "(" << percentageComplete << "%)";
-
-                // Emit a signal showing the progress
-                emit percentageProcessed(percentageComplete);
-            }
-
-            // Stop the sample conversion
-            convertSampleStop();
-
-            // Reset the cancel flag
-            if (cancel) qDebug() << "FileConverter::run(): Conversion cancelled";
-            cancel = false;
-        }
+        // Perform the conversion
+        processConversion();
 
         // Emit a signal showing the conversion is complete
         emit completed();
@@ -131,6 +155,70 @@ void FileConverter::run()
     qDebug() << "FileConverter::run(): Thread aborted";
 }
 
+// Convert input file to output file on the calling thread (rather than the converter's
+// own thread).  Returns true if all of the samples were converted
+bool FileConverter::convertFile(QString inputFilename, QString outputFilename,
+                                QTime startTime, QTime endTime,
+                                bool isInputTenBit, bool isOutputTenBit)
+{
+    mutex.lock();
+    this->inputFilename = inputFilename;
+    this->outputFilename = outputFilename;
+    this->isInputTenBit = isInputTenBit;
+    this->isOutputTenBit = isOutputTenBit;
+    this->startTime = startTime;
+    this->endTime = endTime;
+    mutex.unlock();
+
+    return processConversion();
+}
+
+// Perform a conversion with the current parameters.  Returns true if the conversion
+// completed (wasn't cancelled and didn't fail)
+bool FileConverter::processConversion(void)
+{
+    // Lock and copy all parameters to 'thread-safe' variables
+    mutex.lock();
+    inputFilenameTs = this->inputFilename;
+    outputFilenameTs = this->outputFilename;
+    isInputTenBitTs = this->isInputTenBit;
+    isOutputTenBitTs = this->isOutputTenBit;
+    startTimeTs = this->startTime;
+    endTimeTs = this->endTime;
+    mutex.unlock();
+
+    // Start the sample conversion
+    if (!convertSampleStart()) return false;
+
+    // Process the conversion until completed
+    bool notComplete = true;
+    qreal percentageCompleteReal = 0;
+    qint32 percentageComplete = 0;
+
+    while (notComplete && !cancel) {
+        notComplete = convertSampleProcess();
+
+        // Calculate the completion percentage
+        percentageCompleteReal = (100 / static_cast<qreal>(samplesToConvertTs)) * static_cast<qreal>(numberOfSampleProcessedTs);
+        percentageComplete = static_cast<qint32>(percentageCompleteReal);
+        qDebug() << "FileConverter::processConversion(): Processed" << numberOfSampleProcessedTs.load() << "of" <<
+                    samplesToConvertTs << "(" << percentageComplete << "%)";
+
+        // Emit a signal showing the progress
+        emit percentageProcessed(percentageComplete);
+    }
+
+    // Stop the sample conversion
+    convertSampleStop();
+    bool isSuccessful = !cancel && !isWriteFailedTs;
+
+    // Reset the cancel flag
+    if (cancel) qDebug() << "FileConverter::processConversion(): Conversion cancelled";
+    cancel = false;
+
+    return isSuccessful;
+}
+
 // Function sets the cancel flag (which terminates the conversion if in progress)
 void FileConverter::cancelConversion()
 {
@@ -145,6 +233,12 @@ void FileConverter::quit()
     abort = true;
 }
 
+// Get the number of samples processed by the last (or current) conversion
+qint64 FileConverter::getNumberOfSamplesProcessed(void)
+{
+    return numberOfSampleProcessedTs;
+}
+
 // File conversion methods --------------------------------------------------------------------------------------------
 
 // Open the files and get ready to convert
@@ -167,7 +261,7 @@ bool FileConverter::convertSampleStart(void)
         qDebug() << "AnalyseTestData::analyseSampleStart(): Could not open input sample file!";
 
         // Destroy the input sample object
-        inputSample->deleteLater();
+        delete inputSample;
         return false;
     }
 
@@ -175,6 +269,9 @@ bool FileConverter::convertSampleStart(void)
     if (!openOutputSample(outputFilenameTs)) {
         // Opening output sample failed!
         qDebug() << "FileConverter::convertSampleStart(): Could not open output sample file!";
+
+        // Destroy the input sample object
+        delete inputSample;
         return false;
     }
 
@@ -203,39 +300,38 @@ bool FileConverter::convertSampleStart(void)
 
     // Move the sample position to the start sample
     if (startSampleTs != 0) inputSample->seek(startSampleTs);
+    inputSample->adviseSequentialRead();
+
+    // Start reading and writing
+    startPipeline();
 
     // Return success
     return true;
 }
 
-// Process a buffer of sample data
+// Convert the next buffer of sample data (the reader and writer threads read and write
+// the buffers either side of it)
 bool FileConverter::convertSampleProcess(void)
 {
-    // Define a sample buffer for the transfer of data
-    QVector<quint16> sampleBuffer;
-
-    // Read the input sample data
-    qint32 maximumBufferSize = 102400000;
-    if ((numberOfSampleProcessedTs + maximumBufferSize) >= samplesToConvertTs)
-        maximumBufferSize = static_cast<qint32>(samplesToConvertTs - numberOfSampleProcessedTs);
-
-    sampleBuffer = inputSample->read(maximumBufferSize);
-    numberOfSampleProcessedTs += sampleBuffer.size();
-
-    // Did we get data?
-    if (sampleBuffer.size() > 0) {
-        // Write the input sample data to the output sample
-        writeOutputSample(sampleBuffer, isOutputTenBitTs);
-    } else {
-        // No sample data left, return false
-        qDebug() << "FileConverter::convertSampleProcess(): No more data to convert";
+    // Get the next buffer read from the input sample
+    ConversionBuffer *buffer = readQueue.take();
+    if (buffer == nullptr) {
+        qDebug() << "FileConverter::convertSampleProcess(): Conversion pipeline stopped";
         return false;
     }
 
+    // Convert the buffer and pass it to the writer
+    bool isLast = buffer->isLast;
+    convertBuffer(buffer);
+    writeQueue.put(buffer);
+
     // Have we finished processing all the samples?
-    if (numberOfSampleProcessedTs >= samplesToConvertTs) {
-        qDebug() << "FileConverter::convertSampleProcess():" << numberOfSampleProcessedTs << "of"
-                 << samplesToConvertTs << "converted. Done.";
+    if (isLast) {
+        // Wait for the remaining buffers to be written
+        writerFuture.waitForFinished();
+        if (isWriteFailedTs) qDebug() << "FileConverter::convertSampleProcess(): Writing the output sample file failed!";
+        else qDebug() << "FileConverter::convertSampleProcess():" << numberOfSampleProcessedTs.load() << "of"
+                      << samplesToConvertTs << "converted. Done.";
         return false;
     }
 
@@ -246,13 +342,183 @@ bool FileConverter::convertSampleProcess(void)
 // Close the sample files and clean up
 void FileConverter::convertSampleStop(void)
 {
+    // Stop reading and writing
+    stopPipeline();
+
     // Destroy the input sample object
-    inputSample->deleteLater();
+    delete inputSample;
 
     // Close the output sample file
     closeOutputSample();
 }
 
+// Conversion pipeline methods ----------------------------------------------------------------------------------------
+
+// Allocate the pipeline buffers and start the reader and writer threads
+void FileConverter::startPipeline(void)
+{
+    bool isPassThrough = (inputSample->isTenBit() == isOutputTenBitTs);
+    qint64 inputBufferBytes = inputSample->isTenBit() ? samplesToTenBitBytes(PIPELINEBUFFERSAMPLES) : PIPELINEBUFFERSAMPLES * 2;
+
+    for (qint32 bufferNumber = 0; bufferNumber < PIPELINEBUFFERS; bufferNumber++) {
+        ConversionBuffer *buffer = new ConversionBuffer;
+        buffer->inputData.resize(static_cast<qint32>(inputBufferBytes));
+        if (!isPassThrough) buffer->outputData.resize(static_cast<qint32>(samplesToOutputBytes(PIPELINEBUFFERSAMPLES)));
+        buffer->numberOfSamples = 0;
+        buffer->isPassThrough = isPassThrough;
+        buffer->isLast = false;
+
+        conversionBuffers.append(buffer);
+        freeQueue.put(buffer);
+    }
+
+    isWriteFailedTs = false;
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+    readerFuture = QtConcurrent::run(&pipelineThreadPool, this, &FileConverter::runReader);
+    writerFuture = QtConcurrent::run(&pipelineThreadPool, this, &FileConverter::runWriter);
+#else
+    readerFuture = QtConcurrent::run(&pipelineThreadPool, &FileConverter::runReader, this);
+    writerFuture = QtConcurrent::run(&pipelineThreadPool, &FileConverter::runWriter, this);
+#endif
+}
+
+// Stop the reader and writer threads (if the conversion didn't complete) and free the pipeline buffers
+void FileConverter::stopPipeline(void)
+{
+    freeQueue.cancel();
+    readQueue.cancel();
+    writeQueue.cancel();
+    readerFuture.waitForFinished();
+    writerFuture.waitForFinished();
+
+    freeQueue.reset();
+    readQueue.reset();
+    writeQueue.reset();
+    qDeleteAll(conversionBuffers);
+    conversionBuffers.clear();
+}
+
+// Reader thread - fills free buffers from the input sample
+void FileConverter::runReader(void)
+{
+    qint64 numberOfSamplesRead = 0;
+    bool isLast = false;
+
+    while (!isLast) {
+        ConversionBuffer *buffer = freeQueue.take();
+        if (buffer == nullptr) break;
+
+        qint32 requestedSamples = PIPELINEBUFFERSAMPLES;
+        if ((samplesToConvertTs - numberOfSamplesRead) < requestedSamples)
+            requestedSamples = static_cast<qint32>(qMax(samplesToConvertTs - numberOfSamplesRead, static_cast<qint64>(0)));
+
+        buffer->numberOfSamples = 0;
+        if (requestedSamples > 0) buffer->numberOfSamples = inputSample->readRaw(buffer->inputData.data(), requestedSamples);
+        numberOfSamplesRead += buffer->numberOfSamples;
+
+        // Stop at the end sample (or the end of the file)
+        isLast = (buffer->numberOfSamples < requestedSamples) || (numberOfSamplesRead >= samplesToConvertTs);
+        buffer->isLast = isLast;
+        readQueue.put(buffer);
+    }
+
+    qDebug() << "FileConverter::runReader(): Read" << numberOfSamplesRead << "samples";
+}
+
+// Writer thread - writes converted buffers to the output sample and returns them to the reader
+void FileConverter::runWriter(void)
+{
+    bool isLast = false;
+
+    while (!isLast) {
+        ConversionBuffer *buffer = writeQueue.take();
+        if (buffer == nullptr) break;
+
+        const QByteArray &data = buffer->isPassThrough ? buffer->inputData : buffer->outputData;
+        qint64 numberOfBytes = samplesToOutputBytes(buffer->numberOfSamples);
+        if (numberOfBytes > 0 && outputSampleFileHandleTs->write(data.constData(), numberOfBytes) != numberOfBytes) {
+            qDebug() << "FileConverter::runWriter(): Writing to the output sample file failed!";
+
+            // Stop the rest of the pipeline
+            isWriteFailedTs = true;
+            freeQueue.cancel();
+            readQueue.cancel();
+            break;
+        }
+
+        numberOfSampleProcessedTs += buffer->numberOfSamples;
+        isLast = buffer->isLast;
+        freeQueue.put(buffer);
+    }
+}
+
+// Convert a buffer to the output format, split across the available CPUs
+void FileConverter::convertBuffer(ConversionBuffer *buffer)
+{
+    if (buffer->isPassThrough || buffer->numberOfSamples == 0) return;
+
+    // Split the buffer into slices of whole 4 sample groups
+    qint32 numberOfSlices = qMax(1, QThread::idealThreadCount());
+    qint32 samplesPerSlice = qMax(4, ((buffer->numberOfSamples / numberOfSlices) + 3) & ~3);
+    bool isInputTenBit = inputSample->isTenBit();
+
+    QVector<QFuture<void>> sliceFutures;
+    for (qint32 firstSample = 0; firstSample < buffer->numberOfSamples; firstSample += samplesPerSlice) {
+        qint32 sliceSamples = qMin(samplesPerSlice, buffer->numberOfSamples - firstSample);
+        const char *input = buffer->inputData.constData() +
+                (isInputTenBit ? samplesToTenBitBytes(firstSample) : static_cast<qint64>(firstSample) * 2);
+        char *output = buffer->outputData.data() + samplesToOutputBytes(firstSample);
+
+        sliceFutures.append(QtConcurrent::run(convertSamples, input, output, sliceSamples, isInputTenBit, isOutputTenBitTs));
+    }
+
+    for (qint32 slice = 0; slice < sliceFutures.size(); slice++) sliceFutures[slice].waitForFinished();
+}
+
+// Conversion queue methods -------------------------------------------------------------------------------------------
+
+ConversionQueue::ConversionQueue()
+{
+    isCancelled = false;
+}
+
+// Add a buffer to the queue
+void ConversionQueue::put(ConversionBuffer *buffer)
+{
+    QMutexLocker locker(&mutex);
+    queue.enqueue(buffer);
+    condition.wakeOne();
+}
+
+// Take the next buffer from the queue (waiting until one is available).  Returns nullptr
+// if the queue has been cancelled
+ConversionBuffer *ConversionQueue::take(void)
+{
+    QMutexLocker locker(&mutex);
+    while (queue.isEmpty() && !isCancelled) condition.wait(&mutex);
+    if (isCancelled) return nullptr;
+
+    return queue.dequeue();
+}
+
+// Cancel the queue (waking any thread waiting on it)
+void ConversionQueue::cancel(void)
+{
+    QMutexLocker locker(&mutex);
+    isCancelled = true;
+    condition.wakeAll();
+}
+
+// Empty the queue ready for the next conversion
+void ConversionQueue::reset(void)
+{
+    QMutexLocker locker(&mutex);
+    queue.clear();
+    isCancelled = false;
+}
+
+// Output sample methods ----------------------------------------------------------------------------------------------
+
 // Open the output RF sample
 // Returns 'true' on success
 bool FileConverter::openOutputSample(QString filename)
@@ -275,92 +541,13 @@ void FileConverter::closeOutputSample(void)
     if (outputSampleFileHandleTs != nullptr) {
         qDebug() << "FileConverter::closeOutputSample(): Closing output sample file";
         outputSampleFileHandleTs->close();
+        delete outputSampleFileHandleTs;
     }
 
     // Clear the file handle pointer
     outputSampleFileHandleTs = nullptr;
 }
 
-// Write the output sample data from a quint16 vector
-bool FileConverter::writeOutputSample(QVector<quint16> sampleBuffer, bool isTenBit)
-{
-    // Only set this to true if you want huge amounts of debug from this method.
-    bool fullDebug = false;
-
-    if (isTenBit) {
-        // Prepare the packed sample buffer (which stores the packed 10-bit data byte stream)
-        QVector<quint8> packedSampleBuffer;
-        packedSampleBuffer.resize(static_cast<qint32>(samplesToTenBitBytes(sampleBuffer.size())));
-        qint32 packedSampleBufferPointer = 0;
-        if (fullDebug) qDebug() << "FileConverter::writeOutputSample(): Writing " << sampleBuffer.size() <<
-                    "samples to 10-bit output sample file as" << packedSampleBuffer.size() << "bytes";
-
-        // Pack the data 4 samples at a time
-        //
-        // Unpacked:                 Packed:
-        // 0: xxxx xx00 0000 0000    0: 0000 0000 0011 1111
-        // 1: xxxx xx11 1111 1111    2: 1111 2222 2222 2233
-        // 2: xxxx xx22 2222 2222    4: 3333 3333
-        // 3: xxxx xx33 3333 3333
-
-        quint16 word0, word1, word2, word3;
-        for (qint32 samplePointer = 0; samplePointer < sampleBuffer.size(); samplePointer += 4) {
-
-            word0 = sampleBuffer[samplePointer];
-            word1 = sampleBuffer[samplePointer + 1];
-            word2 = sampleBuffer[samplePointer + 2];
-            word3 = sampleBuffer[samplePointer + 3];
-
-            packedSampleBuffer[packedSampleBufferPointer + 0]  = static_cast<quint8>((word0 & 0x03FC) >> 2);
-            packedSampleBuffer[packedSampleBufferPointer + 1]  = static_cast<quint8>(((word0 & 0x0003) << 6) + ((word1 & 0x03F0) >> 4));
-            packedSampleBuffer[packedSampleBufferPointer + 2]  = static_cast<quint8>(((word1 & 0x000F) << 4) + ((word2 & 0x03C0) >> 6));
-            packedSampleBuffer[packedSampleBufferPointer + 3]  = static_cast<quint8>(((word2 & 0x003F) << 2) + ((word3 & 0x0300) >> 8));
-            packedSampleBuffer[packedSampleBufferPointer + 4]  = static_cast<quint8>(word3 & 0x00FF);
-
-            // Increment the packed sample buffer pointer
-            packedSampleBufferPointer += 5;
-        }
-
-        // Write the packed data to the output sample file
-        qint64 writeResult = 0;
-        writeResult = outputSampleFileHandleTs->write(reinterpret_cast<char *>(packedSampleBuffer.data()),
-                                      packedSampleBuffer.size()
-                                      );
-
-        if (writeResult == -1) {
-            qDebug() << "FileConverter::writeOutputSample(): Writing to 10-bit output sample file failed!";
-            return false;
-        }
-    } else {
-        // Write output sample as 16-bit scaled data
-        QVector<qint16> scaledSampleData;
-        scaledSampleData.resize(sampleBuffer.size());
-        if (fullDebug) qDebug() << "FileConverter::writeOutputSample(): Writing " << sampleBuffer.size() <<
-                    "samples to 16-bit output sample file as" << scaledSampleData.size() * 2 << "bytes";
-
-
-        // Convert sample data
-        for (qint32 samplePointer = 0; samplePointer < sampleBuffer.size(); samplePointer++) {
-            // -512 from 10-bit data to move centre-point to 0 and then *64 to scale to 16-bit
-            scaledSampleData[samplePointer] = static_cast<qint16>((sampleBuffer[samplePointer] - 512) * 64);
-        }
-
-        // Write the scaled data to the output sample file
-        qint64 writeResult = 0;
-        writeResult = outputSampleFileHandleTs->write(reinterpret_cast<char *>(scaledSampleData.data()),
-                                      scaledSampleData.size() * static_cast<qint32>(sizeof(qint16))
-                                      );
-
-        if (writeResult == -1) {
-            qDebug() << "FileConverter::writeOutputSample(): Writing to 16-bit output sample file failed!";
-            return false;
-        }
-    }
-
-    // Return successfully
-    return true;
-}
-
 // This function takes a number of samples and returns the number
 // of bytes required to store the same number of samples as 10-bit
 // packed values
@@ -369,3 +556,11 @@ qint64 FileConverter::samplesToTenBitBytes(qint64 numberOfSamples)
     // Every 4 samples requires 5 bytes
     return (numberOfSamples / 4) * 5;
 }
+
+// This function takes a number of samples and returns the number
+// of bytes required to store them in the output format
+qint64 FileConverter::samplesToOutputBytes(qint64 numberOfSamples)
+{
+    if (isOutputTenBitTs) return samplesToTenBitBytes(numberOfSamples);
+    return numberOfSamples * 2;
+}
@@ -35,10 +35,45 @@
 #include <QString>
 #include <QTime>
 #include <QFile>
+#include <QQueue>
+#include <QVector>
+#include <QByteArray>
+#include <QThreadPool>
 #include <QDebug>
+#include <QtConcurrent/QtConcurrent>
+
+#include <atomic>
 
 #include "inputsample.h"
 
+// A reusable buffer passed between the stages of the conversion pipeline
+struct ConversionBuffer {
+    QByteArray inputData;       // Samples in the input file format
+    QByteArray outputData;      // Samples in the output file format
+    qint32 numberOfSamples;     // Number of samples held in the buffer
+    bool isPassThrough;         // True if the input data is written unchanged (the formats match)
+    bool isLast;                // True if this is the last buffer of the conversion
+};
+
+// A queue of conversion buffers between two stages of the pipeline (the queues are
+// bounded by the number of buffers in the pipeline)
+class ConversionQueue
+{
+public:
+    ConversionQueue();
+
+    void put(ConversionBuffer *buffer);
+    ConversionBuffer *take(void);
+    void cancel(void);
+    void reset(void);
+
+private:
+    QMutex mutex;
+    QWaitCondition condition;
+    QQueue<ConversionBuffer *> queue;
+    bool isCancelled;
+};
+
 class FileConverter : public QThread
 {
     Q_OBJECT
@@ -51,8 +86,13 @@ public:
                                       QTime startTime, QTime endTime,
                                       bool isInputTenBit, bool isOutputTenBit);
 
+    bool convertFile(QString inputFilename, QString outputFilename,
+                     QTime startTime, QTime endTime,
+                     bool isInputTenBit, bool isOutputTenBit);
+
     void cancelConversion();
     void quit();
+    qint64 getNumberOfSamplesProcessed(void);
 
 signals:
     void percentageProcessed(qint32);
@@ -86,20 +126,37 @@ private:
     bool isOutputTenBitTs;
     QTime startTimeTs;
     QTime endTimeTs;
-    qint64 numberOfSampleProcessedTs;
+    std::atomic<qint64> numberOfSampleProcessedTs;
 
     qint64 startSampleTs;
     qint64 endSampleTs;
     qint64 samplesToConvertTs;
 
+    bool processConversion(void);
     bool convertSampleStart(void);
     bool convertSampleProcess(void);
     void convertSampleStop(void);
 
-    bool writeOutputSample(QVector<quint16> sampleBuffer, bool isTenBit);
+    // Conversion pipeline (the input file is read, converted and written concurrently)
+    QVector<ConversionBuffer *> conversionBuffers;
+    ConversionQueue freeQueue;
+    ConversionQueue readQueue;
+    ConversionQueue writeQueue;
+    QThreadPool pipelineThreadPool;
+    QFuture<void> readerFuture;
+    QFuture<void> writerFuture;
+    std::atomic<bool> isWriteFailedTs;
+
+    void startPipeline(void);
+    void stopPipeline(void);
+    void runReader(void);
+    void runWriter(void);
+    void convertBuffer(ConversionBuffer *buffer);
+
     bool openOutputSample(QString filename);
     void closeOutputSample(void);
     qint64 samplesToTenBitBytes(qint64 numberOfSamples);
+    qint64 samplesToOutputBytes(qint64 numberOfSamples);
 };
 
 #endif // FILECONVERTER_H
@@ -27,6 +27,10 @@
 
 #include "inputsample.h"
 
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#endif
+
 InputSample::InputSample(QObject *parent, QString fileName, bool isTenBit) : QObject(parent)
 {
     // Set object as invalid
@@ -79,6 +83,7 @@ void InputSample::close(void)
     if (sampleFileHandle != nullptr) {
         qDebug() << "InputSample::close(): Closing input sample file";
         sampleFileHandle->close();
+        delete sampleFileHandle;
     }
 
     // Clear the file handle pointer
@@ -220,6 +225,32 @@ QVector<quint16> InputSample::read(qint32 maximumSamples)
     return sampleBuffer;
 }
 
+// Read the input sample data without unpacking it (in the file's own format).  Only whole
+// samples are read (a multiple of 4 for 10-bit data); returns the number of samples read
+qint32 InputSample::readRaw(char *data, qint32 maximumSamples)
+{
+    if (!sampleIsValid) {
+        // There is no valid input sample
+        qDebug() << "InputSample::readRaw(): Called, but there is no valid input sample file!";
+        return 0;
+    }
+
+    qint64 requestedBytes;
+    if (sampleIsTenBit) requestedBytes = samplesToTenBitBytes(maximumSamples);
+    else requestedBytes = samplesToSixteenBitBytes(maximumSamples);
+
+    // Read until the request is filled or the end of the file is reached
+    qint64 totalReceivedBytes = 0;
+    qint64 receivedBytes = 0;
+    do {
+        receivedBytes = sampleFileHandle->read(data + totalReceivedBytes, requestedBytes - totalReceivedBytes);
+        if (receivedBytes > 0) totalReceivedBytes += receivedBytes;
+    } while (receivedBytes > 0 && totalReceivedBytes < requestedBytes);
+
+    if (sampleIsTenBit) return static_cast<qint32>(tenBitBytesToSamples(totalReceivedBytes));
+    return static_cast<qint32>(sixteenBitBytesToSamples(totalReceivedBytes));
+}
+
 // Seek to a sample position in the input file
 void InputSample::seek(qint64 numberOfSamples)
 {
@@ -233,6 +264,17 @@ void InputSample::seek(qint64 numberOfSamples)
     else sampleFileHandle->seek(samplesToSixteenBitBytes(numberOfSamples));
 }
 
+// Tell the kernel the input file will be read sequentially (so it reads further ahead)
+void InputSample::adviseSequentialRead(void)
+{
+    if (!sampleIsValid) return;
+
+#ifdef Q_OS_LINUX
+    qint32 result = posix_fadvise(sampleFileHandle->handle(), 0, 0, POSIX_FADV_SEQUENTIAL);
+    if (result != 0) qDebug() << "InputSample::adviseSequentialRead(): posix_fadvise failed with error" << result;
+#endif
+}
+
 // Get and set methods ------------------------------------------------------------------------------------------------
 
 // Determine if input sample is valid
@@ -247,6 +289,12 @@ qint64 InputSample::getNumberOfSamples(void)
     return numberOfSamples;
 }
 
+// Determine if the input sample is 10-bit packed (rather than 16-bit)
+bool InputSample::isTenBit(void)
+{
+    return sampleIsTenBit;
+}
+
 // Conversion methods to make the rest of the code a little more readable ---------------------------------------------
 
 // This function takes a number of samples and returns the number
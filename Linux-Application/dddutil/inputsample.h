@@ -42,10 +42,13 @@ public:
     ~InputSample();
 
     QVector<quint16> read(qint32 maximumSamples);
+    qint32 readRaw(char *data, qint32 maximumSamples);
     void seek(qint64 numberOfSamples);
+    void adviseSequentialRead(void);
 
     bool isInputSampleValid(void);
     qint64 getNumberOfSamples(void);
+    bool isTenBit(void);
 
 signals:
 
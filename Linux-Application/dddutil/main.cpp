@@ -26,13 +26,193 @@
 ************************************************************************/
 
 #include "mainwindow.h"
+#include "batchqueue.h"
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QScopedPointer>
+#include <QDir>
+#include <QFileInfo>
+
+// Batch queue for the --batch mode (each job is reported as it completes)
+static BatchQueue *batchQueue = nullptr;
+
+// Batch mode debug message handler (debug output is only shown with --debug)
+static void batchOutputHandler(QtMsgType type, const QMessageLogContext &context, const QString &msg)
+{
+    Q_UNUSED(context);
+    if (type == QtDebugMsg) return;
+
+    fprintf(stderr, "%s\n", msg.toLocal8Bit().constData());
+    if (type == QtFatalMsg) abort();
+}
+
+// Report a batch job as it completes
+static void batchJobCompleteHandler(qint32 jobNumber, bool isSuccessful)
+{
+    Q_UNUSED(isSuccessful);
+    fprintf(stdout, "%s\n", batchQueue->getJobReport(jobNumber).toLocal8Bit().constData());
+    fflush(stdout);
+}
+
+// Queue the jobs for each capture in the directory and run them
+static int runBatch(QCoreApplication &application, QCommandLineParser &parser)
+{
+    QDir inputDirectory(parser.value("batch"));
+    if (!inputDirectory.exists()) {
+        fprintf(stderr, "The batch directory %s does not exist\n", parser.value("batch").toLocal8Bit().constData());
+        return 1;
+    }
+
+    // Get the output format (if converting)
+    bool isConvert = parser.isSet("convert");
+    bool isOutputTenBit = true;
+    if (isConvert) {
+        if (parser.value("convert") == "lds") isOutputTenBit = true;
+        else if (parser.value("convert") == "raw") isOutputTenBit = false;
+        else {
+            fprintf(stderr, "The conversion format must be lds (10-bit packed) or raw (16-bit signed)\n");
+            return 1;
+        }
+    }
+
+    bool isVerify = parser.isSet("verify");
+    bool isOverview = parser.isSet("overview");
+    bool isChecksum = parser.isSet("checksums");
+    if (!isConvert && !isVerify && !isOverview && !isChecksum) {
+        fprintf(stderr, "Nothing to do - specify --convert, --verify, --overview and/or --checksums\n");
+        return 1;
+    }
+
+    // Get the trim times (null for the whole capture)
+    QTime startTime;
+    QTime endTime;
+    if (parser.isSet("start")) startTime = QTime::fromString(parser.value("start"), "hh:mm:ss");
+    if (parser.isSet("end")) endTime = QTime::fromString(parser.value("end"), "hh:mm:ss");
+    if ((parser.isSet("start") && !startTime.isValid()) || (parser.isSet("end") && !endTime.isValid())) {
+        fprintf(stderr, "The start and end times must be given as hh:mm:ss\n");
+        return 1;
+    }
+    bool isTrim = !startTime.isNull() || !endTime.isNull();
+
+    QDir outputDirectory(parser.isSet("output") ? parser.value("output") : inputDirectory.path());
+    if (isConvert && !outputDirectory.exists()) {
+        fprintf(stderr, "The output directory %s does not exist\n", outputDirectory.path().toLocal8Bit().constData());
+        return 1;
+    }
+
+    BatchQueue queue;
+    batchQueue = &queue;
+    if (parser.isSet("workers")) queue.setNumberOfWorkers(parser.value("workers").toInt());
+
+    // Queue the jobs for every 10-bit (.lds) and 16-bit (.raw) capture in the directory
+    QStringList captures = inputDirectory.entryList(QStringList() << "*.lds" << "*.raw", QDir::Files, QDir::Name);
+    QStringList outputFilenames;
+    for (qint32 i = 0; i < captures.size(); i++) {
+        QString inputFilename = inputDirectory.filePath(captures[i]);
+        bool isInputTenBit = QFileInfo(inputFilename).suffix() == "lds";
+
+        if (isChecksum) queue.addChecksumVerification(inputFilename, isInputTenBit);
+        if (isOverview) queue.addOverview(inputFilename, isInputTenBit);
+        if (isVerify) queue.addVerification(inputFilename, isInputTenBit, startTime, endTime);
+
+        if (isConvert) {
+            // Converting to the same format is only useful to trim the capture
+            if (isInputTenBit == isOutputTenBit && !isTrim) continue;
+
+            QString outputFilename = outputDirectory.filePath(QFileInfo(inputFilename).completeBaseName() +
+                                                              (isInputTenBit == isOutputTenBit ? "_trimmed" : "") +
+                                                              (isOutputTenBit ? ".lds" : ".raw"));
+
+            // Never overwrite an existing file (it may be a capture that other jobs are reading)
+            // or the output of another conversion
+            QString absoluteOutputFilename = QFileInfo(outputFilename).absoluteFilePath();
+            if (QFileInfo::exists(outputFilename) || outputFilenames.contains(absoluteOutputFilename)) {
+                fprintf(stderr, "Not converting %s - %s would be overwritten\n", inputFilename.toLocal8Bit().constData(),
+                        outputFilename.toLocal8Bit().constData());
+                continue;
+            }
+            outputFilenames.append(absoluteOutputFilename);
+
+            queue.addConversion(inputFilename, outputFilename, isInputTenBit, isOutputTenBit, startTime, endTime);
+        }
+    }
+
+    fprintf(stdout, "Processing %d jobs for %d captures with %d workers\n",
+            queue.getNumberOfJobs(), captures.size(), queue.getNumberOfWorkers());
+    fflush(stdout);
+
+    QObject::connect(&queue, &BatchQueue::jobComplete, &application, batchJobCompleteHandler);
+    QObject::connect(&queue, &BatchQueue::batchComplete, &application, &QCoreApplication::quit);
+    queue.start();
+    application.exec();
+
+    fprintf(stdout, "%s\n", queue.getReport().toLocal8Bit().constData());
+    batchQueue = nullptr;
+
+    // Succeed only if every job succeeded
+    for (qint32 jobNumber = 0; jobNumber < queue.getNumberOfJobs(); jobNumber++) {
+        if (queue.getJob(jobNumber).state != BatchJob::JobState::succeeded) return 1;
+    }
+    return 0;
+}
 
 int main(int argc, char *argv[])
 {
-    QApplication a(argc, argv);
+    // Batch mode runs without a display
+    bool isBatchMode = false;
+    bool isDebugOn = false;
+    for (qint32 i = 1; i < argc; i++) {
+        if (QString(argv[i]) == "--batch") isBatchMode = true;
+        if (QString(argv[i]) == "--debug" || QString(argv[i]) == "-d") isDebugOn = true;
+    }
+    if (isBatchMode && !isDebugOn) qInstallMessageHandler(batchOutputHandler);
+
+    QScopedPointer<QCoreApplication> a(isBatchMode ? new QCoreApplication(argc, argv) : new QApplication(argc, argv));
+    QCoreApplication::setApplicationName("dddutil");
+
+    // Set up the command line parser
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "dddutil - Utilities for Domesday Duplicator\n"
+        "\n"
+        "(c)2018-2019 Simon Inns\n"
+        "GPLv3 Open-Source - github: https://github.com/simoninns/DomesdayDuplicator");
+    parser.addHelpOption();
+
+    parser.addOption(QCommandLineOption(QStringList() << "d" << "debug",
+                                        QCoreApplication::translate("main", "Show debug (batch mode)")));
+    parser.addOption(QCommandLineOption("batch",
+                                        QCoreApplication::translate("main", "Process every capture in <directory> and exit"),
+                                        QCoreApplication::translate("main", "directory")));
+    parser.addOption(QCommandLineOption("convert",
+                                        QCoreApplication::translate("main", "Convert each capture to <format> (lds or raw)"),
+                                        QCoreApplication::translate("main", "format")));
+    parser.addOption(QCommandLineOption("verify",
+                                        QCoreApplication::translate("main", "Verify the test data in each capture")));
+    parser.addOption(QCommandLineOption("overview",
+                                        QCoreApplication::translate("main", "Build or update the waveform overview of each capture")));
+    parser.addOption(QCommandLineOption("checksums",
+                                        QCoreApplication::translate("main", "Verify each capture against its checksum manifest")));
+    parser.addOption(QCommandLineOption("start",
+                                        QCoreApplication::translate("main", "Trim the conversions to start at <time> (hh:mm:ss)"),
+                                        QCoreApplication::translate("main", "time")));
+    parser.addOption(QCommandLineOption("end",
+                                        QCoreApplication::translate("main", "Trim the conversions to end at <time> (hh:mm:ss)"),
+                                        QCoreApplication::translate("main", "time")));
+    parser.addOption(QCommandLineOption("output",
+                                        QCoreApplication::translate("main", "Write the conversions to <directory>"),
+                                        QCoreApplication::translate("main", "directory")));
+    parser.addOption(QCommandLineOption("workers",
+                                        QCoreApplication::translate("main", "Process <number> captures at once"),
+                                        QCoreApplication::translate("main", "number")));
+
+    // Process the command line arguments given by the user
+    parser.process(*a);
+
+    if (parser.isSet("batch")) return runBatch(*a, parser);
+
     MainWindow w;
     w.show();
 
-    return a.exec();
+    return a->exec();
 }
@@ -0,0 +1,481 @@
+/************************************************************************
+
+    waveformcache.cpp
+
+    Utilities for Domesday Duplicator
+    DomesdayDuplicator - LaserDisc RF sampler
+    Copyright (C) 2019 Simon Inns
+
+    This file is part of Domesday Duplicator.
+
+    Domesday Duplicator is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+
+#include "waveformcache.h"
+
+#include <cmath>
+
+// Samples summarised by each level 0 block (a multiple of 4 so that 10-bit blocks are whole bytes)
+#define WAVEFORMBLOCKSIZE 65536
+
+// Number of blocks each scan task takes at a time
+#define WAVEFORMSEGMENTBLOCKS 64
+
+// Cache file identification ("DDWC")
+#define WAVEFORMCACHEMAGIC 0x44445743
+#define WAVEFORMCACHEVERSION 1
+
+// Running summary of a number of blocks
+struct WaveformAccumulator {
+    quint16 minimum;
+    quint16 maximum;
+    double sumSquares;
+    qint64 numberOfSamples;
+};
+
+// Summarise a level 0 block of samples
+static WaveformSummary summariseBlock(const uchar *data, bool isTenBit)
+{
+    quint16 minimum = 1023;
+    quint16 maximum = 0;
+    qint64 sumSquares = 0;
+    quint16 word[4];
+
+    for (qint32 samplePointer = 0; samplePointer < WAVEFORMBLOCKSIZE; samplePointer += 4) {
+        // Unpack 4 samples (see InputSample::read())
+        if (isTenBit) {
+            const uchar *packed = data + ((samplePointer / 4) * 5);
+            word[0] = static_cast<quint16>((packed[0] * 4) + ((packed[1] & 0xC0) >> 6));
+            word[1] = static_cast<quint16>(((packed[1] & 0x3F) * 16) + ((packed[2] & 0xF0) >> 4));
+            word[2] = static_cast<quint16>(((packed[2] & 0x0F) * 64) + ((packed[3] & 0xFC) >> 2));
+            word[3] = static_cast<quint16>(((packed[3] & 0x03) * 256) + packed[4]);
+        } else {
+            for (qint32 i = 0; i < 4; i++) {
+                const uchar *sample = data + ((samplePointer + i) * 2);
+                qint16 signedSample = static_cast<qint16>(sample[0] | (sample[1] << 8));
+                word[i] = static_cast<quint16>((signedSample >> 6) + 512);
+            }
+        }
+
+        for (qint32 i = 0; i < 4; i++) {
+            if (word[i] < minimum) minimum = word[i];
+            if (word[i] > maximum) maximum = word[i];
+            qint64 level = static_cast<qint64>(word[i]) - 512;
+            sumSquares += level * level;
+        }
+    }
+
+    WaveformSummary summary;
+    summary.minimum = minimum;
+    summary.maximum = maximum;
+    summary.rms = static_cast<float>(sqrt(static_cast<double>(sumSquares) / WAVEFORMBLOCKSIZE));
+    return summary;
+}
+
+// Add a summary covering numberOfSamples samples to an accumulator
+static void accumulateSummary(WaveformAccumulator &accumulator, const WaveformSummary &summary, qint64 numberOfSamples)
+{
+    if (summary.minimum < accumulator.minimum) accumulator.minimum = summary.minimum;
+    if (summary.maximum > accumulator.maximum) accumulator.maximum = summary.maximum;
+    accumulator.sumSquares += static_cast<double>(summary.rms) * static_cast<double>(summary.rms) * static_cast<double>(numberOfSamples);
+    accumulator.numberOfSamples += numberOfSamples;
+}
+
+WaveformCache::WaveformCache(QObject *parent) : QObject(parent)
+{
+    isTenBit = true;
+    captureSize = 0;
+    captureModified = 0;
+    numberOfSamplesScanned = 0;
+    mappedData = nullptr;
+    scanResults = nullptr;
+    firstScanBlock = 0;
+    numberOfScanBlocks = 0;
+    nextScanSegment = 0;
+    numberOfBlocksScanned = 0;
+    lastError = tr("None");
+}
+
+// Open the overview of a capture - the cached overview is used if it is up to date, extended
+// if the capture has grown since it was cached and rebuilt otherwise.  Returns true on success
+bool WaveformCache::open(QString filename, bool isTenBit)
+{
+    this->filename = filename;
+    this->isTenBit = isTenBit;
+    levels.clear();
+    numberOfSamplesScanned = 0;
+
+    QFile captureFile(filename);
+    if (!captureFile.open(QIODevice::ReadOnly)) {
+        qDebug() << "WaveformCache::open(): Could not open" << filename;
+        lastError = tr("Could not open %1").arg(filename);
+        return false;
+    }
+
+    qint64 size = captureFile.size();
+    qint64 modified = QFileInfo(filename).lastModified().toMSecsSinceEpoch();
+    qint64 numberOfBlocks = bytesToSamples(size) / WAVEFORMBLOCKSIZE;
+
+    // Use as much of the cached overview as still matches the capture
+    qint64 firstBlock = 0;
+    if (loadCache()) {
+        qint64 numberOfCachedBlocks = levels[0].size();
+
+        if (size == captureSize && modified == captureModified) {
+            qDebug() << "WaveformCache::open(): The cached overview of" << filename << "is up to date";
+            buildLevels();
+            return true;
+        }
+
+        if (size > captureSize && numberOfCachedBlocks <= numberOfBlocks &&
+                getFingerprint(captureFile, numberOfCachedBlocks) == fingerprint) {
+            qDebug() << "WaveformCache::open(): Extending the cached overview of" << filename << "from block" << numberOfCachedBlocks;
+            firstBlock = numberOfCachedBlocks;
+        } else {
+            qDebug() << "WaveformCache::open(): The capture has changed - rebuilding the overview of" << filename;
+            levels.clear();
+        }
+    }
+    if (levels.isEmpty()) levels.append(QVector<WaveformSummary>());
+
+    // Scan the new blocks
+    if (!scanBlocks(captureFile, firstBlock, numberOfBlocks)) return false;
+
+    captureSize = size;
+    captureModified = modified;
+    fingerprint = getFingerprint(captureFile, numberOfBlocks);
+    buildLevels();
+
+    // A missing cache only costs time on the next open
+    if (!saveCache()) qDebug() << "WaveformCache::open(): Could not save the overview cache for" << filename;
+
+    return true;
+}
+
+// Get the name of the cache file for a capture
+QString WaveformCache::cacheFilename(QString filename)
+{
+    return filename + ".overview";
+}
+
+// Get the number of samples covered by the overview (the samples of the final partial
+// block of a capture aren't summarised)
+qint64 WaveformCache::getNumberOfSamples(void)
+{
+    if (levels.isEmpty()) return 0;
+    return static_cast<qint64>(levels[0].size()) * WAVEFORMBLOCKSIZE;
+}
+
+// Get the number of samples that had to be scanned when the overview was opened
+qint64 WaveformCache::getNumberOfSamplesScanned(void)
+{
+    return numberOfSamplesScanned;
+}
+
+// Get the number of levels in the overview
+qint32 WaveformCache::getNumberOfLevels(void)
+{
+    return levels.size();
+}
+
+// Get the number of samples summarised by each entry of a level
+qint64 WaveformCache::getBlockSize(qint32 level)
+{
+    return static_cast<qint64>(WAVEFORMBLOCKSIZE) << level;
+}
+
+// Summarise a range of samples (rounded out to whole level 0 blocks)
+WaveformSummary WaveformCache::getSummary(qint64 startSample, qint64 endSample)
+{
+    WaveformAccumulator accumulator = { 1023, 0, 0.0, 0 };
+    if (levels.isEmpty()) return summariseEntries(0, 0, 0);
+
+    qint64 firstEntry = qMax(startSample / WAVEFORMBLOCKSIZE, static_cast<qint64>(0));
+    qint64 lastEntry = qMin((endSample + WAVEFORMBLOCKSIZE - 1) / WAVEFORMBLOCKSIZE, static_cast<qint64>(levels[0].size()));
+
+    // Work up the levels, taking the entries at each end that don't pair up at the level above
+    for (qint32 level = 0; firstEntry < lastEntry; level++) {
+        if (level == levels.size() - 1) {
+            WaveformSummary summary = summariseEntries(level, firstEntry, lastEntry);
+            accumulateSummary(accumulator, summary, qMin(getBlockSize(level) * (lastEntry - firstEntry),
+                                                         getNumberOfSamples() - getBlockSize(level) * firstEntry));
+            break;
+        }
+
+        if (firstEntry & 1) {
+            accumulateSummary(accumulator, levels[level][static_cast<qint32>(firstEntry)], getBlockSize(level));
+            firstEntry++;
+        }
+        if ((lastEntry & 1) && lastEntry > firstEntry) {
+            lastEntry--;
+            accumulateSummary(accumulator, levels[level][static_cast<qint32>(lastEntry)],
+                              qMin(getBlockSize(level), getNumberOfSamples() - getBlockSize(level) * lastEntry));
+        }
+
+        firstEntry /= 2;
+        lastEntry /= 2;
+    }
+
+    WaveformSummary summary;
+    summary.minimum = accumulator.minimum;
+    summary.maximum = accumulator.maximum;
+    summary.rms = (accumulator.numberOfSamples > 0) ?
+                static_cast<float>(sqrt(accumulator.sumSquares / static_cast<double>(accumulator.numberOfSamples))) : 0.0f;
+    if (accumulator.numberOfSamples == 0) summary.minimum = 0;
+    return summary;
+}
+
+// Get the overview of a range of samples divided into a number of columns (for display)
+QVector<WaveformSummary> WaveformCache::getOverview(qint64 startSample, qint64 endSample, qint32 numberOfColumns)
+{
+    QVector<WaveformSummary> overview;
+    for (qint32 column = 0; column < numberOfColumns; column++) {
+        qint64 columnStart = startSample + ((endSample - startSample) * column) / numberOfColumns;
+        qint64 columnEnd = startSample + ((endSample - startSample) * (column + 1)) / numberOfColumns;
+        overview.append(getSummary(columnStart, columnEnd));
+    }
+
+    return overview;
+}
+
+// Find the regions of the capture where the RMS is at least minimumRms for at least
+// minimumLength samples (for example, the RF from the disc rather than noise)
+QVector<WaveformRegion> WaveformCache::findSignalRegions(float minimumRms, qint64 minimumLength)
+{
+    QVector<WaveformRegion> regions;
+    if (levels.isEmpty()) return regions;
+
+    // Use the coarsest level that still resolves a quarter of the minimum length
+    qint32 level = 0;
+    while (level < levels.size() - 1 && getBlockSize(level + 1) <= minimumLength / 4) level++;
+
+    bool isInRegion = false;
+    WaveformRegion region = { 0, 0 };
+    for (qint32 entry = 0; entry <= levels[level].size(); entry++) {
+        bool isSignal = (entry < levels[level].size()) && (levels[level][entry].rms >= minimumRms);
+
+        if (isSignal && !isInRegion) {
+            region.startSample = getBlockSize(level) * entry;
+            isInRegion = true;
+        } else if (!isSignal && isInRegion) {
+            region.endSample = qMin(getBlockSize(level) * entry, getNumberOfSamples());
+            if (region.endSample - region.startSample >= minimumLength) regions.append(region);
+            isInRegion = false;
+        }
+    }
+
+    return regions;
+}
+
+// Get the last error
+QString WaveformCache::getLastError(void)
+{
+    return lastError;
+}
+
+// Load the level 0 blocks from the cache file.  Returns false if there is no usable cache
+bool WaveformCache::loadCache(void)
+{
+    QFile cacheFile(cacheFilename(filename));
+    if (!cacheFile.open(QIODevice::ReadOnly)) return false;
+
+    QDataStream stream(&cacheFile);
+    quint32 magic;
+    quint32 version;
+    bool isCacheTenBit;
+    qint64 blockSize;
+    qint64 numberOfBlocks;
+    stream >> magic >> version >> isCacheTenBit >> blockSize >> captureSize >> captureModified >> fingerprint >> numberOfBlocks;
+
+    if (stream.status() != QDataStream::Ok || magic != WAVEFORMCACHEMAGIC || version != WAVEFORMCACHEVERSION ||
+            isCacheTenBit != isTenBit || blockSize != WAVEFORMBLOCKSIZE || numberOfBlocks < 0) {
+        qDebug() << "WaveformCache::loadCache(): Ignoring the incompatible cache file" << cacheFilename(filename);
+        return false;
+    }
+
+    // The blocks are stored in the host's byte order
+    levels.clear();
+    levels.append(QVector<WaveformSummary>(static_cast<qint32>(numberOfBlocks)));
+    qint32 numberOfBytes = static_cast<qint32>(numberOfBlocks * static_cast<qint64>(sizeof(WaveformSummary)));
+    if (stream.readRawData(reinterpret_cast<char *>(levels[0].data()), numberOfBytes) != numberOfBytes) {
+        qDebug() << "WaveformCache::loadCache(): The cache file" << cacheFilename(filename) << "is truncated";
+        levels.clear();
+        return false;
+    }
+
+    return true;
+}
+
+// Save the level 0 blocks to the cache file (the other levels are rebuilt when it is loaded)
+bool WaveformCache::saveCache(void)
+{
+    QSaveFile cacheFile(cacheFilename(filename));
+    if (!cacheFile.open(QIODevice::WriteOnly)) return false;
+
+    QDataStream stream(&cacheFile);
+    stream << static_cast<quint32>(WAVEFORMCACHEMAGIC) << static_cast<quint32>(WAVEFORMCACHEVERSION) << isTenBit
+           << static_cast<qint64>(WAVEFORMBLOCKSIZE) << captureSize << captureModified << fingerprint
+           << static_cast<qint64>(levels[0].size());
+
+    qint32 numberOfBytes = levels[0].size() * static_cast<qint32>(sizeof(WaveformSummary));
+    if (stream.writeRawData(reinterpret_cast<const char *>(levels[0].constData()), numberOfBytes) != numberOfBytes) return false;
+
+    return cacheFile.commit();
+}
+
+// Scan level 0 blocks firstBlock to lastBlock - 1 of the capture.  The capture is memory
+// mapped and scanned in segments across the global thread pool
+bool WaveformCache::scanBlocks(QFile &captureFile, qint64 firstBlock, qint64 lastBlock)
+{
+    levels[0].resize(static_cast<qint32>(lastBlock));
+    if (lastBlock <= firstBlock) return true;
+
+    qint64 blockBytes = samplesToBytes(WAVEFORMBLOCKSIZE);
+    mappedData = captureFile.map(firstBlock * blockBytes, (lastBlock - firstBlock) * blockBytes);
+    if (mappedData == nullptr) {
+        qDebug() << "WaveformCache::scanBlocks(): Could not map" << filename;
+        lastError = tr("Could not map %1 into memory").arg(filename);
+        return false;
+    }
+
+    qDebug() << "WaveformCache::scanBlocks(): Scanning blocks" << firstBlock << "to" << lastBlock - 1;
+    scanResults = levels[0].data();
+    firstScanBlock = firstBlock;
+    numberOfScanBlocks = lastBlock - firstBlock;
+    nextScanSegment = 0;
+    numberOfBlocksScanned = 0;
+
+    QVector<QFuture<void>> scanFutures;
+    for (qint32 task = 0; task < qMax(1, QThread::idealThreadCount()); task++) {
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+        scanFutures.append(QtConcurrent::run(this, &WaveformCache::runScan));
+#else
+        scanFutures.append(QtConcurrent::run(&WaveformCache::runScan, this));
+#endif
+    }
+
+    // Report the progress until the scan is complete
+    for (qint32 task = 0; task < scanFutures.size(); task++) {
+        while (!scanFutures[task].isFinished()) {
+            emit buildProgress(static_cast<qint32>((numberOfBlocksScanned * 100) / numberOfScanBlocks));
+            QThread::msleep(100);
+        }
+    }
+    emit buildProgress(100);
+
+    captureFile.unmap(const_cast<uchar *>(mappedData));
+    mappedData = nullptr;
+    scanResults = nullptr;
+    numberOfSamplesScanned = numberOfScanBlocks * WAVEFORMBLOCKSIZE;
+
+    return true;
+}
+
+// Scan task - summarises segments of blocks until none are left
+void WaveformCache::runScan(void)
+{
+    qint64 blockBytes = samplesToBytes(WAVEFORMBLOCKSIZE);
+
+    while (true) {
+        qint64 firstBlock = nextScanSegment++ * WAVEFORMSEGMENTBLOCKS;
+        if (firstBlock >= numberOfScanBlocks) break;
+        qint64 lastBlock = qMin(firstBlock + WAVEFORMSEGMENTBLOCKS, numberOfScanBlocks);
+
+        for (qint64 block = firstBlock; block < lastBlock; block++) {
+            scanResults[firstScanBlock + block] = summariseBlock(mappedData + (block * blockBytes), isTenBit);
+        }
+        numberOfBlocksScanned += lastBlock - firstBlock;
+    }
+}
+
+// Build the levels above level 0 (each entry summarises a pair of entries from the level below)
+void WaveformCache::buildLevels(void)
+{
+    levels.resize(1);
+
+    while (levels.last().size() > 1) {
+        const QVector<WaveformSummary> &childLevel = levels.last();
+        QVector<WaveformSummary> parentLevel((childLevel.size() + 1) / 2);
+
+        for (qint32 entry = 0; entry < parentLevel.size(); entry++) {
+            const WaveformSummary &first = childLevel[entry * 2];
+            if ((entry * 2) + 1 >= childLevel.size()) {
+                parentLevel[entry] = first;
+                continue;
+            }
+
+            const WaveformSummary &second = childLevel[(entry * 2) + 1];
+            parentLevel[entry].minimum = qMin(first.minimum, second.minimum);
+            parentLevel[entry].maximum = qMax(first.maximum, second.maximum);
+            parentLevel[entry].rms = static_cast<float>(sqrt(((static_cast<double>(first.rms) * first.rms) +
+                                                             (static_cast<double>(second.rms) * second.rms)) / 2.0));
+        }
+
+        levels.append(parentLevel);
+    }
+}
+
+// Get the fingerprint of the cached part of a capture (a hash of its first and last blocks)
+QByteArray WaveformCache::getFingerprint(QFile &captureFile, qint64 numberOfBlocks)
+{
+    if (numberOfBlocks == 0) return QByteArray();
+
+    qint64 blockBytes = samplesToBytes(WAVEFORMBLOCKSIZE);
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    captureFile.seek(0);
+    hash.addData(captureFile.read(blockBytes));
+    captureFile.seek((numberOfBlocks - 1) * blockBytes);
+    hash.addData(captureFile.read(blockBytes));
+
+    return hash.result();
+}
+
+// Summarise entries firstEntry to lastEntry - 1 of a level
+WaveformSummary WaveformCache::summariseEntries(qint32 level, qint64 firstEntry, qint64 lastEntry)
+{
+    WaveformAccumulator accumulator = { 1023, 0, 0.0, 0 };
+    for (qint64 entry = firstEntry; entry < lastEntry; entry++) {
+        accumulateSummary(accumulator, levels[level][static_cast<qint32>(entry)], 1);
+    }
+
+    WaveformSummary summary;
+    summary.minimum = (accumulator.numberOfSamples > 0) ? accumulator.minimum : 0;
+    summary.maximum = accumulator.maximum;
+    summary.rms = (accumulator.numberOfSamples > 0) ?
+                static_cast<float>(sqrt(accumulator.sumSquares / static_cast<double>(accumulator.numberOfSamples))) : 0.0f;
+    return summary;
+}
+
+// Conversion methods -------------------------------------------------------------------------------------------------
+
+// This function takes a number of samples and returns the number
+// of bytes they occupy in the capture
+qint64 WaveformCache::samplesToBytes(qint64 numberOfSamples)
+{
+    // Every 4 10-bit samples requires 5 bytes, 16-bit samples require 2 bytes
+    if (isTenBit) return (numberOfSamples / 4) * 5;
+    return numberOfSamples * 2;
+}
+
+// This function takes a number of bytes and returns the number
+// of samples they hold
+qint64 WaveformCache::bytesToSamples(qint64 numberOfBytes)
+{
+    if (isTenBit) return (numberOfBytes / 5) * 4;
+    return numberOfBytes / 2;
+}
@@ -0,0 +1,115 @@
+/************************************************************************
+
+    waveformcache.h
+
+    Utilities for Domesday Duplicator
+    DomesdayDuplicator - LaserDisc RF sampler
+    Copyright (C) 2019 Simon Inns
+
+    This file is part of Domesday Duplicator.
+
+    Domesday Duplicator is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+
+#ifndef WAVEFORMCACHE_H
+#define WAVEFORMCACHE_H
+
+#include <QObject>
+#include <QFile>
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QDataStream>
+#include <QCryptographicHash>
+#include <QVector>
+#include <QThread>
+#include <QDebug>
+#include <QtConcurrent/QtConcurrent>
+
+#include <atomic>
+
+// Summary of the samples in a block (or range of blocks) of a capture
+struct WaveformSummary {
+    quint16 minimum;    // Lowest 10-bit sample value
+    quint16 maximum;    // Highest 10-bit sample value
+    float rms;          // RMS about mid-scale (code 512)
+};
+
+// A range of samples in a capture
+struct WaveformRegion {
+    qint64 startSample;
+    qint64 endSample;   // Exclusive
+};
+
+// Multi-resolution min/max/RMS overview of a capture.  Level 0 summarises blocks of
+// WAVEFORMBLOCKSIZE samples and each level above summarises pairs of blocks from the
+// level below.  The overview is kept in a cache file next to the capture; when the
+// capture grows only the new blocks are scanned, and if it changes otherwise the
+// overview is rebuilt.
+class WaveformCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit WaveformCache(QObject *parent = nullptr);
+
+    bool open(QString filename, bool isTenBit);
+    static QString cacheFilename(QString filename);
+
+    qint64 getNumberOfSamples(void);
+    qint64 getNumberOfSamplesScanned(void);
+    qint32 getNumberOfLevels(void);
+    qint64 getBlockSize(qint32 level);
+    WaveformSummary getSummary(qint64 startSample, qint64 endSample);
+    QVector<WaveformSummary> getOverview(qint64 startSample, qint64 endSample, qint32 numberOfColumns);
+    QVector<WaveformRegion> findSignalRegions(float minimumRms, qint64 minimumLength);
+    QString getLastError(void);
+
+signals:
+    void buildProgress(qint32 percentage);
+
+private:
+    QString filename;
+    bool isTenBit;
+    QVector<QVector<WaveformSummary>> levels;
+    qint64 captureSize;
+    qint64 captureModified;
+    QByteArray fingerprint;
+    qint64 numberOfSamplesScanned;
+    QString lastError;
+
+    // Parallel scan state
+    const uchar *mappedData;
+    WaveformSummary *scanResults;
+    qint64 firstScanBlock;
+    qint64 numberOfScanBlocks;
+    std::atomic<qint64> nextScanSegment;
+    std::atomic<qint64> numberOfBlocksScanned;
+
+    bool loadCache(void);
+    bool saveCache(void);
+    bool scanBlocks(QFile &captureFile, qint64 firstBlock, qint64 lastBlock);
+    void runScan(void);
+    void buildLevels(void);
+    QByteArray getFingerprint(QFile &captureFile, qint64 numberOfBlocks);
+    WaveformSummary summariseEntries(qint32 level, qint64 firstEntry, qint64 lastEntry);
+    qint64 samplesToBytes(qint64 numberOfSamples);
+    qint64 bytesToSamples(qint64 numberOfBytes);
+};
+
+#endif // WAVEFORMCACHE_H